@@ -19,6 +19,66 @@ SRCS += $(PROJECT)/src/common/iio_pqm.c
 INCS += $(PROJECT)/src/common/pqm.h
 SRCS += $(PROJECT)/src/common/pqm.c
 
+INCS += $(PROJECT)/src/common/pqm_ring.h
+SRCS += $(PROJECT)/src/common/pqm_ring.c
+
+INCS += $(PROJECT)/src/common/pqm_pp.h
+SRCS += $(PROJECT)/src/common/pqm_pp.c
+
+INCS += $(PROJECT)/src/common/pqm_pack.h
+SRCS += $(PROJECT)/src/common/pqm_pack.c
+
+INCS += $(PROJECT)/src/common/pqm_compress.h
+SRCS += $(PROJECT)/src/common/pqm_compress.c
+
+INCS += $(PROJECT)/src/common/pqm_rms.h
+SRCS += $(PROJECT)/src/common/pqm_rms.c
+
+INCS += $(PROJECT)/src/common/pqm_fft.h
+SRCS += $(PROJECT)/src/common/pqm_fft.c
+
+INCS += $(PROJECT)/src/common/pqm_harm.h
+SRCS += $(PROJECT)/src/common/pqm_harm.c
+
+INCS += $(PROJECT)/src/common/pqm_flicker.h
+SRCS += $(PROJECT)/src/common/pqm_flicker.c
+
+INCS += $(PROJECT)/src/common/pqm_seq.h
+SRCS += $(PROJECT)/src/common/pqm_seq.c
+
+INCS += $(PROJECT)/src/common/pqm_event.h
+SRCS += $(PROJECT)/src/common/pqm_event.c
+
+INCS += $(PROJECT)/src/common/pqm_msv.h
+SRCS += $(PROJECT)/src/common/pqm_msv.c
+
+INCS += $(PROJECT)/src/common/pqm_freq.h
+SRCS += $(PROJECT)/src/common/pqm_freq.c
+
+INCS += $(PROJECT)/src/common/pqm_sdft.h
+SRCS += $(PROJECT)/src/common/pqm_sdft.c
+
+INCS += $(PROJECT)/src/common/pqm_energy.h
+SRCS += $(PROJECT)/src/common/pqm_energy.c
+
+INCS += $(PROJECT)/src/common/pqm_cal.h
+SRCS += $(PROJECT)/src/common/pqm_cal.c
+
+INCS += $(PROJECT)/src/common/pqm_stage.h
+SRCS += $(PROJECT)/src/common/pqm_stage.c
+
+INCS += $(PROJECT)/src/common/pqm_agg.h
+SRCS += $(PROJECT)/src/common/pqm_agg.c
+
+INCS += $(PROJECT)/src/common/pqm_stats.h
+SRCS += $(PROJECT)/src/common/pqm_stats.c
+
+INCS += $(PROJECT)/src/common/pqm_capture.h
+SRCS += $(PROJECT)/src/common/pqm_capture.c
+
+INCS += $(PROJECT)/src/common/pqm_transient.h
+SRCS += $(PROJECT)/src/common/pqm_transient.c
+
 INCS += $(PROJECT)/src/common/common_data.h
 SRCS += $(PROJECT)/src/common/common_data.c
 
@@ -27,6 +87,9 @@ INCS += $(PROJECT)/src/platform/platform_includes.h
 INCS += $(PROJECT)/src/platform/$(PLATFORM)/parameters.h
 SRCS += $(PROJECT)/src/platform/$(PLATFORM)/parameters.c 
 
+INCS += $(PROJECT)/src/platform/$(PLATFORM)/pqm_nv_flash.h
+SRCS += $(PROJECT)/src/platform/$(PLATFORM)/pqm_nv_flash.c
+
 SRCS += $(DRIVERS)/api/no_os_uart.c     \
         $(DRIVERS)/api/no_os_spi.c      \
         $(NO-OS)/util/no_os_fifo.c      \
@@ -39,6 +102,7 @@ SRCS += $(DRIVERS)/api/no_os_uart.c     \
 
 INCS += $(INCLUDE)/no_os_delay.h     \
         $(INCLUDE)/no_os_error.h     \
+        $(INCLUDE)/no_os_circular_buffer.h \
         $(INCLUDE)/no_os_fifo.h      \
         $(INCLUDE)/no_os_irq.h       \
         $(INCLUDE)/no_os_lf256fifo.h \
@@ -126,14 +126,37 @@ struct adin1110_init_param adin1110_ip = {
 	.append_crc = false,
 };
 
+struct no_os_timer_init_param acq_timer_ip = {
+	.id = ACQ_TIMER_ID,
+	.freq_hz = ACQ_TIMER_FREQ_HZ,
+	.platform_ops = ACQ_TIMER_OPS,
+	.extra = ACQ_TIMER_EXTRA,
+};
+
+struct no_os_irq_init_param acq_irq_ip = {
+	.irq_ctrl_id = INTC_DEVICE_ID,
+	.platform_ops = IRQ_OPS,
+	.extra = NULL,
+};
+
 struct pqm_init_para pqm_ip = {
 	.ext_buff_len = SAMPLES_PER_CHANNEL,
 	.ext_buff = (uint16_t **)loopback_buffs,
+	.acq_timer_ip = &acq_timer_ip,
+	.acq_irq_ip = &acq_irq_ip,
+	.acq_irq_id = ACQ_TIMER_IRQ_ID,
+	.cpu_clk_hz = PQM_CPU_CLK_HZ,
+	.nv = {
+		.ops = PQM_NV_OPS,
+		.page_size = PQM_NV_PAGE_SIZE,
+		.pages = PQM_NV_PAGES,
+	},
 	.dev_global_attr = {
 		10, 20, 30, 40, 50, 60, 70, 80, 90, 100,
-		10, 20, 30, 40, 50, 60, 70, 80, 90, 100,
-		10, 20, 30, 40, 50, 60,
-		_4W_WYE, _230V_50HZ, _50
+		/* Each event type stays disabled until its threshold is set */
+		10, 20, 30, 0, 0, 2, 0, 2, 0, 2,
+		0, 2, 175, 50, 1, 8000,
+		_4W_WYE, _230V_50HZ, _50, 0
 	},
 	.dev_ch_attr = {
 		{1, 2, 3, 4, 5, 6, 7, 8, 9, 10},
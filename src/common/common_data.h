@@ -57,6 +57,8 @@ extern struct no_os_uart_init_param iio_demo_uart_ip;
 extern struct adin1110_init_param adin1110_ip;
 extern const struct no_os_spi_init_param adin1110_spi_ip;
 extern struct pqm_init_para pqm_ip;;
+extern struct no_os_timer_init_param acq_timer_ip;
+extern struct no_os_irq_init_param acq_irq_ip;
 
 extern const struct no_os_gpio_init_param adin1110_int_gpio_ip;
 extern const struct no_os_gpio_init_param tx_perf_gpio_ip;
@@ -39,37 +39,15 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "no_os_error.h"
 #include "no_os_util.h"
 #include "no_os_alloc.h"
 #include "iio.h"
+#include "no_os_circular_buffer.h"
 #include "iio_pqm.h"
 #include "pqm.h"
-
-/**
- * @brief utility function for computing next upcoming channel.
- * @param ch_mask - active channels .
- * @param last_idx -  previous index.
- * @param new_idx - upcoming channel index, return param.
- * @return 1 if there are more channels, 0 if done.
- */
-static bool get_next_ch_idx(uint32_t ch_mask, uint32_t last_idx,
-			    uint32_t *new_idx)
-{
-	last_idx++;
-	ch_mask >>= last_idx;
-	if (!ch_mask) {
-		*new_idx = -1;
-		return 0;
-	}
-	while (!(ch_mask & 1)) {
-		last_idx++;
-		ch_mask >>= 1;
-	}
-	*new_idx = last_idx;
-
-	return 1;
-}
+#include "pqm_compress.h"
 
 /**
  * @brief Read the available values for v_consel, flicker model and nominal frequency attributes.
@@ -114,6 +92,38 @@ int read_available_values(void *device, char *buf, uint32_t len,
 				strcat(buf, " ");
 		}
 		break;
+	case CAPTURE_MODE:
+		val_cnt = NO_OS_ARRAY_SIZE(pqm_capture_mode_available);
+		for (i = 0; i < val_cnt; i++) {
+			strcat(buf, pqm_capture_mode_available[i]);
+			if (i != val_cnt - 1)
+				strcat(buf, " ");
+		}
+		break;
+	case COMPRESSION:
+		val_cnt = NO_OS_ARRAY_SIZE(pqm_compression_available);
+		for (i = 0; i < val_cnt; i++) {
+			strcat(buf, pqm_compression_available[i]);
+			if (i != val_cnt - 1)
+				strcat(buf, " ");
+		}
+		break;
+	case CAPTURE_SOURCE:
+		val_cnt = NO_OS_ARRAY_SIZE(pqm_capture_source_names);
+		for (i = 0; i < val_cnt; i++) {
+			strcat(buf, pqm_capture_source_names[i]);
+			if (i != val_cnt - 1)
+				strcat(buf, " ");
+		}
+		break;
+	case STAGE:
+		val_cnt = NO_OS_ARRAY_SIZE(pqm_stage_names);
+		for (i = 0; i < val_cnt; i++) {
+			strcat(buf, pqm_stage_names[i]);
+			if (i != val_cnt - 1)
+				strcat(buf, " ");
+		}
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -168,6 +178,7 @@ int write_v_consel_attr(void *device, char *buf, uint32_t len,
 	for (int i = 0; i < data_size; i++) {
 		if (strcmp(buf, pqm_v_consel_available[i]) == 0) {
 			desc->pqm_global_attr[attr_id] = i;
+			pqm_update_wiring(desc);
 			return len;
 		}
 	}
@@ -221,6 +232,7 @@ int write_flicker_model_attr(void *device, char *buf, uint32_t len,
 	for (int i = 0; i < data_size; i++) {
 		if (strcmp(buf, pqm_flicker_model_available[i]) == 0) {
 			desc->pqm_global_attr[attr_id] = i;
+			pqm_update_windows(desc);
 			return len;
 		}
 	}
@@ -274,12 +286,251 @@ int write_nominal_freq_attr(void *device, char *buf, uint32_t len,
 	for (int i = 0; i < data_size; i++) {
 		if (strcmp(buf, pqm_nominal_frequency_available[i]) == 0) {
 			desc->pqm_global_attr[attr_id] = i;
+			pqm_update_windows(desc);
 			return len;
 		}
 	}
 	return -EINVAL;
 }
 
+/**
+ * @brief Find the analysis stage producing a channel attribute.
+ * @param type - channel type.
+ * @param attr_id - attribute, see enum pqm_voltage_attr_id and enum
+ * pqm_current_attr_id.
+ * @return the stage, PQM_STAGES if the attribute is not computed.
+ */
+static enum pqm_stage_id pqm_ch_attr_stage(enum iio_chan_type type,
+					   intptr_t attr_id)
+{
+	if (type == IIO_VOLTAGE) {
+		switch (attr_id) {
+		case PQM_VOLTAGE_RMS:
+		case PQM_VOLTAGE_DEVIATION_UNDER:
+		case PQM_VOLTAGE_DEVIATION_OVER:
+			return PQM_STAGE_RMS;
+		case PQM_VOLTAGE_ANGLE:
+			return PQM_STAGE_SDFT;
+		case PQM_VOLTAGE_PINST:
+		case PQM_VOLTAGE_PST:
+		case PQM_VOLTAGE_PLT:
+			return PQM_STAGE_FLICKER;
+		case PQM_VOLTAGE_THD:
+		case PQM_VOLTAGE_HARMONICS:
+			return PQM_STAGE_HARM;
+		default:
+			return PQM_STAGES;
+		}
+	}
+
+	switch (attr_id) {
+	case PQM_CURRENT_RMS:
+		return PQM_STAGE_RMS;
+	case PQM_CURRENT_ANGLE:
+		return PQM_STAGE_SDFT;
+	case PQM_CURRENT_THD:
+	case PQM_CURRENT_HARMONICS:
+		return PQM_STAGE_HARM;
+	default:
+		return PQM_STAGES;
+	}
+}
+
+/**
+ * @brief Find the analysis stage producing a device attribute.
+ * @param attr_id - attribute, see enum pqm_global_attr_id.
+ * @return the stage, PQM_STAGES if the attribute is not computed.
+ */
+static enum pqm_stage_id pqm_global_attr_stage(intptr_t attr_id)
+{
+	if (attr_id >= PQM_U2 && attr_id <= PQM_SZRO_CURRENT)
+		return PQM_STAGE_SEQ;
+	if (attr_id == PQM_FREQUENCY)
+		return PQM_STAGE_FREQ;
+
+	return PQM_STAGES;
+}
+
+/**
+ * @brief Print the names of a set of stages, separated by spaces.
+ * @param buf - Buffer to be filled with the names
+ * @param len - Length of the buffer in bytes
+ * @param mask - stages to be printed
+ * @return the length of the buffer.
+ */
+static int pqm_format_stages(char *buf, uint32_t len, uint32_t mask)
+{
+	uint32_t pos = 0;
+	uint32_t s;
+
+	buf[0] = '\0';
+	for (s = 0; s < PQM_STAGES && pos < len; s++)
+		if (mask & NO_OS_BIT(s))
+			pos += snprintf(buf + pos, len - pos, pos ? " %s" : "%s",
+					pqm_stage_names[s]);
+
+	return no_os_min(pos, len - 1);
+}
+
+/**
+ * @brief Print weekly percentiles, one line per series with its name, the
+ * 95th and the 99th percentile and the number of 10 min values they are
+ * taken from, after a line with the week and the number of flagged
+ * intervals left out. A series whose stage did not run all week has fewer
+ * values than the unflagged intervals.
+ * @param buf - buffer to be filled
+ * @param len - length of the buffer
+ * @param st - weekly statistics
+ * @param last - print the last complete week instead of the current one
+ * @return the length of the buffer.
+ */
+static int pqm_format_weekly(char *buf, uint32_t len,
+			     const struct pqm_stats *st, bool last)
+{
+	uint32_t pos;
+	uint32_t s, n, p95, p99, cnt;
+	const char *name;
+
+	pos = snprintf(buf, len, "week %" PRIu32 " flagged %" PRIu32 "\n",
+		       last ? st->weeks : st->weeks + 1,
+		       last ? st->last_flagged : st->flagged);
+	for (s = 0; s < PQM_STATS_SERIES && pos < len; s++) {
+		if (s < PQM_STATS_THD) {
+			name = "rms";
+			n = s - PQM_STATS_RMS;
+		} else if (s < PQM_STATS_U2) {
+			name = "thd";
+			n = s - PQM_STATS_THD;
+		} else if (s < PQM_STATS_PST) {
+			name = "u2";
+			n = 0;
+		} else {
+			name = "pst";
+			n = s - PQM_STATS_PST;
+		}
+		p95 = last ? st->last[s][PQM_STATS_P95] :
+		      pqm_stats_value(st, s, PQM_STATS_P95);
+		p99 = last ? st->last[s][PQM_STATS_P99] :
+		      pqm_stats_value(st, s, PQM_STATS_P99);
+		cnt = last ? st->last_count[s] : st->count[s];
+		if (s == PQM_STATS_U2)
+			pos += snprintf(buf + pos, len - pos, "%s", name);
+		else
+			pos += snprintf(buf + pos, len - pos, "%s%" PRIu32 "", name, n);
+		if (pos < len)
+			pos += snprintf(buf + pos, len - pos,
+					" %" PRIu32 " %" PRIu32 " %" PRIu32 "\n",
+					p95, p99, cnt);
+	}
+
+	return no_os_min(pos, len - 1);
+}
+
+/**
+ * @brief Drain the detected voltage events. Every event is reported once, as
+ * a line with its type, start and duration in ms, extreme value in codes
+ * and the mask of the phases involved.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_events_attr(void *device, char *buf, uint32_t len,
+		     const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	/* Longest line: "interruption", 20 + 10 + 10 + 1 digits, separators */
+	const uint32_t line_max = 64;
+	struct pqm_desc *desc;
+	struct pqm_event e;
+	uint32_t pos = 0;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_EVENT);
+	buf[0] = '\0';
+	while (len - pos > line_max && pqm_event_pop(&desc->events, &e))
+		pos += snprintf(buf + pos, len - pos,
+				"%s %" PRIu64 " %" PRIu32 " %" PRIu32 " %u\n",
+				pqm_event_names[e.type], e.start_ms, e.duration_ms,
+				e.extreme, e.phases);
+	return pos;
+}
+
+/**
+ * @brief Drain the detected transients. Every transient is reported once, as
+ * a line with its start and duration in us, the mask of the channels
+ * involved, the mask of the detectors that triggered (bit 0 deviation from
+ * one cycle earlier, bit 1 slope), the largest deviation and the largest
+ * slope in codes.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_transients_attr(void *device, char *buf, uint32_t len,
+			 const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	/* Longest line: 20 + 10 + 3 + 1 + 10 + 10 digits, separators */
+	const uint32_t line_max = 64;
+	struct pqm_transient t;
+	struct pqm_desc *desc;
+	uint32_t pos = 0;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_TRANSIENT);
+	buf[0] = '\0';
+	while (len - pos > line_max && pqm_transient_pop(&desc->transient, &t))
+		pos += snprintf(buf + pos, len - pos,
+				"%" PRIu64 " %" PRIu32 " %u %u %" PRIu32 " %" PRIu32 "\n",
+				t.start_us, t.duration_us, t.channels, t.kinds,
+				t.peak, t.slope);
+	return pos;
+}
+
+/**
+ * @brief Read the last mains signalling record, one line per 10/12 cycle
+ * window: end time in ms, then the carrier RMS of each phase in codes. Reads
+ * resume where the previous one stopped, the detector is armed again once
+ * the whole record was read.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_msv_record_attr(void *device, char *buf, uint32_t len,
+			 const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	/* Longest line: 20 + 3 * 10 digits, separators */
+	const uint32_t line_max = 56;
+	uint32_t value[PQM_MSV_CHANNELS];
+	struct pqm_desc *desc;
+	uint32_t pos = 0;
+	uint64_t ms;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_MSV);
+	buf[0] = '\0';
+	while (len - pos > line_max && pqm_msv_read(&desc->msv, value, &ms))
+		pos += snprintf(buf + pos, len - pos,
+				"%" PRIu64 " %" PRIu32 " %" PRIu32 " %" PRIu32 "\n",
+				ms, value[0], value[1], value[2]);
+	return pos;
+}
+
 /**
  * @brief Read a pqm device attribute.
  *
@@ -298,6 +549,7 @@ int read_pqm_attr(void *device, char *buf, uint32_t len,
 		return -ENODEV;
 	desc = device;
 	if (attr_id < PQM_DEVICE_ATTR_NUMBER) {
+		pqm_stage_touch(&desc->stages, pqm_global_attr_stage(attr_id));
 		return snprintf(buf, len, "%" PRIu32 "", desc->pqm_global_attr[attr_id]);
 	} else {
 		return -EINVAL;
@@ -319,10 +571,31 @@ int write_pqm_attr(void *device, char *buf, uint32_t len,
 {
 	struct pqm_desc *desc;
 	uint32_t value = no_os_str_to_uint32(buf);
+	int32_t ret;
 
 	if (!device)
 		return -ENODEV;
 	desc = device;
+	if (attr_id == PQM_SAMPLING_FREQUENCY) {
+		ret = pqm_set_sampling_frequency(desc, value);
+		return ret ? ret : (int)len;
+	}
+	if (attr_id == PQM_I_CONSEL_EN) {
+		desc->pqm_global_attr[attr_id] = !!value;
+		pqm_update_wiring(desc);
+		return len;
+	}
+	if (attr_id == PQM_MSV_CARRIER_FREQUENCY) {
+		desc->pqm_global_attr[attr_id] = value;
+		pqm_update_windows(desc);
+		return len;
+	}
+	if (attr_id == PQM_NOMINAL_VOLTAGE ||
+	    (attr_id >= PQM_DIP_THRESHOLD && attr_id <= PQM_MSV_THRESHOLD)) {
+		desc->pqm_global_attr[attr_id] = value;
+		pqm_update_thresholds(desc);
+		return len;
+	}
 	if (attr_id < PQM_DEVICE_ATTR_NUMBER) {
 		desc->pqm_global_attr[attr_id] = value;
 		return len;
@@ -352,6 +625,7 @@ int read_ch_attr(void *device, char *buf, uint32_t len,
 	if (attr_id >= MAX_CH_ATTRS) {
 		return -EINVAL;
 	}
+	pqm_stage_touch(&desc->stages, pqm_ch_attr_stage(channel->type, attr_id));
 	switch (channel->type) {
 	case IIO_VOLTAGE:
 		return snprintf(buf, len, "%" PRIu32 "",
@@ -366,369 +640,2244 @@ int read_ch_attr(void *device, char *buf, uint32_t len,
 }
 
 /**
- * @brief function for reading samples from the device.
- * @param dev_data  - The iio device data structure.
- * @return the number of read samples.
+ * @brief Read a calibration channel attribute: calibscale in millionths,
+ * calibbias in codes and calibphase in hundredths of a degree.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
  */
-int32_t read_samples(struct iio_device_data *dev_data)
+int read_cal_attr(void *device, char *buf, uint32_t len,
+		  const struct iio_ch_info *channel, intptr_t attr_id)
 {
 	struct pqm_desc *desc;
-	uint32_t k = 0;
-	uint32_t ch = -1;
-	uint32_t buff[TOTAL_PQM_CHANNELS];
-	uint32_t i;
-	uint32_t *ch_buf_ptr;
+	uint32_t ch;
 
-	if (!dev_data)
+	if (!device)
 		return -ENODEV;
+	desc = device;
+	ch = channel->ch_num;
+	if (channel->type == IIO_CURRENT)
+		ch += VOLTAGE_CH_NUMBER;
+	switch (attr_id) {
+	case PQM_CALIBSCALE:
+		return snprintf(buf, len, "%" PRId32 "", desc->cal.scale[ch]);
+	case PQM_CALIBBIAS:
+		return snprintf(buf, len, "%" PRId32 "", desc->cal.offset[ch]);
+	case PQM_CALIBPHASE:
+		return snprintf(buf, len, "%" PRId32 "", desc->cal.phase[ch]);
+	default:
+		return -EINVAL;
+	}
+}
 
-	desc = (struct pqm_desc *)dev_data->dev;
+/**
+ * @brief Write a calibration channel attribute. calibbias is removed before
+ * calibscale is applied, a positive calibphase delays the channel. The
+ * phase correction is limited by the sampling frequency.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_cal_attr(void *device, char *buf, uint32_t len,
+		   const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	int32_t value = no_os_str_to_int32(buf);
+	int32_t scale, offset, phase;
+	uint32_t ch;
+	int ret;
 
-	if (desc->ext_buff == NULL) {
-		int offset_per_ch = TOTAL_PQM_CHANNELS;
-		for (i = 0; i < dev_data->buffer->size / dev_data->buffer->bytes_per_scan;
-		     i++) {
-			while (get_next_ch_idx(desc->active_ch, ch, &ch))
-				buff[k++] = sine_lut[(ch + i * offset_per_ch) % NO_OS_ARRAY_SIZE(sine_lut)];
-			k = 0;
-			iio_buffer_push_scan(dev_data->buffer, buff);
-		}
-		return dev_data->buffer->size / dev_data->buffer->bytes_per_scan;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	ch = channel->ch_num;
+	if (channel->type == IIO_CURRENT)
+		ch += VOLTAGE_CH_NUMBER;
+	if (ch >= TOTAL_PQM_CHANNELS)
+		return -EINVAL;
+	scale = desc->cal.scale[ch];
+	offset = desc->cal.offset[ch];
+	phase = desc->cal.phase[ch];
+	switch (attr_id) {
+	case PQM_CALIBSCALE:
+		scale = value;
+		break;
+	case PQM_CALIBBIAS:
+		offset = value;
+		break;
+	case PQM_CALIBPHASE:
+		phase = value;
+		break;
+	default:
+		return -EINVAL;
 	}
+	ret = pqm_set_calibration(desc, ch, scale, offset, phase);
 
-	for (i = 0; i < dev_data->buffer->size / dev_data->buffer->bytes_per_scan;
-	     i++) {
-		while (get_next_ch_idx(desc->active_ch, ch, &ch)) {
-			ch_buf_ptr = (uint32_t *)desc->ext_buff + (ch * desc->ext_buff_len);
-			buff[k++] = ch_buf_ptr[i];
-		}
-		k = 0;
-		iio_buffer_push_scan(dev_data->buffer, buff);
-	}
-	return dev_data->buffer->size / dev_data->buffer->bytes_per_scan;
+	return ret ? ret : (int)len;
 }
 
 /**
- * @brief Handles trigger: reads one data-set and writes it to the buffer.
- *
- * @param dev_data  - The iio device data structure.
+ * @brief Read a transient threshold channel attribute: transient_level, the
+ * deviation from one cycle earlier, and transient_slope, the difference
+ * between consecutive samples, both in codes. Zero means disabled.
  *
- * @return ret - Result of the handling procedure. In case of success, the size
- * 				 of the written data is returned.
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
  */
-int32_t pqm_trigger_handler(struct iio_device_data *dev_data)
+int read_transient_thr_attr(void *device, char *buf, uint32_t len,
+			    const struct iio_ch_info *channel, intptr_t attr_id)
 {
 	struct pqm_desc *desc;
-	uint32_t k = 0;
-	uint32_t ch = -1;
-	uint32_t buff[TOTAL_PQM_CHANNELS];
-	static uint32_t i = 0;
-	uint32_t *ch_buf_ptr;
+	uint32_t ch;
 
-	if (!dev_data)
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	ch = channel->ch_num;
+	if (channel->type == IIO_CURRENT)
+		ch += VOLTAGE_CH_NUMBER;
+	switch (attr_id) {
+	case PQM_TRANSIENT_LEVEL:
+		return snprintf(buf, len, "%" PRIu32 "", desc->transient.level[ch]);
+	case PQM_TRANSIENT_SLOPE:
+		return snprintf(buf, len, "%" PRIu32 "", desc->transient.slope[ch]);
+	default:
 		return -EINVAL;
+	}
+}
 
-	desc = (struct pqm_desc *)dev_data->dev;
+/**
+ * @brief Write a transient threshold channel attribute, see
+ * read_transient_thr_attr(). Takes effect from the next scan.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_transient_thr_attr(void *device, char *buf, uint32_t len,
+			     const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t value = no_os_str_to_uint32(buf);
+	uint32_t level, slope;
+	uint32_t ch;
 
-	if(desc->ext_buff == NULL) {
-		int offset_per_ch = TOTAL_PQM_CHANNELS;
-		while(get_next_ch_idx(desc->active_ch, ch, &ch))
-			buff[k++] = sine_lut[(ch + i * offset_per_ch ) % NO_OS_ARRAY_SIZE(sine_lut)];
-		if (i == NO_OS_ARRAY_SIZE(sine_lut))
-			i = 0;
-		else
-			i++;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	ch = channel->ch_num;
+	if (channel->type == IIO_CURRENT)
+		ch += VOLTAGE_CH_NUMBER;
+	if (ch >= TOTAL_PQM_CHANNELS)
+		return -EINVAL;
+	level = desc->transient.level[ch];
+	slope = desc->transient.slope[ch];
+	switch (attr_id) {
+	case PQM_TRANSIENT_LEVEL:
+		level = value;
+		break;
+	case PQM_TRANSIENT_SLOPE:
+		slope = value;
+		break;
+	default:
+		return -EINVAL;
+	}
+	pqm_transient_set_thr(&desc->transient, ch, level, slope);
 
-		return iio_buffer_push_scan(dev_data->buffer, buff);
+	return len;
+}
+
+/**
+ * @brief Format a power attribute. Powers are in codes^2, the power factor
+ * in thousandths, negative when exporting.
+ * @param buf - Buffer to be filled with requested data
+ * @param len - Length of the received command buffer in bytes
+ * @param attr_id - power attribute
+ * @param p - active power
+ * @param q - reactive power
+ * @param s - apparent power
+ * @return The length of the buffer in case of success, negative value otherwise
+ */
+static int pqm_format_power(char *buf, uint32_t len, intptr_t attr_id,
+			    int64_t p, int64_t q, uint64_t s)
+{
+	switch (attr_id) {
+	case PQM_ACTIVE_POWER:
+		return snprintf(buf, len, "%" PRId64 "", p);
+	case PQM_REACTIVE_POWER:
+		return snprintf(buf, len, "%" PRId64 "", q);
+	case PQM_APPARENT_POWER:
+		return snprintf(buf, len, "%" PRIu64 "", s);
+	case PQM_POWER_FACTOR:
+		return snprintf(buf, len, "%" PRId64 "",
+				s ? p * 1000 / (int64_t)s : 0);
+	default:
+		return -EINVAL;
 	}
+}
+
+/**
+ * @brief Read a power channel attribute of a phase current channel.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_power_attr(void *device, char *buf, uint32_t len,
+		    const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	struct pqm_power pw;
+	uint32_t ph;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	/* The neutral has no voltage to pair with */
+	if (channel->type != IIO_CURRENT || channel->ch_num >= PQM_RMS_PHASES)
+		return -EINVAL;
+	ph = channel->ch_num;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_RMS);
+	pqm_rms_power(&desc->rms, &pw);
+
+	return pqm_format_power(buf, len, attr_id, pw.p[ph], pw.q[ph], pw.s[ph]);
+}
+
+/**
+ * @brief Read a total power device attribute. The total apparent power is
+ * the arithmetic sum of the phase apparent powers.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_total_power_attr(void *device, char *buf, uint32_t len,
+			  const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	struct pqm_power pw;
+	int64_t p = 0, q = 0;
+	uint64_t s = 0;
+	uint32_t ph;
 
-	while(get_next_ch_idx(desc->active_ch, ch, &ch)) {
-		ch_buf_ptr = (uint32_t*)desc->ext_buff + (ch * desc->ext_buff_len);
-		buff[k++] = ch_buf_ptr[i];
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_RMS);
+	pqm_rms_power(&desc->rms, &pw);
+	for (ph = 0; ph < PQM_RMS_PHASES; ph++) {
+		p += pw.p[ph];
+		q += pw.q[ph];
+		s += pw.s[ph];
 	}
-	if (i == (desc->ext_buff_len - 1))
-		i = 0;
-	else
-		i++;
 
-	return iio_buffer_push_scan(dev_data->buffer, buff);
+	return pqm_format_power(buf, len, attr_id, p, q, s);
 }
 
-struct iio_attribute voltage_pqm_attributes[] = {
-	{
-		.name = "rms",
-		.show = read_ch_attr,
-		.priv = 0,
-	},
-	{
+/**
+ * @brief Read an energy channel attribute of a phase current channel, in
+ * codes^2 * h.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_energy_attr(void *device, char *buf, uint32_t len,
+		     const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	uint64_t reg[PQM_ENERGY_REGS][PQM_RMS_PHASES];
+	struct pqm_desc *desc;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	if (channel->type != IIO_CURRENT || channel->ch_num >= PQM_RMS_PHASES ||
+	    attr_id >= PQM_ENERGY_REGS)
+		return -EINVAL;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_RMS);
+	pqm_energy_read(&desc->energy, reg, NULL);
+
+	return snprintf(buf, len, "%" PRIu64 "", reg[attr_id][channel->ch_num]);
+}
+
+/**
+ * @brief Read a total energy device attribute, in codes^2 * h.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_total_energy_attr(void *device, char *buf, uint32_t len,
+			   const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	uint64_t reg[PQM_ENERGY_REGS][PQM_RMS_PHASES];
+	struct pqm_desc *desc;
+	uint64_t total = 0;
+	uint32_t ph;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	if (attr_id >= PQM_ENERGY_REGS)
+		return -EINVAL;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_RMS);
+	pqm_energy_read(&desc->energy, reg, NULL);
+	for (ph = 0; ph < PQM_RMS_PHASES; ph++)
+		total += reg[attr_id][ph];
+
+	return snprintf(buf, len, "%" PRIu64 "", total);
+}
+
+/**
+ * @brief Read the harmonics channel attribute: RMS of orders 1 to
+ * PQM_MAX_HARMONIC, in codes, space separated.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_harmonics_attr(void *device, char *buf, uint32_t len,
+			const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t *harmonics;
+	uint32_t pos = 0;
+	int ret;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_HARM);
+	switch (channel->type) {
+	case IIO_VOLTAGE:
+		harmonics = desc->harm.harmonics[channel->ch_num];
+		break;
+	case IIO_CURRENT:
+		harmonics = desc->harm.harmonics[channel->ch_num + VOLTAGE_CH_NUMBER];
+		break;
+	default:
+		return -EINVAL;
+	}
+	for (int i = 0; i < PQM_MAX_HARMONIC; i++) {
+		ret = snprintf(buf + pos, len - pos, i ? " %" PRIu32 "" : "%" PRIu32 "",
+			       harmonics[i]);
+		if (ret < 0 || (uint32_t)ret >= len - pos)
+			return -EINVAL;
+		pos += ret;
+	}
+	return pos;
+}
+
+/**
+ * @brief Read a harmonic power flow attribute of a phase current channel, for
+ * orders 1 to PQM_MAX_HARMONIC, space separated: harmonic_power is the
+ * active power of every order in codes^2, harmonic_direction is 1 when it
+ * flows towards the load, -1 when the load injects it and 0 when its power
+ * factor is too small to tell.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_harmonic_power_attr(void *device, char *buf, uint32_t len,
+			     const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t pos = 0;
+	uint32_t ph;
+	int ret;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	/* The neutral has no voltage to pair with */
+	if (channel->type != IIO_CURRENT || channel->ch_num >= PQM_HARM_PHASES)
+		return -EINVAL;
+	ph = channel->ch_num;
+	pqm_stage_touch(&desc->stages, PQM_STAGE_HARM);
+	for (int i = 0; i < PQM_MAX_HARMONIC; i++) {
+		switch (attr_id) {
+		case PQM_HARMONIC_POWER:
+			ret = snprintf(buf + pos, len - pos,
+				       i ? " %" PRId64 "" : "%" PRId64 "",
+				       desc->harm.power[ph][i]);
+			break;
+		case PQM_HARMONIC_DIRECTION:
+			ret = snprintf(buf + pos, len - pos, i ? " %d" : "%d",
+				       desc->harm.direction[ph][i]);
+			break;
+		default:
+			return -EINVAL;
+		}
+		if (ret < 0 || (uint32_t)ret >= len - pos)
+			return -EINVAL;
+		pos += ret;
+	}
+	return pos;
+}
+
+/*
+ * Scan layout seen by the client for each transport format. The one of
+ * PQM_SCAN_FORMAT goes into the IIO context description, built once at init
+ */
+static struct scan_type pqm_scan_formats[] = {
+	[PQM_SCAN_BE32] = {
+		.sign = 'u',
+		.realbits = 24,
+		.storagebits = 32,
+		.shift = 0,
+		.is_big_endian = true
+	},
+	[PQM_SCAN_LE32] = {
+		.sign = 'u',
+		.realbits = 24,
+		.storagebits = 32,
+		.shift = 0,
+		.is_big_endian = false
+	},
+	[PQM_SCAN_PACKED24] = {
+		.sign = 'u',
+		.realbits = 24,
+		.storagebits = 24,
+		.shift = 0,
+		.is_big_endian = false
+	},
+	[PQM_SCAN_TRUNC16] = {
+		.sign = 'u',
+		.realbits = 16,
+		.storagebits = 16,
+		.shift = 0,
+		.is_big_endian = false
+	},
+	/* IEEE 754 single precision, in volts or amps */
+	[PQM_SCAN_FLOAT32] = {
+		.sign = 'f',
+		.realbits = 32,
+		.storagebits = 32,
+		.shift = 0,
+		.is_big_endian = false
+	},
+};
+
+/**
+ * @brief Convert native 32-bit samples to the transport format of the buffer
+ * session. Output is never larger than input, so src and dst may be the same
+ * buffer.
+ * @param desc - descriptor for the pqm
+ * @param src - native samples, 24 significant bits in each word.
+ * @param dst - destination of the converted samples.
+ * @param nb_samples - number of samples to convert.
+ * @return the number of bytes written to dst.
+ */
+static uint32_t pqm_pack_samples(struct pqm_desc *desc,
+				 const uint32_t *src, void *dst,
+				 uint32_t nb_samples)
+{
+	uint32_t start;
+
+	if (desc->scan_format != PQM_SCAN_FLOAT32)
+		return pqm_pack(desc->scan_format, src, dst, nb_samples);
+
+	start = pqm_cycles();
+	pqm_pack_float(desc->float_scale, desc->active_ch_cnt, src, dst,
+		       nb_samples);
+	desc->float_cycles = pqm_cycles() - start;
+
+	return nb_samples * 4;
+}
+
+/* Scans a refill waits for beyond its own before the acquisition is deemed stalled */
+#define PQM_WAIT_MARGIN_SCANS PQM_RING_SCANS
+
+/**
+ * @struct pqm_wait
+ * @brief Bound of a wait for the acquisition, in core cycles.
+ */
+struct pqm_wait {
+	/** Cycles left before the wait times out */
+	uint64_t left;
+	/** Core cycle count when last checked */
+	uint32_t last;
+};
+
+/**
+ * @brief Start bounding a wait for scans from the acquisition: their scan
+ * periods plus a margin.
+ * @param desc - descriptor for the pqm
+ * @param wait - the wait, return param.
+ * @param nb_scans - scans waited for.
+ */
+static void pqm_wait_start(struct pqm_desc *desc, struct pqm_wait *wait,
+			   uint32_t nb_scans)
+{
+	/* Without the core clock, the bound is a full turn of the counter */
+	wait->left = desc->scan_cycles ? (uint64_t)desc->scan_cycles *
+		     (nb_scans + PQM_WAIT_MARGIN_SCANS) : UINT32_MAX;
+	wait->last = pqm_cycles();
+}
+
+/**
+ * @brief Charge the time spent since the last check to a wait.
+ * @param wait - the wait.
+ * @return true if the wait timed out.
+ */
+static bool pqm_wait_expired(struct pqm_wait *wait)
+{
+	uint32_t now = pqm_cycles();
+	uint32_t spent = now - wait->last;
+
+	wait->last = now;
+	if (spent >= wait->left)
+		return true;
+	wait->left -= spent;
+
+	return false;
+}
+
+/**
+ * @brief Serve a refill from the ping-pong capture halves. The complete half
+ * becomes the storage of the IIO buffer, so nothing is copied.
+ * @param dev_data  - The iio device data structure.
+ * @param nb_scans  - Number of requested scans.
+ * @return the number of read samples, -ETIMEDOUT if the acquisition stalled
+ * before a half was complete, negative error code otherwise.
+ */
+static int32_t read_samples_pp(struct iio_device_data *dev_data,
+			       uint32_t nb_scans)
+{
+	struct pqm_desc *desc = dev_data->dev;
+	struct pqm_wait wait;
+	uint32_t *half;
+	void *addr;
+	int ret;
+
+	if (!desc->pp.armed || desc->pp.nb_scans != nb_scans) {
+		pqm_pp_arm(&desc->pp, nb_scans, desc->active_ch_cnt);
+		if (desc->pp.nb_scans != nb_scans)
+			return -EINVAL;
+	}
+
+	half = pqm_pp_take(&desc->pp);
+	if (!half) {
+		desc->pp.underruns++;
+		pqm_wait_start(desc, &wait, nb_scans);
+		while (!(half = pqm_pp_take(&desc->pp)))
+			if (pqm_wait_expired(&wait))
+				return -ETIMEDOUT;
+	}
+	pqm_pack_samples(desc, half, half,
+			 nb_scans * desc->active_ch_cnt);
+
+	ret = no_os_cb_cfg(dev_data->buffer->buf, (int8_t *)half,
+			   dev_data->buffer->size);
+	if (ret)
+		return ret;
+	desc->pp_cb = dev_data->buffer->buf;
+
+	ret = iio_buffer_get_block(dev_data->buffer, &addr);
+	if (ret)
+		return ret;
+
+	ret = iio_buffer_block_done(dev_data->buffer);
+	if (ret)
+		return ret;
+
+	return nb_scans;
+}
+
+/**
+ * @brief Fill a refill with as many compressed blocks as fit, padding the
+ * rest. Each refill therefore carries more scans than a raw one.
+ * @param dev_data  - The iio device data structure.
+ * @param nb_scans  - Number of requested scans.
+ * @return the number of read samples, -EINVAL if the refill cannot hold a
+ * worst case block, -ETIMEDOUT if the acquisition stalled before the refill
+ * was complete, negative error code otherwise.
+ */
+static int32_t read_samples_compressed(struct iio_device_data *dev_data,
+				       uint32_t nb_scans)
+{
+	struct pqm_desc *desc = dev_data->dev;
+	uint32_t cnt = desc->active_ch_cnt;
+	struct pqm_wait wait;
+	uint32_t block_max;
+	uint8_t *dst, *end;
+	uint32_t done = PQM_COMPRESS_BLOCK_SCANS;
+	uint32_t run;
+	int ret;
+
+	/* Otherwise every refill would be padding only and the ring would overrun */
+	block_max = pqm_compress_max_size(cnt, PQM_COMPRESS_BLOCK_SCANS);
+	if (dev_data->buffer->size < block_max)
+		return -EINVAL;
+
+	ret = iio_buffer_get_block(dev_data->buffer, (void **)&dst);
+	if (ret)
+		return ret;
+
+	end = dst + dev_data->buffer->size;
+	while (end - dst >= block_max) {
+		if (pqm_ring_level(&desc->ring) < PQM_COMPRESS_BLOCK_SCANS)
+			desc->ring.underruns++;
+		pqm_wait_start(desc, &wait, PQM_COMPRESS_BLOCK_SCANS);
+		for (done = 0; done < PQM_COMPRESS_BLOCK_SCANS; done += run) {
+			run = pqm_ring_pop(&desc->ring, desc->active_ch_idx, cnt,
+					   desc->stage_buff + done * cnt,
+					   PQM_COMPRESS_BLOCK_SCANS - done);
+			if (!run && pqm_wait_expired(&wait))
+				break;
+		}
+		/* The acquisition stalled, the partial block is dropped */
+		if (done < PQM_COMPRESS_BLOCK_SCANS)
+			break;
+
+		ret = pqm_compress_block(desc->stage_buff, PQM_COMPRESS_BLOCK_SCANS,
+					 desc->active_ch, dst);
+		dst += ret;
+		desc->comp_bytes += ret;
+		desc->comp_raw_bytes += PQM_COMPRESS_BLOCK_SCANS *
+					dev_data->buffer->bytes_per_scan;
+	}
+	pqm_compress_pad(dst, end - dst);
+
+	ret = iio_buffer_block_done(dev_data->buffer);
+	if (ret)
+		return ret;
+
+	return done < PQM_COMPRESS_BLOCK_SCANS ? -ETIMEDOUT : (int32_t)nb_scans;
+}
+
+/**
+ * @brief Fill a refill with the frozen capture slot, zero padded if the
+ * refill is longer than the rest of the slot. Reading the whole slot arms
+ * the capture again.
+ * @param dev_data  - The iio device data structure.
+ * @param nb_scans  - Number of requested scans.
+ * @return the number of read samples, -EAGAIN if no slot is frozen,
+ * negative error code otherwise.
+ */
+static int32_t read_samples_snapshot(struct iio_device_data *dev_data,
+				     uint32_t nb_scans)
+{
+	struct pqm_desc *desc = dev_data->dev;
+	uint32_t cnt = desc->active_ch_cnt;
+	uint8_t *dst, *end;
+	uint32_t done;
+	uint32_t run;
+	int ret;
+
+	if (__atomic_load_n(&desc->capture.state, __ATOMIC_ACQUIRE) !=
+	    PQM_CAPTURE_FROZEN)
+		return -EAGAIN;
+
+	ret = iio_buffer_get_block(dev_data->buffer, (void **)&dst);
+	if (ret)
+		return ret;
+
+	end = dst + dev_data->buffer->size;
+	for (done = 0; done < nb_scans; done += run) {
+		run = pqm_capture_read(&desc->capture, desc->active_ch_idx, cnt,
+				       desc->stage_buff,
+				       no_os_min(nb_scans - done,
+						 PQM_MAX_SCANS_PER_TRIGGER));
+		if (!run)
+			break;
+		dst += pqm_pack_samples(desc, desc->stage_buff, dst, run * cnt);
+	}
+	memset(dst, 0, end - dst);
+
+	ret = iio_buffer_block_done(dev_data->buffer);
+	if (ret)
+		return ret;
+
+	return nb_scans;
+}
+
+/**
+ * @brief function for reading samples from the device.
+ * @param dev_data  - The iio device data structure.
+ * @return the number of read samples, -ETIMEDOUT if the acquisition stalled
+ * before the refill was complete.
+ */
+int32_t read_samples(struct iio_device_data *dev_data)
+{
+	struct pqm_desc *desc;
+	struct pqm_wait wait;
+	uint32_t nb_scans;
+	uint32_t done;
+	uint32_t run;
+	uint32_t cnt;
+	uint32_t *buff;
+	uint8_t *dst, *end;
+	int ret;
+
+	if (!dev_data)
+		return -ENODEV;
+
+	desc = (struct pqm_desc *)dev_data->dev;
+	nb_scans = dev_data->buffer->size / dev_data->buffer->bytes_per_scan;
+
+	if (desc->capture_mode == PQM_CAPTURE_PING_PONG)
+		return read_samples_pp(dev_data, nb_scans);
+	if (desc->capture_mode == PQM_CAPTURE_SNAPSHOT)
+		return read_samples_snapshot(dev_data, nb_scans);
+	if (desc->compression == PQM_COMPRESSION_RICE)
+		return read_samples_compressed(dev_data, nb_scans);
+
+	ret = iio_buffer_get_block(dev_data->buffer, (void **)&buff);
+	if (ret)
+		return ret;
+
+	/* Wait for the acquisition interrupt to catch up, if needed */
+	cnt = desc->active_ch_cnt;
+	if (pqm_ring_level(&desc->ring) < nb_scans)
+		desc->ring.underruns++;
+	pqm_wait_start(desc, &wait, nb_scans);
+	dst = (uint8_t *)buff;
+	end = dst + dev_data->buffer->size;
+	if (pqm_scan_formats[desc->scan_format].storagebits == 32) {
+		for (done = 0; done < nb_scans; done += run) {
+			run = pqm_ring_pop(&desc->ring, desc->active_ch_idx, cnt,
+					   buff + done * cnt, nb_scans - done);
+			if (!run && pqm_wait_expired(&wait))
+				break;
+		}
+		dst += pqm_pack_samples(desc, buff, buff, done * cnt);
+	} else {
+		/* Narrower formats go through the staging area */
+		for (done = 0; done < nb_scans; done += run) {
+			run = pqm_ring_pop(&desc->ring, desc->active_ch_idx, cnt,
+					   desc->stage_buff,
+					   no_os_min(nb_scans - done,
+						     PQM_MAX_SCANS_PER_TRIGGER));
+			if (!run && pqm_wait_expired(&wait))
+				break;
+			dst += pqm_pack_samples(desc, desc->stage_buff,
+						dst, run * cnt);
+		}
+	}
+	/* A stalled acquisition leaves zeros, the block is closed all the same */
+	memset(dst, 0, end - dst);
+
+	ret = iio_buffer_block_done(dev_data->buffer);
+	if (ret)
+		return ret;
+
+	return done < nb_scans ? -ETIMEDOUT : (int32_t)nb_scans;
+}
+
+/**
+ * @brief Handles trigger: reads up to scans_per_trigger data-sets and writes
+ * them to the buffer.
+ *
+ * @param dev_data  - The iio device data structure.
+ *
+ * @return ret - Result of the handling procedure. In case of success, the size
+ * 				 of the written data is returned.
+ */
+int32_t pqm_trigger_handler(struct iio_device_data *dev_data)
+{
+	struct pqm_desc *desc;
+	uint32_t nb_scans;
+
+	if (!dev_data)
+		return -EINVAL;
+
+	desc = (struct pqm_desc *)dev_data->dev;
+
+	nb_scans = pqm_ring_pop(&desc->ring, desc->active_ch_idx,
+				desc->active_ch_cnt, desc->stage_buff,
+				desc->scans_per_trigger);
+	if (nb_scans < desc->scans_per_trigger)
+		desc->ring.underruns++;
+	if (!nb_scans)
+		return 0;
+
+	pqm_pack_samples(desc, desc->stage_buff, desc->stage_buff,
+			 nb_scans * desc->active_ch_cnt);
+	if (nb_scans == 1)
+		return iio_buffer_push_scan(dev_data->buffer, desc->stage_buff);
+
+	return no_os_cb_write(dev_data->buffer->buf, desc->stage_buff,
+			      nb_scans * dev_data->buffer->bytes_per_scan);
+}
+
+/**
+ * @brief Read the scans_per_trigger buffer attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_scans_per_trigger_attr(void *device, char *buf, uint32_t len,
+				const struct iio_ch_info *channel,
+				intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	return snprintf(buf, len, "%" PRIu32 "", desc->scans_per_trigger);
+}
+
+/**
+ * @brief Write the scans_per_trigger buffer attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_scans_per_trigger_attr(void *device, char *buf, uint32_t len,
+				 const struct iio_ch_info *channel,
+				 intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t value = no_os_str_to_uint32(buf);
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	if (!value || value > PQM_MAX_SCANS_PER_TRIGGER)
+		return -EINVAL;
+	desc->scans_per_trigger = value;
+	return len;
+}
+
+/**
+ * @brief Read the aggregates device attribute: the last 150/180 cycle, 10 min
+ * and 2 h records in one read, one line per interval with its name, index,
+ * flag, the RMS of every channel in codes, then the under and the over
+ * deviation of every voltage channel in hundredths of a percent.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_aggregates_attr(void *device, char *buf, uint32_t len,
+			 const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_agg_record *r;
+	struct pqm_desc *desc;
+	uint32_t pos = 0;
+	uint32_t l, ch;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	for (l = 0; l < PQM_AGG_LEVELS && pos < len; l++) {
+		r = &desc->agg.rec[l];
+		pos += snprintf(buf + pos, len - pos, "%s %" PRIu32 " %d",
+				pqm_agg_names[l], r->index, r->flagged);
+		for (ch = 0; ch < PQM_AGG_CHANNELS && pos < len; ch++)
+			pos += snprintf(buf + pos, len - pos, " %" PRIu32 "",
+					r->rms[ch]);
+		for (ch = 0; ch < PQM_AGG_VOLTAGES && pos < len; ch++)
+			pos += snprintf(buf + pos, len - pos, " %" PRIu32 "",
+					r->under[ch]);
+		for (ch = 0; ch < PQM_AGG_VOLTAGES && pos < len; ch++)
+			pos += snprintf(buf + pos, len - pos, " %" PRIu32 "",
+					r->over[ch]);
+		if (pos < len)
+			pos += snprintf(buf + pos, len - pos, "\n");
+	}
+	return no_os_min(pos, len - 1);
+}
+
+/**
+ * @brief Read the weekly_stats and weekly_stats_current device attributes:
+ * the 95th and 99th percentiles of the 10 min RMS, THD, u2 and Pst values
+ * of the last complete week and of the current one, with the number of
+ * values of each. The stages feeding them are subscribed by default, see
+ * stage_subscriptions; unsubscribed, a series only covers the intervals its
+ * stage ran.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_weekly_stats_attr(void *device, char *buf, uint32_t len,
+			   const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	return pqm_format_weekly(buf, len, &desc->stats, attr_id);
+}
+
+/**
+ * @brief Read the harmonics_slice device attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_harmonics_slice_attr(void *device, char *buf, uint32_t len,
+			      const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	return snprintf(buf, len, "%" PRIu32 "", desc->harm.slice);
+}
+
+/**
+ * @brief Write the harmonics_slice device attribute: work units of the
+ * harmonic analysis done per main loop iteration, 0 for a whole window.
+ * Restarts the fft_slice_max and fft_slice_hist statistics.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_harmonics_slice_attr(void *device, char *buf, uint32_t len,
+			       const struct iio_ch_info *channel,
+			       intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	pqm_harm_set_slice(&desc->harm, no_os_str_to_uint32(buf));
+	return len;
+}
+
+/**
+ * @brief Read the stage_lease device attribute, in ms.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_stage_lease_attr(void *device, char *buf, uint32_t len,
+			  const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	return snprintf(buf, len, "%" PRIu32 "", desc->stages.lease_ms);
+}
+
+/**
+ * @brief Write the stage_lease device attribute: how long, in ms, a stage
+ * keeps running after one of its attributes was read.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_stage_lease_attr(void *device, char *buf, uint32_t len,
+			   const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	pqm_stage_set_lease(&desc->stages, no_os_str_to_uint32(buf));
+	return len;
+}
+
+/**
+ * @brief Read the stage_subscriptions device attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_stage_subscriptions_attr(void *device, char *buf, uint32_t len,
+				  const struct iio_ch_info *channel,
+				  intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	return pqm_format_stages(buf, len, desc->stages.subscribed);
+}
+
+/**
+ * @brief Write the stage_subscriptions device attribute: the names of the
+ * stages that keep running whether their attributes are read or not,
+ * separated by spaces. Every other stage only runs on demand. By default
+ * rms, harmonics, unbalance, events, flicker, msv and transients are
+ * subscribed: the energy registers, Pst, Plt and the weekly statistics of
+ * RMS, THD and u2 need unbroken history, and dips, signalling and transients
+ * cannot be caught once they are over.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_stage_subscriptions_attr(void *device, char *buf, uint32_t len,
+				   const struct iio_ch_info *channel,
+				   intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t mask = 0;
+	const char *p = buf;
+	size_t n;
+	uint32_t s;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	p += strspn(p, " \n");
+	while (*p) {
+		n = strcspn(p, " \n");
+		for (s = 0; s < PQM_STAGES; s++)
+			if (strlen(pqm_stage_names[s]) == n &&
+			    !strncmp(p, pqm_stage_names[s], n))
+				break;
+		if (s == PQM_STAGES)
+			return -EINVAL;
+		mask |= NO_OS_BIT(s);
+		p += n;
+		p += strspn(p, " \n");
+	}
+	desc->stages.subscribed = mask;
+	return len;
+}
+
+struct iio_attribute voltage_pqm_attributes[] = {
+	{
+		.name = "rms",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_RMS,
+	},
+	{
+		.name = "angle",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_ANGLE,
+	},
+	{
+		.name = "deviation_under",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_DEVIATION_UNDER,
+	},
+	{
+		.name = "deviation_over",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_DEVIATION_OVER,
+	},
+	{
+		.name = "pinst",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_PINST,
+	},
+	{
+		.name = "pst",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_PST,
+	},
+	{
+		.name = "plt",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_PLT,
+	},
+	{
+		.name = "thd",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_THD,
+	},
+	{
+		.name = "harmonics",
+		.show = read_harmonics_attr,
+		.priv = PQM_VOLTAGE_HARMONICS,
+	},
+	{
+		.name = "raw",
+		.show = read_ch_attr,
+		.priv = PQM_VOLTAGE_RAW,
+	},
+	{
+		.name = "calibscale",
+		.show = read_cal_attr,
+		.store = write_cal_attr,
+		.priv = PQM_CALIBSCALE,
+	},
+	{
+		.name = "calibbias",
+		.show = read_cal_attr,
+		.store = write_cal_attr,
+		.priv = PQM_CALIBBIAS,
+	},
+	{
+		.name = "calibphase",
+		.show = read_cal_attr,
+		.store = write_cal_attr,
+		.priv = PQM_CALIBPHASE,
+	},
+	{
+		.name = "transient_level",
+		.show = read_transient_thr_attr,
+		.store = write_transient_thr_attr,
+		.priv = PQM_TRANSIENT_LEVEL,
+	},
+	{
+		.name = "transient_slope",
+		.show = read_transient_thr_attr,
+		.store = write_transient_thr_attr,
+		.priv = PQM_TRANSIENT_SLOPE,
+	},
+	END_ATTRIBUTES_ARRAY,
+};
+
+struct iio_attribute current_pqm_attributes[] = {
+
+	{
+		.name = "rms",
+		.show = read_ch_attr,
+		.priv = PQM_CURRENT_RMS,
+	},
+	{
 		.name = "angle",
 		.show = read_ch_attr,
-		.priv = 1,
+		.priv = PQM_CURRENT_ANGLE,
+	},
+	{
+		.name = "thd",
+		.show = read_ch_attr,
+		.priv = PQM_CURRENT_THD,
+	},
+	{
+		.name = "harmonics",
+		.show = read_harmonics_attr,
+		.priv = PQM_CURRENT_HARMONICS,
+	},
+	{
+		.name = "raw",
+		.show = read_ch_attr,
+		.priv = PQM_CURRENT_RAW,
+	},
+	{
+		.name = "calibscale",
+		.show = read_cal_attr,
+		.store = write_cal_attr,
+		.priv = PQM_CALIBSCALE,
+	},
+	{
+		.name = "calibbias",
+		.show = read_cal_attr,
+		.store = write_cal_attr,
+		.priv = PQM_CALIBBIAS,
+	},
+	{
+		.name = "calibphase",
+		.show = read_cal_attr,
+		.store = write_cal_attr,
+		.priv = PQM_CALIBPHASE,
+	},
+	{
+		.name = "transient_level",
+		.show = read_transient_thr_attr,
+		.store = write_transient_thr_attr,
+		.priv = PQM_TRANSIENT_LEVEL,
+	},
+	{
+		.name = "transient_slope",
+		.show = read_transient_thr_attr,
+		.store = write_transient_thr_attr,
+		.priv = PQM_TRANSIENT_SLOPE,
+	},
+	{
+		.name = "active_power",
+		.show = read_power_attr,
+		.priv = PQM_ACTIVE_POWER,
+	},
+	{
+		.name = "reactive_power",
+		.show = read_power_attr,
+		.priv = PQM_REACTIVE_POWER,
+	},
+	{
+		.name = "apparent_power",
+		.show = read_power_attr,
+		.priv = PQM_APPARENT_POWER,
+	},
+	{
+		.name = "power_factor",
+		.show = read_power_attr,
+		.priv = PQM_POWER_FACTOR,
+	},
+	{
+		.name = "harmonic_power",
+		.show = read_harmonic_power_attr,
+		.priv = PQM_HARMONIC_POWER,
+	},
+	{
+		.name = "harmonic_direction",
+		.show = read_harmonic_power_attr,
+		.priv = PQM_HARMONIC_DIRECTION,
+	},
+	{
+		.name = "active_energy_import",
+		.show = read_energy_attr,
+		.priv = PQM_EP_IMPORT,
+	},
+	{
+		.name = "active_energy_export",
+		.show = read_energy_attr,
+		.priv = PQM_EP_EXPORT,
+	},
+	{
+		.name = "reactive_energy_import",
+		.show = read_energy_attr,
+		.priv = PQM_EQ_IMPORT,
+	},
+	{
+		.name = "reactive_energy_export",
+		.show = read_energy_attr,
+		.priv = PQM_EQ_EXPORT,
+	},
+	END_ATTRIBUTES_ARRAY,
+};
+
+struct iio_attribute global_pqm_attributes[] = {
+	{
+		.name = "u2",
+		.show = read_pqm_attr,
+		.priv = PQM_U2,
+	},
+	{
+		.name = "u0",
+		.show = read_pqm_attr,
+		.priv = PQM_U0,
+	},
+	{
+		.name = "sneg_voltage",
+		.show = read_pqm_attr,
+		.priv = PQM_SNEG_VOLTAGE,
+	},
+	{
+		.name = "spos_voltage",
+		.show = read_pqm_attr,
+		.priv = PQM_SPOS_VOLTAGE,
+	},
+	{
+		.name = "szro_voltage",
+		.show = read_pqm_attr,
+		.priv = PQM_SZRO_VOLTAGE,
+	},
+	{
+		.name = "i2",
+		.show = read_pqm_attr,
+		.priv = PQM_I2,
+	},
+	{
+		.name = "i0",
+		.show = read_pqm_attr,
+		.priv = PQM_I0,
+	},
+	{
+		.name = "sneg_current",
+		.show = read_pqm_attr,
+		.priv = PQM_SNEG_CURRENT,
+	},
+	{
+		.name = "spos_current",
+		.show = read_pqm_attr,
+		.priv = PQM_SPOS_CURRENT,
+	},
+	{
+		.name = "szro_current",
+		.show = read_pqm_attr,
+		.priv = PQM_SZRO_CURRENT,
+	},
+	{
+		.name = "active_power",
+		.show = read_total_power_attr,
+		.priv = PQM_ACTIVE_POWER,
+	},
+	{
+		.name = "reactive_power",
+		.show = read_total_power_attr,
+		.priv = PQM_REACTIVE_POWER,
+	},
+	{
+		.name = "apparent_power",
+		.show = read_total_power_attr,
+		.priv = PQM_APPARENT_POWER,
+	},
+	{
+		.name = "power_factor",
+		.show = read_total_power_attr,
+		.priv = PQM_POWER_FACTOR,
+	},
+	{
+		.name = "active_energy_import",
+		.show = read_total_energy_attr,
+		.priv = PQM_EP_IMPORT,
+	},
+	{
+		.name = "active_energy_export",
+		.show = read_total_energy_attr,
+		.priv = PQM_EP_EXPORT,
+	},
+	{
+		.name = "reactive_energy_import",
+		.show = read_total_energy_attr,
+		.priv = PQM_EQ_IMPORT,
+	},
+	{
+		.name = "reactive_energy_export",
+		.show = read_total_energy_attr,
+		.priv = PQM_EQ_EXPORT,
+	},
+	{
+		.name = "nominal_voltage",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_NOMINAL_VOLTAGE,
+	},
+	{
+		.name = "voltage_scale",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_VOLTAGE_SCALE,
 	},
 	{
-		.name = "deviation_under",
-		.show = read_ch_attr,
-		.priv = 2,
+		.name = "current_scale",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_CURRENT_SCALE,
 	},
 	{
-		.name = "deviation_over",
-		.show = read_ch_attr,
-		.priv = 3,
+		.name = "i_consel_en",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_I_CONSEL_EN,
+	},
+	{
+		.name = "dip_threshold",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_DIP_THRESHOLD,
+	},
+	{
+		.name = "dip_hysteresis",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_DIP_HYSTERESIS,
+	},
+	{
+		.name = "swell_threshold",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_SWELL_THRESHOLD,
+	},
+	{
+		.name = "swell_hysteresis",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_SWELL_HYSTERESIS,
+	},
+	{
+		.name = "intrp_threshold",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_INTRP_THRESHOLD,
+	},
+	{
+		.name = "intrp_hysteresis",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_INTRP_HYSTERESIS,
+	},
+	{
+		.name = "rvc_threshold",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_RVC_THRESHOLD,
+	},
+	{
+		.name = "rvc_hysteresis",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_RVC_HYSTERESIS,
+	},
+	{
+		.name = "events",
+		.show = read_events_attr,
+	},
+	{
+		.name = "transients",
+		.show = read_transients_attr,
+	},
+	{
+		.name = "msv_carrier_frequency",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_MSV_CARRIER_FREQUENCY,
+	},
+	{
+		.name = "msv_record_length",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_MSV_RECORD_LENGTH,
 	},
 	{
-		.name = "pinst",
-		.show = read_ch_attr,
-		.priv = 4,
+		.name = "msv_threshold",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_MSV_THRESHOLD,
+	},
+	{
+		.name = "msv_record",
+		.show = read_msv_record_attr,
+	},
+	{
+		.name = "sampling_frequency",
+		.show = read_pqm_attr,
+		.store = write_pqm_attr,
+		.priv = PQM_SAMPLING_FREQUENCY,
+	},
+	{
+		.name = "v_consel",
+		.show = read_v_consel_attr,
+		.store = write_v_consel_attr,
+		.priv = PQM_V_CONSEL,
+	},
+	{
+		.name = "v_consel_available",
+		.show = read_available_values,
+		.priv = V_CONSEL,
+	},
+	{
+		.name = "flicker_model",
+		.show = read_flicker_model_attr,
+		.store = write_flicker_model_attr,
+		.priv = PQM_FLICKER_MODEL,
+	},
+	{
+		.name = "flicker_model_available",
+		.show = read_available_values,
+		.priv = FLICKER_MODEL,
+	},
+	{
+		.name = "nominal_frequency",
+		.show = read_nominal_freq_attr,
+		.store = write_nominal_freq_attr,
+		.priv = PQM_NOMINAL_FREQUENCY,
+	},
+	{
+		.name = "frequency",
+		.show = read_pqm_attr,
+		.priv = PQM_FREQUENCY,
+	},
+	{
+		.name = "aggregates",
+		.show = read_aggregates_attr,
+	},
+	{
+		.name = "weekly_stats",
+		.show = read_weekly_stats_attr,
+		.priv = true,
+	},
+	{
+		.name = "weekly_stats_current",
+		.show = read_weekly_stats_attr,
+		.priv = false,
+	},
+	{
+		.name = "harmonics_slice",
+		.show = read_harmonics_slice_attr,
+		.store = write_harmonics_slice_attr,
+	},
+	{
+		.name = "stage_lease",
+		.show = read_stage_lease_attr,
+		.store = write_stage_lease_attr,
+	},
+	{
+		.name = "stage_subscriptions",
+		.show = read_stage_subscriptions_attr,
+		.store = write_stage_subscriptions_attr,
+	},
+	{
+		.name = "stage_available",
+		.show = read_available_values,
+		.priv = STAGE,
+	},
+	{
+		.name = "nominal_frequency_available",
+		.show = read_available_values,
+		.store = write_nominal_freq_attr,
+		.priv = NOMINAL_FREQUENCY,
+	},
+	END_ATTRIBUTES_ARRAY,
+};
+
+/**
+ * @brief Read a pqm debug attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_pqm_debug_attr(void *device, char *buf, uint32_t len,
+			const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t pos;
+	uint32_t s;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	switch (attr_id) {
+	case PQM_DBG_RING_OVERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->ring.overruns);
+	case PQM_DBG_RING_UNDERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->ring.underruns);
+	case PQM_DBG_PP_OVERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->pp.overruns);
+	case PQM_DBG_PP_UNDERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->pp.underruns);
+	case PQM_DBG_COMPRESSION_RATIO:
+		/* Raw to compressed size, in thousandths */
+		if (!desc->comp_bytes)
+			return snprintf(buf, len, "0");
+		return snprintf(buf, len, "%" PRIu64 "",
+				desc->comp_raw_bytes * 1000 / desc->comp_bytes);
+	case PQM_DBG_FFT_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->harm.last_cycles);
+	case PQM_DBG_FFT_OVERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->harm.overruns);
+	case PQM_DBG_FLICKER_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->flicker.last_cycles);
+	case PQM_DBG_FLICKER_OVERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->flicker.overruns);
+	case PQM_DBG_SEQ_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->seq.last_cycles);
+	case PQM_DBG_EVENT_OVERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->events.overruns);
+	case PQM_DBG_MSV_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->msv.last_cycles);
+	case PQM_DBG_MSV_OVERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->msv.overruns);
+	case PQM_DBG_FREQ_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->freq.last_cycles);
+	case PQM_DBG_SDFT_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->sdft.last_cycles);
+	case PQM_DBG_RMS_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->rms.last_cycles);
+	case PQM_DBG_CHECKPOINT_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->energy.last_cycles);
+	case PQM_DBG_NV_ERRORS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->energy.nv_errors);
+	case PQM_DBG_CHECKPOINT_LOST_SCANS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->energy.lost_scans);
+	case PQM_DBG_CAL_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->cal.last_cycles);
+	case PQM_DBG_FLOAT_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->float_cycles);
+	case PQM_DBG_STAGE_ACTIVE:
+		return pqm_format_stages(buf, len, desc->stages.active);
+	case PQM_DBG_STAGE_CPU:
+		/* One line per stage, share of the last second in thousandths */
+		pos = 0;
+		for (s = 0; s < PQM_STAGES && pos < len; s++)
+			pos += snprintf(buf + pos, len - pos, "%s %" PRIu32 "\n",
+					pqm_stage_names[s], desc->stages.share[s]);
+		return no_os_min(pos, len - 1);
+	case PQM_DBG_FFT_SLICE_MAX:
+		return snprintf(buf, len, "%" PRIu32 "", desc->harm.slice_max);
+	case PQM_DBG_FFT_SLICE_HIST:
+		/* Bucket b > 0 counts slices of 2^(b + 10) to 2^(b + 11) cycles */
+		pos = 0;
+		for (s = 0; s < PQM_HARM_HIST_BUCKETS && pos < len; s++)
+			pos += snprintf(buf + pos, len - pos, "%s%" PRIu32 "",
+					s ? " " : "", desc->harm.slice_hist[s]);
+		return no_os_min(pos, len - 1);
+	case PQM_DBG_AGG_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "", desc->agg.last_cycles);
+	case PQM_DBG_AGG_OVERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "", desc->agg.overruns);
+	case PQM_DBG_TRANSIENT_CYCLES:
+		return snprintf(buf, len, "%" PRIu32 "",
+				desc->transient.last_cycles);
+	case PQM_DBG_TRANSIENT_OVERRUNS:
+		return snprintf(buf, len, "%" PRIu32 "",
+				desc->transient.overruns);
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * @brief Read the capture_mode buffer attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_capture_mode_attr(void *device, char *buf, uint32_t len,
+			   const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	strncpy(buf, pqm_capture_mode_available[desc->capture_mode], len);
+	return strlen(buf);
+}
+
+/**
+ * @brief Write the capture_mode buffer attribute. Not allowed while a buffer
+ * session is running.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_capture_mode_attr(void *device, char *buf, uint32_t len,
+			    const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	if (desc->active_ch)
+		return -EBUSY;
+	int data_size = NO_OS_ARRAY_SIZE(pqm_capture_mode_available);
+	for (int i = 0; i < data_size; i++) {
+		if (strcmp(buf, pqm_capture_mode_available[i]) == 0) {
+			if (i != PQM_CAPTURE_RING &&
+			    desc->compression != PQM_COMPRESSION_NONE)
+				return -EINVAL;
+			if (i == PQM_CAPTURE_SNAPSHOT && !desc->capture.nb_scans)
+				return -EINVAL;
+			/* The history starts when snapshot mode is selected */
+			if (i == PQM_CAPTURE_SNAPSHOT &&
+			    desc->capture_mode != PQM_CAPTURE_SNAPSHOT)
+				pqm_capture_arm(&desc->capture);
+			else if (i != PQM_CAPTURE_SNAPSHOT)
+				pqm_capture_stop(&desc->capture);
+			desc->capture_mode = i;
+			return len;
+		}
+	}
+	return -EINVAL;
+}
+
+/**
+ * @brief Read the scan_format buffer attribute: the transport format chosen
+ * at build time with PQM_SCAN_FORMAT.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_scan_format_attr(void *device, char *buf, uint32_t len,
+			  const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	strncpy(buf, pqm_scan_format_available[desc->scan_format], len);
+	return strlen(buf);
+}
+
+/**
+ * @brief Read the compression buffer attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_compression_attr(void *device, char *buf, uint32_t len,
+			  const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	strncpy(buf, pqm_compression_available[desc->compression], len);
+	return strlen(buf);
+}
+
+/**
+ * @brief Write the compression buffer attribute. Only available with ring
+ * capture and the be32 scan_format, and not allowed while a buffer session
+ * is running.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_compression_attr(void *device, char *buf, uint32_t len,
+			   const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	if (desc->active_ch)
+		return -EBUSY;
+	int data_size = NO_OS_ARRAY_SIZE(pqm_compression_available);
+	for (int i = 0; i < data_size; i++) {
+		if (strcmp(buf, pqm_compression_available[i]) == 0) {
+			if (i != PQM_COMPRESSION_NONE &&
+			    (desc->capture_mode != PQM_CAPTURE_RING ||
+			     desc->scan_format != PQM_SCAN_BE32))
+				return -EINVAL;
+			desc->compression = i;
+			return len;
+		}
+	}
+	return -EINVAL;
+}
+
+/**
+ * @brief Read the calibrated buffer attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_calibrated_attr(void *device, char *buf, uint32_t len,
+			 const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	return snprintf(buf, len, "%d", desc->stream_calibrated);
+}
+
+/**
+ * @brief Write the calibrated buffer attribute: 1 to stream the scans
+ * seen by the measurement engines, 0 for the raw ones. float32 sessions are
+ * always calibrated. Not allowed while a buffer session is running.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_calibrated_attr(void *device, char *buf, uint32_t len,
+			  const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	if (desc->active_ch)
+		return -EBUSY;
+	desc->stream_calibrated = !!no_os_str_to_uint32(buf);
+	return len;
+}
+
+/**
+ * @brief Read the capture_pre, capture_post and capture_level buffer
+ * attributes: nominal cycles before and from the trigger, level trigger in
+ * codes.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_capture_attr(void *device, char *buf, uint32_t len,
+		      const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t val;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	switch (attr_id) {
+	case PQM_CAPTURE_PRE_CYCLES:
+		val = desc->capture_pre;
+		break;
+	case PQM_CAPTURE_POST_CYCLES:
+		val = desc->capture_post;
+		break;
+	case PQM_CAPTURE_LEVEL_CODES:
+		val = desc->capture.level;
+		break;
+	default:
+		return -EINVAL;
+	}
+	return snprintf(buf, len, "%" PRIu32 "", val);
+}
+
+/**
+ * @brief Write the capture_pre, capture_post and capture_level buffer
+ * attributes. pre + post, in nominal cycles, must fit the capture history;
+ * a new length drops the frozen slot and restarts the history. A change of
+ * sampling or nominal frequency resizes the slot, cut to the history.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_capture_attr(void *device, char *buf, uint32_t len,
+		       const struct iio_ch_info *channel, intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t val;
+	int ret;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	val = no_os_str_to_uint32(buf);
+	switch (attr_id) {
+	case PQM_CAPTURE_PRE_CYCLES:
+		ret = pqm_set_capture(desc, val, desc->capture_post);
+		break;
+	case PQM_CAPTURE_POST_CYCLES:
+		ret = pqm_set_capture(desc, desc->capture_pre, val);
+		break;
+	case PQM_CAPTURE_LEVEL_CODES:
+		desc->capture.level = val;
+		ret = 0;
+		break;
+	default:
+		return -EINVAL;
+	}
+	return ret ? ret : (int)len;
+}
+
+/**
+ * @brief Read the capture_sources buffer attribute.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_capture_sources_attr(void *device, char *buf, uint32_t len,
+			      const struct iio_ch_info *channel,
+			      intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t pos = 0;
+	uint32_t s;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	buf[0] = '\0';
+	for (s = 0; s < PQM_CAPTURE_SOURCES && pos < len; s++)
+		if (desc->capture.sources & NO_OS_BIT(s))
+			pos += snprintf(buf + pos, len - pos, pos ? " %s" : "%s",
+					pqm_capture_source_names[s]);
+	return no_os_min(pos, len - 1);
+}
+
+/**
+ * @brief Write the capture_sources buffer attribute: space separated list of
+ * the sources that trigger the capture. A manual trigger is always honoured.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_capture_sources_attr(void *device, char *buf, uint32_t len,
+			       const struct iio_ch_info *channel,
+			       intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	uint32_t mask = 0;
+	const char *p = buf;
+	size_t n;
+	uint32_t s;
+
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	p += strspn(p, " \n");
+	while (*p) {
+		n = strcspn(p, " \n");
+		for (s = 0; s < PQM_CAPTURE_SOURCES; s++)
+			if (strlen(pqm_capture_source_names[s]) == n &&
+			    !strncmp(p, pqm_capture_source_names[s], n))
+				break;
+		if (s == PQM_CAPTURE_SOURCES)
+			return -EINVAL;
+		mask |= NO_OS_BIT(s);
+		p += n;
+		p += strspn(p, " \n");
+	}
+	desc->capture.sources = mask;
+	return len;
+}
+
+/**
+ * @brief Read the capture_trigger buffer attribute: state of the capture,
+ * then, for a frozen slot, its source, its scans before the trigger and its
+ * total scans, then the number of slots frozen so far.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int read_capture_trigger_attr(void *device, char *buf, uint32_t len,
+			      const struct iio_ch_info *channel,
+			      intptr_t attr_id)
+{
+	struct pqm_capture *cap;
+	uint32_t state;
+	if (!device)
+		return -ENODEV;
+	cap = &((struct pqm_desc *)device)->capture;
+	state = __atomic_load_n(&cap->state, __ATOMIC_ACQUIRE);
+	if (state != PQM_CAPTURE_FROZEN)
+		return snprintf(buf, len, "%s %" PRIu32 "",
+				pqm_capture_state_names[state], cap->count);
+	return snprintf(buf, len, "%s %s %" PRIu32 " %" PRIu32 " %" PRIu32 "",
+			pqm_capture_state_names[state],
+			pqm_capture_source_names[cap->cause], cap->pre_valid,
+			cap->len, cap->count);
+}
+
+/**
+ * @brief Write the capture_trigger buffer attribute: trigger the capture on
+ * the next scan, if it is armed.
+ *
+ * @param device    - The iio device structure
+ * @param buf       - Buffer to be filled with requested data
+ * @param len 	    - Length of the received command buffer in bytes
+ * @param channel   - Command channel info
+ * @param attr_type - attribute descriptor
+ * @return          - The length of the buffer in case of success, negative value otherwise
+ */
+int write_capture_trigger_attr(void *device, char *buf, uint32_t len,
+			       const struct iio_ch_info *channel,
+			       intptr_t attr_id)
+{
+	struct pqm_desc *desc;
+	if (!device)
+		return -ENODEV;
+	desc = device;
+	if (desc->capture.state != PQM_CAPTURE_ARMED)
+		return -EBUSY;
+	desc->capture.force = true;
+	return len;
+}
+
+struct iio_attribute debug_pqm_attributes[] = {
+	{
+		.name = "ring_overruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_RING_OVERRUNS,
 	},
 	{
-		.name = "pst",
-		.show = read_ch_attr,
-		.priv = 5,
+		.name = "ring_underruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_RING_UNDERRUNS,
 	},
 	{
-		.name = "plt",
-		.show = read_ch_attr,
-		.priv = 6,
+		.name = "pp_overruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_PP_OVERRUNS,
 	},
 	{
-		.name = "thd",
-		.show = read_ch_attr,
-		.priv = 7,
+		.name = "pp_underruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_PP_UNDERRUNS,
 	},
 	{
-		.name = "harmonics",
-		.show = read_ch_attr,
-		.priv = 8,
+		.name = "compression_ratio",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_COMPRESSION_RATIO,
 	},
 	{
-		.name = "raw",
-		.show = read_ch_attr,
-		.priv = 9,
+		.name = "fft_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_FFT_CYCLES,
 	},
-	END_ATTRIBUTES_ARRAY,
-};
-
-struct iio_attribute current_pqm_attributes[] = {
-
 	{
-		.name = "rms",
-		.show = read_ch_attr,
-		.priv = 0,
+		.name = "fft_overruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_FFT_OVERRUNS,
 	},
 	{
-		.name = "angle",
-		.show = read_ch_attr,
-		.priv = 1,
+		.name = "flicker_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_FLICKER_CYCLES,
 	},
 	{
-		.name = "thd",
-		.show = read_ch_attr,
-		.priv = 2,
+		.name = "flicker_overruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_FLICKER_OVERRUNS,
 	},
 	{
-		.name = "harmonics",
-		.show = read_ch_attr,
-		.priv = 3,
+		.name = "seq_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_SEQ_CYCLES,
 	},
 	{
-		.name = "raw",
-		.show = read_ch_attr,
-		.priv = 4,
+		.name = "event_overruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_EVENT_OVERRUNS,
 	},
-	END_ATTRIBUTES_ARRAY,
-};
-
-struct iio_attribute global_pqm_attributes[] = {
 	{
-		.name = "u2",
-		.show = read_pqm_attr,
-		.priv = 0,
+		.name = "msv_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_MSV_CYCLES,
 	},
 	{
-		.name = "u0",
-		.show = read_pqm_attr,
-		.priv = 1,
+		.name = "msv_overruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_MSV_OVERRUNS,
 	},
 	{
-		.name = "sneg_voltage",
-		.show = read_pqm_attr,
-		.priv = 2,
+		.name = "freq_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_FREQ_CYCLES,
 	},
 	{
-		.name = "spos_voltage",
-		.show = read_pqm_attr,
-		.priv = 3,
+		.name = "sdft_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_SDFT_CYCLES,
 	},
 	{
-		.name = "szro_voltage",
-		.show = read_pqm_attr,
-		.priv = 4,
+		.name = "rms_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_RMS_CYCLES,
 	},
 	{
-		.name = "i2",
-		.show = read_pqm_attr,
-		.priv = 5,
+		.name = "checkpoint_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_CHECKPOINT_CYCLES,
 	},
 	{
-		.name = "i0",
-		.show = read_pqm_attr,
-		.priv = 6,
+		.name = "nv_errors",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_NV_ERRORS,
 	},
 	{
-		.name = "sneg_current",
-		.show = read_pqm_attr,
-		.priv = 7,
+		.name = "checkpoint_lost_scans",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_CHECKPOINT_LOST_SCANS,
 	},
 	{
-		.name = "spos_current",
-		.show = read_pqm_attr,
-		.priv = 8,
+		.name = "cal_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_CAL_CYCLES,
 	},
 	{
-		.name = "szro_current",
-		.show = read_pqm_attr,
-		.priv = 9,
+		.name = "float_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_FLOAT_CYCLES,
 	},
 	{
-		.name = "nominal_voltage",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 10,
+		.name = "stage_active",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_STAGE_ACTIVE,
 	},
 	{
-		.name = "voltage_scale",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 11,
+		.name = "stage_cpu",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_STAGE_CPU,
 	},
 	{
-		.name = "current_scale",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 12,
+		.name = "fft_slice_max",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_FFT_SLICE_MAX,
 	},
 	{
-		.name = "i_consel_en",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 13,
+		.name = "fft_slice_hist",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_FFT_SLICE_HIST,
 	},
 	{
-		.name = "dip_threshold",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 14,
+		.name = "agg_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_AGG_CYCLES,
 	},
 	{
-		.name = "dip_hysteresis",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 15,
+		.name = "agg_overruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_AGG_OVERRUNS,
 	},
 	{
-		.name = "swell_threshold",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 16,
+		.name = "transient_cycles",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_TRANSIENT_CYCLES,
 	},
 	{
-		.name = "swell_hysteresis",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 17,
+		.name = "transient_overruns",
+		.show = read_pqm_debug_attr,
+		.priv = PQM_DBG_TRANSIENT_OVERRUNS,
 	},
+	END_ATTRIBUTES_ARRAY,
+};
+
+struct iio_attribute buffer_pqm_attributes[] = {
 	{
-		.name = "intrp_threshold",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 18,
+		.name = "scans_per_trigger",
+		.show = read_scans_per_trigger_attr,
+		.store = write_scans_per_trigger_attr,
 	},
 	{
-		.name = "intrp_hysteresis",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 19,
+		.name = "capture_mode",
+		.show = read_capture_mode_attr,
+		.store = write_capture_mode_attr,
 	},
 	{
-		.name = "rvc_threshold",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 20,
+		.name = "capture_mode_available",
+		.show = read_available_values,
+		.priv = CAPTURE_MODE,
 	},
 	{
-		.name = "rvc_hysteresis",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 21,
+		.name = "scan_format",
+		.show = read_scan_format_attr,
 	},
 	{
-		.name = "msv_carrier_frequency",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 22,
+		.name = "compression",
+		.show = read_compression_attr,
+		.store = write_compression_attr,
 	},
 	{
-		.name = "msv_record_length",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 23,
+		.name = "compression_available",
+		.show = read_available_values,
+		.priv = COMPRESSION,
 	},
 	{
-		.name = "msv_threshold",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 24,
+		.name = "calibrated",
+		.show = read_calibrated_attr,
+		.store = write_calibrated_attr,
 	},
 	{
-		.name = "sampling_frequency",
-		.show = read_pqm_attr,
-		.store = write_pqm_attr,
-		.priv = 25,
+		.name = "capture_pre",
+		.show = read_capture_attr,
+		.store = write_capture_attr,
+		.priv = PQM_CAPTURE_PRE_CYCLES,
 	},
 	{
-		.name = "v_consel",
-		.show = read_v_consel_attr,
-		.store = write_v_consel_attr,
-		.priv = 26,
+		.name = "capture_post",
+		.show = read_capture_attr,
+		.store = write_capture_attr,
+		.priv = PQM_CAPTURE_POST_CYCLES,
 	},
 	{
-		.name = "v_consel_available",
-		.show = read_available_values,
-		.priv = V_CONSEL,
+		.name = "capture_level",
+		.show = read_capture_attr,
+		.store = write_capture_attr,
+		.priv = PQM_CAPTURE_LEVEL_CODES,
 	},
 	{
-		.name = "flicker_model",
-		.show = read_flicker_model_attr,
-		.store = write_flicker_model_attr,
-		.priv = 27,
+		.name = "capture_sources",
+		.show = read_capture_sources_attr,
+		.store = write_capture_sources_attr,
 	},
 	{
-		.name = "flicker_model_available",
+		.name = "capture_sources_available",
 		.show = read_available_values,
-		.priv = FLICKER_MODEL,
-	},
-	{
-		.name = "nominal_frequency",
-		.show = read_nominal_freq_attr,
-		.store = write_nominal_freq_attr,
-		.priv = 28,
+		.priv = CAPTURE_SOURCE,
 	},
 	{
-		.name = "nominal_frequency_available",
-		.show = read_available_values,
-		.store = write_nominal_freq_attr,
-		.priv = NOMINAL_FREQUENCY,
+		.name = "capture_trigger",
+		.show = read_capture_trigger_attr,
+		.store = write_capture_trigger_attr,
 	},
 	END_ATTRIBUTES_ARRAY,
 };
 
-struct scan_type pqm_scan_type = {
-	.sign = 'u',
-	.realbits = 24,
-	.storagebits = 32,
-	.shift = 0,
-	.is_big_endian = true
-};
+/* Scan layout of every channel */
+#define PQM_SCAN_TYPE (&pqm_scan_formats[PQM_SCAN_FORMAT])
 
 #define PQM_VOLTAGE_CHANNEL(_idx, _scan_idx, _name) \
 	{                                               \
@@ -737,7 +2886,7 @@ struct scan_type pqm_scan_type = {
 		.channel = _idx,                            \
 		.scan_index = _scan_idx,                    \
 		.indexed = true,                            \
-		.scan_type = &pqm_scan_type,                \
+		.scan_type = PQM_SCAN_TYPE,                 \
 		.attributes = voltage_pqm_attributes,       \
 		.ch_out = false                             \
 	}
@@ -749,7 +2898,7 @@ struct scan_type pqm_scan_type = {
 		.channel = _idx,                            \
 		.scan_index = _scan_idx,                    \
 		.indexed = true,                            \
-		.scan_type = &pqm_scan_type,                \
+		.scan_type = PQM_SCAN_TYPE,                 \
 		.attributes = current_pqm_attributes,       \
 		.ch_out = false                             \
 	}
@@ -768,8 +2917,8 @@ struct iio_device pqm_iio_descriptor = {
 	.num_ch = TOTAL_PQM_CHANNELS,
 	.channels = iio_pqm_channels,
 	.attributes = global_pqm_attributes,
-	.debug_attributes = NULL,
-	.buffer_attributes = NULL,
+	.debug_attributes = debug_pqm_attributes,
+	.buffer_attributes = buffer_pqm_attributes,
 	.pre_enable = update_pqm_channels,
 	.post_disable = close_pqm_channels,
 	.trigger_handler = (int32_t (*)())pqm_trigger_handler,
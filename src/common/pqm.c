@@ -40,9 +40,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include "no_os_error.h"
 #include "no_os_util.h"
 #include "no_os_alloc.h"
+#include "no_os_circular_buffer.h"
 
 /* default sine lookup table to be used if ext_buff is not available */
 const uint32_t sine_lut[112] = {
@@ -64,10 +66,695 @@ const uint32_t sine_lut[112] = {
 	0x0001, 0x0008, 0x000C, 0x0010, 0x0020, 0x0030, 0x0040
 };
 
+/**
+ * @brief Read the next full scan from the sample source.
+ * @param desc - descriptor for the pqm
+ * @param scan - TOTAL_PQM_CHANNELS words, return param.
+ */
+static void pqm_read_source(struct pqm_desc *desc, uint32_t *scan)
+{
+	const uint16_t *src;
+	uint32_t src_len;
+	uint32_t ch;
+
+	if (desc->ext_buff == NULL) {
+		/* sine_lut holds full scans of TOTAL_PQM_CHANNELS samples */
+		src_len = NO_OS_ARRAY_SIZE(sine_lut) / TOTAL_PQM_CHANNELS;
+		memcpy(scan, &sine_lut[desc->acq_idx * TOTAL_PQM_CHANNELS],
+		       TOTAL_PQM_CHANNELS * sizeof(*scan));
+	} else {
+		/* ext_buff holds src_len 16-bit samples per channel */
+		src = (const uint16_t *)desc->ext_buff;
+		src_len = desc->ext_buff_len;
+		for (ch = 0; ch < TOTAL_PQM_CHANNELS; ch++)
+			scan[ch] = src[ch * src_len + desc->acq_idx];
+	}
+
+	if (++desc->acq_idx >= src_len)
+		desc->acq_idx = 0;
+}
+
+/**
+ * @brief Run the active measurement engines on a full scan and publish the
+ * results of every completed window.
+ * @param desc - descriptor for the pqm
+ * @param scan - full scan of TOTAL_PQM_CHANNELS words
+ */
+static void pqm_measure(struct pqm_desc *desc, const uint32_t *scan)
+{
+	struct pqm_stages *st = &desc->stages;
+	uint32_t active = __atomic_load_n(&st->active, __ATOMIC_ACQUIRE);
+	uint32_t start, t;
+	uint32_t ch;
+
+	if (active & NO_OS_BIT(PQM_STAGE_FLICKER)) {
+		start = pqm_cycles();
+		if (pqm_flicker_feed(&desc->flicker, scan)) {
+			for (ch = 0; ch < VOLTAGE_CH_NUMBER; ch++)
+				__atomic_store_n(&desc->pqm_ch_attr[ch][PQM_VOLTAGE_PINST],
+						 desc->flicker.pinst[ch], __ATOMIC_RELAXED);
+			desc->flicker.last_cycles = pqm_cycles() - start;
+		}
+		st->isr_cycles[PQM_STAGE_FLICKER] += pqm_cycles() - start;
+	}
+
+	if (active & NO_OS_BIT(PQM_STAGE_RMS)) {
+		start = pqm_cycles();
+		if (pqm_rms_update(&desc->rms, scan)) {
+			/* RMS is the first attribute of voltage and current rows alike */
+			for (ch = 0; ch < TOTAL_PQM_CHANNELS; ch++)
+				__atomic_store_n(&desc->pqm_ch_attr[ch][PQM_VOLTAGE_RMS],
+						 desc->rms.value[ch], __ATOMIC_RELAXED);
+			pqm_energy_add(&desc->energy, &desc->rms.power, desc->rms.window);
+			pqm_agg_push(&desc->agg, desc->rms.value, desc->rms.window,
+				     pqm_event_flag(&desc->events));
+		}
+		desc->rms.last_cycles = pqm_cycles() - start;
+		st->isr_cycles[PQM_STAGE_RMS] += desc->rms.last_cycles;
+	}
+
+	if (active & NO_OS_BIT(PQM_STAGE_FREQ)) {
+		start = pqm_cycles();
+		if (pqm_freq_feed(&desc->freq, scan))
+			__atomic_store_n(&desc->pqm_global_attr[PQM_FREQUENCY],
+					 desc->freq.value, __ATOMIC_RELAXED);
+		desc->freq.last_cycles = pqm_cycles() - start;
+		st->isr_cycles[PQM_STAGE_FREQ] += desc->freq.last_cycles;
+	}
+
+	if (active & NO_OS_BIT(PQM_STAGE_SDFT)) {
+		start = pqm_cycles();
+		pqm_sdft_feed(&desc->sdft, scan);
+		desc->sdft.last_cycles = pqm_cycles() - start;
+		st->isr_cycles[PQM_STAGE_SDFT] += desc->sdft.last_cycles;
+	}
+
+	if (active & NO_OS_BIT(PQM_STAGE_HARM)) {
+		start = pqm_cycles();
+		pqm_harm_track(&desc->harm, desc->freq.period);
+		pqm_harm_feed(&desc->harm, scan);
+		st->isr_cycles[PQM_STAGE_HARM] += pqm_cycles() - start;
+	}
+
+	if (active & NO_OS_BIT(PQM_STAGE_SEQ)) {
+		start = pqm_cycles();
+		pqm_seq_feed(&desc->seq, scan);
+		t = pqm_cycles() - start;
+		st->isr_cycles[PQM_STAGE_SEQ] += t;
+		desc->seq.cycles += t;
+		if (!desc->seq.count) {
+			desc->seq.last_cycles = desc->seq.cycles;
+			desc->seq.cycles = 0;
+		}
+	}
+
+	if (active & NO_OS_BIT(PQM_STAGE_EVENT)) {
+		start = pqm_cycles();
+		pqm_event_feed(&desc->events, scan);
+		st->isr_cycles[PQM_STAGE_EVENT] += pqm_cycles() - start;
+	}
+
+	if (active & NO_OS_BIT(PQM_STAGE_MSV)) {
+		start = pqm_cycles();
+		pqm_msv_feed(&desc->msv, scan);
+		t = pqm_cycles() - start;
+		st->isr_cycles[PQM_STAGE_MSV] += t;
+		desc->msv.cycles += t;
+		if (!desc->msv.count) {
+			desc->msv.last_cycles = desc->msv.cycles;
+			desc->msv.cycles = 0;
+		}
+	}
+
+	if (active & NO_OS_BIT(PQM_STAGE_TRANSIENT)) {
+		start = pqm_cycles();
+		pqm_transient_track(&desc->transient, desc->freq.period);
+		pqm_transient_feed(&desc->transient, scan);
+		desc->transient.last_cycles = pqm_cycles() - start;
+		st->isr_cycles[PQM_STAGE_TRANSIENT] += desc->transient.last_cycles;
+	}
+
+	__atomic_store_n(&st->now, st->now + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Acquisition interrupt: moves one scan from the source to the
+ * capture path selected for the current buffer session.
+ * @param dev - descriptor for the pqm
+ */
+void pqm_acquisition_handler(void *dev)
+{
+	struct pqm_desc *desc = dev;
+	uint32_t raw[TOTAL_PQM_CHANNELS];
+	uint32_t cal[TOTAL_PQM_CHANNELS];
+	const uint32_t *scan = raw;
+	uint32_t events, ago = 0;
+	uint32_t start, gap;
+
+	if (desc->ext_buff != NULL && !desc->ext_buff_len)
+		return;
+
+	start = pqm_cycles();
+	if (desc->scan_cycles && desc->acq_stamp) {
+		/* Timer periods elapsed while held back were merged into one */
+		gap = start - desc->acq_stamp;
+		if (gap >= 2 * desc->scan_cycles)
+			desc->lost_scans += gap / desc->scan_cycles - 1;
+	}
+	desc->acq_stamp = start;
+
+	pqm_read_source(desc, raw);
+	if (!desc->cal.identity) {
+		start = pqm_cycles();
+		pqm_cal_apply(&desc->cal, raw, cal);
+		desc->cal.last_cycles = pqm_cycles() - start;
+		scan = cal;
+	}
+	pqm_measure(desc, scan);
+	events = pqm_event_started(&desc->events, &ago);
+	/* Engineering units are always calibrated */
+	if (!desc->stream_calibrated && desc->scan_format != PQM_SCAN_FLOAT32)
+		scan = raw;
+	if (desc->capture_mode == PQM_CAPTURE_SNAPSHOT) {
+		pqm_capture_feed(&desc->capture, scan, events, ago);
+		return;
+	}
+	if (desc->capture_mode == PQM_CAPTURE_PING_PONG) {
+		if (__atomic_load_n(&desc->pp.armed, __ATOMIC_ACQUIRE))
+			pqm_pp_produce(&desc->pp, scan, desc->active_ch_idx);
+		return;
+	}
+	pqm_ring_push(&desc->ring, scan);
+}
+
+/**
+ * @brief Nominal cycles of a measurement window: 10 cycles at 50 Hz and 12
+ * cycles at 60 Hz, i.e. 200 ms as per IEC 61000-4-30.
+ * @param desc - descriptor for the pqm
+ * @param cycles - cycles in a window, return param.
+ * @param f_nom - nominal frequency in Hz, return param.
+ */
+static void pqm_nominal(struct pqm_desc *desc, uint32_t *cycles,
+			uint32_t *f_nom)
+{
+	if (desc->pqm_global_attr[PQM_NOMINAL_FREQUENCY] == _60) {
+		*cycles = 12;
+		*f_nom = 60;
+	} else {
+		*cycles = 10;
+		*f_nom = 50;
+	}
+}
+
+/**
+ * @brief Restart an analysis stage from scratch, for the current sampling
+ * and nominal frequency. Called with the acquisition stopped.
+ * @param desc - descriptor for the pqm
+ * @param stage - stage to be restarted
+ */
+static void pqm_stage_start(struct pqm_desc *desc, enum pqm_stage_id stage)
+{
+	uint32_t fs = desc->pqm_global_attr[PQM_SAMPLING_FREQUENCY];
+	uint32_t model = desc->pqm_global_attr[PQM_FLICKER_MODEL];
+	uint32_t cycles, f_nom;
+
+	pqm_nominal(desc, &cycles, &f_nom);
+	switch (stage) {
+	case PQM_STAGE_RMS:
+		pqm_rms_init(&desc->rms, fs * cycles / f_nom,
+			     ((uint64_t)fs << 16) / (4 * f_nom));
+		pqm_agg_init(&desc->agg, fs);
+		break;
+	case PQM_STAGE_FREQ:
+		pqm_freq_init(&desc->freq, fs, f_nom);
+		break;
+	case PQM_STAGE_SDFT:
+		pqm_sdft_init(&desc->sdft, fs, f_nom);
+		break;
+	case PQM_STAGE_HARM:
+		pqm_harm_init(&desc->harm, fs * cycles / f_nom, cycles);
+		break;
+	case PQM_STAGE_SEQ:
+		pqm_seq_init(&desc->seq, fs * cycles / f_nom, cycles);
+		break;
+	case PQM_STAGE_FLICKER:
+		pqm_flicker_init(&desc->flicker, fs,
+				 model == _120V_50HZ || model == _120V_60HZ,
+				 model == _230V_60HZ || model == _120V_60HZ);
+		break;
+	case PQM_STAGE_EVENT:
+		pqm_event_init(&desc->events, fs, f_nom);
+		break;
+	case PQM_STAGE_MSV:
+		pqm_msv_init(&desc->msv, fs, fs * cycles / f_nom,
+			     desc->pqm_global_attr[PQM_MSV_CARRIER_FREQUENCY]);
+		break;
+	case PQM_STAGE_TRANSIENT:
+		pqm_transient_init(&desc->transient, fs, f_nom);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Size the capture slot for the current sampling and nominal
+ * frequency. Called with the acquisition stopped.
+ * @param desc - descriptor for the pqm
+ * @param pre - nominal cycles before the trigger
+ * @param post - nominal cycles from the trigger
+ * @param clamp - cut a slot that does not fit the history instead of failing
+ * @return 0 in case of success, -EINVAL if the slot does not fit.
+ */
+static int pqm_capture_resize(struct pqm_desc *desc, uint32_t pre,
+			      uint32_t post, bool clamp)
+{
+	uint32_t fs = desc->pqm_global_attr[PQM_SAMPLING_FREQUENCY];
+	uint32_t nb = desc->capture.nb_scans;
+	uint32_t cycles, f_nom;
+	uint64_t pre_s, post_s;
+
+	pqm_nominal(desc, &cycles, &f_nom);
+	/* Whole cycles from the trigger on, even at 60 Hz */
+	pre_s = (uint64_t)pre * fs / f_nom;
+	post_s = ((uint64_t)post * fs + f_nom - 1) / f_nom;
+	if (clamp && nb) {
+		post_s = no_os_clamp(post_s, 1, nb);
+		pre_s = no_os_min(pre_s, nb - post_s);
+	}
+	if (pre_s > nb || post_s > nb)
+		return -EINVAL;
+
+	return pqm_capture_config(&desc->capture, pre_s, post_s);
+}
+
+/**
+ * @brief Recompute the measurement windows after a change of the sampling or
+ * nominal frequency, of the flicker model or of the MSV carrier.
+ * @param desc - descriptor for the pqm
+ */
+void pqm_update_windows(struct pqm_desc *desc)
+{
+	uint32_t fs = desc->pqm_global_attr[PQM_SAMPLING_FREQUENCY];
+	uint32_t cycles, f_nom;
+	uint32_t s;
+
+	pqm_nominal(desc, &cycles, &f_nom);
+	if (desc->acq_irq)
+		no_os_irq_disable(desc->acq_irq, desc->acq_irq_id);
+	/* Phase corrections no longer in range are clamped */
+	pqm_cal_compile(&desc->cal, fs, f_nom);
+	pqm_energy_init(&desc->energy, fs);
+	/* Capture slots no longer fitting the history are cut */
+	pqm_capture_resize(desc, desc->capture_pre, desc->capture_post, true);
+	pqm_stage_set_rate(&desc->stages, fs);
+	for (s = 0; s < PQM_STAGES; s++)
+		pqm_stage_start(desc, s);
+	if (desc->acq_irq)
+		no_os_irq_enable(desc->acq_irq, desc->acq_irq_id);
+}
+
+/**
+ * @brief Start the stages that became needed and stop the ones that are no
+ * longer. Started stages are restarted from scratch, so their first results
+ * follow after one window.
+ * @param desc - descriptor for the pqm
+ */
+static void pqm_update_stages(struct pqm_desc *desc)
+{
+	struct pqm_stages *st = &desc->stages;
+	uint32_t want = pqm_stage_schedule(st);
+	uint32_t started = want & ~st->active;
+	uint32_t s;
+
+	if (!started) {
+		__atomic_store_n(&st->active, want, __ATOMIC_RELEASE);
+		return;
+	}
+
+	if (desc->acq_irq)
+		no_os_irq_disable(desc->acq_irq, desc->acq_irq_id);
+	for (s = 0; s < PQM_STAGES; s++)
+		if (started & NO_OS_BIT(s))
+			pqm_stage_start(desc, s);
+	__atomic_store_n(&st->active, want, __ATOMIC_RELEASE);
+	if (desc->acq_irq)
+		no_os_irq_enable(desc->acq_irq, desc->acq_irq_id);
+}
+
+/**
+ * @brief Select the measurement kernels after a change of v_consel or
+ * i_consel_en.
+ * @param desc - descriptor for the pqm
+ */
+void pqm_update_wiring(struct pqm_desc *desc)
+{
+	if (desc->acq_irq)
+		no_os_irq_disable(desc->acq_irq, desc->acq_irq_id);
+	pqm_seq_select(&desc->seq, desc->pqm_global_attr[PQM_V_CONSEL],
+		       desc->pqm_global_attr[PQM_I_CONSEL_EN]);
+	if (desc->acq_irq)
+		no_os_irq_enable(desc->acq_irq, desc->acq_irq_id);
+}
+
+/**
+ * @brief Reload the event and MSV thresholds after a change of the nominal
+ * voltage, of a threshold or of the MSV record length. Thresholds and
+ * hysteresis are in percent of the nominal voltage, which is in the unit of
+ * the rms attribute.
+ * @param desc - descriptor for the pqm
+ */
+void pqm_update_thresholds(struct pqm_desc *desc)
+{
+	uint32_t *attr = desc->pqm_global_attr;
+	uint32_t nominal = attr[PQM_NOMINAL_VOLTAGE];
+
+	if (desc->acq_irq)
+		no_os_irq_disable(desc->acq_irq, desc->acq_irq_id);
+	pqm_event_set_thr(&desc->events, PQM_EVENT_DIP, nominal,
+			  attr[PQM_DIP_THRESHOLD], attr[PQM_DIP_HYSTERESIS]);
+	pqm_event_set_thr(&desc->events, PQM_EVENT_SWELL, nominal,
+			  attr[PQM_SWELL_THRESHOLD], attr[PQM_SWELL_HYSTERESIS]);
+	pqm_event_set_thr(&desc->events, PQM_EVENT_INTERRUPTION, nominal,
+			  attr[PQM_INTRP_THRESHOLD], attr[PQM_INTRP_HYSTERESIS]);
+	pqm_event_set_thr(&desc->events, PQM_EVENT_RVC, nominal,
+			  attr[PQM_RVC_THRESHOLD], attr[PQM_RVC_HYSTERESIS]);
+	pqm_msv_set_trigger(&desc->msv, nominal, attr[PQM_MSV_THRESHOLD],
+			    attr[PQM_MSV_RECORD_LENGTH]);
+	pqm_agg_set_nominal(&desc->agg, nominal);
+	if (desc->acq_irq)
+		no_os_irq_enable(desc->acq_irq, desc->acq_irq_id);
+}
+
+/**
+ * @brief Change the gain, offset and phase correction of a channel.
+ * @param desc - descriptor for the pqm
+ * @param ch - channel, in scan order
+ * @param scale - gain, in millionths
+ * @param offset - offset removed before the gain, in codes
+ * @param phase - delay at the nominal frequency, in hundredths of a degree
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int pqm_set_calibration(struct pqm_desc *desc, uint32_t ch, int32_t scale,
+			int32_t offset, int32_t phase)
+{
+	int ret;
+
+	if (desc->acq_irq)
+		no_os_irq_disable(desc->acq_irq, desc->acq_irq_id);
+	ret = pqm_cal_set(&desc->cal, ch, scale, offset, phase);
+	if (desc->acq_irq)
+		no_os_irq_enable(desc->acq_irq, desc->acq_irq_id);
+
+	return ret;
+}
+
+/**
+ * @brief Change the length of the capture slot, in nominal cycles before
+ * and from the trigger. Restarts the history if the capture was running.
+ * @param desc - descriptor for the pqm
+ * @param pre - cycles before the trigger
+ * @param post - cycles from the trigger, at least one
+ * @return 0 in case of success, -EINVAL if the slot does not fit.
+ */
+int pqm_set_capture(struct pqm_desc *desc, uint32_t pre, uint32_t post)
+{
+	int ret;
+
+	if (!post)
+		return -EINVAL;
+
+	if (desc->acq_irq)
+		no_os_irq_disable(desc->acq_irq, desc->acq_irq_id);
+	ret = pqm_capture_resize(desc, pre, post, false);
+	if (!ret) {
+		desc->capture_pre = pre;
+		desc->capture_post = post;
+	}
+	if (desc->acq_irq)
+		no_os_irq_enable(desc->acq_irq, desc->acq_irq_id);
+
+	return ret;
+}
+
+/**
+ * @brief Publish the fundamental angle of every channel, as its lag behind
+ * the phase A voltage in hundredths of a degree, if the phasors moved since
+ * the last call.
+ * @param desc - descriptor for the pqm
+ */
+static void pqm_update_angles(struct pqm_desc *desc)
+{
+	int64_t ph[PQM_SDFT_CHANNELS][2];
+	double ref, lag;
+	uint32_t seq;
+	uint32_t ch;
+
+	seq = pqm_sdft_phasors(&desc->sdft, ph);
+	if (seq == desc->sdft.seen)
+		return;
+	desc->sdft.seen = seq;
+
+	ref = atan2(ph[0][1], ph[0][0]);
+	for (ch = 0; ch < TOTAL_PQM_CHANNELS; ch++) {
+		lag = (ref - atan2(ph[ch][1], ph[ch][0])) * 18000.0 / M_PI;
+		if (lag < 0)
+			lag += 36000.0;
+		/* Angle is the second attribute of voltage and current rows alike */
+		desc->pqm_ch_attr[ch][PQM_VOLTAGE_ANGLE] = lround(lag) % 36000;
+	}
+}
+
+/**
+ * @brief Main loop part of the measurement engines: analyses the windows
+ * completed by the acquisition and publishes the results.
+ * @param dev - descriptor for the pqm
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int pqm_process(void *dev)
+{
+	struct pqm_desc *desc = dev;
+	struct pqm_agg_record *rec;
+	struct pqm_stages *st;
+	uint32_t start, t, lost;
+	bool busy, done;
+	uint32_t ch;
+
+	if (!desc)
+		return -ENODEV;
+
+	st = &desc->stages;
+	pqm_update_stages(desc);
+
+	start = pqm_cycles();
+	busy = desc->harm.pending;
+	done = pqm_harm_process(&desc->harm);
+	if (done) {
+		for (ch = 0; ch < TOTAL_PQM_CHANNELS; ch++) {
+			if (ch < VOLTAGE_CH_NUMBER)
+				desc->pqm_ch_attr[ch][PQM_VOLTAGE_THD] = desc->harm.thd[ch];
+			else
+				desc->pqm_ch_attr[ch][PQM_CURRENT_THD] = desc->harm.thd[ch];
+			pqm_stats_sample(&desc->stats, PQM_STATS_THD + ch,
+					 desc->harm.thd[ch]);
+		}
+	}
+	t = pqm_cycles();
+	if (busy)
+		pqm_harm_account(&desc->harm, t - start, done);
+	st->main_cycles[PQM_STAGE_HARM] += t - start;
+	start = t;
+
+	if (pqm_seq_process(&desc->seq)) {
+		desc->pqm_global_attr[PQM_U2] = desc->seq.unb_neg[0];
+		desc->pqm_global_attr[PQM_U0] = desc->seq.unb_zro[0];
+		desc->pqm_global_attr[PQM_SNEG_VOLTAGE] = desc->seq.neg[0];
+		desc->pqm_global_attr[PQM_SPOS_VOLTAGE] = desc->seq.pos[0];
+		desc->pqm_global_attr[PQM_SZRO_VOLTAGE] = desc->seq.zro[0];
+		desc->pqm_global_attr[PQM_I2] = desc->seq.unb_neg[1];
+		desc->pqm_global_attr[PQM_I0] = desc->seq.unb_zro[1];
+		desc->pqm_global_attr[PQM_SNEG_CURRENT] = desc->seq.neg[1];
+		desc->pqm_global_attr[PQM_SPOS_CURRENT] = desc->seq.pos[1];
+		desc->pqm_global_attr[PQM_SZRO_CURRENT] = desc->seq.zro[1];
+		pqm_stats_sample(&desc->stats, PQM_STATS_U2, desc->seq.unb_neg[0]);
+	}
+	t = pqm_cycles();
+	st->main_cycles[PQM_STAGE_SEQ] += t - start;
+	start = t;
+
+	pqm_msv_process(&desc->msv);
+	t = pqm_cycles();
+	st->main_cycles[PQM_STAGE_MSV] += t - start;
+	start = t;
+
+	pqm_update_angles(desc);
+	t = pqm_cycles();
+	st->main_cycles[PQM_STAGE_SDFT] += t - start;
+	start = t;
+
+	/*
+	 * Checkpoints belong to the energy registers, fed by the RMS stage. A
+	 * handler held back by the flash runs as soon as the flash is free, so
+	 * before the checkpoint returns.
+	 */
+	lost = desc->lost_scans;
+	if (pqm_energy_checkpoint(&desc->energy, &desc->nv, false) > 0) {
+		desc->energy.last_cycles = pqm_cycles() - start;
+		desc->energy.lost_scans += desc->lost_scans - lost;
+	}
+	t = pqm_cycles();
+	st->main_cycles[PQM_STAGE_RMS] += t - start;
+	start = t;
+
+	/* Deviations and weekly statistics follow the 10 min interval */
+	busy = desc->agg.pending;
+	if (pqm_agg_process(&desc->agg) & NO_OS_BIT(PQM_AGG_10MIN)) {
+		rec = &desc->agg.rec[PQM_AGG_10MIN];
+		for (ch = 0; ch < VOLTAGE_CH_NUMBER; ch++) {
+			desc->pqm_ch_attr[ch][PQM_VOLTAGE_DEVIATION_UNDER] =
+				rec->under[ch];
+			desc->pqm_ch_attr[ch][PQM_VOLTAGE_DEVIATION_OVER] =
+				rec->over[ch];
+		}
+		for (ch = 0; ch < TOTAL_PQM_CHANNELS; ch++)
+			pqm_stats_sample(&desc->stats, PQM_STATS_RMS + ch,
+					 rec->rms[ch]);
+		pqm_stats_interval(&desc->stats, rec->flagged);
+	}
+	t = pqm_cycles();
+	if (busy)
+		desc->agg.last_cycles = t - start;
+	st->main_cycles[PQM_STAGE_RMS] += t - start;
+	start = t;
+
+	if (pqm_flicker_process(&desc->flicker)) {
+		for (ch = 0; ch < VOLTAGE_CH_NUMBER; ch++) {
+			desc->pqm_ch_attr[ch][PQM_VOLTAGE_PST] = desc->flicker.pst[ch];
+			desc->pqm_ch_attr[ch][PQM_VOLTAGE_PLT] = desc->flicker.plt[ch];
+			pqm_stats_sample(&desc->stats, PQM_STATS_PST + ch,
+					 desc->flicker.pst[ch]);
+		}
+	}
+	t = pqm_cycles();
+	st->main_cycles[PQM_STAGE_FLICKER] += t - start;
+
+	pqm_stage_account(st, t);
+
+	return 0;
+}
+
+/**
+ * @brief Create and start the acquisition timer.
+ * @param desc - descriptor for the pqm
+ * @param freq - sampling frequency in Hz
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int32_t pqm_acq_timer_start(struct pqm_desc *desc, uint32_t freq)
+{
+	int32_t ret;
+
+	desc->acq_timer_ip.ticks_count = desc->acq_timer_ip.freq_hz / freq;
+	desc->scan_cycles = desc->cpu_clk_hz / freq;
+	desc->acq_stamp = 0;
+	ret = no_os_timer_init(&desc->acq_timer, &desc->acq_timer_ip);
+	if (ret) {
+		desc->acq_timer = NULL;
+		return ret;
+	}
+
+	ret = no_os_timer_start(desc->acq_timer);
+	if (ret) {
+		no_os_timer_remove(desc->acq_timer);
+		desc->acq_timer = NULL;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief (Re)start the acquisition timer at the given rate. Rates the
+ * measurement engines cannot follow are lowered to PQM_MAX_SAMPLING_FREQUENCY.
+ * If the timer cannot be restarted, acquisition goes on at the previous rate.
+ * @param desc - descriptor for the pqm
+ * @param freq - sampling frequency in Hz
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int32_t pqm_set_sampling_frequency(struct pqm_desc *desc, uint32_t freq)
+{
+	uint32_t prev;
+	int32_t ret;
+
+	if (!desc)
+		return -ENODEV;
+	freq = no_os_min(freq, PQM_MAX_SAMPLING_FREQUENCY);
+	if (!freq || freq > desc->acq_timer_ip.freq_hz)
+		return -EINVAL;
+
+	if (desc->acq_timer) {
+		no_os_timer_stop(desc->acq_timer);
+		no_os_timer_remove(desc->acq_timer);
+		desc->acq_timer = NULL;
+	}
+
+	prev = desc->pqm_global_attr[PQM_SAMPLING_FREQUENCY];
+	desc->pqm_global_attr[PQM_SAMPLING_FREQUENCY] = freq;
+	pqm_update_windows(desc);
+	if (!desc->acq_timer_ip.platform_ops)
+		return 0;
+
+	ret = pqm_acq_timer_start(desc, freq);
+	if (!ret || prev == freq)
+		return ret;
+
+	desc->pqm_global_attr[PQM_SAMPLING_FREQUENCY] = prev;
+	pqm_update_windows(desc);
+	pqm_acq_timer_start(desc, prev);
+
+	return ret;
+}
+
+/**
+ * @brief Hook the acquisition handler to the timer interrupt and start it.
+ * @param desc - descriptor for the pqm
+ * @param param - pqm initialization parameters
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int32_t pqm_acquisition_init(struct pqm_desc *desc,
+				    struct pqm_init_para *param)
+{
+	int32_t ret;
+
+	desc->acq_timer_ip = *param->acq_timer_ip;
+	desc->acq_irq_id = param->acq_irq_id;
+	desc->cpu_clk_hz = param->cpu_clk_hz;
+
+	ret = no_os_irq_ctrl_init(&desc->acq_irq, param->acq_irq_ip);
+	if (ret)
+		return ret;
+
+	desc->acq_cb.callback = pqm_acquisition_handler;
+	desc->acq_cb.ctx = desc;
+	desc->acq_cb.event = NO_OS_EVT_TIM_ELAPSED;
+	desc->acq_cb.peripheral = NO_OS_TIM_IRQ;
+	ret = no_os_irq_register_callback(desc->acq_irq, desc->acq_irq_id,
+					  &desc->acq_cb);
+	if (ret)
+		return ret;
+
+	ret = no_os_irq_enable(desc->acq_irq, desc->acq_irq_id);
+	if (ret)
+		return ret;
+
+	return pqm_set_sampling_frequency(desc,
+					  desc->pqm_global_attr[PQM_SAMPLING_FREQUENCY]);
+}
+
 int32_t pqm_init(struct pqm_desc **desc,
 		 struct pqm_init_para *param)
 {
 	struct pqm_desc *d;
+	uint32_t cycles, f_nom;
+	int32_t ret;
 	d = (struct pqm_desc *)no_os_calloc(1, sizeof(*d));
 
 	if (!d)
@@ -75,6 +762,13 @@ int32_t pqm_init(struct pqm_desc **desc,
 
 	d->ext_buff = param->ext_buff;
 	d->ext_buff_len = param->ext_buff_len;
+	d->scans_per_trigger = 1;
+	d->scan_format = PQM_SCAN_FORMAT;
+	pqm_ring_init(&d->ring, d->ring_buff, PQM_RING_SCANS, TOTAL_PQM_CHANNELS);
+	pqm_pp_init(&d->pp, param->pp_buff[0], param->pp_buff[1],
+		    param->pp_buff_size);
+	d->iio_buff = param->iio_buff;
+	d->iio_buff_size = param->iio_buff_size;
 	for (int i = 0; i < TOTAL_PQM_CHANNELS; i++) {
 		for (int j = 0; j < MAX_CH_ATTRS; j++) {
 			d->pqm_ch_attr[i][j] = param->dev_ch_attr[i][j];
@@ -83,6 +777,40 @@ int32_t pqm_init(struct pqm_desc **desc,
 	for (int i = 0; i < PQM_DEVICE_ATTR_NUMBER; i++) {
 		d->pqm_global_attr[i] = param->dev_global_attr[i];
 	}
+	d->nv = param->nv;
+	/* Without a valid checkpoint, the registers start from zero */
+	if (d->nv.ops)
+		pqm_energy_restore(&d->energy, &d->nv);
+	pqm_cal_init(&d->cal);
+	pqm_stats_init(&d->stats);
+	pqm_capture_init(&d->capture, param->capture_buff, param->capture_scans);
+	/* Half of the history before the trigger, sized by pqm_update_windows() */
+	pqm_nominal(d, &cycles, &f_nom);
+	d->capture_post = (uint64_t)param->capture_scans * f_nom /
+			  d->pqm_global_attr[PQM_SAMPLING_FREQUENCY];
+	d->capture_pre = d->capture_post / 2;
+	d->capture_post -= d->capture_pre;
+	d->capture.sources = NO_OS_GENMASK(PQM_CAPTURE_RVC, PQM_CAPTURE_DIP);
+	/* Stages whose results need unbroken history, see stage_subscriptions */
+	pqm_stage_init(&d->stages, NO_OS_BIT(PQM_STAGE_RMS) |
+		       NO_OS_BIT(PQM_STAGE_HARM) | NO_OS_BIT(PQM_STAGE_SEQ) |
+		       NO_OS_BIT(PQM_STAGE_EVENT) | NO_OS_BIT(PQM_STAGE_FLICKER) |
+		       NO_OS_BIT(PQM_STAGE_MSV) | NO_OS_BIT(PQM_STAGE_TRANSIENT),
+		       PQM_STAGE_LEASE_MS);
+	pqm_harm_set_slice(&d->harm, PQM_HARM_SLICE);
+	pqm_cycles_enable();
+	pqm_fft_init();
+	pqm_update_windows(d);
+	pqm_update_wiring(d);
+	pqm_update_thresholds(d);
+
+	if (param->acq_timer_ip) {
+		ret = pqm_acquisition_init(d, param);
+		if (ret) {
+			pqm_remove(d);
+			return ret;
+		}
+	}
 	*desc = d;
 
 	return 0;
@@ -92,6 +820,17 @@ int32_t pqm_remove(struct pqm_desc *desc)
 {
 	if (!desc)
 		return -EINVAL;
+	if (desc->acq_timer) {
+		no_os_timer_stop(desc->acq_timer);
+		no_os_timer_remove(desc->acq_timer);
+	}
+	if (desc->acq_irq) {
+		no_os_irq_disable(desc->acq_irq, desc->acq_irq_id);
+		no_os_irq_unregister_callback(desc->acq_irq, desc->acq_irq_id,
+					      &desc->acq_cb);
+	}
+	/* Keep the energy accumulated since the last checkpoint */
+	pqm_energy_checkpoint(&desc->energy, &desc->nv, true);
 	no_os_free(desc);
 
 	return 0;
@@ -106,15 +845,43 @@ int32_t pqm_remove(struct pqm_desc *desc)
 int32_t update_pqm_channels(void *dev, uint32_t mask)
 {
 	struct pqm_desc *desc;
+	uint32_t ch;
 
 	if(!dev)
 		return -ENODEV;
 
 	desc = dev;
 
+	/* Blocks are coded from the native words, no other format applies */
+	if (desc->compression != PQM_COMPRESSION_NONE &&
+	    desc->scan_format != PQM_SCAN_BE32)
+		return -EINVAL;
+
 	desc->active_ch = mask;
+	/* Start the session with fresh data */
+	desc->pp.armed = false;
+	pqm_ring_flush(&desc->ring);
+	desc->comp_raw_bytes = 0;
+	desc->comp_bytes = 0;
 	/* If a real device. Here needs to be selected the channels to be read*/
 
+	/* Resolve the mask once, so the data path does not have to. */
+	desc->active_ch_cnt = 0;
+	for (ch = 0; ch < TOTAL_PQM_CHANNELS; ch++) {
+		if (!(mask & NO_OS_BIT(ch)))
+			continue;
+		/*
+		 * Scales are in uV and uA per code. float32 samples are
+		 * converted from the code shifted left by 8, which folds the
+		 * sign extension into the conversion.
+		 */
+		desc->float_scale[desc->active_ch_cnt] =
+			desc->pqm_global_attr[ch < VOLTAGE_CH_NUMBER ?
+					      PQM_VOLTAGE_SCALE : PQM_CURRENT_SCALE] *
+			1e-6f / 256;
+		desc->active_ch_idx[desc->active_ch_cnt++] = ch;
+	}
+
 	return 0;
 }
 
@@ -132,7 +899,14 @@ int32_t close_pqm_channels(void* dev)
 
 	desc = dev;
 
+	desc->pp.armed = false;
+	/* Give the IIO buffer its own storage back */
+	if (desc->pp_cb) {
+		no_os_cb_cfg(desc->pp_cb, desc->iio_buff, desc->iio_buff_size);
+		desc->pp_cb = NULL;
+	}
 	desc->active_ch = 0;
+	desc->active_ch_cnt = 0;
 
 	return 0;
 }
\ No newline at end of file
@@ -41,28 +41,220 @@
 
 #include <stdint.h>
 #include "iio_types.h"
+#include "no_os_util.h"
 #include "no_os_irq.h"
+#include "no_os_timer.h"
 #include "adin1110.h"
+#include "pqm_ring.h"
+#include "pqm_pp.h"
+#include "pqm_pack.h"
+#include "pqm_rms.h"
+#include "pqm_harm.h"
+#include "pqm_flicker.h"
+#include "pqm_seq.h"
+#include "pqm_event.h"
+#include "pqm_msv.h"
+#include "pqm_freq.h"
+#include "pqm_sdft.h"
+#include "pqm_energy.h"
+#include "pqm_cal.h"
+#include "pqm_stage.h"
+#include "pqm_agg.h"
+#include "pqm_stats.h"
+#include "pqm_capture.h"
+#include "pqm_transient.h"
 
 #define TOTAL_PQM_CHANNELS 7
 #define VOLTAGE_CH_NUMBER 3
 #define MAX_CH_ATTRS 10
-#define PQM_DEVICE_ATTR_NUMBER 29
+#define PQM_DEVICE_ATTR_NUMBER 30
+#define PQM_MAX_SCANS_PER_TRIGGER 128
+/* Acquisition ring depth in scans, must be a power of two */
+#define PQM_RING_SCANS 1024
+/*
+ * Transport format of the buffer samples, see enum scan_format_values. It is
+ * part of the IIO context description, so it is chosen at build time
+ */
+#ifndef PQM_SCAN_FORMAT
+#define PQM_SCAN_FORMAT PQM_SCAN_BE32
+#endif
+/*
+ * Highest sampling frequency: a cycle of the lowest nominal frequency must
+ * fit the SDFT and transient delay lines, a quarter of it the RMS delay
+ */
+#define PQM_MAX_SAMPLING_FREQUENCY \
+	(50 * no_os_min(no_os_min(PQM_SDFT_MAX_LEN, PQM_TRANSIENT_DELAY - 2), \
+			4 * PQM_RMS_DELAY_MAX))
 
 extern const uint32_t sine_lut[112];
 
+#if defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_7M__)
+/* ARMv7-M debug registers, used to time the measurement engines */
+#define PQM_DEMCR	(*(volatile uint32_t *)0xE000EDFC)
+#define PQM_DWT_CTRL	(*(volatile uint32_t *)0xE0001000)
+#define PQM_DWT_CYCCNT	(*(volatile uint32_t *)0xE0001004)
+
+static inline void pqm_cycles_enable(void)
+{
+	PQM_DEMCR |= NO_OS_BIT(24);
+	PQM_DWT_CYCCNT = 0;
+	PQM_DWT_CTRL |= NO_OS_BIT(0);
+}
+
+static inline uint32_t pqm_cycles(void)
+{
+	return PQM_DWT_CYCCNT;
+}
+#else
+static inline void pqm_cycles_enable(void) {}
+
+static inline uint32_t pqm_cycles(void)
+{
+	return 0;
+}
+#endif
+
+enum pqm_global_attr_id {
+	PQM_U2,
+	PQM_U0,
+	PQM_SNEG_VOLTAGE,
+	PQM_SPOS_VOLTAGE,
+	PQM_SZRO_VOLTAGE,
+	PQM_I2,
+	PQM_I0,
+	PQM_SNEG_CURRENT,
+	PQM_SPOS_CURRENT,
+	PQM_SZRO_CURRENT,
+	PQM_NOMINAL_VOLTAGE,
+	PQM_VOLTAGE_SCALE,
+	PQM_CURRENT_SCALE,
+	PQM_I_CONSEL_EN,
+	PQM_DIP_THRESHOLD,
+	PQM_DIP_HYSTERESIS,
+	PQM_SWELL_THRESHOLD,
+	PQM_SWELL_HYSTERESIS,
+	PQM_INTRP_THRESHOLD,
+	PQM_INTRP_HYSTERESIS,
+	PQM_RVC_THRESHOLD,
+	PQM_RVC_HYSTERESIS,
+	PQM_MSV_CARRIER_FREQUENCY,
+	PQM_MSV_RECORD_LENGTH,
+	PQM_MSV_THRESHOLD,
+	PQM_SAMPLING_FREQUENCY,
+	PQM_V_CONSEL,
+	PQM_FLICKER_MODEL,
+	PQM_NOMINAL_FREQUENCY,
+	PQM_FREQUENCY
+};
+
+/* Layout of a voltage channel row of pqm_ch_attr */
+enum pqm_voltage_attr_id {
+	PQM_VOLTAGE_RMS,
+	PQM_VOLTAGE_ANGLE,
+	PQM_VOLTAGE_DEVIATION_UNDER,
+	PQM_VOLTAGE_DEVIATION_OVER,
+	PQM_VOLTAGE_PINST,
+	PQM_VOLTAGE_PST,
+	PQM_VOLTAGE_PLT,
+	PQM_VOLTAGE_THD,
+	PQM_VOLTAGE_HARMONICS,
+	PQM_VOLTAGE_RAW
+};
+
+/* Power attributes of current channels and of the device */
+enum pqm_power_attr_id {
+	PQM_ACTIVE_POWER,
+	PQM_REACTIVE_POWER,
+	PQM_APPARENT_POWER,
+	PQM_POWER_FACTOR
+};
+
+/* Harmonic power flow attributes of the phase current channels */
+enum pqm_harm_power_attr_id {
+	PQM_HARMONIC_POWER,
+	PQM_HARMONIC_DIRECTION
+};
+
+/* Calibration attributes of every channel */
+enum pqm_cal_attr_id {
+	PQM_CALIBSCALE,
+	PQM_CALIBBIAS,
+	PQM_CALIBPHASE
+};
+
+/* Transient thresholds of every channel */
+enum pqm_transient_attr_id {
+	PQM_TRANSIENT_LEVEL,
+	PQM_TRANSIENT_SLOPE
+};
+
+/* Capture slot attributes of the buffer */
+enum pqm_capture_attr_id {
+	PQM_CAPTURE_PRE_CYCLES,
+	PQM_CAPTURE_POST_CYCLES,
+	PQM_CAPTURE_LEVEL_CODES
+};
+
+/* Layout of a current channel row of pqm_ch_attr */
+enum pqm_current_attr_id {
+	PQM_CURRENT_RMS,
+	PQM_CURRENT_ANGLE,
+	PQM_CURRENT_THD,
+	PQM_CURRENT_HARMONICS,
+	PQM_CURRENT_RAW
+};
+
+enum pqm_debug_attr_id {
+	PQM_DBG_RING_OVERRUNS,
+	PQM_DBG_RING_UNDERRUNS,
+	PQM_DBG_PP_OVERRUNS,
+	PQM_DBG_PP_UNDERRUNS,
+	PQM_DBG_COMPRESSION_RATIO,
+	PQM_DBG_FFT_CYCLES,
+	PQM_DBG_FFT_OVERRUNS,
+	PQM_DBG_FLICKER_CYCLES,
+	PQM_DBG_FLICKER_OVERRUNS,
+	PQM_DBG_SEQ_CYCLES,
+	PQM_DBG_EVENT_OVERRUNS,
+	PQM_DBG_MSV_CYCLES,
+	PQM_DBG_MSV_OVERRUNS,
+	PQM_DBG_FREQ_CYCLES,
+	PQM_DBG_SDFT_CYCLES,
+	PQM_DBG_RMS_CYCLES,
+	PQM_DBG_CHECKPOINT_CYCLES,
+	PQM_DBG_NV_ERRORS,
+	PQM_DBG_CHECKPOINT_LOST_SCANS,
+	PQM_DBG_CAL_CYCLES,
+	PQM_DBG_FLOAT_CYCLES,
+	PQM_DBG_STAGE_ACTIVE,
+	PQM_DBG_STAGE_CPU,
+	PQM_DBG_FFT_SLICE_MAX,
+	PQM_DBG_FFT_SLICE_HIST,
+	PQM_DBG_AGG_CYCLES,
+	PQM_DBG_AGG_OVERRUNS,
+	PQM_DBG_TRANSIENT_CYCLES,
+	PQM_DBG_TRANSIENT_OVERRUNS
+};
+
 enum availavle_values_type {
 	V_CONSEL,
 	FLICKER_MODEL,
-	NOMINAL_FREQUENCY
+	NOMINAL_FREQUENCY,
+	CAPTURE_MODE,
+	COMPRESSION,
+	STAGE,
+	CAPTURE_SOURCE
+};
+
+enum capture_mode_values {
+	PQM_CAPTURE_RING,
+	PQM_CAPTURE_PING_PONG,
+	PQM_CAPTURE_SNAPSHOT
 };
 
-enum v_consel_values {
-	_4W_WYE,
-	_4W_WYE_NON_BLONDEL,
-	_3W_DELTA,
-	_3W_DELTA_2,
-	_4W_DELTA_NON_BLONDEL
+enum compression_values {
+	PQM_COMPRESSION_NONE,
+	PQM_COMPRESSION_RICE
 };
 
 enum flicker_model_values {
@@ -97,14 +289,156 @@ static const char *const pqm_nominal_frequency_available[] = {
 	[_60] = "60",
 };
 
+static const char *const pqm_event_names[] = {
+	[PQM_EVENT_DIP] = "dip",
+	[PQM_EVENT_SWELL] = "swell",
+	[PQM_EVENT_INTERRUPTION] = "interruption",
+	[PQM_EVENT_RVC] = "rvc",
+};
+
+static const char *const pqm_stage_names[] = {
+	[PQM_STAGE_RMS] = "rms",
+	[PQM_STAGE_FREQ] = "frequency",
+	[PQM_STAGE_SDFT] = "angle",
+	[PQM_STAGE_HARM] = "harmonics",
+	[PQM_STAGE_SEQ] = "unbalance",
+	[PQM_STAGE_FLICKER] = "flicker",
+	[PQM_STAGE_EVENT] = "events",
+	[PQM_STAGE_MSV] = "msv",
+	[PQM_STAGE_TRANSIENT] = "transients",
+};
+
+static const char *const pqm_capture_source_names[] = {
+	[PQM_CAPTURE_DIP] = "dip",
+	[PQM_CAPTURE_SWELL] = "swell",
+	[PQM_CAPTURE_INTERRUPTION] = "interruption",
+	[PQM_CAPTURE_RVC] = "rvc",
+	[PQM_CAPTURE_LEVEL] = "level",
+	[PQM_CAPTURE_MANUAL] = "manual",
+};
+
+static const char *const pqm_capture_state_names[] = {
+	[PQM_CAPTURE_IDLE] = "idle",
+	[PQM_CAPTURE_ARMED] = "armed",
+	[PQM_CAPTURE_TRIGGERED] = "triggered",
+	[PQM_CAPTURE_FROZEN] = "frozen",
+};
+
+static const char *const pqm_agg_names[] = {
+	[PQM_AGG_3S] = "3s",
+	[PQM_AGG_10MIN] = "10min",
+	[PQM_AGG_2H] = "2h",
+};
+
+static const char *const pqm_capture_mode_available[] = {
+	[PQM_CAPTURE_RING] = "ring",
+	[PQM_CAPTURE_PING_PONG] = "ping_pong",
+	[PQM_CAPTURE_SNAPSHOT] = "snapshot",
+};
+
+static const char *const pqm_scan_format_available[] = {
+	[PQM_SCAN_BE32] = "be32",
+	[PQM_SCAN_LE32] = "le32",
+	[PQM_SCAN_PACKED24] = "packed24",
+	[PQM_SCAN_TRUNC16] = "trunc16",
+	[PQM_SCAN_FLOAT32] = "float32",
+};
+
+static const char *const pqm_compression_available[] = {
+	[PQM_COMPRESSION_NONE] = "none",
+	[PQM_COMPRESSION_RICE] = "rice",
+};
+
 struct pqm_desc {
 	/** Dummy registers of device for testing */
 	uint8_t reg[TOTAL_PQM_CHANNELS];
 	uint32_t pqm_global_attr[PQM_DEVICE_ATTR_NUMBER];
 	uint32_t pqm_ch_attr[TOTAL_PQM_CHANNELS][MAX_CH_ATTRS];
 	uint32_t active_ch;
+	/** Indexes of the enabled channels, in scan order */
+	uint8_t active_ch_idx[TOTAL_PQM_CHANNELS];
+	/** Number of enabled channels */
+	uint32_t active_ch_cnt;
 	uint32_t ext_buff_len;
 	uint16_t **ext_buff;
+	/** Next scan to be read from the sample source */
+	uint32_t acq_idx;
+	/** Timer pacing the acquisition */
+	struct no_os_timer_desc *acq_timer;
+	struct no_os_timer_init_param acq_timer_ip;
+	struct no_os_irq_ctrl_desc *acq_irq;
+	uint32_t acq_irq_id;
+	struct no_os_callback_desc acq_cb;
+	/** Core clock counted by pqm_cycles(), 0 when unknown */
+	uint32_t cpu_clk_hz;
+	/** Core cycles in a scan period, 0 when the core clock is unknown */
+	uint32_t scan_cycles;
+	/** Core cycle count at the last scan, 0 before the first one */
+	uint32_t acq_stamp;
+	/** Scan periods the acquisition handler was held back over */
+	volatile uint32_t lost_scans;
+	/** Scans acquired but not yet handed to the IIO buffer */
+	struct pqm_ring ring;
+	uint32_t ring_buff[PQM_RING_SCANS * TOTAL_PQM_CHANNELS];
+	/** Where read_samples() takes its data from */
+	enum capture_mode_values capture_mode;
+	struct pqm_ping_pong pp;
+	/** Storage of the IIO buffer, given back when a ping-pong session ends */
+	void *iio_buff;
+	uint32_t iio_buff_size;
+	/** Circular buffer of the IIO buffer while a half is its storage */
+	struct no_os_circular_buffer *pp_cb;
+	/** Number of scans pushed to the buffer on each trigger */
+	uint32_t scans_per_trigger;
+	/** Transport format of the current buffer session */
+	enum scan_format_values scan_format;
+	/** Compression of the current buffer session, ring capture only */
+	enum compression_values compression;
+	/** Stream calibrated scans instead of the raw ones */
+	bool stream_calibrated;
+	/** Volts or amps per code of the enabled channels, for float32 */
+	float float_scale[TOTAL_PQM_CHANNELS];
+	/** Processor cycles spent on the last float32 conversion */
+	uint32_t float_cycles;
+	/** Uncompressed and compressed bytes streamed so far */
+	uint64_t comp_raw_bytes;
+	uint64_t comp_bytes;
+	/** Gain, offset and phase correction applied before every engine */
+	struct pqm_cal cal;
+	/** Stages fed by the acquisition, driven by the attributes read */
+	struct pqm_stages stages;
+	/** 10/12 cycle RMS of every channel, published to pqm_ch_attr */
+	struct pqm_rms rms;
+	/** 150/180 cycle, 10 min and 2 h values of the RMS windows */
+	struct pqm_agg agg;
+	/** Weekly percentiles of the 10 min RMS, THD, u2 and Pst values */
+	struct pqm_stats stats;
+	/** Fundamental period and 10 s frequency, in mHz */
+	struct pqm_freq freq;
+	/** Fundamental phasor of every channel, updated on every scan */
+	struct pqm_sdft sdft;
+	/** Harmonics and THD of every channel, refreshed by pqm_process() */
+	struct pqm_harm harm;
+	/** Pinst, Pst and Plt of the voltage channels, in thousandths */
+	struct pqm_flicker flicker;
+	/** Symmetrical components of the fundamental, for the wiring in use */
+	struct pqm_seq seq;
+	/** Dips, swells, interruptions and RVCs waiting for the client */
+	struct pqm_event_engine events;
+	/** Imported and exported energy, checkpointed to nv */
+	struct pqm_energy energy;
+	struct pqm_nv nv;
+	/** Pre and post trigger waveform of the last event, snapshot mode */
+	struct pqm_capture capture;
+	/** Nominal cycles of the capture slot before and from the trigger */
+	uint32_t capture_pre;
+	uint32_t capture_post;
+	/** Mains signalling carrier level and the last record */
+	struct pqm_msv msv;
+	/** Transients on every channel, compared scan by scan */
+	struct pqm_transient_engine transient;
+	/** Staging area for scans pushed on a trigger or being repacked */
+	uint32_t stage_buff[PQM_MAX_SCANS_PER_TRIGGER * TOTAL_PQM_CHANNELS];
 };
 
 struct pqm_init_para {
@@ -112,6 +446,24 @@ struct pqm_init_para {
 	uint32_t dev_ch_attr[TOTAL_PQM_CHANNELS][MAX_CH_ATTRS];
 	uint32_t ext_buff_len;
 	uint16_t **ext_buff;
+	/** Timer pacing the acquisition, NULL to leave it stopped */
+	struct no_os_timer_init_param *acq_timer_ip;
+	/** Interrupt controller serving the acquisition timer */
+	struct no_os_irq_init_param *acq_irq_ip;
+	uint32_t acq_irq_id;
+	/** Core clock counted by pqm_cycles(), 0 when unknown */
+	uint32_t cpu_clk_hz;
+	/** Ping-pong capture halves and their capacity in words */
+	uint32_t *pp_buff[2];
+	uint32_t pp_buff_size;
+	/** Storage of the IIO buffer and its size in bytes */
+	void *iio_buff;
+	uint32_t iio_buff_size;
+	/** Storage for the energy checkpoints, ops NULL to run without */
+	struct pqm_nv nv;
+	/** Waveform capture history and its capacity in scans, may be NULL */
+	uint32_t *capture_buff;
+	uint32_t capture_scans;
 };
 
 int32_t pqm_init(struct pqm_desc **desc,
@@ -119,6 +471,23 @@ int32_t pqm_init(struct pqm_desc **desc,
 
 int32_t pqm_remove(struct pqm_desc *desc);
 
+int32_t pqm_set_sampling_frequency(struct pqm_desc *desc, uint32_t freq);
+
+void pqm_update_windows(struct pqm_desc *desc);
+
+void pqm_update_wiring(struct pqm_desc *desc);
+
+void pqm_update_thresholds(struct pqm_desc *desc);
+
+int pqm_set_calibration(struct pqm_desc *desc, uint32_t ch, int32_t scale,
+			int32_t offset, int32_t phase);
+
+int pqm_set_capture(struct pqm_desc *desc, uint32_t pre, uint32_t post);
+
+void pqm_acquisition_handler(void *dev);
+
+int pqm_process(void *dev);
+
 int32_t update_pqm_channels(void *dev, uint32_t mask);
 int32_t close_pqm_channels(void* dev);
 
@@ -0,0 +1,207 @@
+/**
+ * @file pqm_agg.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm interval aggregation.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_agg.h"
+#include "pqm_rms.h"
+#include "no_os_util.h"
+
+/**
+ * @brief Restart every interval for a new sampling frequency. The last
+ * records are kept.
+ * @param agg - aggregation engine.
+ * @param fs - sampling frequency in Hz.
+ */
+void pqm_agg_init(struct pqm_agg *agg, uint32_t fs)
+{
+	agg->fs = fs;
+	agg->pending = false;
+	agg->now = 0;
+	agg->tick = (uint64_t)fs * PQM_AGG_INTERVAL_S;
+	agg->intervals = 0;
+	memset(agg->acc, 0, sizeof(agg->acc));
+}
+
+/**
+ * @brief Set the reference of the deviations. Takes effect on the next
+ * window. Consumer side only.
+ * @param agg - aggregation engine.
+ * @param nominal - nominal voltage, in codes.
+ */
+void pqm_agg_set_nominal(struct pqm_agg *agg, uint32_t nominal)
+{
+	agg->nominal = nominal;
+}
+
+/**
+ * @brief Hand a complete 10/12 cycle window over. Producer side only.
+ * @param agg - aggregation engine.
+ * @param value - RMS of every channel, in codes.
+ * @param scans - scans in the window.
+ * @param flagged - a dip, swell or interruption overlapped the window.
+ */
+void pqm_agg_push(struct pqm_agg *agg, const uint32_t *value, uint32_t scans,
+		  bool flagged)
+{
+	if (__atomic_load_n(&agg->pending, __ATOMIC_ACQUIRE)) {
+		agg->overruns++;
+		return;
+	}
+	memcpy(agg->value, value, sizeof(agg->value));
+	agg->scans = scans;
+	agg->flagged = flagged;
+	__atomic_store_n(&agg->pending, true, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Add the sums of an interval to the ones of an enclosing interval.
+ * @param dst - enclosing interval.
+ * @param src - interval.
+ */
+static void pqm_agg_merge(struct pqm_agg_sum *dst,
+			  const struct pqm_agg_sum *src)
+{
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_AGG_CHANNELS; ch++)
+		dst->sq[ch] += src->sq[ch];
+	for (ch = 0; ch < PQM_AGG_VOLTAGES; ch++) {
+		dst->under[ch] += src->under[ch];
+		dst->over[ch] += src->over[ch];
+	}
+	dst->count += src->count;
+	dst->flagged |= src->flagged;
+}
+
+/**
+ * @brief Deviation of an aggregated voltage from the nominal one.
+ * @param u - aggregated voltage, in codes.
+ * @param nominal - nominal voltage, in codes.
+ * @return the deviation, in hundredths of a percent of nominal.
+ */
+static uint32_t pqm_agg_dev(uint32_t u, uint32_t nominal)
+{
+	uint32_t d = u > nominal ? u - nominal : nominal - u;
+
+	if (!nominal)
+		return 0;
+
+	return ((uint64_t)d * 10000 + nominal / 2) / nominal;
+}
+
+/**
+ * @brief Publish the record of a complete interval and restart it.
+ * @param agg - aggregation engine.
+ * @param level - interval, see enum pqm_agg_level.
+ */
+static void pqm_agg_close(struct pqm_agg *agg, enum pqm_agg_level level)
+{
+	struct pqm_agg_sum *s = &agg->acc[level];
+	struct pqm_agg_record *r = &agg->rec[level];
+	uint32_t ch;
+
+	if (s->count) {
+		r->index++;
+		r->flagged = s->flagged;
+		for (ch = 0; ch < PQM_AGG_CHANNELS; ch++)
+			r->rms[ch] = pqm_isqrt64(s->sq[ch] / s->count);
+		for (ch = 0; ch < PQM_AGG_VOLTAGES; ch++) {
+			r->under[ch] = pqm_agg_dev(pqm_isqrt64(s->under[ch] / s->count),
+						   agg->nominal);
+			r->over[ch] = pqm_agg_dev(pqm_isqrt64(s->over[ch] / s->count),
+						  agg->nominal);
+		}
+	}
+	memset(s, 0, sizeof(*s));
+}
+
+/**
+ * @brief Aggregate the pending window, if any. Consumer side only.
+ * @param agg - aggregation engine.
+ * @return mask of the levels whose record was updated, see enum
+ * pqm_agg_level.
+ */
+uint32_t pqm_agg_process(struct pqm_agg *agg)
+{
+	struct pqm_agg_sum w = {0};
+	uint32_t done = 0;
+	uint64_t u;
+	uint32_t ch;
+
+	if (!__atomic_load_n(&agg->pending, __ATOMIC_ACQUIRE))
+		return 0;
+
+	for (ch = 0; ch < PQM_AGG_CHANNELS; ch++)
+		w.sq[ch] = (uint64_t)agg->value[ch] * agg->value[ch];
+	for (ch = 0; ch < PQM_AGG_VOLTAGES; ch++) {
+		if (!agg->nominal)
+			continue;
+		u = no_os_min(agg->value[ch], agg->nominal);
+		w.under[ch] = u * u;
+		u = no_os_max(agg->value[ch], agg->nominal);
+		w.over[ch] = u * u;
+	}
+	w.count = 1;
+	w.flagged = agg->flagged;
+	agg->now += agg->scans;
+	__atomic_store_n(&agg->pending, false, __ATOMIC_RELEASE);
+
+	pqm_agg_merge(&agg->acc[PQM_AGG_3S], &w);
+	if (agg->acc[PQM_AGG_3S].count == PQM_AGG_SHORT_WINDOWS) {
+		pqm_agg_close(agg, PQM_AGG_3S);
+		done |= NO_OS_BIT(PQM_AGG_3S);
+	}
+
+	pqm_agg_merge(&agg->acc[PQM_AGG_10MIN], &w);
+	if (agg->now < agg->tick)
+		return done;
+
+	/* The window reaching the tick closes the 10 min interval */
+	agg->tick += (uint64_t)agg->fs * PQM_AGG_INTERVAL_S;
+	memset(&agg->acc[PQM_AGG_3S], 0, sizeof(agg->acc[PQM_AGG_3S]));
+	pqm_agg_merge(&agg->acc[PQM_AGG_2H], &agg->acc[PQM_AGG_10MIN]);
+	pqm_agg_close(agg, PQM_AGG_10MIN);
+	done |= NO_OS_BIT(PQM_AGG_10MIN);
+	if (++agg->intervals < PQM_AGG_LONG_INTERVALS)
+		return done;
+
+	agg->intervals = 0;
+	pqm_agg_close(agg, PQM_AGG_2H);
+
+	return done | NO_OS_BIT(PQM_AGG_2H);
+}
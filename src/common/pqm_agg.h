@@ -0,0 +1,138 @@
+/**
+ * @file pqm_agg.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm interval aggregation.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_AGG_H
+#define PQM_AGG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Channels of a full scan: Va, Vb, Vc, Ia, Ib, Ic, In */
+#define PQM_AGG_CHANNELS 7
+/* Voltage channels, with under and over deviation */
+#define PQM_AGG_VOLTAGES 3
+/* 10/12 cycle windows in a 150/180 cycle interval */
+#define PQM_AGG_SHORT_WINDOWS 15
+/* Length of the 10 min interval, in seconds of the sampling clock */
+#define PQM_AGG_INTERVAL_S 600
+/* 10 min intervals in a 2 h interval */
+#define PQM_AGG_LONG_INTERVALS 12
+
+enum pqm_agg_level {
+	PQM_AGG_3S,
+	PQM_AGG_10MIN,
+	PQM_AGG_2H,
+	PQM_AGG_LEVELS
+};
+
+/**
+ * @struct pqm_agg_sum
+ * @brief Running sums of an interval being aggregated.
+ */
+struct pqm_agg_sum {
+	/** Sum of the squared 10/12 cycle RMS values, in codes^2 */
+	uint64_t sq[PQM_AGG_CHANNELS];
+	/** Same, for the values clamped above and below the nominal voltage */
+	uint64_t under[PQM_AGG_VOLTAGES];
+	uint64_t over[PQM_AGG_VOLTAGES];
+	/** 10/12 cycle windows accumulated */
+	uint32_t count;
+	/** One of the windows overlapped a dip, swell or interruption */
+	bool flagged;
+};
+
+/**
+ * @struct pqm_agg_record
+ * @brief Aggregated values of a complete interval.
+ */
+struct pqm_agg_record {
+	/** Intervals of this level completed since start, zero if none yet */
+	uint32_t index;
+	bool flagged;
+	/** RMS of every channel, in codes */
+	uint32_t rms[PQM_AGG_CHANNELS];
+	/** Under and over deviation, in hundredths of a percent of nominal */
+	uint32_t under[PQM_AGG_VOLTAGES];
+	uint32_t over[PQM_AGG_VOLTAGES];
+};
+
+/**
+ * @struct pqm_agg
+ * @brief IEC 61000-4-30 aggregation of the 10/12 cycle RMS values into
+ * 150/180 cycle, 10 min and 2 h values. The acquisition hands every
+ * complete window over, the main loop accumulates its squares: 150/180
+ * cycle and 10 min intervals sum windows, 2 h intervals sum the sums of
+ * 12 10 min intervals, so every level is the RMS of its 10/12 cycle values
+ * and memory does not grow with the run time. 10 min intervals follow the
+ * sampling clock, the 150/180 cycle interval restarts with each of them.
+ */
+struct pqm_agg {
+	/** Scans per second */
+	uint32_t fs;
+	/** Nominal voltage, in codes, zero to skip the deviations */
+	uint32_t nominal;
+	/** Window handed over by the producer */
+	uint32_t value[PQM_AGG_CHANNELS];
+	uint32_t scans;
+	bool flagged;
+	/** Set by the producer when value holds a complete window */
+	volatile bool pending;
+	/** Windows dropped because the previous one was still pending */
+	volatile uint32_t overruns;
+	/** Scans since start and end of the current 10 min interval */
+	uint64_t now;
+	uint64_t tick;
+	/** 10 min intervals in the current 2 h interval */
+	uint32_t intervals;
+	/** Intervals being accumulated and last complete ones */
+	struct pqm_agg_sum acc[PQM_AGG_LEVELS];
+	struct pqm_agg_record rec[PQM_AGG_LEVELS];
+	/** Processor cycles spent on the last window */
+	uint32_t last_cycles;
+};
+
+void pqm_agg_init(struct pqm_agg *agg, uint32_t fs);
+
+void pqm_agg_set_nominal(struct pqm_agg *agg, uint32_t nominal);
+
+void pqm_agg_push(struct pqm_agg *agg, const uint32_t *value, uint32_t scans,
+		  bool flagged);
+
+uint32_t pqm_agg_process(struct pqm_agg *agg);
+
+#endif
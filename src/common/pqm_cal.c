@@ -0,0 +1,187 @@
+/**
+ * @file pqm_cal.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm calibration pipeline.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include "pqm_cal.h"
+#include "pqm_rms.h"
+#include "no_os_error.h"
+#include "no_os_util.h"
+
+/* Largest calibrated sample, samples are 24 bit two's complement */
+#define PQM_CAL_SAMPLE_MAX ((1 << 23) - 1)
+
+/**
+ * @brief Leave every channel as is.
+ * @param cal - calibration.
+ */
+void pqm_cal_init(struct pqm_cal *cal)
+{
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_CAL_CHANNELS; ch++) {
+		cal->scale[ch] = PQM_CAL_SCALE_ONE;
+		cal->offset[ch] = 0;
+		cal->phase[ch] = 0;
+	}
+}
+
+/**
+ * @brief Compile the settings of every channel into taps for the scan path.
+ * Phase corrections become delays, a lead being a smaller delay than the one
+ * applied to every channel. The fractional part of a delay is a two tap
+ * filter whose phase and gain are exact at the nominal frequency. Delays out
+ * of range are clamped.
+ * @param cal - calibration.
+ * @param fs - sampling frequency in Hz.
+ * @param f_nom - nominal frequency in Hz.
+ * @return 0 in case of success, -EINVAL if a delay was clamped.
+ */
+int pqm_cal_compile(struct pqm_cal *cal, uint32_t fs, uint32_t f_nom)
+{
+	struct pqm_cal_coeff *k;
+	double w, d[PQM_CAL_CHANNELS];
+	double base = 0, frac, t, re, im, g;
+	bool identity = true;
+	uint32_t ch;
+	int ret = 0;
+
+	cal->fs = fs;
+	cal->f_nom = f_nom;
+	/* Below twice the nominal frequency the phase cannot be corrected */
+	w = fs > 2 * f_nom ? 2 * M_PI * f_nom / fs : 0;
+
+	for (ch = 0; ch < PQM_CAL_CHANNELS; ch++) {
+		d[ch] = w ? cal->phase[ch] * (double)fs / (36000.0 * f_nom) : 0;
+		if (cal->phase[ch] && !w)
+			ret = -EINVAL;
+		base = no_os_max(base, ceil(-d[ch]));
+		identity = identity && cal->scale[ch] == PQM_CAL_SCALE_ONE &&
+			   !cal->offset[ch] && !cal->phase[ch];
+	}
+
+	for (ch = 0; ch < PQM_CAL_CHANNELS; ch++) {
+		k = &cal->coeff[ch];
+		d[ch] += base;
+		if (d[ch] > PQM_CAL_DELAY_LEN - 2) {
+			d[ch] = PQM_CAL_DELAY_LEN - 2;
+			ret = -EINVAL;
+		}
+		k->delay = floor(d[ch]);
+		/* Fraction of the delay f such that the taps 1 - f, f turn by it */
+		t = tan((d[ch] - k->delay) * w);
+		frac = t ? t / (sin(w) + t * (1 - cos(w))) : 0;
+		re = 1 - frac + frac * cos(w);
+		im = frac * sin(w);
+		g = cal->scale[ch] / (PQM_CAL_SCALE_ONE * sqrt(re * re + im * im));
+		k->c0 = lround(ldexp(g * (1 - frac), PQM_CAL_Q));
+		k->c1 = lround(ldexp(g * frac, PQM_CAL_Q));
+		k->bias = -((int64_t)k->c0 + k->c1) * cal->offset[ch] +
+			  (1 << (PQM_CAL_Q - 1));
+	}
+	cal->identity = identity;
+
+	return ret;
+}
+
+/**
+ * @brief Change the calibration of a channel. Settings are left untouched
+ * if they cannot be applied at the current rates.
+ * @param cal - calibration.
+ * @param ch - channel.
+ * @param scale - gain, in millionths, up to 4.
+ * @param offset - offset, in codes, removed before the gain.
+ * @param phase - phase correction in hundredths of a degree at the nominal
+ * frequency, positive to delay the channel.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int pqm_cal_set(struct pqm_cal *cal, uint32_t ch, int32_t scale,
+		int32_t offset, int32_t phase)
+{
+	int32_t old[3];
+
+	if (ch >= PQM_CAL_CHANNELS || scale <= 0 ||
+	    scale > 4 * PQM_CAL_SCALE_ONE || abs(offset) > PQM_CAL_SAMPLE_MAX)
+		return -EINVAL;
+
+	old[0] = cal->scale[ch];
+	old[1] = cal->offset[ch];
+	old[2] = cal->phase[ch];
+	cal->scale[ch] = scale;
+	cal->offset[ch] = offset;
+	cal->phase[ch] = phase;
+	if (!pqm_cal_compile(cal, cal->fs, cal->f_nom))
+		return 0;
+
+	cal->scale[ch] = old[0];
+	cal->offset[ch] = old[1];
+	cal->phase[ch] = old[2];
+	pqm_cal_compile(cal, cal->fs, cal->f_nom);
+
+	return -EINVAL;
+}
+
+/**
+ * @brief Calibrate a full scan, in one pass over the channels.
+ * @param cal - calibration.
+ * @param scan - full scan of PQM_CAL_CHANNELS words.
+ * @param out - calibrated scan, 24 significant bits in each word.
+ */
+void pqm_cal_apply(struct pqm_cal *cal, const uint32_t *scan, uint32_t *out)
+{
+	const uint32_t mask = PQM_CAL_DELAY_LEN - 1;
+	const struct pqm_cal_coeff *k;
+	uint32_t pos = (cal->pos + 1) & mask;
+	int32_t *x;
+	int64_t y;
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_CAL_CHANNELS; ch++) {
+		k = &cal->coeff[ch];
+		x = cal->x[ch];
+		x[pos] = pqm_sample_value(scan[ch]);
+		y = (k->bias + (int64_t)k->c0 * x[(pos - k->delay) & mask] +
+		     (int64_t)k->c1 * x[(pos - k->delay - 1) & mask]) >> PQM_CAL_Q;
+		if (y > PQM_CAL_SAMPLE_MAX)
+			y = PQM_CAL_SAMPLE_MAX;
+		else if (y < -PQM_CAL_SAMPLE_MAX - 1)
+			y = -PQM_CAL_SAMPLE_MAX - 1;
+		out[ch] = (uint32_t)y & 0xFFFFFF;
+	}
+	cal->pos = pos;
+}
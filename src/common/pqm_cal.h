@@ -0,0 +1,101 @@
+/**
+ * @file pqm_cal.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm calibration pipeline.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_CAL_H
+#define PQM_CAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Channels of a full scan: Va, Vb, Vc, Ia, Ib, Ic, In */
+#define PQM_CAL_CHANNELS 7
+/* Delay line length in scans, must be a power of two */
+#define PQM_CAL_DELAY_LEN 16
+/* calibscale of a channel left as is */
+#define PQM_CAL_SCALE_ONE 1000000
+/* Fractional bits of the compiled taps */
+#define PQM_CAL_Q 28
+
+/**
+ * @struct pqm_cal_coeff
+ * @brief Calibration of a channel compiled for the scan path. The output is
+ * (c0 * x[n - delay] + c1 * x[n - delay - 1] + bias) >> PQM_CAL_Q, which
+ * applies the gain, removes the offset and delays the channel by exactly the
+ * requested phase at the nominal frequency.
+ */
+struct pqm_cal_coeff {
+	int32_t c0;
+	int32_t c1;
+	int64_t bias;
+	uint32_t delay;
+};
+
+/**
+ * @struct pqm_cal
+ * @brief Per channel gain, offset and phase correction, applied to every scan
+ * before the measurement engines. Settings are compiled when written, so the
+ * scan path only runs two multiply-accumulates per channel.
+ */
+struct pqm_cal {
+	/** Gain in millionths, offset in codes, phase in hundredths of a degree */
+	int32_t scale[PQM_CAL_CHANNELS];
+	int32_t offset[PQM_CAL_CHANNELS];
+	int32_t phase[PQM_CAL_CHANNELS];
+	/** Rates the taps were compiled for */
+	uint32_t fs;
+	uint32_t f_nom;
+	struct pqm_cal_coeff coeff[PQM_CAL_CHANNELS];
+	/** Every channel is left as is, the scan path can be skipped */
+	bool identity;
+	/** Last scans of every channel and slot of the newest one */
+	int32_t x[PQM_CAL_CHANNELS][PQM_CAL_DELAY_LEN];
+	uint32_t pos;
+	/** Processor cycles spent on the last scan */
+	uint32_t last_cycles;
+};
+
+void pqm_cal_init(struct pqm_cal *cal);
+
+int pqm_cal_compile(struct pqm_cal *cal, uint32_t fs, uint32_t f_nom);
+
+int pqm_cal_set(struct pqm_cal *cal, uint32_t ch, int32_t scale,
+		int32_t offset, int32_t phase);
+
+void pqm_cal_apply(struct pqm_cal *cal, const uint32_t *scan, uint32_t *out);
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @file pqm_capture.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm event waveform capture.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_capture.h"
+#include "pqm_rms.h"
+#include "no_os_error.h"
+#include "no_os_util.h"
+
+/**
+ * @brief Attach the history storage. The capture stays idle.
+ * @param cap - capture.
+ * @param buff - storage, nb_scans * PQM_CAPTURE_CHANNELS words, may be NULL.
+ * @param nb_scans - scans the storage can hold.
+ */
+void pqm_capture_init(struct pqm_capture *cap, uint32_t *buff,
+		      uint32_t nb_scans)
+{
+	memset(cap, 0, sizeof(*cap));
+	cap->buff = buff;
+	cap->nb_scans = buff ? nb_scans : 0;
+	cap->pre = cap->nb_scans / 2;
+	cap->post = cap->nb_scans - cap->pre;
+}
+
+/**
+ * @brief Change the slot length. Called with the acquisition stopped, a
+ * frozen slot is dropped.
+ * @param cap - capture.
+ * @param pre - scans before the trigger.
+ * @param post - scans from the trigger, at least one.
+ * @return 0 in case of success, -EINVAL if the slot does not fit.
+ */
+int pqm_capture_config(struct pqm_capture *cap, uint32_t pre, uint32_t post)
+{
+	if (!post || pre > cap->nb_scans || post > cap->nb_scans - pre)
+		return -EINVAL;
+
+	cap->pre = pre;
+	cap->post = post;
+	if (cap->state != PQM_CAPTURE_IDLE)
+		pqm_capture_arm(cap);
+
+	return 0;
+}
+
+/**
+ * @brief Restart the history and wait for a trigger. Consumer side only,
+ * with the capture idle or frozen, or with the acquisition stopped.
+ * @param cap - capture.
+ */
+void pqm_capture_arm(struct pqm_capture *cap)
+{
+	if (!cap->nb_scans)
+		return;
+
+	cap->pos = 0;
+	cap->filled = 0;
+	cap->rd = 0;
+	cap->force = false;
+	__atomic_store_n(&cap->state, PQM_CAPTURE_ARMED, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Stop recording. Called with the acquisition stopped.
+ * @param cap - capture.
+ */
+void pqm_capture_stop(struct pqm_capture *cap)
+{
+	cap->state = PQM_CAPTURE_IDLE;
+}
+
+/**
+ * @brief Check the enabled sources on a new scan.
+ * @param cap - capture.
+ * @param scan - scan just recorded.
+ * @param events - event types started, see enum pqm_event_type.
+ * @return mask of the sources that fired.
+ */
+static uint32_t pqm_capture_fired(struct pqm_capture *cap, const uint32_t *scan,
+				  uint32_t events)
+{
+	uint32_t fired = events & cap->sources;
+	int32_t v;
+	uint32_t ch;
+
+	if (cap->sources & NO_OS_BIT(PQM_CAPTURE_LEVEL)) {
+		for (ch = 0; ch < PQM_CAPTURE_LEVEL_CHANNELS; ch++) {
+			v = pqm_sample_value(scan[ch]);
+			if ((uint32_t)(v < 0 ? -v : v) > cap->level)
+				fired |= NO_OS_BIT(PQM_CAPTURE_LEVEL);
+		}
+	}
+	if (cap->force) {
+		cap->force = false;
+		fired |= NO_OS_BIT(PQM_CAPTURE_MANUAL);
+	}
+
+	return fired;
+}
+
+/**
+ * @brief Record a scan and look for a trigger. Producer side only.
+ * @param cap - capture.
+ * @param scan - full scan.
+ * @param events - event types started, see enum pqm_event_type.
+ * @param ago - scans from the start of the last event to this scan.
+ */
+void pqm_capture_feed(struct pqm_capture *cap, const uint32_t *scan,
+		      uint32_t events, uint32_t ago)
+{
+	uint32_t state = __atomic_load_n(&cap->state, __ATOMIC_ACQUIRE);
+	uint32_t fired, trig;
+
+	if (state != PQM_CAPTURE_ARMED && state != PQM_CAPTURE_TRIGGERED)
+		return;
+
+	memcpy(cap->buff + cap->pos * PQM_CAPTURE_CHANNELS, scan,
+	       PQM_CAPTURE_CHANNELS * sizeof(*scan));
+	if (++cap->pos == cap->nb_scans)
+		cap->pos = 0;
+	if (cap->filled < cap->nb_scans)
+		cap->filled++;
+
+	if (state == PQM_CAPTURE_TRIGGERED) {
+		if (--cap->left)
+			return;
+		cap->count++;
+		__atomic_store_n(&cap->state, PQM_CAPTURE_FROZEN, __ATOMIC_RELEASE);
+		return;
+	}
+
+	fired = pqm_capture_fired(cap, scan, events);
+	if (!fired)
+		return;
+
+	/* Events start a little before they are detected, the rest now */
+	if (!(fired & (NO_OS_BIT(PQM_CAPTURE_LEVEL) |
+		       NO_OS_BIT(PQM_CAPTURE_MANUAL))))
+		ago = no_os_min(ago, cap->filled - 1);
+	else
+		ago = 0;
+	cap->cause = no_os_find_first_set_bit(fired);
+	cap->pre_valid = no_os_min(cap->pre, cap->filled - 1 - ago);
+	cap->len = cap->pre_valid + cap->post;
+	/* pos is one past this scan, the trigger is ago scans before it */
+	trig = (cap->pos + 2 * cap->nb_scans - 1 - ago) % cap->nb_scans;
+	cap->start = (trig + cap->nb_scans - cap->pre_valid) % cap->nb_scans;
+	if (cap->post > ago + 1) {
+		cap->left = cap->post - ago - 1;
+		cap->state = PQM_CAPTURE_TRIGGERED;
+		return;
+	}
+	cap->count++;
+	__atomic_store_n(&cap->state, PQM_CAPTURE_FROZEN, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Copy the next scans of the frozen slot, keeping the enabled
+ * channels. Once the slot is read completely, the capture is armed again.
+ * Consumer side only.
+ * @param cap - capture.
+ * @param idx - scan index of every channel to be copied.
+ * @param cnt - number of channels to be copied.
+ * @param dst - destination, interleaved cnt words per scan.
+ * @param nb_scans - maximum number of scans to be copied.
+ * @return the number of scans copied, zero if no slot is frozen.
+ */
+uint32_t pqm_capture_read(struct pqm_capture *cap, const uint8_t *idx,
+			  uint32_t cnt, uint32_t *dst, uint32_t nb_scans)
+{
+	const uint32_t *src;
+	uint32_t n, i, j;
+
+	if (__atomic_load_n(&cap->state, __ATOMIC_ACQUIRE) != PQM_CAPTURE_FROZEN)
+		return 0;
+
+	n = no_os_min(nb_scans, cap->len - cap->rd);
+	for (i = 0; i < n; i++) {
+		src = cap->buff + ((cap->start + cap->rd + i) % cap->nb_scans) *
+		      PQM_CAPTURE_CHANNELS;
+		for (j = 0; j < cnt; j++)
+			*dst++ = src[idx[j]];
+	}
+	cap->rd += n;
+	if (cap->rd == cap->len)
+		pqm_capture_arm(cap);
+
+	return n;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file pqm_capture.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm event waveform capture.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_CAPTURE_H
+#define PQM_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Channels of a full scan: Va, Vb, Vc, Ia, Ib, Ic, In */
+#define PQM_CAPTURE_CHANNELS 7
+/* Channels checked by the level trigger: Va, Vb, Vc */
+#define PQM_CAPTURE_LEVEL_CHANNELS 3
+
+/* Trigger sources, the event ones in the order of enum pqm_event_type */
+enum pqm_capture_source {
+	PQM_CAPTURE_DIP,
+	PQM_CAPTURE_SWELL,
+	PQM_CAPTURE_INTERRUPTION,
+	PQM_CAPTURE_RVC,
+	PQM_CAPTURE_LEVEL,
+	PQM_CAPTURE_MANUAL,
+	PQM_CAPTURE_SOURCES
+};
+
+enum pqm_capture_state {
+	PQM_CAPTURE_IDLE,
+	PQM_CAPTURE_ARMED,
+	PQM_CAPTURE_TRIGGERED,
+	PQM_CAPTURE_FROZEN
+};
+
+/**
+ * @struct pqm_capture
+ * @brief Pre and post trigger waveform capture. While armed, the acquisition
+ * keeps a circular history of full scans. On a trigger it writes the post
+ * trigger scans and stops, which freezes the slot, pre scans before the
+ * trigger and post scans from it, in place. The client downloads the slot,
+ * which arms the capture again.
+ */
+struct pqm_capture {
+	/** History, nb_scans full scans */
+	uint32_t *buff;
+	uint32_t nb_scans;
+	/** Scans before and from the trigger, pre + post <= nb_scans */
+	uint32_t pre;
+	uint32_t post;
+	/** Enabled sources, see enum pqm_capture_source */
+	uint32_t sources;
+	/** Level trigger, absolute sample value in codes */
+	uint32_t level;
+	/** See enum pqm_capture_state, written by both sides in turn */
+	volatile uint32_t state;
+	/** Manual trigger request, set by the consumer */
+	volatile bool force;
+	/** Next scan written and scans held, up to nb_scans, producer side */
+	uint32_t pos;
+	uint32_t filled;
+	/** Post trigger scans still to be written */
+	uint32_t left;
+	/** Slot: first scan, scans before the trigger and total scans */
+	uint32_t start;
+	uint32_t pre_valid;
+	uint32_t len;
+	/** Source of the trigger, see enum pqm_capture_source */
+	uint32_t cause;
+	/** Scans of the slot already read, consumer side */
+	uint32_t rd;
+	/** Slots frozen so far */
+	uint32_t count;
+};
+
+void pqm_capture_init(struct pqm_capture *cap, uint32_t *buff,
+		      uint32_t nb_scans);
+
+int pqm_capture_config(struct pqm_capture *cap, uint32_t pre, uint32_t post);
+
+void pqm_capture_arm(struct pqm_capture *cap);
+
+void pqm_capture_stop(struct pqm_capture *cap);
+
+void pqm_capture_feed(struct pqm_capture *cap, const uint32_t *scan,
+		      uint32_t events, uint32_t ago);
+
+uint32_t pqm_capture_read(struct pqm_capture *cap, const uint8_t *idx,
+			  uint32_t cnt, uint32_t *dst, uint32_t nb_scans);
+
+#endif
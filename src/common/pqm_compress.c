@@ -0,0 +1,379 @@
+/**
+ * @file pqm_compress.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Lossless compression of scan blocks for raw buffer streaming.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_compress.h"
+#include "no_os_error.h"
+#include "no_os_util.h"
+
+/*
+ * Stream layout, all fields most significant bit first:
+ *
+ * block   := sync(16) nb_scans(16) ch_mask(8) channel... pad-to-byte
+ * channel := order(2) [k(5)] warm-up(24 x order) residual...
+ *
+ * Channels are stored one after the other, in ch_mask order. order 0 keeps
+ * every sample verbatim on 24 bits. Orders 1 and 2 predict each sample from
+ * the previous one or two (delta and linear prediction) and Rice code the
+ * zigzag mapped residual with parameter k. A quotient reaching
+ * PQM_RICE_QMAX is followed by the residual verbatim. A block with
+ * nb_scans == 0 pads the rest of the buffer. So does a zero byte where a
+ * block would start, for the space too short to hold a header.
+ */
+
+#define PQM_SAMPLE_BITS		24
+#define PQM_SAMPLE_MASK		0xFFFFFF
+#define PQM_RICE_QMAX		24
+#define PQM_RICE_KMAX		23
+
+struct pqm_bit_writer {
+	uint8_t *dst;
+	uint32_t acc;
+	uint32_t nb_bits;
+};
+
+struct pqm_bit_reader {
+	const uint8_t *src;
+	const uint8_t *end;
+	uint32_t acc;
+	uint32_t nb_bits;
+};
+
+static inline void pqm_put_bits(struct pqm_bit_writer *bw, uint32_t val,
+				uint32_t nb_bits)
+{
+	while (nb_bits) {
+		uint32_t n = no_os_min(nb_bits, 24 - bw->nb_bits);
+
+		nb_bits -= n;
+		bw->acc = (bw->acc << n) | ((val >> nb_bits) & ((1u << n) - 1));
+		bw->nb_bits += n;
+		while (bw->nb_bits >= 8) {
+			bw->nb_bits -= 8;
+			*bw->dst++ = bw->acc >> bw->nb_bits;
+		}
+	}
+}
+
+static inline void pqm_flush_bits(struct pqm_bit_writer *bw)
+{
+	if (bw->nb_bits)
+		*bw->dst++ = bw->acc << (8 - bw->nb_bits);
+	bw->nb_bits = 0;
+}
+
+static inline int pqm_get_bits(struct pqm_bit_reader *br, uint32_t nb_bits,
+			       uint32_t *val)
+{
+	uint32_t v = 0;
+
+	while (nb_bits) {
+		uint32_t n;
+
+		if (!br->nb_bits) {
+			if (br->src == br->end)
+				return -EINVAL;
+			br->acc = *br->src++;
+			br->nb_bits = 8;
+		}
+		n = no_os_min(nb_bits, br->nb_bits);
+		br->nb_bits -= n;
+		nb_bits -= n;
+		v = (v << n) | ((br->acc >> br->nb_bits) & ((1u << n) - 1));
+	}
+	*val = v;
+
+	return 0;
+}
+
+/**
+ * @brief Zigzag mapped prediction residuals of one channel.
+ * @param x - samples of the channel, stride apart.
+ * @param stride - distance between two samples of the channel.
+ * @param n - number of samples.
+ * @param order - predictor order, 1 or 2.
+ * @param u - residuals for samples order..n-1, return param.
+ * @return the sum of the residuals.
+ */
+static uint32_t pqm_residuals(const uint32_t *x, uint32_t stride, uint32_t n,
+			      uint32_t order, uint32_t *u)
+{
+	uint32_t sum = 0;
+	uint32_t pred;
+	int32_t e;
+	uint32_t i;
+
+	for (i = order; i < n; i++) {
+		pred = x[(i - 1) * stride];
+		if (order == 2)
+			pred = 2 * pred - x[(i - 2) * stride];
+		/* Sign extend the 24-bit modular difference */
+		e = (int32_t)((x[i * stride] - pred) << 8) >> 8;
+		u[i] = ((uint32_t)e << 1) ^ (uint32_t)(e >> 31);
+		u[i] &= PQM_SAMPLE_MASK;
+		sum += u[i];
+	}
+
+	return sum;
+}
+
+/**
+ * @brief Size in bits of Rice coded residuals.
+ * @param u - residuals.
+ * @param first - first residual to count.
+ * @param n - end of the residuals.
+ * @param k - Rice parameter.
+ * @return the number of bits.
+ */
+static uint32_t pqm_rice_bits(const uint32_t *u, uint32_t first, uint32_t n,
+			      uint32_t k)
+{
+	uint32_t bits = 0;
+	uint32_t q;
+	uint32_t i;
+
+	for (i = first; i < n; i++) {
+		q = u[i] >> k;
+		bits += q < PQM_RICE_QMAX ? q + 1 + k :
+			PQM_RICE_QMAX + PQM_SAMPLE_BITS;
+	}
+
+	return bits;
+}
+
+/**
+ * @brief Worst case size of a compressed block.
+ * @param nb_ch - number of channels.
+ * @param nb_scans - number of scans.
+ * @return the size in bytes.
+ */
+uint32_t pqm_compress_max_size(uint32_t nb_ch, uint32_t nb_scans)
+{
+	/* The encoder falls back to verbatim samples when coding does not pay */
+	return PQM_COMPRESS_HDR_SIZE +
+	       (nb_ch * (2 + nb_scans * PQM_SAMPLE_BITS) + 7) / 8;
+}
+
+/**
+ * @brief Compress a block of interleaved scans.
+ * @param scans - interleaved scans of the channels in ch_mask.
+ * @param nb_scans - number of scans, at most PQM_COMPRESS_BLOCK_SCANS.
+ * @param ch_mask - channels present in each scan.
+ * @param dst - destination, at least pqm_compress_max_size() bytes.
+ * @return the size of the compressed block in bytes.
+ */
+uint32_t pqm_compress_block(const uint32_t *scans, uint32_t nb_scans,
+			    uint8_t ch_mask, uint8_t *dst)
+{
+	uint32_t u1[PQM_COMPRESS_BLOCK_SCANS];
+	uint32_t u2[PQM_COMPRESS_BLOCK_SCANS];
+	struct pqm_bit_writer bw = {.dst = dst};
+	uint32_t nb_ch = no_os_hweight32(ch_mask);
+	uint32_t best_bits, bits;
+	uint32_t order, k, best_k;
+	uint32_t sum1, sum2;
+	const uint32_t *x;
+	uint32_t *u;
+	uint32_t ch, i;
+
+	pqm_put_bits(&bw, PQM_COMPRESS_SYNC, 16);
+	pqm_put_bits(&bw, nb_scans, 16);
+	pqm_put_bits(&bw, ch_mask, 8);
+
+	for (ch = 0; ch < nb_ch; ch++) {
+		x = scans + ch;
+		order = 0;
+		best_k = 0;
+		best_bits = nb_scans * PQM_SAMPLE_BITS;
+
+		if (nb_scans > 2) {
+			sum1 = pqm_residuals(x, nb_ch, nb_scans, 1, u1);
+			sum2 = pqm_residuals(x, nb_ch, nb_scans, 2, u2);
+			if (sum2 < sum1) {
+				order = 2;
+				u = u2;
+				sum1 = sum2;
+			} else {
+				order = 1;
+				u = u1;
+			}
+			/* Start from log2 of the mean residual, refine around it */
+			sum1 /= nb_scans - order;
+			k = 0;
+			while (k < PQM_RICE_KMAX && (2u << k) <= sum1)
+				k++;
+			best_bits = UINT32_MAX;
+			for (i = k ? k - 1 : 0; i <= no_os_min(k + 1, PQM_RICE_KMAX); i++) {
+				bits = pqm_rice_bits(u, order, nb_scans, i);
+				if (bits < best_bits) {
+					best_bits = bits;
+					best_k = i;
+				}
+			}
+			best_bits += 5 + order * PQM_SAMPLE_BITS;
+			if (best_bits >= nb_scans * PQM_SAMPLE_BITS)
+				order = 0;
+		}
+
+		pqm_put_bits(&bw, order, 2);
+		if (!order) {
+			for (i = 0; i < nb_scans; i++)
+				pqm_put_bits(&bw, x[i * nb_ch], PQM_SAMPLE_BITS);
+			continue;
+		}
+
+		pqm_put_bits(&bw, best_k, 5);
+		for (i = 0; i < order; i++)
+			pqm_put_bits(&bw, x[i * nb_ch], PQM_SAMPLE_BITS);
+		for (i = order; i < nb_scans; i++) {
+			uint32_t q = u[i] >> best_k;
+
+			if (q >= PQM_RICE_QMAX) {
+				pqm_put_bits(&bw, (1u << PQM_RICE_QMAX) - 1,
+					     PQM_RICE_QMAX);
+				pqm_put_bits(&bw, u[i], PQM_SAMPLE_BITS);
+				continue;
+			}
+			/* q ones and a terminating zero */
+			pqm_put_bits(&bw, ((1u << q) - 1) << 1, q + 1);
+			pqm_put_bits(&bw, u[i], best_k);
+		}
+	}
+	pqm_flush_bits(&bw);
+
+	return bw.dst - dst;
+}
+
+/**
+ * @brief Fill the rest of a buffer with a padding block, or with zeros if it
+ * is too short for a header.
+ * @param dst - start of the unused space.
+ * @param size - unused space in bytes.
+ * @return size.
+ */
+uint32_t pqm_compress_pad(uint8_t *dst, uint32_t size)
+{
+	memset(dst, 0, size);
+	if (size >= PQM_COMPRESS_HDR_SIZE) {
+		dst[0] = PQM_COMPRESS_SYNC >> 8;
+		dst[1] = PQM_COMPRESS_SYNC & 0xFF;
+	}
+
+	return size;
+}
+
+/**
+ * @brief Decompress one block. Portable, meant to be built on the host too.
+ * @param src - compressed stream.
+ * @param size - bytes available in src.
+ * @param scans - destination for the interleaved scans.
+ * @param max_scans - capacity of scans, in scans.
+ * @param nb_scans - number of decoded scans, 0 for padding.
+ * @param ch_mask - channels present in each scan.
+ * @return the size of the block in bytes, negative error code otherwise.
+ */
+int32_t pqm_decompress_block(const uint8_t *src, uint32_t size,
+			     uint32_t *scans, uint32_t max_scans,
+			     uint32_t *nb_scans, uint8_t *ch_mask)
+{
+	struct pqm_bit_reader br = {.src = src, .end = src + size};
+	uint32_t sync, n, mask, nb_ch;
+	uint32_t order, k, q, bit, u;
+	uint32_t pred;
+	int32_t e;
+	uint32_t *x;
+	uint32_t ch, i;
+
+	/* Short padding, see pqm_compress_pad() */
+	if (size && size < PQM_COMPRESS_HDR_SIZE && !src[0]) {
+		*nb_scans = 0;
+		*ch_mask = 0;
+		return size;
+	}
+
+	if (pqm_get_bits(&br, 16, &sync) || sync != PQM_COMPRESS_SYNC)
+		return -EINVAL;
+	if (pqm_get_bits(&br, 16, &n) || pqm_get_bits(&br, 8, &mask))
+		return -EINVAL;
+
+	*nb_scans = n;
+	*ch_mask = mask;
+	if (!n)
+		return size;
+	if (n > max_scans)
+		return -ENOMEM;
+
+	nb_ch = no_os_hweight32(mask);
+	for (ch = 0; ch < nb_ch; ch++) {
+		x = scans + ch;
+		if (pqm_get_bits(&br, 2, &order) || order > 2)
+			return -EINVAL;
+		k = 0;
+		if (order && pqm_get_bits(&br, 5, &k))
+			return -EINVAL;
+		for (i = 0; i < (order ? order : n); i++)
+			if (pqm_get_bits(&br, PQM_SAMPLE_BITS, &x[i * nb_ch]))
+				return -EINVAL;
+		if (!order)
+			continue;
+
+		for (i = order; i < n; i++) {
+			for (q = 0; q < PQM_RICE_QMAX; q++) {
+				if (pqm_get_bits(&br, 1, &bit))
+					return -EINVAL;
+				if (!bit)
+					break;
+			}
+			if (q == PQM_RICE_QMAX) {
+				if (pqm_get_bits(&br, PQM_SAMPLE_BITS, &u))
+					return -EINVAL;
+			} else {
+				if (pqm_get_bits(&br, k, &u))
+					return -EINVAL;
+				u |= q << k;
+			}
+			e = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+			pred = x[(i - 1) * nb_ch];
+			if (order == 2)
+				pred = 2 * pred - x[(i - 2) * nb_ch];
+			x[i * nb_ch] = (pred + e) & PQM_SAMPLE_MASK;
+		}
+	}
+
+	return br.src - src;
+}
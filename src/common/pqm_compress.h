@@ -0,0 +1,61 @@
+/**
+ * @file pqm_compress.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm lossless waveform compression.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_COMPRESS_H
+#define PQM_COMPRESS_H
+
+#include <stdint.h>
+
+/* Scans per compressed block, divides SAMPLES_PER_CHANNEL_PLATFORM */
+#define PQM_COMPRESS_BLOCK_SCANS	64
+/* Block header: sync word, number of scans and channel mask */
+#define PQM_COMPRESS_HDR_SIZE		5
+#define PQM_COMPRESS_SYNC		0x5051
+
+uint32_t pqm_compress_max_size(uint32_t nb_ch, uint32_t nb_scans);
+
+uint32_t pqm_compress_block(const uint32_t *scans, uint32_t nb_scans,
+			    uint8_t ch_mask, uint8_t *dst);
+
+uint32_t pqm_compress_pad(uint8_t *dst, uint32_t size);
+
+int32_t pqm_decompress_block(const uint8_t *src, uint32_t size,
+			     uint32_t *scans, uint32_t max_scans,
+			     uint32_t *nb_scans, uint8_t *ch_mask);
+
+#endif
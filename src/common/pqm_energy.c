@@ -0,0 +1,226 @@
+/**
+ * @file pqm_energy.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm energy registers.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pqm_energy.h"
+#include "no_os_error.h"
+
+/**
+ * @brief Restart accumulation for a new sampling frequency. The registers
+ * are kept, the energy below one unit is dropped.
+ * @param e - energy registers.
+ * @param fs - sampling frequency in Hz.
+ */
+void pqm_energy_init(struct pqm_energy *e, uint32_t fs)
+{
+	e->unit = (uint64_t)(fs ? fs : 1) * 3600;
+	memset(e->frac, 0, sizeof(e->frac));
+	e->next_checkpoint = e->scans + e->unit / 3600 * PQM_ENERGY_CHECKPOINT_S;
+}
+
+/**
+ * @brief Add energy to a register.
+ * @param e - energy registers.
+ * @param reg - register.
+ * @param ph - phase.
+ * @param amount - energy, in codes^2 * scans.
+ */
+static void pqm_energy_acc(struct pqm_energy *e, enum pqm_energy_reg reg,
+			   uint32_t ph, uint64_t amount)
+{
+	uint64_t *frac = &e->frac[reg][ph];
+
+	*frac += amount;
+	if (*frac < e->unit)
+		return;
+	e->reg[reg][ph] += *frac / e->unit;
+	*frac %= e->unit;
+}
+
+/**
+ * @brief Add the powers of a complete window. Producer side only.
+ * @param e - energy registers.
+ * @param pw - powers of the window.
+ * @param scans - scans in the window.
+ */
+void pqm_energy_add(struct pqm_energy *e, const struct pqm_power *pw,
+		    uint32_t scans)
+{
+	uint32_t ph;
+
+	__atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	for (ph = 0; ph < PQM_RMS_PHASES; ph++) {
+		pqm_energy_acc(e, pw->p[ph] >= 0 ? PQM_EP_IMPORT : PQM_EP_EXPORT,
+			       ph, (uint64_t)llabs(pw->p[ph]) * scans);
+		pqm_energy_acc(e, pw->q[ph] >= 0 ? PQM_EQ_IMPORT : PQM_EQ_EXPORT,
+			       ph, (uint64_t)llabs(pw->q[ph]) * scans);
+	}
+	e->scans += scans;
+	__atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Take a consistent copy of the registers. Consumer side only.
+ * @param e - energy registers.
+ * @param reg - the registers, return param.
+ * @param scans - scans accumulated since start, return param, may be NULL.
+ */
+void pqm_energy_read(struct pqm_energy *e,
+		     uint64_t (*reg)[PQM_RMS_PHASES], uint64_t *scans)
+{
+	uint64_t n;
+	uint32_t seq;
+
+	do {
+		seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+		memcpy(reg, e->reg, sizeof(e->reg));
+		n = e->scans;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || seq != __atomic_load_n(&e->seq, __ATOMIC_RELAXED));
+
+	if (scans)
+		*scans = n;
+}
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of a checkpoint record.
+ * @param rec - record.
+ * @return the CRC of the fields preceding crc.
+ */
+static uint32_t pqm_energy_crc(const struct pqm_energy_record *rec)
+{
+	const uint8_t *p = (const uint8_t *)rec;
+	uint32_t len = offsetof(struct pqm_energy_record, crc);
+	uint32_t crc = 0xFFFFFFFF;
+	uint32_t i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+
+	return ~crc;
+}
+
+/**
+ * @brief Load the registers from the most recent valid checkpoint. Must be
+ * called before the acquisition starts.
+ * @param e - energy registers.
+ * @param nv - storage.
+ * @return 0 in case of success, -ENOENT if there is no valid checkpoint,
+ * negative error code otherwise.
+ */
+int pqm_energy_restore(struct pqm_energy *e, const struct pqm_nv *nv)
+{
+	struct pqm_energy_record rec;
+	uint32_t slots, slot;
+	bool found = false;
+	int ret;
+
+	if (!nv->ops || nv->pages < 2 || nv->page_size % PQM_ENERGY_SLOT)
+		return -EINVAL;
+
+	slots = nv->pages * (nv->page_size / PQM_ENERGY_SLOT);
+	for (slot = 0; slot < slots; slot++) {
+		ret = nv->ops->read(nv->ctx, slot * PQM_ENERGY_SLOT, &rec,
+				    sizeof(rec));
+		if (ret)
+			return ret;
+		if (rec.magic != PQM_ENERGY_MAGIC || rec.crc != pqm_energy_crc(&rec))
+			continue;
+		if (found && (int32_t)(rec.seq - e->rec_seq) <= 0)
+			continue;
+		found = true;
+		e->rec_seq = rec.seq;
+		e->slot = (slot + 1) % slots;
+		memcpy(e->reg, rec.reg, sizeof(e->reg));
+	}
+
+	return found ? 0 : -ENOENT;
+}
+
+/**
+ * @brief Write a checkpoint if one is due. Records are appended over the
+ * storage area and a page is only erased when the log wraps into it, so
+ * the other pages always hold the previous checkpoints. Consumer side only.
+ * @param e - energy registers.
+ * @param nv - storage.
+ * @param force - write even if no checkpoint is due.
+ * @return 1 if a checkpoint was written, 0 if none was due, negative error
+ * code otherwise.
+ */
+int pqm_energy_checkpoint(struct pqm_energy *e, const struct pqm_nv *nv,
+			  bool force)
+{
+	struct pqm_energy_record rec = {0};
+	uint32_t offset;
+	uint64_t scans;
+	int ret;
+
+	if (!nv->ops)
+		return 0;
+
+	pqm_energy_read(e, rec.reg, &scans);
+	if (!force && scans < e->next_checkpoint)
+		return 0;
+	e->next_checkpoint = scans + e->unit / 3600 * PQM_ENERGY_CHECKPOINT_S;
+
+	rec.magic = PQM_ENERGY_MAGIC;
+	rec.seq = e->rec_seq + 1;
+	rec.crc = pqm_energy_crc(&rec);
+
+	offset = e->slot * PQM_ENERGY_SLOT;
+	ret = 0;
+	if (!(offset % nv->page_size))
+		ret = nv->ops->erase(nv->ctx, offset);
+	if (!ret)
+		ret = nv->ops->write(nv->ctx, offset, &rec, sizeof(rec));
+	if (ret) {
+		e->nv_errors++;
+		return ret;
+	}
+
+	e->rec_seq = rec.seq;
+	e->slot = (e->slot + 1) % (nv->pages * (nv->page_size / PQM_ENERGY_SLOT));
+
+	return 1;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file pqm_energy.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm energy registers.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_ENERGY_H
+#define PQM_ENERGY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pqm_rms.h"
+
+/* Seconds of acquisition between two checkpoints, at most lost on reset */
+#define PQM_ENERGY_CHECKPOINT_S 120
+/* Bytes taken by a checkpoint record in non-volatile storage */
+#define PQM_ENERGY_SLOT 128
+#define PQM_ENERGY_MAGIC 0x45515150
+
+enum pqm_energy_reg {
+	/** Active energy, imported (P > 0) and exported (P < 0) */
+	PQM_EP_IMPORT,
+	PQM_EP_EXPORT,
+	/** Reactive energy, inductive (Q > 0) and capacitive (Q < 0) */
+	PQM_EQ_IMPORT,
+	PQM_EQ_EXPORT,
+	PQM_ENERGY_REGS
+};
+
+/**
+ * @struct pqm_nv_ops
+ * @brief Page organised non-volatile storage, offsets are relative to the
+ * start of the area reserved for the pqm.
+ */
+struct pqm_nv_ops {
+	int (*read)(void *ctx, uint32_t offset, void *data, uint32_t len);
+	int (*write)(void *ctx, uint32_t offset, const void *data, uint32_t len);
+	/** Erase the page starting at offset */
+	int (*erase)(void *ctx, uint32_t offset);
+};
+
+/**
+ * @struct pqm_nv
+ * @brief Non-volatile storage holding the energy checkpoints.
+ */
+struct pqm_nv {
+	/** Storage operations, NULL when there is no storage */
+	const struct pqm_nv_ops *ops;
+	void *ctx;
+	/** Page size in bytes, a multiple of PQM_ENERGY_SLOT */
+	uint32_t page_size;
+	/** Pages in the area, at least two */
+	uint32_t pages;
+};
+
+/**
+ * @struct pqm_energy_record
+ * @brief Checkpoint record, PQM_ENERGY_SLOT bytes.
+ */
+struct pqm_energy_record {
+	uint32_t magic;
+	/** Incremented on every checkpoint, the highest valid one is restored */
+	uint32_t seq;
+	uint64_t reg[PQM_ENERGY_REGS][PQM_RMS_PHASES];
+	/** CRC-32 of the fields above */
+	uint32_t crc;
+	uint32_t reserved[5];
+};
+
+/**
+ * @struct pqm_energy
+ * @brief Energy registers of every phase. The acquisition adds the powers
+ * of each window, the main loop takes the checkpoints, so storage writes
+ * never run in the sampling path. Registers count in codes^2 * h and wrap
+ * around like meter registers, which takes about 30 years at full scale.
+ */
+struct pqm_energy {
+	/** Energy registers, in codes^2 * h */
+	uint64_t reg[PQM_ENERGY_REGS][PQM_RMS_PHASES];
+	/** Energy below one register unit, in codes^2 * scans */
+	uint64_t frac[PQM_ENERGY_REGS][PQM_RMS_PHASES];
+	/** Scans in an hour */
+	uint64_t unit;
+	/** Scans accumulated since start */
+	uint64_t scans;
+	/** Odd while the producer updates the registers */
+	volatile uint32_t seq;
+	/** Scans at which the next checkpoint is due, consumer side */
+	uint64_t next_checkpoint;
+	/** Sequence number of the last record and next slot to be written */
+	uint32_t rec_seq;
+	uint32_t slot;
+	/** Storage errors, consumer side */
+	uint32_t nv_errors;
+	/** Processor cycles spent on the last checkpoint */
+	uint32_t last_cycles;
+	/** Acquisition scans lost while checkpoints stalled the storage */
+	uint32_t lost_scans;
+};
+
+void pqm_energy_init(struct pqm_energy *e, uint32_t fs);
+
+void pqm_energy_add(struct pqm_energy *e, const struct pqm_power *pw,
+		    uint32_t scans);
+
+void pqm_energy_read(struct pqm_energy *e,
+		     uint64_t (*reg)[PQM_RMS_PHASES], uint64_t *scans);
+
+int pqm_energy_restore(struct pqm_energy *e, const struct pqm_nv *nv);
+
+int pqm_energy_checkpoint(struct pqm_energy *e, const struct pqm_nv *nv,
+			  bool force);
+
+#endif
@@ -0,0 +1,386 @@
+/**
+ * @file pqm_event.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm voltage event detector.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_event.h"
+#include "pqm_rms.h"
+#include "no_os_util.h"
+
+/**
+ * @brief Restart detection for a new sampling or nominal frequency. The
+ * thresholds and the pending events are kept.
+ * @param ev - event engine.
+ * @param fs - sampling frequency in Hz.
+ * @param f_nom - nominal frequency in Hz.
+ */
+void pqm_event_init(struct pqm_event_engine *ev, uint32_t fs, uint32_t f_nom)
+{
+	uint64_t half = ((uint64_t)fs << 32) / (2 * f_nom);
+
+	ev->fs = fs ? fs : 1;
+	ev->half_len = no_os_max(half >> 32, 1);
+	ev->half_frac = half;
+	ev->frac_acc = 0;
+	ev->cur_len = ev->half_len;
+	ev->count = 0;
+	ev->prev_len = 0;
+	memset(ev->sum, 0, sizeof(ev->sum));
+	memset(ev->prev_sum, 0, sizeof(ev->prev_sum));
+	memset(ev->det, 0, sizeof(ev->det));
+	memset(ev->hist_sum, 0, sizeof(ev->hist_sum));
+	ev->hist_len = no_os_min(2 * f_nom, PQM_EVENT_RVC_MAX_LEN);
+	ev->hist_pos = 0;
+	ev->hist_cnt = 0;
+	ev->steady = 0;
+	ev->settled = false;
+	ev->flag = false;
+	ev->started = 0;
+}
+
+/**
+ * @brief Set the thresholds of an event type. A zero level disables it.
+ * @param ev - event engine.
+ * @param type - event type.
+ * @param nominal - nominal voltage, in codes.
+ * @param level_pct - start level in percent of the nominal voltage, for RVC
+ * the deviation from the steady state.
+ * @param hyst_pct - hysteresis in percent of the nominal voltage.
+ */
+void pqm_event_set_thr(struct pqm_event_engine *ev, enum pqm_event_type type,
+		       uint32_t nominal, uint32_t level_pct, uint32_t hyst_pct)
+{
+	ev->thr[type].level = (uint64_t)nominal * level_pct / 100;
+	ev->thr[type].hyst = (uint64_t)nominal * hyst_pct / 100;
+}
+
+/**
+ * @brief Hand a finished event to the client. Producer side only.
+ * @param ev - event engine.
+ * @param type - event type.
+ * @param end - scan at which the event ended.
+ */
+static void pqm_event_push(struct pqm_event_engine *ev,
+			   enum pqm_event_type type, uint64_t end)
+{
+	struct pqm_event_det *det = &ev->det[type];
+	uint32_t head = ev->head;
+	struct pqm_event *e;
+
+	det->active = false;
+	if (type != PQM_EVENT_RVC)
+		ev->flag = true;
+	if (head - __atomic_load_n(&ev->tail, __ATOMIC_ACQUIRE) >=
+	    PQM_EVENT_RING_SIZE) {
+		ev->overruns++;
+		return;
+	}
+
+	e = &ev->ring[head & (PQM_EVENT_RING_SIZE - 1)];
+	e->type = type;
+	e->phases = det->phases;
+	e->start_ms = det->start * 1000 / ev->fs;
+	e->duration_ms = (end - det->start) * 1000 / ev->fs;
+	e->extreme = det->extreme;
+	__atomic_store_n(&ev->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Start an event.
+ * @param ev - event engine.
+ * @param type - event type.
+ * @param start - first scan of the event.
+ * @param extreme - initial extreme value.
+ */
+static void pqm_event_start(struct pqm_event_engine *ev,
+			    enum pqm_event_type type, uint64_t start,
+			    uint32_t extreme)
+{
+	struct pqm_event_det *det = &ev->det[type];
+
+	ev->started |= NO_OS_BIT(type);
+	ev->started_at = start;
+	det->active = true;
+	det->start = start;
+	det->extreme = extreme;
+	det->phases = 0;
+}
+
+/**
+ * @brief Polyphase dip, swell and interruption detection on a new set of
+ * Urms(1/2) values.
+ * @param ev - event engine.
+ * @param t - first scan of the half cycle just completed.
+ */
+static void pqm_event_levels(struct pqm_event_engine *ev, uint64_t t)
+{
+	struct pqm_event_thr *thr;
+	struct pqm_event_det *det;
+	uint32_t min = UINT32_MAX, max = 0;
+	uint8_t below = 0, above = 0, intr = 0;
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_EVENT_CHANNELS; ch++) {
+		min = no_os_min(min, ev->urms[ch]);
+		max = no_os_max(max, ev->urms[ch]);
+		if (ev->urms[ch] < ev->thr[PQM_EVENT_DIP].level)
+			below |= NO_OS_BIT(ch);
+		if (ev->urms[ch] > ev->thr[PQM_EVENT_SWELL].level)
+			above |= NO_OS_BIT(ch);
+		if (ev->urms[ch] < ev->thr[PQM_EVENT_INTERRUPTION].level)
+			intr |= NO_OS_BIT(ch);
+	}
+
+	/* Dip: starts on any phase, ends when all phases recovered */
+	thr = &ev->thr[PQM_EVENT_DIP];
+	det = &ev->det[PQM_EVENT_DIP];
+	if (thr->level) {
+		if (!det->active && below)
+			pqm_event_start(ev, PQM_EVENT_DIP, t, min);
+		if (det->active) {
+			det->extreme = no_os_min(det->extreme, min);
+			det->phases |= below;
+			if (min >= thr->level + thr->hyst)
+				pqm_event_push(ev, PQM_EVENT_DIP, t);
+		}
+	}
+
+	/* Swell: starts on any phase, ends when all phases recovered */
+	thr = &ev->thr[PQM_EVENT_SWELL];
+	det = &ev->det[PQM_EVENT_SWELL];
+	if (thr->level) {
+		if (!det->active && above)
+			pqm_event_start(ev, PQM_EVENT_SWELL, t, max);
+		if (det->active) {
+			det->extreme = no_os_max(det->extreme, max);
+			det->phases |= above;
+			if (max + thr->hyst <= thr->level)
+				pqm_event_push(ev, PQM_EVENT_SWELL, t);
+		}
+	}
+
+	/* Interruption: starts when all phases are down, ends on any phase */
+	thr = &ev->thr[PQM_EVENT_INTERRUPTION];
+	det = &ev->det[PQM_EVENT_INTERRUPTION];
+	if (thr->level) {
+		if (!det->active && intr == NO_OS_GENMASK(PQM_EVENT_CHANNELS - 1, 0))
+			pqm_event_start(ev, PQM_EVENT_INTERRUPTION, t, min);
+		if (det->active) {
+			det->extreme = no_os_min(det->extreme, min);
+			det->phases |= intr;
+			if (max >= thr->level + thr->hyst)
+				pqm_event_push(ev, PQM_EVENT_INTERRUPTION, t);
+		}
+	}
+
+	if (ev->det[PQM_EVENT_DIP].active || ev->det[PQM_EVENT_SWELL].active ||
+	    ev->det[PQM_EVENT_INTERRUPTION].active)
+		ev->flag = true;
+}
+
+/**
+ * @brief Rapid voltage change detection against the mean of the last second
+ * of Urms(1/2) values.
+ * @param ev - event engine.
+ * @param t - first scan of the half cycle just completed.
+ */
+static void pqm_event_rvc(struct pqm_event_engine *ev, uint64_t t)
+{
+	struct pqm_event_thr *thr = &ev->thr[PQM_EVENT_RVC];
+	struct pqm_event_det *det = &ev->det[PQM_EVENT_RVC];
+	uint32_t mean, dev, max_dev = 0;
+	uint8_t moved = 0;
+	bool close = true;
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_EVENT_CHANNELS; ch++) {
+		mean = ev->hist_cnt ? ev->hist_sum[ch] / ev->hist_cnt : ev->urms[ch];
+		dev = ev->urms[ch] > mean ? ev->urms[ch] - mean : mean - ev->urms[ch];
+		if (dev > thr->level)
+			moved |= NO_OS_BIT(ch);
+		if (dev + thr->hyst > thr->level)
+			close = false;
+		if (det->active) {
+			mean = ev->rvc_ref[ch];
+			dev = ev->urms[ch] > mean ? ev->urms[ch] - mean : mean - ev->urms[ch];
+		} else {
+			ev->rvc_ref[ch] = mean;
+		}
+		max_dev = no_os_max(max_dev, dev);
+
+		/* Slide the one second window */
+		if (ev->hist_cnt == ev->hist_len)
+			ev->hist_sum[ch] -= ev->hist[ch][ev->hist_pos];
+		ev->hist[ch][ev->hist_pos] = ev->urms[ch];
+		ev->hist_sum[ch] += ev->urms[ch];
+	}
+	ev->hist_pos = (ev->hist_pos + 1) % ev->hist_len;
+	if (ev->hist_cnt < ev->hist_len)
+		ev->hist_cnt++;
+
+	if (!thr->level)
+		return;
+
+	if (ev->det[PQM_EVENT_DIP].active || ev->det[PQM_EVENT_SWELL].active) {
+		ev->rvc_void = true;
+		ev->settled = false;
+	}
+
+	/* Starts on a step out of a steady state, not during a dip or swell */
+	if (!det->active) {
+		if (moved && ev->settled) {
+			pqm_event_start(ev, PQM_EVENT_RVC, t, max_dev);
+			det->phases = moved;
+			ev->rvc_void = false;
+			ev->settled = false;
+			ev->steady = 0;
+			return;
+		}
+	} else {
+		det->extreme = no_os_max(det->extreme, max_dev);
+		det->phases |= moved;
+	}
+
+	ev->steady = close ? ev->steady + 1 : 0;
+	if (ev->steady >= ev->hist_len &&
+	    !ev->det[PQM_EVENT_DIP].active && !ev->det[PQM_EVENT_SWELL].active)
+		ev->settled = true;
+
+	/* Ends once a new steady state holds for a full window */
+	if (det->active && ev->steady >= ev->hist_len) {
+		if (ev->rvc_void) {
+			det->active = false;
+			return;
+		}
+		pqm_event_push(ev, PQM_EVENT_RVC,
+			       t - (uint64_t)(ev->steady - 1) * ev->half_len);
+	}
+}
+
+/**
+ * @brief Accumulate one full scan and run detection at the end of every half
+ * cycle. Producer side only.
+ * @param ev - event engine.
+ * @param scan - raw samples, voltage channels first.
+ */
+void pqm_event_feed(struct pqm_event_engine *ev, const uint32_t *scan)
+{
+	uint64_t t;
+	int64_t s;
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_EVENT_CHANNELS; ch++) {
+		s = pqm_sample_value(scan[ch]);
+		ev->sum[ch] += (uint64_t)(s * s);
+	}
+	ev->now++;
+
+	if (++ev->count < ev->cur_len)
+		return;
+
+	/* Urms(1/2): RMS over the last two half cycles */
+	for (ch = 0; ch < PQM_EVENT_CHANNELS; ch++) {
+		ev->urms[ch] = pqm_isqrt64((ev->sum[ch] + ev->prev_sum[ch]) /
+					   (ev->count + ev->prev_len));
+		ev->prev_sum[ch] = ev->sum[ch];
+		ev->sum[ch] = 0;
+	}
+	t = ev->now - ev->count;
+	ev->prev_len = ev->count;
+	ev->count = 0;
+	ev->cur_len = ev->half_len;
+	if (ev->frac_acc + ev->half_frac < ev->frac_acc)
+		ev->cur_len++;
+	ev->frac_acc += ev->half_frac;
+
+	pqm_event_levels(ev, t);
+	pqm_event_rvc(ev, t);
+}
+
+/**
+ * @brief Take the oldest detected event. Consumer side only.
+ * @param ev - event engine.
+ * @param event - the event, return param.
+ * @return true if an event was available.
+ */
+bool pqm_event_pop(struct pqm_event_engine *ev, struct pqm_event *event)
+{
+	uint32_t tail = ev->tail;
+
+	if (__atomic_load_n(&ev->head, __ATOMIC_ACQUIRE) == tail)
+		return false;
+
+	*event = ev->ring[tail & (PQM_EVENT_RING_SIZE - 1)];
+	__atomic_store_n(&ev->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * @brief Take and clear the flag of the measurement windows: set while a
+ * dip, swell or interruption is in progress and when one ends. Producer
+ * side only.
+ * @param ev - event engine.
+ * @return true if an event overlapped the time since the last call.
+ */
+bool pqm_event_flag(struct pqm_event_engine *ev)
+{
+	bool flag = ev->flag;
+
+	ev->flag = false;
+
+	return flag;
+}
+
+/**
+ * @brief Take and clear the types of the events started since the last
+ * call. Producer side only.
+ * @param ev - event engine.
+ * @param ago - scans from the first one of the last event to the last scan
+ * fed, return param.
+ * @return mask of the event types started, see enum pqm_event_type.
+ */
+uint32_t pqm_event_started(struct pqm_event_engine *ev, uint32_t *ago)
+{
+	uint32_t started = ev->started;
+
+	ev->started = 0;
+	if (started)
+		*ago = ev->now - 1 - ev->started_at;
+
+	return started;
+}
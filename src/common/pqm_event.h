@@ -0,0 +1,168 @@
+/**
+ * @file pqm_event.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm voltage event detector.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_EVENT_H
+#define PQM_EVENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Event detection runs on the voltage channels: Va, Vb, Vc */
+#define PQM_EVENT_CHANNELS 3
+/* Events kept for the client, must be a power of two */
+#define PQM_EVENT_RING_SIZE 32
+/* Half cycles in the RVC steady state window: 1 s at 50 Hz */
+#define PQM_EVENT_RVC_MAX_LEN 120
+
+enum pqm_event_type {
+	PQM_EVENT_DIP,
+	PQM_EVENT_SWELL,
+	PQM_EVENT_INTERRUPTION,
+	PQM_EVENT_RVC,
+	PQM_EVENT_TYPES
+};
+
+/**
+ * @struct pqm_event
+ * @brief Detected voltage event.
+ */
+struct pqm_event {
+	/** See enum pqm_event_type */
+	uint8_t type;
+	/** Phases that crossed the threshold during the event */
+	uint8_t phases;
+	/** Start, in ms since the acquisition started */
+	uint64_t start_ms;
+	/** Duration, in ms */
+	uint32_t duration_ms;
+	/**
+	 * Residual voltage of dips and interruptions, maximum voltage of
+	 * swells, largest deviation from the steady state of RVCs, in codes
+	 */
+	uint32_t extreme;
+};
+
+/**
+ * @struct pqm_event_thr
+ * @brief Start level and hysteresis of an event type, in codes.
+ */
+struct pqm_event_thr {
+	uint32_t level;
+	uint32_t hyst;
+};
+
+/**
+ * @struct pqm_event_det
+ * @brief State machine of an event type.
+ */
+struct pqm_event_det {
+	bool active;
+	uint64_t start;
+	uint32_t extreme;
+	uint8_t phases;
+};
+
+/**
+ * @struct pqm_event_engine
+ * @brief IEC 61000-4-30 event detection on the one cycle RMS refreshed
+ * every half cycle, Urms(1/2). Events are evaluated as soon as a half cycle
+ * completes and handed to the client through a lock-free ring.
+ */
+struct pqm_event_engine {
+	/** Thresholds, see enum pqm_event_type */
+	struct pqm_event_thr thr[PQM_EVENT_TYPES];
+	/** Scans per second */
+	uint32_t fs;
+	/** Half cycle length, integer scans and Q32 fraction */
+	uint32_t half_len;
+	uint32_t half_frac;
+	/** Fraction carried to the next half cycle, Q32 */
+	uint32_t frac_acc;
+	/** Length of the current half cycle and scans accumulated in it */
+	uint32_t cur_len;
+	uint32_t count;
+	/** Scans since the acquisition started */
+	uint64_t now;
+	/** Sum of squares of the current and of the previous half cycle */
+	uint64_t sum[PQM_EVENT_CHANNELS];
+	uint64_t prev_sum[PQM_EVENT_CHANNELS];
+	uint32_t prev_len;
+	/** Last Urms(1/2), in codes */
+	uint32_t urms[PQM_EVENT_CHANNELS];
+	struct pqm_event_det det[PQM_EVENT_TYPES];
+	/** Last Urms(1/2) values, for the RVC steady state */
+	uint32_t hist[PQM_EVENT_CHANNELS][PQM_EVENT_RVC_MAX_LEN];
+	uint64_t hist_sum[PQM_EVENT_CHANNELS];
+	uint32_t hist_pos;
+	uint32_t hist_len;
+	uint32_t hist_cnt;
+	/** Consecutive half cycles close to the mean, all phases */
+	uint32_t steady;
+	/** A steady state was reached and no event broke it since */
+	bool settled;
+	/** Mean before the current RVC, per phase */
+	uint32_t rvc_ref[PQM_EVENT_CHANNELS];
+	/** Set if a dip or swell happened during the current RVC */
+	bool rvc_void;
+	/** A dip, swell or interruption was in progress, see pqm_event_flag() */
+	bool flag;
+	/** Types and first scan of the events started, see pqm_event_started() */
+	uint32_t started;
+	uint64_t started_at;
+	/** Ring of detected events, producer writes head, consumer tail */
+	struct pqm_event ring[PQM_EVENT_RING_SIZE];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	/** Events lost because the ring was full */
+	volatile uint32_t overruns;
+};
+
+void pqm_event_init(struct pqm_event_engine *ev, uint32_t fs, uint32_t f_nom);
+
+void pqm_event_set_thr(struct pqm_event_engine *ev, enum pqm_event_type type,
+		       uint32_t nominal, uint32_t level_pct, uint32_t hyst_pct);
+
+void pqm_event_feed(struct pqm_event_engine *ev, const uint32_t *scan);
+
+bool pqm_event_pop(struct pqm_event_engine *ev, struct pqm_event *event);
+
+bool pqm_event_flag(struct pqm_event_engine *ev);
+
+uint32_t pqm_event_started(struct pqm_event_engine *ev, uint32_t *ago);
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file pqm_fft.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm fixed-point FFT.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <math.h>
+#include "pqm_fft.h"
+#include "no_os_util.h"
+
+/* e^(-j*2*pi*k/PQM_FFT_MAX_SIZE) for the first half circle, Q31 */
+static int32_t pqm_fft_cos[PQM_FFT_MAX_SIZE / 2];
+static int32_t pqm_fft_sin[PQM_FFT_MAX_SIZE / 2];
+
+/**
+ * @brief Convert a value in [-1, 1] to Q31, saturating at +1.
+ * @param v - value to convert.
+ * @return the Q31 value.
+ */
+static int32_t pqm_fft_q31(double v)
+{
+	if (v >= 1.0)
+		return INT32_MAX;
+
+	return (int32_t)lrint(v * 2147483648.0);
+}
+
+/**
+ * @brief Fill the twiddle table. Must be called once before pqm_fft().
+ */
+void pqm_fft_init(void)
+{
+	uint32_t k;
+
+	for (k = 0; k < PQM_FFT_MAX_SIZE / 2; k++) {
+		pqm_fft_cos[k] = pqm_fft_q31(cos(2 * M_PI * k / PQM_FFT_MAX_SIZE));
+		pqm_fft_sin[k] = pqm_fft_q31(sin(2 * M_PI * k / PQM_FFT_MAX_SIZE));
+	}
+}
+
+/**
+ * @brief Prepare an in place radix-2 decimation in time FFT, see pqm_fft().
+ * @param job - transform to be prepared.
+ * @param x - 2^log2n samples, replaced by their spectrum in natural order.
+ * @param log2n - transform size, from 1 to PQM_FFT_MAX_LOG2.
+ */
+void pqm_fft_start(struct pqm_fft_job *job, struct pqm_cpx *x,
+		   uint32_t log2n)
+{
+	job->x = x;
+	job->n = 1 << log2n;
+	job->half = 0;
+	/* Bit reversal: i is the index, j its reverse */
+	job->i = 1;
+	job->j = 0;
+}
+
+/**
+ * @brief Advance a transform by up to budget units of work.
+ * @param job - transform started by pqm_fft_start().
+ * @param budget - units of work allowed.
+ * @return the units left, nonzero once the transform is complete.
+ */
+uint32_t pqm_fft_run(struct pqm_fft_job *job, uint32_t budget)
+{
+	struct pqm_cpx *x = job->x;
+	uint32_t n = job->n;
+	uint32_t half = job->half;
+	uint32_t i = job->i;
+	uint32_t j = job->j;
+	uint32_t step, k;
+	struct pqm_cpx a, b;
+	int32_t wc, ws;
+	int64_t tr, ti;
+
+	if (!half) {
+		/* Bit reversal permutation */
+		for (; i < n && budget; i++, budget--) {
+			k = n >> 1;
+			while (j & k) {
+				j ^= k;
+				k >>= 1;
+			}
+			j |= k;
+			if (i < j) {
+				a = x[i];
+				x[i] = x[j];
+				x[j] = a;
+			}
+		}
+		if (i < n) {
+			job->i = i;
+			job->j = j;
+			return 0;
+		}
+		half = 1;
+		i = 0;
+	}
+
+	if (half == 1 && budget) {
+		/* First stage only has unity twiddles */
+		for (; i < n && budget; i += 2, budget--) {
+			a = x[i];
+			b = x[i + 1];
+			x[i].re = ((int64_t)a.re + b.re) >> 1;
+			x[i].im = ((int64_t)a.im + b.im) >> 1;
+			x[i + 1].re = ((int64_t)a.re - b.re) >> 1;
+			x[i + 1].im = ((int64_t)a.im - b.im) >> 1;
+		}
+		if (i < n) {
+			job->half = half;
+			job->i = i;
+			return 0;
+		}
+		half = 2;
+		i = 0;
+		j = 0;
+	}
+
+	while (half < n && budget) {
+		step = PQM_FFT_MAX_SIZE / (half << 1);
+		wc = pqm_fft_cos[j * step];
+		ws = pqm_fft_sin[j * step];
+		for (; i < n && budget; i += half << 1, budget--) {
+			a = x[i];
+			b = x[i + half];
+			/* b * (wc - j * ws) */
+			tr = ((int64_t)b.re * wc + (int64_t)b.im * ws) >> 31;
+			ti = ((int64_t)b.im * wc - (int64_t)b.re * ws) >> 31;
+			x[i].re = (a.re + tr) >> 1;
+			x[i].im = (a.im + ti) >> 1;
+			x[i + half].re = (a.re - tr) >> 1;
+			x[i + half].im = (a.im - ti) >> 1;
+		}
+		if (i < n)
+			break;
+		if (++j == half) {
+			half <<= 1;
+			j = 0;
+		}
+		i = j;
+	}
+
+	job->half = half;
+	job->i = i;
+	job->j = j;
+
+	return half < n ? 0 : no_os_max(budget, 1);
+}
+
+/**
+ * @brief In place radix-2 decimation in time FFT. Every stage halves its
+ * output, so the result is the DFT divided by the transform size and cannot
+ * overflow as long as the input magnitudes stay below 2^30.
+ * @param x - 2^log2n samples, replaced by their spectrum in natural order.
+ * @param log2n - transform size, from 1 to PQM_FFT_MAX_LOG2.
+ */
+void pqm_fft(struct pqm_cpx *x, uint32_t log2n)
+{
+	struct pqm_fft_job job;
+
+	pqm_fft_start(&job, x, log2n);
+	pqm_fft_run(&job, UINT32_MAX);
+}
+
+/**
+ * @brief Cosine and sine of a point of the twiddle circle.
+ * @param k - angle, in units of 2*pi/PQM_FFT_MAX_SIZE, below PQM_FFT_MAX_SIZE.
+ * @param c - cos(2*pi*k/PQM_FFT_MAX_SIZE) in Q31, return param.
+ * @param s - sin(2*pi*k/PQM_FFT_MAX_SIZE) in Q31, return param.
+ */
+void pqm_fft_twiddle(uint32_t k, int32_t *c, int32_t *s)
+{
+	if (k < PQM_FFT_MAX_SIZE / 2) {
+		*c = pqm_fft_cos[k];
+		*s = pqm_fft_sin[k];
+	} else {
+		*c = -pqm_fft_cos[k - PQM_FFT_MAX_SIZE / 2];
+		*s = -pqm_fft_sin[k - PQM_FFT_MAX_SIZE / 2];
+	}
+}
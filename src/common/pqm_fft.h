@@ -0,0 +1,83 @@
+/**
+ * @file pqm_fft.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm fixed-point FFT.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_FFT_H
+#define PQM_FFT_H
+
+#include <stdint.h>
+
+/* Largest supported transform, sets the size of the twiddle table */
+#define PQM_FFT_MAX_LOG2 11
+#define PQM_FFT_MAX_SIZE (1 << PQM_FFT_MAX_LOG2)
+
+/**
+ * @struct pqm_cpx
+ * @brief Fixed-point complex sample.
+ */
+struct pqm_cpx {
+	int32_t re;
+	int32_t im;
+};
+
+/**
+ * @struct pqm_fft_job
+ * @brief Transform run in several calls. Each unit of work is a butterfly or
+ * a step of the bit reversal.
+ */
+struct pqm_fft_job {
+	struct pqm_cpx *x;
+	uint32_t n;
+	/** Half size of the current stage, 0 during the bit reversal */
+	uint32_t half;
+	/** Next butterfly: twiddle index and first point */
+	uint32_t j;
+	uint32_t i;
+};
+
+void pqm_fft_init(void);
+
+void pqm_fft_start(struct pqm_fft_job *job, struct pqm_cpx *x,
+		   uint32_t log2n);
+
+uint32_t pqm_fft_run(struct pqm_fft_job *job, uint32_t budget);
+
+void pqm_fft(struct pqm_cpx *x, uint32_t log2n);
+
+void pqm_fft_twiddle(uint32_t k, int32_t *c, int32_t *s);
+
+#endif
@@ -0,0 +1,485 @@
+/**
+ * @file pqm_flicker.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm flicker meter.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "pqm_flicker.h"
+#include "pqm_rms.h"
+#include "no_os_util.h"
+
+/* Rate of the filter cascade */
+#define PQM_FLICKER_RATE 800
+/* Reference level time constant, seconds */
+#define PQM_FLICKER_NORM_TAU 27.3
+/* Block 4 smoothing time constant, seconds */
+#define PQM_FLICKER_SMOOTH_TAU 0.3
+/* Filter settling after a restart, not classified, seconds */
+#define PQM_FLICKER_SETTLE_TIME 5
+/* Pst interval, seconds */
+#define PQM_FLICKER_PST_TIME 600
+/* 0.25 % peak to peak at 8.8 Hz gives a Pinst peaking at 1 */
+#define PQM_FLICKER_REF_MOD 0.00125
+#define PQM_FLICKER_REF_FREQ 8.8
+/* Largest normalized input, Q24, keeps the biquads within 64 bits */
+#define PQM_FLICKER_MAX_IN (1 << 28)
+/* Largest weighted signal, Q24, keeps the smoothing within 64 bits */
+#define PQM_FLICKER_CLAMP (1 << 26)
+
+/**
+ * @struct pqm_lamp
+ * @brief Weighting filter of the lamp-eye-brain chain, IEC 61000-4-15.
+ */
+struct pqm_lamp {
+	double k;
+	double lambda;
+	double f1;
+	double f2;
+	double f3;
+	double f4;
+};
+
+static const struct pqm_lamp pqm_lamp_230v = {
+	1.74802, 4.05981, 9.15494, 2.27979, 1.22535, 21.9
+};
+
+static const struct pqm_lamp pqm_lamp_120v = {
+	1.6357, 4.167375, 9.077169, 2.939902, 1.394468, 17.31512
+};
+
+/* Percentiles used for Pst, in thousandths of a percent of the interval */
+static const uint32_t pqm_flicker_pct[] = {
+	100, 700, 1000, 1500, 2200, 3000, 4000, 6000,
+	8000, 10000, 13000, 17000, 30000, 50000, 80000
+};
+
+/**
+ * @brief Gain of the weighting filter.
+ * @param lamp - lamp model.
+ * @param f - frequency in Hz.
+ * @return the magnitude of the response.
+ */
+static double pqm_lamp_gain(const struct pqm_lamp *lamp, double f)
+{
+	double w = f / lamp->f1;
+	double bp = lamp->k * w / sqrt((1 - w * w) * (1 - w * w) +
+				       4 * lamp->lambda * lamp->lambda * f * f /
+				       (lamp->f1 * lamp->f1 * lamp->f1 * lamp->f1));
+	double lead = sqrt(1 + f * f / (lamp->f2 * lamp->f2));
+	double lag = sqrt((1 + f * f / (lamp->f3 * lamp->f3)) *
+			  (1 + f * f / (lamp->f4 * lamp->f4)));
+
+	return bp * lead / lag;
+}
+
+/**
+ * @brief Bilinear transform of (B0 + B1 s + B2 s^2) / (A0 + A1 s + A2 s^2)
+ * into a Q30 biquad.
+ * @param bq - biquad to be set.
+ * @param num - B0, B1, B2.
+ * @param den - A0, A1, A2.
+ * @param fs - sampling frequency in Hz.
+ */
+static void pqm_biquad_design(struct pqm_biquad *bq, const double *num,
+			      const double *den, double fs)
+{
+	double c = 2 * fs;
+	double a0;
+
+	/* First order sections must not get a pole at z = -1 */
+	if (!num[2] && !den[2]) {
+		a0 = den[0] + den[1] * c;
+		bq->b0 = lrint((num[0] + num[1] * c) / a0 * (1 << 30));
+		bq->b1 = lrint((num[0] - num[1] * c) / a0 * (1 << 30));
+		bq->b2 = 0;
+		bq->a1 = lrint((den[0] - den[1] * c) / a0 * (1 << 30));
+		bq->a2 = 0;
+		return;
+	}
+
+	a0 = den[0] + den[1] * c + den[2] * c * c;
+	bq->b0 = lrint((num[0] + num[1] * c + num[2] * c * c) / a0 * (1 << 30));
+	bq->b1 = lrint((2 * num[0] - 2 * num[2] * c * c) / a0 * (1 << 30));
+	bq->b2 = lrint((num[0] - num[1] * c + num[2] * c * c) / a0 * (1 << 30));
+	bq->a1 = lrint((2 * den[0] - 2 * den[2] * c * c) / a0 * (1 << 30));
+	bq->a2 = lrint((den[0] - den[1] * c + den[2] * c * c) / a0 * (1 << 30));
+}
+
+/**
+ * @brief Run a biquad on one sample, feeding the rounding error back.
+ * @param bq - coefficients.
+ * @param st - state.
+ * @param x - input sample.
+ * @return the output sample.
+ */
+static int32_t pqm_biquad_run(const struct pqm_biquad *bq,
+			      struct pqm_biquad_state *st, int32_t x)
+{
+	int64_t acc = st->err;
+	int32_t y;
+
+	acc += (int64_t)bq->b0 * x;
+	acc += (int64_t)bq->b1 * st->x1;
+	acc += (int64_t)bq->b2 * st->x2;
+	acc -= (int64_t)bq->a1 * st->y1;
+	acc -= (int64_t)bq->a2 * st->y2;
+
+	y = acc >> 30;
+	st->err = acc & ((1 << 30) - 1);
+	st->x2 = st->x1;
+	st->x1 = x;
+	st->y2 = st->y1;
+	st->y1 = y;
+
+	return y;
+}
+
+/**
+ * @brief Configure the meter and restart it.
+ * @param flk - flicker meter.
+ * @param fs - input sampling frequency in Hz.
+ * @param lamp_120v - use the 120 V lamp model instead of the 230 V one.
+ * @param supply_60hz - 60 Hz supply, sets the demodulator low pass corner.
+ */
+void pqm_flicker_init(struct pqm_flicker *flk, uint32_t fs, bool lamp_120v,
+		      bool supply_60hz)
+{
+	const struct pqm_lamp *lamp = lamp_120v ? &pqm_lamp_120v : &pqm_lamp_230v;
+	double w1, w2, w3, w4, wc, rate, ref, ripple;
+	double num[3], den[3];
+	uint32_t i;
+
+	flk->decim = no_os_max(fs / PQM_FLICKER_RATE, 1);
+	rate = (double)no_os_max(fs, 1) / flk->decim;
+
+	/* 0.05 Hz first order high pass */
+	num[0] = 0;
+	num[1] = 1;
+	num[2] = 0;
+	den[0] = 2 * M_PI * 0.05;
+	den[1] = 1;
+	den[2] = 0;
+	pqm_biquad_design(&flk->bq[0], num, den, rate);
+
+	/* 6th order Butterworth low pass, 35 Hz or 42 Hz */
+	wc = 2 * M_PI * (supply_60hz ? 42 : 35);
+	for (i = 0; i < 3; i++) {
+		num[0] = wc * wc;
+		num[1] = 0;
+		num[2] = 0;
+		den[0] = wc * wc;
+		den[1] = 2 * wc * sin(M_PI * (2 * i + 1) / 12);
+		den[2] = 1;
+		pqm_biquad_design(&flk->bq[1 + i], num, den, rate);
+	}
+
+	/* k w1 s / (s^2 + 2 lambda s + w1^2) * (1 + s / w2) / ((1 + s / w3)(1 + s / w4)) */
+	w1 = 2 * M_PI * lamp->f1;
+	w2 = 2 * M_PI * lamp->f2;
+	w3 = 2 * M_PI * lamp->f3;
+	w4 = 2 * M_PI * lamp->f4;
+	num[0] = 0;
+	num[1] = lamp->k * w1;
+	num[2] = 0;
+	den[0] = w1 * w1;
+	den[1] = 2 * M_PI * 2 * lamp->lambda;
+	den[2] = 1;
+	pqm_biquad_design(&flk->bq[4], num, den, rate);
+	num[0] = 1;
+	num[1] = 1 / w2;
+	num[2] = 0;
+	den[0] = 1;
+	den[1] = 1 / w3 + 1 / w4;
+	den[2] = 1 / (w3 * w4);
+	pqm_biquad_design(&flk->bq[5], num, den, rate);
+
+	flk->norm_len = lrint(PQM_FLICKER_NORM_TAU * rate);
+	flk->smooth = lrint((1 - exp(-1 / (PQM_FLICKER_SMOOTH_TAU * rate))) *
+			    (1 << 24));
+	/*
+	 * The reference modulation m gives a weighted signal of 2 * m * g and
+	 * after squaring and smoothing a mean of 2 * (m * g)^2 with a ripple
+	 * of r at twice the modulation frequency. Scale its peak to 1.
+	 */
+	ref = PQM_FLICKER_REF_MOD * pqm_lamp_gain(&pqm_lamp_230v,
+			PQM_FLICKER_REF_FREQ);
+	ripple = 1 / sqrt(1 + pow(2 * M_PI * 2 * PQM_FLICKER_REF_FREQ *
+				  PQM_FLICKER_SMOOTH_TAU, 2));
+	flk->gain = lrint(1000 / (2 * ref * ref * (1 + ripple)));
+	flk->pst_len = lrint(PQM_FLICKER_PST_TIME * rate);
+	flk->settle = lrint(PQM_FLICKER_SETTLE_TIME * rate);
+
+	memset(flk->acc, 0, sizeof(flk->acc));
+	memset(flk->norm, 0, sizeof(flk->norm));
+	flk->norm_cnt = 0;
+	memset(flk->st, 0, sizeof(flk->st));
+	memset(flk->lp, 0, sizeof(flk->lp));
+	memset(flk->hist, 0, sizeof(flk->hist));
+	flk->acc_cnt = 0;
+	flk->primed = false;
+	flk->fill = 0;
+	flk->count = 0;
+	flk->pending = false;
+	flk->pst_pos = 0;
+	flk->pst_cnt = 0;
+}
+
+/**
+ * @brief Log class of a Pinst value.
+ * @param p - Pinst in thousandths.
+ * @return the class index.
+ */
+static uint32_t pqm_flicker_class(uint32_t p)
+{
+	uint32_t l, m;
+
+	if (!p)
+		return 0;
+
+	l = 31 - __builtin_clz(p);
+	m = l >= 5 ? p >> (l - 5) : p << (5 - l);
+
+	return 1 + l * 32 + (m & 31);
+}
+
+/**
+ * @brief Lower bound of a class.
+ * @param c - class index.
+ * @return the smallest Pinst, in thousandths, falling in the class.
+ */
+static uint64_t pqm_flicker_class_min(uint32_t c)
+{
+	if (!c)
+		return 0;
+	c--;
+
+	return ((uint64_t)(32 + (c & 31)) << (c / 32)) >> 5;
+}
+
+/**
+ * @brief Filter one squared and decimated sample of a channel.
+ * @param flk - flicker meter.
+ * @param ch - channel.
+ * @param ms - mean square of the input over the decimation block.
+ */
+static void pqm_flicker_filter(struct pqm_flicker *flk, uint32_t ch,
+			       uint64_t ms)
+{
+	struct pqm_biquad_state *st = flk->st[ch];
+	uint64_t ref;
+	int64_t sq;
+	int32_t x;
+	uint32_t i;
+
+	/*
+	 * Block 1 and 2: the demodulated signal relative to the mean level. The
+	 * level is a plain running mean until the time constant is reached.
+	 */
+	flk->norm[ch] += ((int64_t)(ms - flk->norm[ch])) /
+			 (int64_t)no_os_min(flk->norm_cnt, flk->norm_len);
+	ref = flk->norm[ch] >> 8;
+	x = ref ? no_os_min((ms << 16) / ref, (uint64_t)PQM_FLICKER_MAX_IN) : 0;
+	if (!flk->primed) {
+		st[0].x1 = x;
+		st[0].x2 = x;
+	}
+
+	/* Block 3 */
+	for (i = 0; i < PQM_FLICKER_BIQUADS; i++)
+		x = pqm_biquad_run(&flk->bq[i], &st[i], x);
+
+	/* Block 4 */
+	x = no_os_clamp(x, -PQM_FLICKER_CLAMP, PQM_FLICKER_CLAMP);
+	sq = ((int64_t)x * x) >> 8;
+	flk->lp[ch] += ((sq - flk->lp[ch]) * flk->smooth) >> 24;
+	flk->pinst[ch] = no_os_min(((uint64_t)(flk->lp[ch] >> 12) * flk->gain) >> 28,
+				   (uint64_t)UINT32_MAX);
+
+	/* Block 5, classification */
+	if (!flk->settle)
+		flk->hist[flk->fill][ch][pqm_flicker_class(flk->pinst[ch])]++;
+}
+
+/**
+ * @brief Accumulate one full scan. Producer side only.
+ * @param flk - flicker meter.
+ * @param scan - raw samples, voltage channels first.
+ * @return true when the scan completed a filtered sample and pinst holds new
+ * values.
+ */
+bool pqm_flicker_feed(struct pqm_flicker *flk, const uint32_t *scan)
+{
+	int64_t s;
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_FLICKER_CHANNELS; ch++) {
+		s = pqm_sample_value(scan[ch]);
+		flk->acc[ch] += (uint64_t)(s * s);
+	}
+
+	if (++flk->acc_cnt < flk->decim)
+		return false;
+
+	if (flk->norm_cnt < flk->norm_len)
+		flk->norm_cnt++;
+	for (ch = 0; ch < PQM_FLICKER_CHANNELS; ch++) {
+		pqm_flicker_filter(flk, ch, flk->acc[ch] / flk->acc_cnt);
+		flk->acc[ch] = 0;
+	}
+	flk->acc_cnt = 0;
+	flk->primed = true;
+
+	if (flk->settle) {
+		flk->settle--;
+		return true;
+	}
+
+	if (++flk->count < flk->pst_len)
+		return true;
+
+	flk->count = 0;
+	if (__atomic_load_n(&flk->pending, __ATOMIC_ACQUIRE)) {
+		flk->overruns++;
+		memset(flk->hist[flk->fill], 0, sizeof(flk->hist[flk->fill]));
+	} else {
+		flk->fill ^= 1;
+		__atomic_store_n(&flk->pending, true, __ATOMIC_RELEASE);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Integer cube root.
+ * @param x - radicand.
+ * @return floor(cbrt(x)).
+ */
+static uint32_t pqm_icbrt64(uint64_t x)
+{
+	uint64_t lo = 0, hi = 2642245, mid;
+
+	/* 2642245^3 is the largest cube below 2^64 */
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (mid * mid * mid <= x)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return lo;
+}
+
+/**
+ * @brief Pst of a channel from its Pinst distribution.
+ * @param hist - class counts of the interval.
+ * @return Pst in thousandths.
+ */
+static uint32_t pqm_flicker_pst(const uint32_t *hist)
+{
+	uint64_t p[NO_OS_ARRAY_SIZE(pqm_flicker_pct)];
+	uint64_t total = 0, above = 0, thr, lo, hi;
+	uint64_t p1s, p3s, p10s, p50s;
+	uint32_t i = 0;
+	int32_t c;
+
+	for (c = 0; c < PQM_FLICKER_CLASSES; c++)
+		total += hist[c];
+	if (!total)
+		return 0;
+
+	/* Walk down from the highest class, interpolating inside a class */
+	for (c = PQM_FLICKER_CLASSES - 1; c >= 0 && i < NO_OS_ARRAY_SIZE(p); c--) {
+		lo = pqm_flicker_class_min(c);
+		hi = c == PQM_FLICKER_CLASSES - 1 ? lo : pqm_flicker_class_min(c + 1);
+		while (i < NO_OS_ARRAY_SIZE(p)) {
+			thr = total * pqm_flicker_pct[i] / 100000;
+			if (above + hist[c] < thr)
+				break;
+			p[i++] = hist[c] ? hi - (hi - lo) * (thr - above) / hist[c] : lo;
+		}
+		above += hist[c];
+	}
+	for (; i < NO_OS_ARRAY_SIZE(p); i++)
+		p[i] = 0;
+
+	p1s = (p[1] + p[2] + p[3]) / 3;
+	p3s = (p[4] + p[5] + p[6]) / 3;
+	p10s = (p[7] + p[8] + p[9] + p[10] + p[11]) / 5;
+	p50s = (p[12] + p[13] + p[14]) / 3;
+
+	/* Weights in units of 1e-4, Pst = sqrt(sum(w * P)) */
+	return pqm_isqrt64((314 * p[0] + 525 * p1s + 657 * p3s + 2800 * p10s +
+			    800 * p50s) / 10);
+}
+
+/**
+ * @brief Evaluate the pending interval, if any. Consumer side only.
+ * @param flk - flicker meter.
+ * @return true if pst and plt were updated.
+ */
+bool pqm_flicker_process(struct pqm_flicker *flk)
+{
+	uint32_t (*hist)[PQM_FLICKER_CLASSES];
+	uint64_t sum;
+	uint32_t ch, i, pst;
+
+	if (!__atomic_load_n(&flk->pending, __ATOMIC_ACQUIRE))
+		return false;
+
+	hist = flk->hist[flk->fill ^ 1];
+	if (flk->pst_cnt < PQM_FLICKER_PLT_PST)
+		flk->pst_cnt++;
+	for (ch = 0; ch < PQM_FLICKER_CHANNELS; ch++) {
+		flk->pst[ch] = pqm_flicker_pst(hist[ch]);
+		flk->pst_hist[ch][flk->pst_pos] = flk->pst[ch];
+
+		/* Plt = cbrt(mean(Pst^3)) over the last PQM_FLICKER_PLT_PST values */
+		sum = 0;
+		for (i = 0; i < flk->pst_cnt; i++) {
+			pst = no_os_min(flk->pst_hist[ch][i], 1000000);
+			sum += (uint64_t)pst * pst * pst / flk->pst_cnt;
+		}
+		flk->plt[ch] = pqm_icbrt64(sum);
+	}
+	flk->pst_pos = (flk->pst_pos + 1) % PQM_FLICKER_PLT_PST;
+
+	memset(hist, 0, sizeof(flk->hist[0]));
+	__atomic_store_n(&flk->pending, false, __ATOMIC_RELEASE);
+
+	return true;
+}
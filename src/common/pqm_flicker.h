@@ -0,0 +1,139 @@
+/**
+ * @file pqm_flicker.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm flicker meter.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_FLICKER_H
+#define PQM_FLICKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Flicker is measured on the voltage channels: Va, Vb, Vc */
+#define PQM_FLICKER_CHANNELS 3
+/* High pass, three sections of the 6th order low pass, weighting filter */
+#define PQM_FLICKER_BIQUADS 6
+/* Log classifier: 32 classes per octave of Pinst in thousandths, plus 0 */
+#define PQM_FLICKER_CLASSES (32 * 32 + 1)
+/* Short term values averaged into a long term one */
+#define PQM_FLICKER_PLT_PST 12
+
+/**
+ * @struct pqm_biquad
+ * @brief Direct form I biquad, coefficients in Q30, a0 normalized to 1.
+ */
+struct pqm_biquad {
+	int32_t b0;
+	int32_t b1;
+	int32_t b2;
+	int32_t a1;
+	int32_t a2;
+};
+
+/**
+ * @struct pqm_biquad_state
+ * @brief Delay line of a biquad and the rounding error fed back into it.
+ */
+struct pqm_biquad_state {
+	int32_t x1;
+	int32_t x2;
+	int32_t y1;
+	int32_t y2;
+	int32_t err;
+};
+
+/**
+ * @struct pqm_flicker
+ * @brief IEC 61000-4-15 flicker meter. The acquisition squares and
+ * decimates the input to about 800 Hz, then runs the normalization,
+ * weighting filters and smoothing in fixed point. The main loop computes
+ * Pst and Plt from the classified Pinst values.
+ */
+struct pqm_flicker {
+	/** Filter cascade for the selected lamp and supply frequency */
+	struct pqm_biquad bq[PQM_FLICKER_BIQUADS];
+	/** Input samples per filtered sample */
+	uint32_t decim;
+	/** Normalization time constant, in filtered samples */
+	uint32_t norm_len;
+	/** Smoothing coefficient, Q24 */
+	int32_t smooth;
+	/** Pinst in thousandths for one unit of smoothed output Q28 */
+	uint32_t gain;
+	/** Filtered samples in a Pst interval */
+	uint32_t pst_len;
+	/** Filtered samples left before classification starts */
+	uint32_t settle;
+	/** Squared input accumulated for the next filtered sample */
+	uint64_t acc[PQM_FLICKER_CHANNELS];
+	uint32_t acc_cnt;
+	/** Mean square of the input, used as reference level */
+	uint64_t norm[PQM_FLICKER_CHANNELS];
+	uint32_t norm_cnt;
+	bool primed;
+	struct pqm_biquad_state st[PQM_FLICKER_CHANNELS][PQM_FLICKER_BIQUADS];
+	/** Smoothed squared output, Q40 */
+	int64_t lp[PQM_FLICKER_CHANNELS];
+	/** Instantaneous flicker sensation, in thousandths */
+	uint32_t pinst[PQM_FLICKER_CHANNELS];
+	/** Pinst distribution, one filled by the acquisition, one evaluated */
+	uint32_t hist[2][PQM_FLICKER_CHANNELS][PQM_FLICKER_CLASSES];
+	uint32_t fill;
+	/** Filtered samples classified in the current interval */
+	uint32_t count;
+	/** Set by the producer when hist[fill ^ 1] is complete */
+	volatile bool pending;
+	/** Intervals dropped because the previous one was still pending */
+	volatile uint32_t overruns;
+	/** Processor cycles spent on the last filtered sample, all channels */
+	uint32_t last_cycles;
+	/** Short and long term severity, in thousandths */
+	uint32_t pst[PQM_FLICKER_CHANNELS];
+	uint32_t plt[PQM_FLICKER_CHANNELS];
+	/** Last short term values, for Plt */
+	uint32_t pst_hist[PQM_FLICKER_CHANNELS][PQM_FLICKER_PLT_PST];
+	uint32_t pst_pos;
+	uint32_t pst_cnt;
+};
+
+void pqm_flicker_init(struct pqm_flicker *flk, uint32_t fs, bool lamp_120v,
+		      bool supply_60hz);
+
+bool pqm_flicker_feed(struct pqm_flicker *flk, const uint32_t *scan);
+
+bool pqm_flicker_process(struct pqm_flicker *flk);
+
+#endif
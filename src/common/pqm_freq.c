@@ -0,0 +1,170 @@
+/**
+ * @file pqm_freq.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm frequency tracker.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pqm_freq.h"
+#include "pqm_rms.h"
+#include "no_os_util.h"
+
+/**
+ * @brief Restart tracking for a new sampling or nominal frequency.
+ * @param freq - frequency tracker.
+ * @param fs - sampling frequency in Hz.
+ * @param f_nom - nominal frequency in Hz.
+ */
+void pqm_freq_init(struct pqm_freq *freq, uint32_t fs, uint32_t f_nom)
+{
+	uint32_t nom = ((uint64_t)fs << 16) / f_nom;
+
+	memset(freq, 0, sizeof(*freq));
+	/* Below 8 scans per cycle zero crossings are too coarse to be useful */
+	if (fs < 8 * f_nom || nom > UINT32_MAX / 2)
+		return;
+
+	freq->fs = fs;
+	/* Accept 40 to 60 Hz, resp. 48 to 72 Hz */
+	freq->min_period = nom - nom / 6;
+	freq->max_period = nom + nom / 4;
+	/* Two sections at the nominal frequency keep the 3rd harmonic at 20 % */
+	freq->lp_coeff = lround(65536.0 * (1.0 - exp(-2.0 * M_PI * f_nom / fs)));
+	freq->interval_end = (uint64_t)fs * PQM_FREQ_INTERVAL_S;
+	freq->int_valid = true;
+}
+
+/**
+ * @brief Update the interval measurement on a zero crossing.
+ * @param freq - frequency tracker.
+ * @param tc - zero crossing, in scans Q16.
+ * @param ok - the cycle ending at tc has a valid period.
+ * @return true if a 10 s measurement completed.
+ */
+static bool pqm_freq_interval(struct pqm_freq *freq, uint64_t tc, bool ok)
+{
+	bool done = false;
+	uint64_t span;
+
+	if (freq->n < freq->interval_end) {
+		if (!ok)
+			freq->int_valid = false;
+		if (!freq->first_tc) {
+			freq->first_tc = tc;
+		} else {
+			freq->int_cycles++;
+			freq->end_tc = tc;
+		}
+		return false;
+	}
+
+	/* First crossing of the next interval closes the current one */
+	span = freq->end_tc - freq->first_tc;
+	if (freq->int_valid && freq->int_cycles && span) {
+		freq->value = ((uint64_t)freq->int_cycles * freq->fs * 1000 << 16) /
+			      span;
+		done = true;
+	}
+	while (freq->interval_end <= freq->n)
+		freq->interval_end += (uint64_t)freq->fs * PQM_FREQ_INTERVAL_S;
+	freq->first_tc = tc;
+	freq->end_tc = tc;
+	freq->int_cycles = 0;
+	freq->int_valid = true;
+
+	return done;
+}
+
+/**
+ * @brief Track the fundamental on one full scan. Producer side only.
+ * @param freq - frequency tracker.
+ * @param scan - raw samples, phase A voltage first.
+ * @return true if a new 10 s frequency is available in value.
+ */
+bool pqm_freq_feed(struct pqm_freq *freq, const uint32_t *scan)
+{
+	uint64_t tc, meas;
+	bool done = false;
+	uint32_t frac;
+	int32_t y;
+
+	if (!freq->fs)
+		return false;
+
+	freq->lp[0] += (((int64_t)pqm_sample_value(scan[0]) * 256 - freq->lp[0]) *
+			freq->lp_coeff) >> 16;
+	freq->lp[1] += ((freq->lp[0] - freq->lp[1]) * freq->lp_coeff) >> 16;
+	y = freq->lp[1] >> 8;
+	freq->cyc_peak = no_os_max(freq->cyc_peak, abs(y));
+
+	if (y < -(freq->peak >> 3))
+		freq->armed = true;
+
+	if (freq->armed && y >= 0 && freq->prev < 0) {
+		/* Crossing between the previous scan and this one */
+		frac = ((uint64_t)-freq->prev << 16) / ((int64_t)y - freq->prev);
+		tc = ((freq->n - 1) << 16) + frac;
+		meas = tc - freq->last_tc;
+
+		if (!freq->last_tc) {
+			/* The filters are still settling, the next one opens */
+		} else if (meas >= freq->min_period && meas <= freq->max_period) {
+			if (!freq->valid)
+				freq->loop = meas;
+			else
+				freq->loop += ((int32_t)(meas - freq->loop)) >>
+					      PQM_FREQ_LOOP_SHIFT;
+			if (++freq->valid >= PQM_FREQ_LOCK_CYCLES)
+				freq->period = freq->loop;
+			done = pqm_freq_interval(freq, tc, true);
+		} else {
+			freq->valid = 0;
+			freq->period = 0;
+			done = pqm_freq_interval(freq, tc, false);
+		}
+
+		freq->last_tc = tc;
+		freq->armed = false;
+		freq->peak = freq->cyc_peak;
+		freq->cyc_peak = 0;
+	}
+
+	freq->prev = y;
+	freq->n++;
+
+	return done;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file pqm_freq.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm frequency tracker.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_FREQ_H
+#define PQM_FREQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Gain of the tracking loop, 2^-SHIFT of the period error per cycle */
+#define PQM_FREQ_LOOP_SHIFT 2
+/* Consecutive valid cycles before the tracked period is used */
+#define PQM_FREQ_LOCK_CYCLES 4
+/* Length of a frequency measurement, as per IEC 61000-4-30 */
+#define PQM_FREQ_INTERVAL_S 10
+
+/**
+ * @struct pqm_freq
+ * @brief Fundamental frequency tracker. The acquisition low-pass filters the
+ * phase A voltage, times its positive zero crossings to a fraction of a scan
+ * and tracks the period with a first order loop. The frequency is published
+ * every 10 s as the number of whole cycles over their cumulative duration.
+ */
+struct pqm_freq {
+	/** Scans per second, zero when tracking is disabled */
+	uint32_t fs;
+	/** Shortest and longest accepted period, in scans Q16 */
+	uint32_t min_period;
+	uint32_t max_period;
+	/** Coefficient of the two low-pass sections, Q16 */
+	int32_t lp_coeff;
+	/** Low-pass states, in codes Q8 */
+	int64_t lp[2];
+	/** Previous filtered sample, in codes */
+	int32_t prev;
+	/** Largest filtered amplitude of the last and of the current cycle */
+	int32_t peak;
+	int32_t cyc_peak;
+	/** Set once the signal went below the hysteresis */
+	bool armed;
+	/** Scans since the acquisition started */
+	uint64_t n;
+	/** Last zero crossing, in scans Q16, zero when none */
+	uint64_t last_tc;
+	/** Tracked period, in scans Q16, zero while unlocked */
+	uint32_t period;
+	/** Loop state and consecutive valid cycles */
+	uint32_t loop;
+	uint32_t valid;
+	/** End of the current measurement interval, in scans */
+	uint64_t interval_end;
+	/** First and last zero crossing of the interval, in scans Q16 */
+	uint64_t first_tc;
+	uint64_t end_tc;
+	/** Whole cycles in the interval, cleared if one was rejected */
+	uint32_t int_cycles;
+	bool int_valid;
+	/** Last 10 s frequency, in mHz */
+	uint32_t value;
+	/** Processor cycles spent on the last scan */
+	uint32_t last_cycles;
+};
+
+void pqm_freq_init(struct pqm_freq *freq, uint32_t fs, uint32_t f_nom);
+
+bool pqm_freq_feed(struct pqm_freq *freq, const uint32_t *scan);
+
+#endif
@@ -0,0 +1,396 @@
+/**
+ * @file pqm_harm.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm harmonic analyser.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "pqm_harm.h"
+#include "pqm_rms.h"
+#include "no_os_util.h"
+
+/* Input headroom left for the transform, see pqm_fft() */
+#define PQM_HARM_PRESHIFT 6
+/* Work units of the extraction of a pair, mostly square roots */
+#define PQM_HARM_EXTRACT_COST (8 * PQM_MAX_HARMONIC)
+/* Largest droop correction, Q16, only reached past a third of fs */
+#define PQM_HARM_GAIN_MAX (2 << 16)
+
+/**
+ * @brief Restart the analyser with a new window length.
+ * @param harm - harmonic analyser.
+ * @param window - input samples in a window, at least 1.
+ * @param cycles - fundamental cycles in a window.
+ */
+void pqm_harm_init(struct pqm_harm *harm, uint32_t window, uint32_t cycles)
+{
+	harm->window = window ? window : 1;
+	/* window / PQM_HARM_POINTS in Q16, exact */
+	harm->step = harm->window << (16 - PQM_HARM_LOG2);
+	harm->cycles = cycles;
+	harm->period = 0;
+	harm->fill = 0;
+	harm->k = 0;
+	harm->pos = 0;
+	harm->n = 0;
+	harm->pending = false;
+	harm->state = PQM_HARM_LOAD;
+	harm->pair = 0;
+	harm->point = 0;
+	harm->busy_cycles = 0;
+	memset(harm->prev, 0, sizeof(harm->prev));
+}
+
+/**
+ * @brief Bound the work done by each call of pqm_harm_process() and restart
+ * the slice statistics. Consumer side only.
+ * @param harm - harmonic analyser.
+ * @param slice - work units per call, zero to analyse a window in one call.
+ * A unit is about one butterfly: a 7 channel window is some 62000 units.
+ */
+void pqm_harm_set_slice(struct pqm_harm *harm, uint32_t slice)
+{
+	harm->slice = slice;
+	harm->slice_max = 0;
+	memset(harm->slice_hist, 0, sizeof(harm->slice_hist));
+}
+
+/**
+ * @brief Record the duration of a call of pqm_harm_process() that had a
+ * window to work on. Consumer side only.
+ * @param harm - harmonic analyser.
+ * @param cycles - processor cycles spent in the call.
+ * @param done - the call completed the window.
+ */
+void pqm_harm_account(struct pqm_harm *harm, uint32_t cycles, bool done)
+{
+	uint32_t b = 0;
+
+	while (b < PQM_HARM_HIST_BUCKETS - 1 &&
+	       cycles >> (b + PQM_HARM_HIST_SHIFT + 1))
+		b++;
+	harm->slice_hist[b]++;
+	harm->slice_max = no_os_max(harm->slice_max, cycles);
+	harm->busy_cycles += cycles;
+	if (!done)
+		return;
+	harm->last_cycles = harm->busy_cycles;
+	harm->busy_cycles = 0;
+}
+
+/**
+ * @brief Set the fundamental period the next windows are resampled on.
+ * Producer side only.
+ * @param harm - harmonic analyser.
+ * @param period - period in input samples Q16, zero for the nominal one.
+ */
+void pqm_harm_track(struct pqm_harm *harm, uint32_t period)
+{
+	harm->period = period;
+}
+
+/**
+ * @brief Resample one full scan into the window being filled. Producer side
+ * only.
+ * @param harm - harmonic analyser.
+ * @param scan - PQM_HARM_CHANNELS raw samples.
+ */
+void pqm_harm_feed(struct pqm_harm *harm, const uint32_t *scan)
+{
+	int32_t cur[PQM_HARM_CHANNELS];
+	int64_t t = (int64_t)harm->n << 16;
+	int64_t whole;
+	int32_t frac;
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_HARM_CHANNELS; ch++)
+		cur[ch] = pqm_sample_value(scan[ch]);
+
+	/* Points between the previous sample and this one, linear interpolation */
+	while (harm->pos <= t) {
+		frac = harm->pos + 0x10000 - t;
+		for (ch = 0; ch < PQM_HARM_CHANNELS; ch++)
+			harm->win[harm->fill][ch][harm->k] = harm->prev[ch] +
+							     (((int64_t)(cur[ch] - harm->prev[ch]) * frac) >> 16);
+		harm->pos += harm->step;
+
+		if (++harm->k < PQM_HARM_POINTS)
+			continue;
+
+		if (__atomic_load_n(&harm->pending, __ATOMIC_ACQUIRE)) {
+			harm->overruns++;
+		} else {
+			harm->fill ^= 1;
+			__atomic_store_n(&harm->pending, true, __ATOMIC_RELEASE);
+		}
+		harm->k = 0;
+		/* The next window starts on the next point */
+		whole = harm->pos >> 16;
+		harm->pos -= whole << 16;
+		harm->n -= whole;
+		t -= whole << 16;
+		if (harm->period)
+			harm->step = ((uint64_t)harm->period * harm->cycles) >>
+				     PQM_HARM_LOG2;
+		else
+			harm->step = harm->window << (16 - PQM_HARM_LOG2);
+	}
+
+	memcpy(harm->prev, cur, sizeof(cur));
+	harm->n++;
+}
+
+/**
+ * @brief Load points of two channels in the transform area, one as the real
+ * and one as the imaginary part.
+ * @param harm - harmonic analyser.
+ * @param win - complete window.
+ * @param ch - first channel, the second is ch + 1 if it exists.
+ * @param from - first point to be loaded.
+ * @param n - number of points to be loaded.
+ */
+static void pqm_harm_load(struct pqm_harm *harm,
+			  int32_t (*win)[PQM_HARM_POINTS], uint32_t ch,
+			  uint32_t from, uint32_t n)
+{
+	bool two = ch + 1 < PQM_HARM_CHANNELS;
+	struct pqm_cpx *z = harm->work;
+	uint32_t i;
+
+	for (i = from; i < from + n; i++) {
+		z[i].re = win[ch][i] * (1 << PQM_HARM_PRESHIFT);
+		z[i].im = two ? win[ch + 1][i] * (1 << PQM_HARM_PRESHIFT) : 0;
+	}
+}
+
+/**
+ * @brief Compute the droop correction of the window about to be analysed.
+ * The resampler interpolates linearly and its points fall at every fraction
+ * of an input sample, which averages to a gain of sinc^2(f / fs) at input
+ * frequency f: 0.73 for order 49 of 50 Hz at 8 kS/s.
+ * @param harm - harmonic analyser.
+ */
+static void pqm_harm_gain(struct pqm_harm *harm)
+{
+	/* Input samples per window */
+	float window = (float)harm->step * PQM_HARM_POINTS / 65536;
+	float x, g;
+	uint32_t h;
+
+	for (h = 1; h <= PQM_MAX_HARMONIC; h++) {
+		x = (float)M_PI * h * harm->cycles / window;
+		g = sinf(x) / x;
+		g *= g;
+		harm->gain[h - 1] = g * PQM_HARM_GAIN_MAX > 65536 ?
+				    lrintf(65536 / g) : PQM_HARM_GAIN_MAX;
+	}
+}
+
+/**
+ * @brief Extract the harmonics of two channels from their joint transform.
+ * @param harm - harmonic analyser.
+ * @param ch - first channel, the second is ch + 1 if it exists.
+ */
+static void pqm_harm_extract(struct pqm_harm *harm, uint32_t ch)
+{
+	bool two = ch + 1 < PQM_HARM_CHANNELS;
+	struct pqm_cpx *z = harm->work;
+	int64_t xr, xi, yr, yi;
+	uint32_t h, k;
+
+	for (h = 1; h <= PQM_MAX_HARMONIC; h++) {
+		k = h * harm->cycles;
+		if (k >= PQM_HARM_POINTS / 2) {
+			harm->next[ch][h - 1] = 0;
+			harm->bins[ch][h - 1] = (struct pqm_cpx) {0, 0};
+			if (two) {
+				harm->next[ch + 1][h - 1] = 0;
+				harm->bins[ch + 1][h - 1] = (struct pqm_cpx) {0, 0};
+			}
+			continue;
+		}
+		/* X = (Z[k] + Z*[N - k]) / 2, Y = (Z[k] - Z*[N - k]) / 2j */
+		xr = ((int64_t)z[k].re + z[PQM_HARM_POINTS - k].re) >> 1;
+		xi = ((int64_t)z[k].im - z[PQM_HARM_POINTS - k].im) >> 1;
+		yr = ((int64_t)z[k].im + z[PQM_HARM_POINTS - k].im) >> 1;
+		yi = ((int64_t)z[PQM_HARM_POINTS - k].re - z[k].re) >> 1;
+		xr = (xr * harm->gain[h - 1]) >> 16;
+		xi = (xi * harm->gain[h - 1]) >> 16;
+		yr = (yr * harm->gain[h - 1]) >> 16;
+		yi = (yi * harm->gain[h - 1]) >> 16;
+		harm->bins[ch][h - 1] = (struct pqm_cpx) {xr, xi};
+		if (two)
+			harm->bins[ch + 1][h - 1] = (struct pqm_cpx) {yr, yi};
+		/*
+		 * |X| is half the amplitude scaled by 2^PRESHIFT, the RMS value
+		 * is |X| * sqrt(2) / 2^PRESHIFT.
+		 */
+		harm->next[ch][h - 1] =
+			(pqm_isqrt64(2 * (xr * xr + xi * xi)) +
+			 (1 << (PQM_HARM_PRESHIFT - 1))) >> PQM_HARM_PRESHIFT;
+		if (two)
+			harm->next[ch + 1][h - 1] =
+				(pqm_isqrt64(2 * (yr * yr + yi * yi)) +
+				 (1 << (PQM_HARM_PRESHIFT - 1))) >> PQM_HARM_PRESHIFT;
+	}
+}
+
+/**
+ * @brief Compute the THD of a channel from its harmonics.
+ * @param harm - harmonic analyser.
+ * @param ch - channel.
+ */
+static void pqm_harm_thd(struct pqm_harm *harm, uint32_t ch)
+{
+	uint64_t sum = 0;
+	uint32_t h;
+
+	for (h = 1; h < PQM_MAX_HARMONIC; h++)
+		sum += (uint64_t)harm->harmonics[ch][h] * harm->harmonics[ch][h];
+
+	if (!harm->harmonics[ch][0]) {
+		harm->thd[ch] = 0;
+		return;
+	}
+	harm->thd[ch] = (uint64_t)pqm_isqrt64(sum) * 10000 /
+			harm->harmonics[ch][0];
+}
+
+/**
+ * @brief Compute the active power of every order of a phase from the voltage
+ * and current phasors of the window, and its direction.
+ * @param harm - harmonic analyser.
+ * @param ph - phase.
+ */
+static void pqm_harm_phase_power(struct pqm_harm *harm, uint32_t ph)
+{
+	const struct pqm_cpx *v = harm->bins[ph];
+	const struct pqm_cpx *i = harm->bins[ph + PQM_HARM_PHASES];
+	uint64_t s, mag;
+	int64_t p;
+	uint32_t h;
+
+	for (h = 0; h < PQM_MAX_HARMONIC; h++) {
+		/*
+		 * P = Urms * Irms * cos(phi) = 2 * Re(V * I*) / 2^(2 * PRESHIFT),
+		 * V and I being half amplitudes scaled by 2^PRESHIFT.
+		 */
+		p = 2 * ((int64_t)v[h].re * i[h].re + (int64_t)v[h].im * i[h].im);
+		p = (p + (1 << (2 * PQM_HARM_PRESHIFT - 1))) >>
+		    (2 * PQM_HARM_PRESHIFT);
+		harm->power[ph][h] = p;
+		s = (uint64_t)harm->harmonics[ph][h] *
+		    harm->harmonics[ph + PQM_HARM_PHASES][h];
+		mag = p < 0 ? -p : p;
+		if (!s || mag * 1000 < s * PQM_HARM_DIR_MIN)
+			harm->direction[ph][h] = 0;
+		else
+			harm->direction[ph][h] = p < 0 ? -1 : 1;
+	}
+}
+
+/**
+ * @brief Compute the harmonic active power and direction of every phase from
+ * the phasors and harmonics of the last window. Consumer side only, run by
+ * pqm_harm_process once the window is complete.
+ * @param harm - harmonic analyser.
+ */
+void pqm_harm_power(struct pqm_harm *harm)
+{
+	uint32_t ph;
+
+	for (ph = 0; ph < PQM_HARM_PHASES; ph++)
+		pqm_harm_phase_power(harm, ph);
+}
+
+/**
+ * @brief Advance the analysis of the pending window, if any, by at most one
+ * slice. Consumer side only.
+ * @param harm - harmonic analyser.
+ * @return true if the window is complete and harmonics, thd and harmonic powers
+ * were updated.
+ */
+bool pqm_harm_process(struct pqm_harm *harm)
+{
+	uint32_t budget = harm->slice ? harm->slice : UINT32_MAX;
+	int32_t (*win)[PQM_HARM_POINTS];
+	uint32_t ch, n;
+
+	if (!__atomic_load_n(&harm->pending, __ATOMIC_ACQUIRE))
+		return false;
+
+	win = harm->win[harm->fill ^ 1];
+	while (budget) {
+		switch (harm->state) {
+		case PQM_HARM_LOAD:
+			if (!harm->pair && !harm->point)
+				pqm_harm_gain(harm);
+			n = no_os_min(budget, PQM_HARM_POINTS - harm->point);
+			pqm_harm_load(harm, win, harm->pair, harm->point, n);
+			harm->point += n;
+			budget -= n;
+			if (harm->point < PQM_HARM_POINTS)
+				break;
+			pqm_fft_start(&harm->job, harm->work, PQM_HARM_LOG2);
+			harm->state = PQM_HARM_FFT;
+			break;
+		case PQM_HARM_FFT:
+			budget = pqm_fft_run(&harm->job, budget);
+			if (budget)
+				harm->state = PQM_HARM_EXTRACT;
+			break;
+		case PQM_HARM_EXTRACT:
+			pqm_harm_extract(harm, harm->pair);
+			budget -= no_os_min(budget, PQM_HARM_EXTRACT_COST);
+			harm->pair += 2;
+			harm->point = 0;
+			harm->state = harm->pair < PQM_HARM_CHANNELS ?
+				      PQM_HARM_LOAD : PQM_HARM_FINISH;
+			break;
+		default:
+			memcpy(harm->harmonics, harm->next, sizeof(harm->next));
+			for (ch = 0; ch < PQM_HARM_CHANNELS; ch++)
+				pqm_harm_thd(harm, ch);
+			pqm_harm_power(harm);
+			harm->state = PQM_HARM_LOAD;
+			harm->pair = 0;
+			__atomic_store_n(&harm->pending, false, __ATOMIC_RELEASE);
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file pqm_harm.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm harmonic analyser.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_HARM_H
+#define PQM_HARM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pqm_fft.h"
+
+/* Channels of a full scan: Va, Vb, Vc, Ia, Ib, Ic, In */
+#define PQM_HARM_CHANNELS 7
+/* Phases: the voltage of phase p is channel p, its current p + 3 */
+#define PQM_HARM_PHASES 3
+/* Points per analysis window, whatever the sampling frequency */
+#define PQM_HARM_LOG2 PQM_FFT_MAX_LOG2
+#define PQM_HARM_POINTS (1 << PQM_HARM_LOG2)
+#define PQM_MAX_HARMONIC 50
+/* Default work units per slice of the analysis, see pqm_harm_set_slice() */
+#define PQM_HARM_SLICE 2048
+/* Slice durations histogram: bucket b > 0 counts 2^(b + 10) to 2^(b + 11) cycles */
+#define PQM_HARM_HIST_BUCKETS 16
+#define PQM_HARM_HIST_SHIFT 10
+/* Smallest power factor of an order with a direction, in thousandths */
+#define PQM_HARM_DIR_MIN 1
+
+enum pqm_harm_state {
+	PQM_HARM_LOAD,
+	PQM_HARM_FFT,
+	PQM_HARM_EXTRACT,
+	PQM_HARM_FINISH
+};
+
+/**
+ * @struct pqm_harm
+ * @brief Harmonic analyser. The acquisition resamples every 10/12 cycle
+ * window to PQM_HARM_POINTS points, so harmonic h falls exactly on bin
+ * h * cycles, and the main loop transforms the complete windows. Windows
+ * follow the tracked fundamental period when there is one, the nominal one
+ * otherwise. The analysis of a window may be split in bounded slices, run
+ * while the next window is acquired.
+ */
+struct pqm_harm {
+	/** Resampled windows, one filled by the acquisition, one analysed */
+	int32_t win[2][PQM_HARM_CHANNELS][PQM_HARM_POINTS];
+	/** Window being filled, owned by the producer */
+	uint32_t fill;
+	/** Index of the next point to be produced */
+	uint32_t k;
+	/** Position of the next point, in input samples Q16 from window start */
+	int64_t pos;
+	/** Index of the next input sample from window start */
+	int32_t n;
+	/** Nominal input samples in a window and between two points, Q16 */
+	uint32_t window;
+	uint32_t step;
+	/** Tracked fundamental period, in input samples Q16, zero if unknown */
+	uint32_t period;
+	/** Fundamental cycles in a window */
+	uint32_t cycles;
+	/** Previous input sample of every channel */
+	int32_t prev[PQM_HARM_CHANNELS];
+	/** Set by the producer when win[fill ^ 1] is complete */
+	volatile bool pending;
+	/** Windows dropped because the previous one was still pending */
+	volatile uint32_t overruns;
+	/** Processor cycles spent on the last window and on the current one */
+	uint32_t last_cycles;
+	uint32_t busy_cycles;
+	/** Work units per call of pqm_harm_process(), zero for a whole window */
+	uint32_t slice;
+	/** Longest slice and histogram of the slice durations, in cycles */
+	uint32_t slice_max;
+	uint32_t slice_hist[PQM_HARM_HIST_BUCKETS];
+	/** Progress through the pending window, see enum pqm_harm_state */
+	uint32_t state;
+	/** Channel pair being analysed and next point to be loaded */
+	uint32_t pair;
+	uint32_t point;
+	/** Transform of the pair */
+	struct pqm_fft_job job;
+	struct pqm_cpx work[PQM_HARM_POINTS];
+	/** Harmonics of the pending window, published once it is complete */
+	uint32_t next[PQM_HARM_CHANNELS][PQM_MAX_HARMONIC];
+	/** Inverse of the resampler droop at every order, Q16 */
+	uint32_t gain[PQM_MAX_HARMONIC];
+	/** Phasors of the pending window, half amplitude * 2^PQM_HARM_PRESHIFT */
+	struct pqm_cpx bins[PQM_HARM_CHANNELS][PQM_MAX_HARMONIC];
+	/** RMS of harmonic orders 1 to PQM_MAX_HARMONIC, in codes */
+	uint32_t harmonics[PQM_HARM_CHANNELS][PQM_MAX_HARMONIC];
+	/** Total harmonic distortion, in hundredths of a percent */
+	uint32_t thd[PQM_HARM_CHANNELS];
+	/** Active power of orders 1 to PQM_MAX_HARMONIC, in codes^2 */
+	int64_t power[PQM_HARM_PHASES][PQM_MAX_HARMONIC];
+	/**
+	 * Direction of the active power of every order: 1 towards the load,
+	 * -1 from the load, 0 when the power factor of the order is below
+	 * PQM_HARM_DIR_MIN thousandths
+	 */
+	int8_t direction[PQM_HARM_PHASES][PQM_MAX_HARMONIC];
+};
+
+void pqm_harm_init(struct pqm_harm *harm, uint32_t window, uint32_t cycles);
+
+void pqm_harm_track(struct pqm_harm *harm, uint32_t period);
+
+void pqm_harm_feed(struct pqm_harm *harm, const uint32_t *scan);
+
+bool pqm_harm_process(struct pqm_harm *harm);
+
+void pqm_harm_power(struct pqm_harm *harm);
+
+void pqm_harm_set_slice(struct pqm_harm *harm, uint32_t slice);
+
+void pqm_harm_account(struct pqm_harm *harm, uint32_t cycles, bool done);
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * @file pqm_msv.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm mains signalling voltage detector.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "pqm_msv.h"
+#include "pqm_rms.h"
+#include "no_os_util.h"
+
+/**
+ * @brief Restart detection for a new window or carrier. The carrier is
+ * rounded to the nearest bin of the 10/12 cycle window, so the fundamental
+ * and its harmonics do not leak into it. The trigger settings, the time
+ * since acquisition start and a complete record not yet read are kept, a
+ * record in progress is dropped.
+ * @param msv - detector.
+ * @param fs - sampling frequency in Hz.
+ * @param window - scans in a 10/12 cycle window.
+ * @param carrier - carrier frequency in Hz, zero to disable detection.
+ */
+void pqm_msv_init(struct pqm_msv *msv, uint32_t fs, uint32_t window,
+		  uint32_t carrier)
+{
+	uint32_t bin = fs ? ((uint64_t)carrier * window + fs / 2) / fs : 0;
+
+	msv->fs = fs ? fs : 1;
+	msv->window = 0;
+	msv->coeff = 0;
+	if (bin && 2 * bin < window) {
+		msv->window = window;
+		msv->coeff = no_os_min(lround(ldexp(2.0 * cos(2.0 * M_PI * bin /
+							    window), 30)),
+				       INT32_MAX);
+	}
+	msv->count = 0;
+	memset(msv->s1, 0, sizeof(msv->s1));
+	memset(msv->s2, 0, sizeof(msv->s2));
+	memset(msv->value, 0, sizeof(msv->value));
+	msv->pending = false;
+	if (msv->state == PQM_MSV_DONE)
+		return;
+	msv->state = PQM_MSV_IDLE;
+	msv->rec_cnt = 0;
+	msv->rec_rd = 0;
+}
+
+/**
+ * @brief Set the level starting a record and the record length.
+ * @param msv - detector.
+ * @param nominal - nominal voltage, in codes.
+ * @param level_pct - carrier level in percent of the nominal voltage, zero
+ * to disable recording.
+ * @param rec_len - windows in a record, limited to PQM_MSV_RECORD_MAX.
+ */
+void pqm_msv_set_trigger(struct pqm_msv *msv, uint32_t nominal,
+			 uint32_t level_pct, uint32_t rec_len)
+{
+	msv->level = (uint64_t)nominal * level_pct / 100;
+	msv->rec_len = no_os_clamp(rec_len, 1, PQM_MSV_RECORD_MAX);
+}
+
+/**
+ * @brief Run the Goertzel recursion on one full scan and hand the filter
+ * state over at the end of every window. Producer side only.
+ * @param msv - detector.
+ * @param scan - raw samples, voltage channels first.
+ */
+void pqm_msv_feed(struct pqm_msv *msv, const uint32_t *scan)
+{
+	int64_t s;
+	uint32_t ch;
+
+	msv->now++;
+	if (!msv->window)
+		return;
+
+	for (ch = 0; ch < PQM_MSV_CHANNELS; ch++) {
+		s = (pqm_sample_value(scan[ch]) >> PQM_MSV_PRESHIFT) +
+		    ((msv->coeff * msv->s1[ch]) >> 30) - msv->s2[ch];
+		msv->s2[ch] = msv->s1[ch];
+		msv->s1[ch] = s;
+	}
+
+	if (++msv->count < msv->window)
+		return;
+	msv->count = 0;
+
+	if (__atomic_load_n(&msv->pending, __ATOMIC_ACQUIRE)) {
+		msv->overruns++;
+	} else {
+		for (ch = 0; ch < PQM_MSV_CHANNELS; ch++) {
+			msv->done[ch][0] = msv->s1[ch];
+			msv->done[ch][1] = msv->s2[ch];
+		}
+		msv->done_at = msv->now;
+		__atomic_store_n(&msv->pending, true, __ATOMIC_RELEASE);
+	}
+	memset(msv->s1, 0, sizeof(msv->s1));
+	memset(msv->s2, 0, sizeof(msv->s2));
+}
+
+/**
+ * @brief Compute the carrier RMS of the last complete window and update the
+ * record. Consumer side only.
+ * @param msv - detector.
+ * @return true if a new window was processed.
+ */
+bool pqm_msv_process(struct pqm_msv *msv)
+{
+	double c = ldexp(msv->coeff, -30);
+	double s1, s2, p;
+	bool above = false;
+	uint64_t at;
+	uint32_t ch;
+
+	if (!__atomic_load_n(&msv->pending, __ATOMIC_ACQUIRE))
+		return false;
+
+	for (ch = 0; ch < PQM_MSV_CHANNELS; ch++) {
+		s1 = msv->done[ch][0];
+		s2 = msv->done[ch][1];
+		/* |X|^2 of the bin, the carrier RMS is sqrt(2) * |X| / N */
+		p = no_os_max(s1 * s1 + s2 * s2 - c * s1 * s2, 0.0);
+		msv->value[ch] = ldexp(sqrt(2.0 * p), PQM_MSV_PRESHIFT) /
+				 msv->window + 0.5;
+		if (msv->level && msv->value[ch] >= msv->level)
+			above = true;
+	}
+	at = msv->done_at;
+	__atomic_store_n(&msv->pending, false, __ATOMIC_RELEASE);
+
+	if (msv->state == PQM_MSV_IDLE && above) {
+		msv->state = PQM_MSV_RECORDING;
+		msv->rec_cnt = 0;
+		msv->rec_rd = 0;
+		msv->rec_start_ms = at * 1000 / msv->fs;
+		msv->rec_step_us = (uint64_t)msv->window * 1000000 / msv->fs;
+	}
+	if (msv->state == PQM_MSV_RECORDING) {
+		memcpy(msv->record[msv->rec_cnt], msv->value, sizeof(msv->value));
+		if (++msv->rec_cnt >= msv->rec_len)
+			msv->state = PQM_MSV_DONE;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Take the next window of a complete record. Once the whole record
+ * was read, detection is armed again. Consumer side only.
+ * @param msv - detector.
+ * @param value - carrier RMS of each phase, in codes, return param.
+ * @param ms - end of the window, in ms since acquisition start, return param.
+ * @return true if a window was available.
+ */
+bool pqm_msv_read(struct pqm_msv *msv, uint32_t *value, uint64_t *ms)
+{
+	if (msv->state != PQM_MSV_DONE)
+		return false;
+
+	memcpy(value, msv->record[msv->rec_rd], sizeof(msv->value));
+	*ms = msv->rec_start_ms + (uint64_t)msv->rec_rd * msv->rec_step_us / 1000;
+	if (++msv->rec_rd >= msv->rec_cnt)
+		msv->state = PQM_MSV_IDLE;
+
+	return true;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file pqm_msv.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm mains signalling voltage detector.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_MSV_H
+#define PQM_MSV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Mains signalling is looked for on the voltage channels: Va, Vb, Vc */
+#define PQM_MSV_CHANNELS 3
+/* Longest record, in 10/12 cycle values: 120 s as per IEC 61000-4-30 */
+#define PQM_MSV_RECORD_MAX 600
+/* Samples are reduced to 16 bits so the filter state fits in 64 bits */
+#define PQM_MSV_PRESHIFT 8
+
+enum pqm_msv_state {
+	/** Waiting for the carrier to cross the threshold */
+	PQM_MSV_IDLE,
+	/** Storing the carrier level of every window */
+	PQM_MSV_RECORDING,
+	/** Record complete, being read by the client */
+	PQM_MSV_DONE
+};
+
+/**
+ * @struct pqm_msv
+ * @brief Mains signalling voltage detection. The acquisition runs a Goertzel
+ * filter tuned to the carrier on every voltage phase over a 10/12 cycle
+ * window, the main loop turns the filter state into the carrier RMS and
+ * records it for msv_record_length windows once it crosses the threshold.
+ */
+struct pqm_msv {
+	/** 2 * cos(2 * pi * carrier / fs), Q30, zero when disabled */
+	int32_t coeff;
+	/** Goertzel state of each phase, last two outputs */
+	int64_t s1[PQM_MSV_CHANNELS];
+	int64_t s2[PQM_MSV_CHANNELS];
+	/** Same, for the last complete window */
+	int64_t done[PQM_MSV_CHANNELS][2];
+	/** Scans accumulated and scans in a window */
+	uint32_t count;
+	uint32_t window;
+	/** Scans per second */
+	uint32_t fs;
+	/** Scans since the acquisition started, at the end of the done window */
+	uint64_t now;
+	uint64_t done_at;
+	/** Set by the producer when done holds a complete window */
+	volatile bool pending;
+	/** Windows dropped because the previous one was still pending */
+	volatile uint32_t overruns;
+	/** Processor cycles spent in the filter, current and last window */
+	uint32_t cycles;
+	uint32_t last_cycles;
+	/** Carrier RMS of the last window, in codes */
+	uint32_t value[PQM_MSV_CHANNELS];
+	/** Carrier level starting a record, in codes, zero when disabled */
+	uint32_t level;
+	/** Windows in a record */
+	uint32_t rec_len;
+	/** See enum pqm_msv_state */
+	enum pqm_msv_state state;
+	/** Windows stored and windows already handed to the client */
+	uint32_t rec_cnt;
+	uint32_t rec_rd;
+	/** End of the first recorded window, in ms since acquisition start */
+	uint64_t rec_start_ms;
+	/** Duration of a recorded window, in us */
+	uint32_t rec_step_us;
+	/** Carrier RMS of every recorded window, in codes */
+	uint32_t record[PQM_MSV_RECORD_MAX][PQM_MSV_CHANNELS];
+};
+
+void pqm_msv_init(struct pqm_msv *msv, uint32_t fs, uint32_t window,
+		  uint32_t carrier);
+
+void pqm_msv_set_trigger(struct pqm_msv *msv, uint32_t nominal,
+			 uint32_t level_pct, uint32_t rec_len);
+
+void pqm_msv_feed(struct pqm_msv *msv, const uint32_t *scan);
+
+bool pqm_msv_process(struct pqm_msv *msv);
+
+bool pqm_msv_read(struct pqm_msv *msv, uint32_t *value, uint64_t *ms);
+
+#endif
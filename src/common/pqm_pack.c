@@ -0,0 +1,109 @@
+/**
+ * @file pqm_pack.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Conversion of native scans to the transport formats.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_pack.h"
+
+/**
+ * @brief Convert native 32-bit samples to an integer transport format. Output
+ * is never larger than input, so src and dst may be the same buffer. Float32
+ * needs the channel scales, see pqm_pack_float().
+ * @param fmt - transport format.
+ * @param src - native samples, 24 significant bits in each word.
+ * @param dst - destination of the converted samples.
+ * @param nb_samples - number of samples to convert.
+ * @return the number of bytes written to dst.
+ */
+uint32_t pqm_pack(enum scan_format_values fmt, const uint32_t *src, void *dst,
+		  uint32_t nb_samples)
+{
+	uint32_t *dst32 = dst;
+	uint16_t *dst16 = dst;
+	uint8_t *dst8 = dst;
+	uint32_t w;
+	uint32_t i;
+
+	switch (fmt) {
+	case PQM_SCAN_BE32:
+		for (i = 0; i < nb_samples; i++)
+			dst32[i] = __builtin_bswap32(src[i]);
+		return nb_samples * 4;
+	case PQM_SCAN_PACKED24:
+		for (i = 0; i < nb_samples; i++) {
+			w = src[i];
+			dst8[0] = w;
+			dst8[1] = w >> 8;
+			dst8[2] = w >> 16;
+			dst8 += 3;
+		}
+		return nb_samples * 3;
+	case PQM_SCAN_TRUNC16:
+		for (i = 0; i < nb_samples; i++)
+			dst16[i] = src[i] >> 8;
+		return nb_samples * 2;
+	case PQM_SCAN_LE32:
+	default:
+		if ((void *)src != dst)
+			memcpy(dst, src, nb_samples * 4);
+		return nb_samples * 4;
+	}
+}
+
+/**
+ * @brief Convert whole scans of native samples to float32 volts and amps.
+ * The code shifted left by 8 is converted as is and its scale carries the
+ * 1/256, so each sample costs a shift, a conversion and a multiplication.
+ * @param scale - factor of each enabled channel, in scan order.
+ * @param cnt - number of enabled channels.
+ * @param src - native samples, 24 significant bits in each word.
+ * @param dst - destination of the converted samples, may be src.
+ * @param nb_samples - number of samples to convert, whole scans.
+ */
+void pqm_pack_float(const float *scale, uint32_t cnt, const uint32_t *src,
+		    uint32_t *dst, uint32_t nb_samples)
+{
+	uint32_t i, j;
+	float f;
+
+	for (i = 0; i < nb_samples; i += cnt) {
+		for (j = 0; j < cnt; j++) {
+			f = (int32_t)(src[i + j] << 8) * scale[j];
+			memcpy(&dst[i + j], &f, sizeof(f));
+		}
+	}
+}
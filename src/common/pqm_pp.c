@@ -0,0 +1,142 @@
+/**
+ * @file pqm_pp.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Ping-pong capture buffers handed to the IIO buffer by pointer.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stddef.h>
+#include "pqm_pp.h"
+#include "no_os_util.h"
+
+/**
+ * @brief Attach the storage of the two halves. No half is filled until the
+ * first call to pqm_pp_arm().
+ * @param pp - ping-pong buffers.
+ * @param buff0 - storage of the first half.
+ * @param buff1 - storage of the second half.
+ * @param size - capacity of a half, in words.
+ */
+void pqm_pp_init(struct pqm_ping_pong *pp, uint32_t *buff0, uint32_t *buff1,
+		 uint32_t size)
+{
+	pp->buff[0] = buff0;
+	pp->buff[1] = buff1;
+	pp->size = size;
+	pp->armed = false;
+	pp->overruns = 0;
+	pp->underruns = 0;
+}
+
+/**
+ * @brief Start filling the ping-pong halves for a session of nb_scans scans
+ * per refill. Consumer side only.
+ * @param pp - ping-pong buffers.
+ * @param nb_scans - scans in each half, limited to the half capacity
+ * @param cnt - enabled channels in a scan
+ */
+void pqm_pp_arm(struct pqm_ping_pong *pp, uint32_t nb_scans, uint32_t cnt)
+{
+	pp->armed = false;
+	pp->cnt = cnt;
+	pp->nb_scans = no_os_min(nb_scans, pp->size / no_os_max(cnt, 1));
+	pp->fill = 0;
+	pp->pos = 0;
+	pp->rd = 0;
+	pp->state[1] = PQM_PP_FREE;
+	pp->state[0] = PQM_PP_FILLING;
+	__atomic_store_n(&pp->armed, true, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Store the enabled channels of a scan in the half being filled and
+ * hand the half over once it is complete. Producer side only.
+ * @param pp - ping-pong buffers.
+ * @param scan - full scan.
+ * @param idx - indexes of the enabled channels, in scan order.
+ */
+void pqm_pp_produce(struct pqm_ping_pong *pp, const uint32_t *scan,
+		    const uint8_t *idx)
+{
+	uint32_t *dst;
+	uint32_t i;
+
+	if (pp->state[pp->fill] != PQM_PP_FILLING) {
+		/* Both halves were busy, try to resume on the other one */
+		if (pp->state[pp->fill ^ 1] != PQM_PP_FREE) {
+			pp->overruns++;
+			return;
+		}
+		pp->fill ^= 1;
+		pp->pos = 0;
+		pp->state[pp->fill] = PQM_PP_FILLING;
+	}
+
+	dst = pp->buff[pp->fill] + pp->pos;
+	for (i = 0; i < pp->cnt; i++)
+		dst[i] = scan[idx[i]];
+	pp->pos += pp->cnt;
+
+	if (pp->pos < pp->nb_scans * pp->cnt)
+		return;
+
+	__atomic_store_n(&pp->state[pp->fill], PQM_PP_READY, __ATOMIC_RELEASE);
+	if (pp->state[pp->fill ^ 1] == PQM_PP_FREE) {
+		pp->fill ^= 1;
+		pp->pos = 0;
+		pp->state[pp->fill] = PQM_PP_FILLING;
+	}
+}
+
+/**
+ * @brief Give back the half held by IIO and take the next complete one, if
+ * any. Consumer side only, the caller decides how long to wait for it.
+ * @param pp - ping-pong buffers.
+ * @return the half now owned by IIO, NULL if it is not complete yet.
+ */
+uint32_t *pqm_pp_take(struct pqm_ping_pong *pp)
+{
+	uint32_t h = pp->rd;
+
+	if (pp->state[h ^ 1] == PQM_PP_IN_IIO)
+		__atomic_store_n(&pp->state[h ^ 1], PQM_PP_FREE, __ATOMIC_RELEASE);
+
+	if (__atomic_load_n(&pp->state[h], __ATOMIC_ACQUIRE) != PQM_PP_READY)
+		return NULL;
+
+	pp->state[h] = PQM_PP_IN_IIO;
+	pp->rd = h ^ 1;
+
+	return pp->buff[h];
+}
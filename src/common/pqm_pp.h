@@ -0,0 +1,92 @@
+/**
+ * @file pqm_pp.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm ping-pong capture buffers.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_PP_H
+#define PQM_PP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum pqm_pp_state {
+	PQM_PP_FREE,
+	PQM_PP_FILLING,
+	PQM_PP_READY,
+	PQM_PP_IN_IIO
+};
+
+/**
+ * @struct pqm_ping_pong
+ * @brief Pair of capture buffers filled in scan-interleaved layout. While the
+ * acquisition interrupt fills one half, the other one is owned by the IIO
+ * buffer, so a refill only swaps pointers.
+ */
+struct pqm_ping_pong {
+	/** Capture halves, also used as IIO buffer storage */
+	uint32_t *buff[2];
+	/** Capacity of a half, in words */
+	uint32_t size;
+	/** Scans per half and channels per scan for the current buffer session */
+	uint32_t nb_scans;
+	uint32_t cnt;
+	/** Owner of each half, see enum pqm_pp_state */
+	volatile uint8_t state[2];
+	/** Set once nb_scans is known and the producer may run */
+	volatile bool armed;
+	/** Half being filled, owned by the producer */
+	uint32_t fill;
+	/** Next word to be written in the filled half, owned by the producer */
+	uint32_t pos;
+	/** Next half to be handed to IIO, owned by the consumer */
+	uint32_t rd;
+	/** Scans dropped because no half was free */
+	volatile uint32_t overruns;
+	/** Refills that had to wait for a half */
+	uint32_t underruns;
+};
+
+void pqm_pp_init(struct pqm_ping_pong *pp, uint32_t *buff0, uint32_t *buff1,
+		 uint32_t size);
+
+void pqm_pp_arm(struct pqm_ping_pong *pp, uint32_t nb_scans, uint32_t cnt);
+
+void pqm_pp_produce(struct pqm_ping_pong *pp, const uint32_t *scan,
+		    const uint8_t *idx);
+
+uint32_t *pqm_pp_take(struct pqm_ping_pong *pp);
+
+#endif
@@ -0,0 +1,244 @@
+/**
+ * @file pqm_ring.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm scan ring.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_ring.h"
+#include "no_os_util.h"
+
+/**
+ * @brief Gather a run of scans from a sample source into interleaved layout.
+ * @param idx - indexes of the channels to be gathered, in scan order.
+ * @param cnt - number of channels in idx.
+ * @param src - first sample of channel 0 in the source.
+ * @param ch_stride - distance, in samples, between two channels of the source.
+ * @param scan_stride - distance, in samples, between two scans of the source.
+ * @param dst - destination for the interleaved scans.
+ * @param nb_scans - number of scans to gather.
+ */
+static void pqm_gather_scans(const uint8_t *idx, uint32_t cnt,
+			     const uint32_t *src, uint32_t ch_stride,
+			     uint32_t scan_stride, uint32_t *dst,
+			     uint32_t nb_scans)
+{
+	const uint32_t *s0, *s1, *s2, *s3, *s4, *s5, *s6;
+	uint32_t i, j;
+
+	/* Every channel of an interleaved source: the layout already matches */
+	if (ch_stride == 1 && scan_stride == cnt) {
+		memcpy(dst, src, nb_scans * cnt * sizeof(*dst));
+		return;
+	}
+
+	s0 = src + idx[0] * ch_stride;
+	s1 = src + idx[no_os_min(cnt - 1, 1)] * ch_stride;
+	s2 = src + idx[no_os_min(cnt - 1, 2)] * ch_stride;
+	s3 = src + idx[no_os_min(cnt - 1, 3)] * ch_stride;
+
+	switch (cnt) {
+	case 1:
+		if (scan_stride == 1) {
+			memcpy(dst, s0, nb_scans * sizeof(*dst));
+			return;
+		}
+		for (i = 0; i < nb_scans; i++, s0 += scan_stride)
+			*dst++ = *s0;
+		return;
+	case 2:
+		for (i = 0; i < nb_scans; i++) {
+			dst[0] = *s0;
+			dst[1] = *s1;
+			s0 += scan_stride;
+			s1 += scan_stride;
+			dst += 2;
+		}
+		return;
+	case 3:
+		for (i = 0; i < nb_scans; i++) {
+			dst[0] = *s0;
+			dst[1] = *s1;
+			dst[2] = *s2;
+			s0 += scan_stride;
+			s1 += scan_stride;
+			s2 += scan_stride;
+			dst += 3;
+		}
+		return;
+	case 4:
+		for (i = 0; i < nb_scans; i++) {
+			dst[0] = *s0;
+			dst[1] = *s1;
+			dst[2] = *s2;
+			dst[3] = *s3;
+			s0 += scan_stride;
+			s1 += scan_stride;
+			s2 += scan_stride;
+			s3 += scan_stride;
+			dst += 4;
+		}
+		return;
+	case 7:
+		s4 = src + idx[4] * ch_stride;
+		s5 = src + idx[5] * ch_stride;
+		s6 = src + idx[6] * ch_stride;
+		for (i = 0; i < nb_scans; i++) {
+			dst[0] = *s0;
+			dst[1] = *s1;
+			dst[2] = *s2;
+			dst[3] = *s3;
+			dst[4] = *s4;
+			dst[5] = *s5;
+			dst[6] = *s6;
+			s0 += scan_stride;
+			s1 += scan_stride;
+			s2 += scan_stride;
+			s3 += scan_stride;
+			s4 += scan_stride;
+			s5 += scan_stride;
+			s6 += scan_stride;
+			dst += 7;
+		}
+		return;
+	default:
+		for (i = 0; i < nb_scans; i++, src += scan_stride)
+			for (j = 0; j < cnt; j++)
+				*dst++ = src[idx[j] * ch_stride];
+		return;
+	}
+}
+
+
+/**
+ * @brief Initialize a scan ring over caller provided storage.
+ * @param ring - ring to be initialized.
+ * @param buff - storage for nb_scans * scan_words words.
+ * @param nb_scans - capacity of the ring in scans, must be a power of two.
+ * @param scan_words - number of words in a scan.
+ */
+void pqm_ring_init(struct pqm_ring *ring, uint32_t *buff, uint32_t nb_scans,
+		   uint32_t scan_words)
+{
+	ring->buff = buff;
+	ring->nb_scans = nb_scans;
+	ring->scan_words = scan_words;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->overruns = 0;
+	ring->underruns = 0;
+}
+
+/**
+ * @brief Append one scan to the ring. Producer side only.
+ * @param ring - scan ring.
+ * @param scan - scan_words words to be stored.
+ * @return true if the scan was stored, false if the ring was full.
+ */
+bool pqm_ring_push(struct pqm_ring *ring, const uint32_t *scan)
+{
+	uint32_t head = ring->head;
+	uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	uint32_t *slot;
+	uint32_t i;
+
+	if (head - tail >= ring->nb_scans) {
+		ring->overruns++;
+		return false;
+	}
+
+	slot = ring->buff + (head & (ring->nb_scans - 1)) * ring->scan_words;
+	for (i = 0; i < ring->scan_words; i++)
+		slot[i] = scan[i];
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * @brief Number of scans available to the consumer.
+ * @param ring - scan ring.
+ * @return the number of stored scans.
+ */
+uint32_t pqm_ring_level(struct pqm_ring *ring)
+{
+	return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+}
+
+/**
+ * @brief Remove up to nb_scans scans from the ring, keeping only the
+ * requested channels. Consumer side only.
+ * @param ring - scan ring.
+ * @param idx - indexes of the channels to be kept, in scan order.
+ * @param cnt - number of channels in idx.
+ * @param dst - destination for the interleaved scans.
+ * @param nb_scans - maximum number of scans to remove.
+ * @return the number of removed scans.
+ */
+uint32_t pqm_ring_pop(struct pqm_ring *ring, const uint8_t *idx, uint32_t cnt,
+		      uint32_t *dst, uint32_t nb_scans)
+{
+	uint32_t tail = ring->tail;
+	uint32_t avail;
+	uint32_t pos;
+	uint32_t run;
+	uint32_t done;
+
+	avail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+	nb_scans = no_os_min(nb_scans, avail);
+
+	for (done = 0; done < nb_scans; done += run) {
+		pos = (tail + done) & (ring->nb_scans - 1);
+		run = no_os_min(nb_scans - done, ring->nb_scans - pos);
+		pqm_gather_scans(idx, cnt, ring->buff + pos * ring->scan_words, 1,
+				 ring->scan_words, dst + done * cnt, run);
+	}
+
+	__atomic_store_n(&ring->tail, tail + nb_scans, __ATOMIC_RELEASE);
+
+	return nb_scans;
+}
+
+/**
+ * @brief Discard every stored scan. Consumer side only.
+ * @param ring - scan ring.
+ */
+void pqm_ring_flush(struct pqm_ring *ring)
+{
+	__atomic_store_n(&ring->tail,
+			 __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE),
+			 __ATOMIC_RELEASE);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file pqm_ring.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm scan ring.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_RING_H
+#define PQM_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @struct pqm_ring
+ * @brief Single-producer/single-consumer lock-free ring of multi-channel
+ * scans. The producer only writes head and the consumer only writes tail,
+ * so the acquisition interrupt never waits for the IIO side.
+ */
+struct pqm_ring {
+	/** Scan storage, nb_scans * scan_words words */
+	uint32_t *buff;
+	/** Number of scans the ring can hold, power of two */
+	uint32_t nb_scans;
+	/** Number of words in a scan */
+	uint32_t scan_words;
+	/** Free running count of written scans, owned by the producer */
+	volatile uint32_t head;
+	/** Free running count of read scans, owned by the consumer */
+	volatile uint32_t tail;
+	/** Scans dropped because the ring was full */
+	volatile uint32_t overruns;
+	/** Reads that found less data than requested */
+	volatile uint32_t underruns;
+};
+
+void pqm_ring_init(struct pqm_ring *ring, uint32_t *buff, uint32_t nb_scans,
+		   uint32_t scan_words);
+
+bool pqm_ring_push(struct pqm_ring *ring, const uint32_t *scan);
+
+uint32_t pqm_ring_level(struct pqm_ring *ring);
+
+uint32_t pqm_ring_pop(struct pqm_ring *ring, const uint8_t *idx, uint32_t cnt,
+		      uint32_t *dst, uint32_t nb_scans);
+
+void pqm_ring_flush(struct pqm_ring *ring);
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * @file pqm_rms.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm RMS engine.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_rms.h"
+
+/**
+ * @brief Integer square root, rounded to the nearest integer.
+ * @param x - radicand.
+ * @return round(sqrt(x)), saturated to UINT32_MAX.
+ */
+uint32_t pqm_isqrt64(uint64_t x)
+{
+	uint64_t bit = 1ULL << 62;
+	uint64_t res = 0;
+
+	while (bit > x)
+		bit >>= 2;
+
+	while (bit) {
+		if (x >= res + bit) {
+			x -= res + bit;
+			res = (res >> 1) + bit;
+		} else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	/* x now holds the remainder of the truncated root */
+	if (x > res && res < UINT32_MAX)
+		res++;
+
+	return res;
+}
+
+/**
+ * @brief Restart the engine with a new window length.
+ * @param rms - RMS engine.
+ * @param window - scans in an aggregation window, at least 1.
+ * @param quarter - quarter of the nominal cycle, in scans Q16.
+ */
+void pqm_rms_init(struct pqm_rms *rms, uint32_t window, uint32_t quarter)
+{
+	memset(rms->sum, 0, sizeof(rms->sum));
+	memset(rms->p_sum, 0, sizeof(rms->p_sum));
+	memset(rms->q_sum, 0, sizeof(rms->q_sum));
+	memset(rms->delay, 0, sizeof(rms->delay));
+	rms->count = 0;
+	rms->window = window ? window : 1;
+	/* v(n - quarter) lies between v(n - d) and v(n - d - 1) */
+	rms->delay_len = (quarter >> 16) + 2;
+	rms->delay_frac = (quarter & 0xFFFF) >> 1;
+	rms->delay_pos = 0;
+	if (!(quarter >> 16) || rms->delay_len > PQM_RMS_DELAY_MAX)
+		rms->delay_len = 0;
+}
+
+/**
+ * @brief Publish the powers of a complete window.
+ * @param rms - RMS engine.
+ */
+static void pqm_rms_publish(struct pqm_rms *rms)
+{
+	struct pqm_power *pw = &rms->power;
+	uint32_t ph;
+
+	__atomic_store_n(&rms->seq, rms->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	for (ph = 0; ph < PQM_RMS_PHASES; ph++) {
+		pw->p[ph] = rms->p_sum[ph] / (int64_t)rms->count;
+		pw->q[ph] = rms->q_sum[ph] / (int64_t)rms->count;
+		pw->s[ph] = (uint64_t)rms->value[ph] *
+			    rms->value[ph + PQM_RMS_PHASES];
+		rms->p_sum[ph] = 0;
+		rms->q_sum[ph] = 0;
+	}
+	__atomic_store_n(&rms->seq, rms->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Accumulate one full scan.
+ * @param rms - RMS engine.
+ * @param scan - PQM_RMS_CHANNELS raw samples.
+ * @return true when the scan completed a window and value holds new results.
+ */
+bool pqm_rms_update(struct pqm_rms *rms, const uint32_t *scan)
+{
+	int32_t *d0, *d1, *d2;
+	int32_t v, i, vq;
+	uint32_t ph, p1, p2;
+	int64_t s;
+
+	/*
+	 * All products are 32 x 32 -> 64 bit accumulations, single SMLAL
+	 * instructions on Cortex-M4.
+	 */
+	if (rms->delay_len) {
+		/* Oldest slot is overwritten, the next two are n - d - 1, n - d */
+		p1 = rms->delay_pos + 1;
+		if (p1 == rms->delay_len)
+			p1 = 0;
+		p2 = p1 + 1;
+		if (p2 == rms->delay_len)
+			p2 = 0;
+		d0 = rms->delay[rms->delay_pos];
+		d1 = rms->delay[p1];
+		d2 = rms->delay[p2];
+		for (ph = 0; ph < PQM_RMS_PHASES; ph++) {
+			v = pqm_sample_value(scan[ph]);
+			i = pqm_sample_value(scan[ph + PQM_RMS_PHASES]);
+			vq = d2[ph] + (((d1[ph] - d2[ph]) * (int64_t)rms->delay_frac) >> 15);
+			d0[ph] = v;
+			rms->sum[ph] += (uint64_t)((int64_t)v * v);
+			rms->sum[ph + PQM_RMS_PHASES] += (uint64_t)((int64_t)i * i);
+			rms->p_sum[ph] += (int64_t)v * i;
+			rms->q_sum[ph] += (int64_t)vq * i;
+		}
+		rms->delay_pos = p1;
+	} else {
+		for (ph = 0; ph < PQM_RMS_PHASES; ph++) {
+			v = pqm_sample_value(scan[ph]);
+			i = pqm_sample_value(scan[ph + PQM_RMS_PHASES]);
+			rms->sum[ph] += (uint64_t)((int64_t)v * v);
+			rms->sum[ph + PQM_RMS_PHASES] += (uint64_t)((int64_t)i * i);
+			rms->p_sum[ph] += (int64_t)v * i;
+		}
+	}
+	s = pqm_sample_value(scan[PQM_RMS_CHANNELS - 1]);
+	rms->sum[PQM_RMS_CHANNELS - 1] += (uint64_t)(s * s);
+
+	if (++rms->count < rms->window)
+		return false;
+
+	for (ph = 0; ph < PQM_RMS_CHANNELS; ph++) {
+		rms->value[ph] = pqm_isqrt64(rms->sum[ph] / rms->count);
+		rms->sum[ph] = 0;
+	}
+	pqm_rms_publish(rms);
+	rms->count = 0;
+
+	return true;
+}
+
+/**
+ * @brief Take a consistent copy of the powers of the last complete window.
+ * Consumer side only.
+ * @param rms - RMS engine.
+ * @param power - the powers, return param.
+ */
+void pqm_rms_power(struct pqm_rms *rms, struct pqm_power *power)
+{
+	uint32_t seq;
+
+	do {
+		seq = __atomic_load_n(&rms->seq, __ATOMIC_ACQUIRE);
+		*power = rms->power;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || seq != __atomic_load_n(&rms->seq,
+			__ATOMIC_RELAXED));
+}
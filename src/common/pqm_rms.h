@@ -0,0 +1,120 @@
+/**
+ * @file pqm_rms.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm RMS engine.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_RMS_H
+#define PQM_RMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Channels of a full scan: Va, Vb, Vc, Ia, Ib, Ic, In */
+#define PQM_RMS_CHANNELS 7
+/* Phases with both a voltage and a current channel */
+#define PQM_RMS_PHASES 3
+/* Longest quarter cycle voltage delay, in scans */
+#define PQM_RMS_DELAY_MAX 256
+
+/**
+ * @struct pqm_power
+ * @brief Powers of a window, per phase. Products of voltage and current
+ * codes, so in codes^2.
+ */
+struct pqm_power {
+	/** Active power, negative when exporting */
+	int64_t p[PQM_RMS_PHASES];
+	/** Reactive power, positive for an inductive load */
+	int64_t q[PQM_RMS_PHASES];
+	/** Apparent power, Urms * Irms */
+	uint64_t s[PQM_RMS_PHASES];
+};
+
+/**
+ * @struct pqm_rms
+ * @brief Running sum-of-squares accumulators over one aggregation window.
+ * Every scan costs one multiply-accumulate per channel, the square root is
+ * only taken when a window completes. The same pass accumulates the
+ * voltage-current products of each phase, for the active power, and the
+ * products with the voltage delayed by a quarter of the nominal cycle, for
+ * the reactive power, so every sample is loaded once. The 64 bit sums hold
+ * windows of up to 2^17 full scale 24 bit samples.
+ */
+struct pqm_rms {
+	/** Sum of squared samples of the current window, in codes^2 */
+	uint64_t sum[PQM_RMS_CHANNELS];
+	/** Scans accumulated in the current window */
+	uint32_t count;
+	/** Scans in a window, 10 cycles at 50 Hz or 12 cycles at 60 Hz */
+	uint32_t window;
+	/** RMS of the last complete window, in codes */
+	uint32_t value[PQM_RMS_CHANNELS];
+	/** Sums of u * i and of delayed u * i of the current window */
+	int64_t p_sum[PQM_RMS_PHASES];
+	int64_t q_sum[PQM_RMS_PHASES];
+	/** Voltage delay line, delay_len scans, zero when Q is not measured */
+	int32_t delay[PQM_RMS_DELAY_MAX][PQM_RMS_PHASES];
+	uint32_t delay_len;
+	uint32_t delay_pos;
+	/** Fraction of a scan added to the delay_len - 2 scans delay, Q15 */
+	int32_t delay_frac;
+	/** Powers of the last complete window */
+	struct pqm_power power;
+	/** Odd while the producer updates power, bumped twice per window */
+	volatile uint32_t seq;
+	/** Processor cycles spent on the last scan */
+	uint32_t last_cycles;
+};
+
+/**
+ * @brief Sign extend a 24 bit sample.
+ * @param sample - raw sample as delivered by the acquisition.
+ * @return the signed sample value.
+ */
+static inline int32_t pqm_sample_value(uint32_t sample)
+{
+	return (int32_t)(sample << 8) >> 8;
+}
+
+uint32_t pqm_isqrt64(uint64_t x);
+
+void pqm_rms_init(struct pqm_rms *rms, uint32_t window, uint32_t quarter);
+
+bool pqm_rms_update(struct pqm_rms *rms, const uint32_t *scan);
+
+void pqm_rms_power(struct pqm_rms *rms, struct pqm_power *power);
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * @file pqm_sdft.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm sliding DFT phasor estimator.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "pqm_sdft.h"
+#include "pqm_rms.h"
+
+/**
+ * @brief Restart the estimator for a new sampling or nominal frequency.
+ * @param sdft - phasor estimator.
+ * @param fs - sampling frequency in Hz.
+ * @param f_nom - nominal frequency in Hz.
+ */
+void pqm_sdft_init(struct pqm_sdft *sdft, uint32_t fs, uint32_t f_nom)
+{
+	uint32_t len = (fs + f_nom / 2) / f_nom;
+	uint32_t i;
+
+	memset(sdft->x, 0, sizeof(sdft->x));
+	memset(sdft->acc, 0, sizeof(sdft->acc));
+	sdft->pos = 0;
+	sdft->anchor = PQM_SDFT_ANCHOR_CYCLES;
+	sdft->seq = 0;
+	sdft->seen = 0;
+	/* Fewer than 4 scans per cycle give no meaningful phase */
+	sdft->len = len >= 4 && len <= PQM_SDFT_MAX_LEN ? len : 0;
+
+	for (i = 0; i < sdft->len; i++) {
+		sdft->cos[i] = lround(32767.0 * cos(2.0 * M_PI * i / len));
+		sdft->sin[i] = lround(32767.0 * sin(2.0 * M_PI * i / len));
+	}
+}
+
+/**
+ * @brief Rebuild the accumulators from the delay line. They already are
+ * exact, this only bounds the lifetime of a corrupted value.
+ * @param sdft - phasor estimator.
+ */
+static void pqm_sdft_anchor(struct pqm_sdft *sdft)
+{
+	uint32_t i, ch;
+
+	memset(sdft->acc, 0, sizeof(sdft->acc));
+	for (i = 0; i < sdft->len; i++) {
+		for (ch = 0; ch < PQM_SDFT_CHANNELS; ch++) {
+			sdft->acc[ch][0] += (int64_t)sdft->x[i][ch] * sdft->cos[i];
+			sdft->acc[ch][1] -= (int64_t)sdft->x[i][ch] * sdft->sin[i];
+		}
+	}
+}
+
+/**
+ * @brief Slide the window of every channel by one scan. Producer side only.
+ * @param sdft - phasor estimator.
+ * @param scan - PQM_SDFT_CHANNELS raw samples.
+ */
+void pqm_sdft_feed(struct pqm_sdft *sdft, const uint32_t *scan)
+{
+	int32_t *old = sdft->x[sdft->pos];
+	int32_t c = sdft->cos[sdft->pos];
+	int32_t s = sdft->sin[sdft->pos];
+	int32_t x, d;
+	uint32_t ch;
+
+	if (!sdft->len)
+		return;
+
+	__atomic_store_n(&sdft->seq, sdft->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	for (ch = 0; ch < PQM_SDFT_CHANNELS; ch++) {
+		x = pqm_sample_value(scan[ch]);
+		d = x - old[ch];
+		old[ch] = x;
+		sdft->acc[ch][0] += (int64_t)d * c;
+		sdft->acc[ch][1] -= (int64_t)d * s;
+	}
+
+	if (++sdft->pos == sdft->len) {
+		sdft->pos = 0;
+		if (!--sdft->anchor) {
+			pqm_sdft_anchor(sdft);
+			sdft->anchor = PQM_SDFT_ANCHOR_CYCLES;
+		}
+	}
+
+	__atomic_store_n(&sdft->seq, sdft->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Take a consistent copy of the fundamental phasors. Their magnitude
+ * is the amplitude times len * 2^14, their angle is relative to a reference
+ * common to all channels. Consumer side only.
+ * @param sdft - phasor estimator.
+ * @param ph - real and imaginary part of every channel, return param.
+ * @return the number of the copied update, changes with every scan.
+ */
+uint32_t pqm_sdft_phasors(struct pqm_sdft *sdft, int64_t (*ph)[2])
+{
+	uint32_t seq;
+
+	do {
+		seq = __atomic_load_n(&sdft->seq, __ATOMIC_ACQUIRE);
+		memcpy(ph, sdft->acc, sizeof(sdft->acc));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || seq != __atomic_load_n(&sdft->seq,
+			__ATOMIC_RELAXED));
+
+	return seq;
+}
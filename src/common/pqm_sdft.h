@@ -0,0 +1,88 @@
+/**
+ * @file pqm_sdft.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm sliding DFT phasor estimator.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_SDFT_H
+#define PQM_SDFT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Channels of a full scan: Va, Vb, Vc, Ia, Ib, Ic, In */
+#define PQM_SDFT_CHANNELS 7
+/* Longest fundamental cycle, in scans */
+#define PQM_SDFT_MAX_LEN 1024
+/* Cycles between two rebuilds of the accumulators from the delay line */
+#define PQM_SDFT_ANCHOR_CYCLES 65536
+
+/**
+ * @struct pqm_sdft
+ * @brief Modulated sliding DFT of the fundamental of every channel, over the
+ * last nominal cycle. Each scan adds its correlation with the reference and
+ * removes the one of the scan leaving the cycle, both computed with the same
+ * twiddle, so the integer accumulators are exact and cannot drift. Phasors
+ * are relative to a reference turning at the nominal frequency, which is
+ * common to all channels.
+ */
+struct pqm_sdft {
+	/** Last cycle of scans, delay line */
+	int32_t x[PQM_SDFT_MAX_LEN][PQM_SDFT_CHANNELS];
+	/** Reference cosine and sine over a cycle, Q15 */
+	int32_t cos[PQM_SDFT_MAX_LEN];
+	int32_t sin[PQM_SDFT_MAX_LEN];
+	/** Real and imaginary fundamental of each channel */
+	int64_t acc[PQM_SDFT_CHANNELS][2];
+	/** Scans in a cycle, zero when disabled, and next delay line slot */
+	uint32_t len;
+	uint32_t pos;
+	/** Cycles left before the next rebuild */
+	uint32_t anchor;
+	/** Odd while the producer updates acc, bumped twice per scan */
+	volatile uint32_t seq;
+	/** Update the angles were last computed from, owned by the consumer */
+	uint32_t seen;
+	/** Processor cycles spent on the last scan */
+	uint32_t last_cycles;
+};
+
+void pqm_sdft_init(struct pqm_sdft *sdft, uint32_t fs, uint32_t f_nom);
+
+void pqm_sdft_feed(struct pqm_sdft *sdft, const uint32_t *scan);
+
+uint32_t pqm_sdft_phasors(struct pqm_sdft *sdft, int64_t (*ph)[2]);
+
+#endif
@@ -0,0 +1,263 @@
+/**
+ * @file pqm_seq.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm symmetrical components engine.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "pqm_seq.h"
+#include "pqm_fft.h"
+#include "pqm_rms.h"
+#include "no_os_util.h"
+
+/**
+ * @brief Correlate one sample with the reference.
+ * @param acc - real and imaginary accumulator of the channel.
+ * @param sample - raw sample.
+ * @param c - cosine of the reference, Q15.
+ * @param s - sine of the reference, Q15.
+ */
+static inline void pqm_seq_acc(int64_t *acc, uint32_t sample, int32_t c,
+			       int32_t s)
+{
+	int32_t x = pqm_sample_value(sample);
+
+	acc[0] += (int64_t)x * c;
+	acc[1] -= (int64_t)x * s;
+}
+
+/* All three phases are measured */
+static void pqm_seq_feed_abc(int64_t (*acc)[2], const uint32_t *scan,
+			     int32_t c, int32_t s)
+{
+	pqm_seq_acc(acc[0], scan[0], c, s);
+	pqm_seq_acc(acc[1], scan[1], c, s);
+	pqm_seq_acc(acc[2], scan[2], c, s);
+}
+
+/* Phase B is derived, its channel is not even read */
+static void pqm_seq_feed_ac(int64_t (*acc)[2], const uint32_t *scan,
+			    int32_t c, int32_t s)
+{
+	pqm_seq_acc(acc[0], scan[0], c, s);
+	pqm_seq_acc(acc[2], scan[2], c, s);
+}
+
+static void pqm_seq_phases_wye(double (*ph)[2])
+{
+}
+
+/* VB = -VA - VC */
+static void pqm_seq_phases_wye_nb(double (*ph)[2])
+{
+	ph[1][0] = -ph[0][0] - ph[2][0];
+	ph[1][1] = -ph[0][1] - ph[2][1];
+}
+
+/* VB = VA - VC */
+static void pqm_seq_phases_delta(double (*ph)[2])
+{
+	ph[1][0] = ph[0][0] - ph[2][0];
+	ph[1][1] = ph[0][1] - ph[2][1];
+}
+
+/* VA = VA - VB, VB = VA - VC, VC = VC - VB */
+static void pqm_seq_phases_delta_2(double (*ph)[2])
+{
+	double a[2] = {ph[0][0], ph[0][1]};
+	double b[2] = {ph[1][0], ph[1][1]};
+	double c[2] = {ph[2][0], ph[2][1]};
+
+	ph[0][0] = a[0] - b[0];
+	ph[0][1] = a[1] - b[1];
+	ph[1][0] = a[0] - c[0];
+	ph[1][1] = a[1] - c[1];
+	ph[2][0] = c[0] - b[0];
+	ph[2][1] = c[1] - b[1];
+}
+
+/* VB = -VA */
+static void pqm_seq_phases_delta_nb(double (*ph)[2])
+{
+	ph[1][0] = -ph[0][0];
+	ph[1][1] = -ph[0][1];
+}
+
+static const struct pqm_seq_kernel pqm_seq_kernels[] = {
+	[_4W_WYE] = {pqm_seq_feed_abc, pqm_seq_phases_wye},
+	[_4W_WYE_NON_BLONDEL] = {pqm_seq_feed_ac, pqm_seq_phases_wye_nb},
+	[_3W_DELTA] = {pqm_seq_feed_ac, pqm_seq_phases_delta},
+	[_3W_DELTA_2] = {pqm_seq_feed_abc, pqm_seq_phases_delta_2},
+	[_4W_DELTA_NON_BLONDEL] = {pqm_seq_feed_ac, pqm_seq_phases_delta_nb},
+};
+
+/**
+ * @brief Drop the current window.
+ * @param seq - symmetrical components engine.
+ */
+static void pqm_seq_restart(struct pqm_seq *seq)
+{
+	memset(seq->acc, 0, sizeof(seq->acc));
+	seq->phase = 0;
+	seq->count = 0;
+	seq->cycles = 0;
+	seq->pending = false;
+}
+
+/**
+ * @brief Restart the engine with a new window length.
+ * @param seq - symmetrical components engine.
+ * @param window - scans in a window, at least 1.
+ * @param cycles - nominal fundamental cycles in a window.
+ */
+void pqm_seq_init(struct pqm_seq *seq, uint32_t window, uint32_t cycles)
+{
+	seq->window = window ? window : 1;
+	seq->dphase = ((uint64_t)cycles << 32) / seq->window;
+	if (!seq->vk)
+		pqm_seq_select(seq, _4W_WYE, false);
+	pqm_seq_restart(seq);
+}
+
+/**
+ * @brief Select the kernels of a wiring and restart the window. Done once
+ * on configuration, so the acquisition never checks the wiring.
+ * @param seq - symmetrical components engine.
+ * @param v_consel - voltage wiring, see enum v_consel_values.
+ * @param i_consel - IB is computed as -IA - IC.
+ */
+void pqm_seq_select(struct pqm_seq *seq, uint32_t v_consel, bool i_consel)
+{
+	if (v_consel >= NO_OS_ARRAY_SIZE(pqm_seq_kernels))
+		v_consel = _4W_WYE;
+
+	seq->vk = &pqm_seq_kernels[v_consel];
+	/* Currents share the kernels, IB = -IA - IC is the non-Blondel wye */
+	seq->ik = &pqm_seq_kernels[i_consel ? _4W_WYE_NON_BLONDEL : _4W_WYE];
+	pqm_seq_restart(seq);
+}
+
+/**
+ * @brief Accumulate one full scan. Producer side only.
+ * @param seq - symmetrical components engine.
+ * @param scan - raw samples, voltages then currents.
+ */
+void pqm_seq_feed(struct pqm_seq *seq, const uint32_t *scan)
+{
+	int32_t c, s;
+
+	pqm_fft_twiddle(seq->phase >> (32 - PQM_FFT_MAX_LOG2), &c, &s);
+	c >>= 16;
+	s >>= 16;
+	seq->vk->feed(seq->acc, scan, c, s);
+	seq->ik->feed(seq->acc + PQM_SEQ_PHASES, scan + PQM_SEQ_PHASES, c, s);
+	seq->phase += seq->dphase;
+
+	if (++seq->count < seq->window)
+		return;
+
+	if (__atomic_load_n(&seq->pending, __ATOMIC_ACQUIRE)) {
+		seq->overruns++;
+	} else {
+		memcpy(seq->done, seq->acc, sizeof(seq->done));
+		__atomic_store_n(&seq->pending, true, __ATOMIC_RELEASE);
+	}
+	memset(seq->acc, 0, sizeof(seq->acc));
+	seq->count = 0;
+	seq->phase = 0;
+}
+
+/**
+ * @brief Sequence components of a triplet.
+ * @param seq - symmetrical components engine.
+ * @param k - kernel of the triplet.
+ * @param acc - accumulated fundamentals of the triplet.
+ * @param i - 0 for voltages, 1 for currents.
+ */
+static void pqm_seq_triplet(struct pqm_seq *seq,
+			    const struct pqm_seq_kernel *k,
+			    int64_t (*acc)[2], uint32_t i)
+{
+	/* a = e^(j * 120deg) */
+	const double ar = -0.5, ai = 0.86602540378443865;
+	/* Accumulated correlation to RMS: sqrt(2) / (window * 2^15) */
+	double scale = M_SQRT2 / (seq->window * 32768.0);
+	double ph[3][2], s0[2], s1[2], s2[2];
+	double m0, m1, m2;
+	uint32_t p;
+
+	for (p = 0; p < 3; p++) {
+		ph[p][0] = acc[p][0] * scale;
+		ph[p][1] = acc[p][1] * scale;
+	}
+	k->phases(ph);
+
+	/* V0 = (A + B + C) / 3, V1 = (A + aB + a^2 C) / 3, V2 = (A + a^2 B + aC) / 3 */
+	s0[0] = ph[0][0] + ph[1][0] + ph[2][0];
+	s0[1] = ph[0][1] + ph[1][1] + ph[2][1];
+	s1[0] = ph[0][0] + ar * (ph[1][0] + ph[2][0]) - ai * (ph[1][1] - ph[2][1]);
+	s1[1] = ph[0][1] + ar * (ph[1][1] + ph[2][1]) + ai * (ph[1][0] - ph[2][0]);
+	s2[0] = ph[0][0] + ar * (ph[1][0] + ph[2][0]) + ai * (ph[1][1] - ph[2][1]);
+	s2[1] = ph[0][1] + ar * (ph[1][1] + ph[2][1]) - ai * (ph[1][0] - ph[2][0]);
+	m0 = sqrt(s0[0] * s0[0] + s0[1] * s0[1]) / 3;
+	m1 = sqrt(s1[0] * s1[0] + s1[1] * s1[1]) / 3;
+	m2 = sqrt(s2[0] * s2[0] + s2[1] * s2[1]) / 3;
+
+	seq->zro[i] = lrint(m0);
+	seq->pos[i] = lrint(m1);
+	seq->neg[i] = lrint(m2);
+	seq->unb_neg[i] = m1 > 0 ? lrint(m2 / m1 * 10000) : 0;
+	seq->unb_zro[i] = m1 > 0 ? lrint(m0 / m1 * 10000) : 0;
+}
+
+/**
+ * @brief Compute the sequence components of the pending window, if any.
+ * Consumer side only.
+ * @param seq - symmetrical components engine.
+ * @return true if the results were updated.
+ */
+bool pqm_seq_process(struct pqm_seq *seq)
+{
+	if (!__atomic_load_n(&seq->pending, __ATOMIC_ACQUIRE))
+		return false;
+
+	pqm_seq_triplet(seq, seq->vk, seq->done, 0);
+	pqm_seq_triplet(seq, seq->ik, seq->done + PQM_SEQ_PHASES, 1);
+
+	__atomic_store_n(&seq->pending, false, __ATOMIC_RELEASE);
+
+	return true;
+}
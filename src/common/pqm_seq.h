@@ -0,0 +1,115 @@
+/**
+ * @file pqm_seq.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm symmetrical components engine.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_SEQ_H
+#define PQM_SEQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Phase channels of a full scan: Va, Vb, Vc, Ia, Ib, Ic */
+#define PQM_SEQ_CHANNELS 6
+#define PQM_SEQ_PHASES 3
+
+/* Voltage wiring, each with its own kernel */
+enum v_consel_values {
+	_4W_WYE,
+	_4W_WYE_NON_BLONDEL,
+	_3W_DELTA,
+	_3W_DELTA_2,
+	_4W_DELTA_NON_BLONDEL
+};
+
+/**
+ * @struct pqm_seq_kernel
+ * @brief Wiring mode specific part of the engine.
+ */
+struct pqm_seq_kernel {
+	/** Accumulate the fundamental of the measured channels of a triplet */
+	void (*feed)(int64_t (*acc)[2], const uint32_t *scan, int32_t c,
+		     int32_t s);
+	/** Rebuild the three phase phasors from the measured ones */
+	void (*phases)(double (*ph)[2]);
+};
+
+/**
+ * @struct pqm_seq
+ * @brief Symmetrical components of voltages and currents. The acquisition
+ * correlates every phase with the nominal fundamental over a 10/12 cycle
+ * window through the kernels of the configured wiring, the main loop
+ * turns the phasors into sequence components.
+ */
+struct pqm_seq {
+	/** Kernels of the voltage and current triplets */
+	const struct pqm_seq_kernel *vk;
+	const struct pqm_seq_kernel *ik;
+	/** Real and imaginary fundamental of each channel, current window */
+	int64_t acc[PQM_SEQ_CHANNELS][2];
+	/** Same, for the last complete window */
+	int64_t done[PQM_SEQ_CHANNELS][2];
+	/** Scans accumulated and scans in a window */
+	uint32_t count;
+	uint32_t window;
+	/** Phase of the reference and its increment per scan, full scale turn */
+	uint32_t phase;
+	uint32_t dphase;
+	/** Set by the producer when done holds a complete window */
+	volatile bool pending;
+	/** Windows dropped because the previous one was still pending */
+	volatile uint32_t overruns;
+	/** Processor cycles spent on the current and on the last window */
+	uint32_t cycles;
+	uint32_t last_cycles;
+	/** Positive, negative and zero sequence RMS, in codes, V then I */
+	uint32_t pos[2];
+	uint32_t neg[2];
+	uint32_t zro[2];
+	/** Negative and zero sequence unbalance, in hundredths of a percent */
+	uint32_t unb_neg[2];
+	uint32_t unb_zro[2];
+};
+
+void pqm_seq_init(struct pqm_seq *seq, uint32_t window, uint32_t cycles);
+
+void pqm_seq_select(struct pqm_seq *seq, uint32_t v_consel, bool i_consel);
+
+void pqm_seq_feed(struct pqm_seq *seq, const uint32_t *scan);
+
+bool pqm_seq_process(struct pqm_seq *seq);
+
+#endif
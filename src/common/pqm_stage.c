@@ -0,0 +1,159 @@
+/**
+ * @file pqm_stage.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm analysis stage scheduler.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_stage.h"
+#include "no_os_util.h"
+
+/* Stages each stage needs to run */
+static const uint32_t pqm_stage_deps[PQM_STAGES] = {
+	/* Harmonics are resampled on the tracked fundamental period */
+	[PQM_STAGE_HARM] = NO_OS_BIT(PQM_STAGE_FREQ),
+	/* Samples are compared with the previous fundamental cycle */
+	[PQM_STAGE_TRANSIENT] = NO_OS_BIT(PQM_STAGE_FREQ),
+};
+
+/**
+ * @brief Set the initial subscriptions and lease. No stage runs until the
+ * first call to pqm_stage_schedule().
+ * @param st - stage scheduler.
+ * @param subscribed - stages running regardless of their lease.
+ * @param lease_ms - lease of a stage after one of its attributes was read.
+ */
+void pqm_stage_init(struct pqm_stages *st, uint32_t subscribed,
+		    uint32_t lease_ms)
+{
+	memset(st, 0, sizeof(*st));
+	st->subscribed = subscribed;
+	st->lease_ms = lease_ms;
+}
+
+/**
+ * @brief Convert the lease to scans after a change of the sampling frequency.
+ * @param st - stage scheduler.
+ * @param fs - sampling frequency in Hz.
+ */
+void pqm_stage_set_rate(struct pqm_stages *st, uint32_t fs)
+{
+	st->fs = fs ? fs : 1;
+	pqm_stage_set_lease(st, st->lease_ms);
+}
+
+/**
+ * @brief Change the lease. Leases already granted are kept.
+ * @param st - stage scheduler.
+ * @param lease_ms - lease of a stage after one of its attributes was read,
+ * limited to a day.
+ */
+void pqm_stage_set_lease(struct pqm_stages *st, uint32_t lease_ms)
+{
+	st->lease_ms = no_os_min(lease_ms, 86400000);
+	st->lease = (uint64_t)st->lease_ms * st->fs / 1000;
+}
+
+/**
+ * @brief Renew the lease of a stage, one of its attributes was read.
+ * Consumer side only.
+ * @param st - stage scheduler.
+ * @param stage - stage.
+ */
+void pqm_stage_touch(struct pqm_stages *st, enum pqm_stage_id stage)
+{
+	if (stage < PQM_STAGES)
+		st->expiry[stage] = __atomic_load_n(&st->now, __ATOMIC_RELAXED) +
+				    st->lease;
+}
+
+/**
+ * @brief Find the stages that have to run: subscribed or leased ones and
+ * everything they depend on. Consumer side only.
+ * @param st - stage scheduler.
+ * @return the mask of stages to run, the caller restarts the ones not yet
+ * active and publishes it in active.
+ */
+uint32_t pqm_stage_schedule(struct pqm_stages *st)
+{
+	uint32_t now = __atomic_load_n(&st->now, __ATOMIC_RELAXED);
+	uint32_t want = st->subscribed;
+	uint32_t prev;
+	uint32_t s;
+
+	for (s = 0; s < PQM_STAGES; s++) {
+		if ((int32_t)(st->expiry[s] - now) > 0)
+			want |= NO_OS_BIT(s);
+		else
+			/* Keep expired leases from wrapping into valid ones */
+			st->expiry[s] = now;
+	}
+
+	do {
+		prev = want;
+		for (s = 0; s < PQM_STAGES; s++)
+			if (want & NO_OS_BIT(s))
+				want |= pqm_stage_deps[s];
+	} while (want != prev);
+
+	return want;
+}
+
+/**
+ * @brief Refresh the processor share of every stage once a second.
+ * Consumer side only.
+ * @param st - stage scheduler.
+ * @param cycles - processor cycle counter.
+ */
+void pqm_stage_account(struct pqm_stages *st, uint32_t cycles)
+{
+	uint32_t now = __atomic_load_n(&st->now, __ATOMIC_RELAXED);
+	uint32_t elapsed = cycles - st->win_start;
+	uint32_t used;
+	uint32_t s;
+
+	if (now - st->win_scans < st->fs)
+		return;
+
+	for (s = 0; s < PQM_STAGES; s++) {
+		used = __atomic_load_n(&st->isr_cycles[s], __ATOMIC_RELAXED) +
+		       st->main_cycles[s];
+		st->share[s] = elapsed ?
+			       (uint64_t)(used - st->prev_cycles[s]) * 1000 / elapsed : 0;
+		st->prev_cycles[s] = used;
+	}
+	st->win_start = cycles;
+	st->win_scans = now;
+}
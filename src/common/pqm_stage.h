@@ -0,0 +1,105 @@
+/**
+ * @file pqm_stage.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm analysis stage scheduler.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_STAGE_H
+#define PQM_STAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Lease of a stage after one of its attributes was read */
+#define PQM_STAGE_LEASE_MS 10000
+
+enum pqm_stage_id {
+	PQM_STAGE_RMS,
+	PQM_STAGE_FREQ,
+	PQM_STAGE_SDFT,
+	PQM_STAGE_HARM,
+	PQM_STAGE_SEQ,
+	PQM_STAGE_FLICKER,
+	PQM_STAGE_EVENT,
+	PQM_STAGE_MSV,
+	PQM_STAGE_TRANSIENT,
+	PQM_STAGES
+};
+
+/**
+ * @struct pqm_stages
+ * @brief Demand driven scheduling of the analysis stages. A stage runs while
+ * it is subscribed, while its lease from the last read of one of its
+ * attributes lasts, or while a running stage depends on it. Stages that do
+ * not run cost nothing.
+ */
+struct pqm_stages {
+	/** Lease in ms and in scans */
+	uint32_t lease_ms;
+	uint32_t lease;
+	/** Scan at which the lease of each stage ends */
+	uint32_t expiry[PQM_STAGES];
+	/** Stages running regardless of their lease */
+	uint32_t subscribed;
+	/** Stages fed by the acquisition */
+	volatile uint32_t active;
+	/** Scans acquired, owned by the producer */
+	volatile uint32_t now;
+	/** Running cycle counters of each stage, on each side */
+	uint32_t isr_cycles[PQM_STAGES];
+	uint32_t main_cycles[PQM_STAGES];
+	/** Counters and time at the start of the share window */
+	uint32_t prev_cycles[PQM_STAGES];
+	uint32_t win_start;
+	uint32_t win_scans;
+	/** Share of the processor of each stage over the last second, in thousandths */
+	uint32_t share[PQM_STAGES];
+	uint32_t fs;
+};
+
+void pqm_stage_init(struct pqm_stages *st, uint32_t subscribed,
+		    uint32_t lease_ms);
+
+void pqm_stage_set_rate(struct pqm_stages *st, uint32_t fs);
+
+void pqm_stage_set_lease(struct pqm_stages *st, uint32_t lease_ms);
+
+void pqm_stage_touch(struct pqm_stages *st, enum pqm_stage_id stage);
+
+uint32_t pqm_stage_schedule(struct pqm_stages *st);
+
+void pqm_stage_account(struct pqm_stages *st, uint32_t cycles);
+
+#endif
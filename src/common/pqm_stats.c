@@ -0,0 +1,146 @@
+/**
+ * @file pqm_stats.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Source file for the pqm weekly statistics.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_stats.h"
+#include "pqm_rms.h"
+
+/* Percentiles, in percent */
+static const uint32_t pqm_stats_pct[PQM_STATS_QUANTILES] = {
+	[PQM_STATS_P95] = 95,
+	[PQM_STATS_P99] = 99,
+};
+
+/**
+ * @brief Start the statistics, without a complete week.
+ * @param st - statistics.
+ */
+void pqm_stats_init(struct pqm_stats *st)
+{
+	memset(st, 0, sizeof(*st));
+}
+
+/**
+ * @brief Add a value to the current 10 min interval of a series.
+ * @param st - statistics.
+ * @param series - series, see enum pqm_stats_series.
+ * @param value - value, in the unit of the series.
+ */
+void pqm_stats_sample(struct pqm_stats *st, uint32_t series, uint32_t value)
+{
+	st->sum[series] += (uint64_t)value * value;
+	st->samples[series]++;
+}
+
+/**
+ * @brief Add a 10 min value to the week of a series.
+ * @param st - statistics.
+ * @param series - series.
+ * @param x - value.
+ */
+static void pqm_stats_add(struct pqm_stats *st, uint32_t series, uint32_t x)
+{
+	uint32_t *top = st->top[series];
+	uint32_t i = st->count[series] < PQM_STATS_TOP ?
+		     st->count[series] : PQM_STATS_TOP - 1;
+
+	st->count[series]++;
+	if (st->count[series] > PQM_STATS_TOP && x <= top[i])
+		return;
+	/* Insert in decreasing order, the smallest one falls off */
+	for (; i && top[i - 1] < x; i--)
+		top[i] = top[i - 1];
+	top[i] = x;
+}
+
+/**
+ * @brief Close a 10 min interval: the RMS of the samples of every series
+ * goes to the week, unless the interval is flagged.
+ * @param st - statistics.
+ * @param flagged - a dip, swell or interruption overlapped the interval.
+ * @return true if the interval completed a week.
+ */
+bool pqm_stats_interval(struct pqm_stats *st, bool flagged)
+{
+	uint32_t s, k;
+
+	for (s = 0; s < PQM_STATS_SERIES; s++) {
+		if (!flagged && st->samples[s])
+			pqm_stats_add(st, s, pqm_isqrt64(st->sum[s] / st->samples[s]));
+		st->sum[s] = 0;
+		st->samples[s] = 0;
+	}
+	st->flagged += flagged;
+	if (++st->intervals < PQM_STATS_WEEK)
+		return false;
+
+	for (s = 0; s < PQM_STATS_SERIES; s++)
+		for (k = 0; k < PQM_STATS_QUANTILES; k++)
+			st->last[s][k] = pqm_stats_value(st, s, k);
+	memcpy(st->last_count, st->count, sizeof(st->count));
+	st->last_flagged = st->flagged;
+	st->weeks++;
+	st->intervals = 0;
+	st->flagged = 0;
+	memset(st->count, 0, sizeof(st->count));
+
+	return true;
+}
+
+/**
+ * @brief Percentile of the current week so far.
+ * @param st - statistics.
+ * @param series - series, see enum pqm_stats_series.
+ * @param quantile - percentile.
+ * @return the smallest value not exceeded by the percentile of the values,
+ * in the unit of the series, zero without any value.
+ */
+uint32_t pqm_stats_value(const struct pqm_stats *st, uint32_t series,
+			 enum pqm_stats_quantile quantile)
+{
+	uint32_t n = st->count[series];
+	uint32_t rank;
+
+	if (!n)
+		return 0;
+
+	/* Nearest rank, counted from the largest value */
+	rank = n - (n * pqm_stats_pct[quantile] + 99) / 100;
+
+	return st->top[series][rank];
+}
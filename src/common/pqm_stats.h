@@ -0,0 +1,109 @@
+/**
+ * @file pqm_stats.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm weekly statistics.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_STATS_H
+#define PQM_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* 10 min intervals in a week */
+#define PQM_STATS_WEEK 1008
+/* Largest values that hold the 95th percentile of a week, and above */
+#define PQM_STATS_TOP (PQM_STATS_WEEK - (PQM_STATS_WEEK * 95 + 99) / 100 + 1)
+
+/* Series of the statistics, first series of each metric */
+enum pqm_stats_series {
+	/* 10 min RMS of Va, Vb, Vc, Ia, Ib, Ic, In, in codes */
+	PQM_STATS_RMS = 0,
+	/* THD of the same channels, in hundredths of a percent */
+	PQM_STATS_THD = 7,
+	/* Negative sequence voltage unbalance, in hundredths of a percent */
+	PQM_STATS_U2 = 14,
+	/* Pst of Va, Vb, Vc, in thousandths */
+	PQM_STATS_PST = 15,
+	PQM_STATS_SERIES = 18
+};
+
+enum pqm_stats_quantile {
+	PQM_STATS_P95,
+	PQM_STATS_P99,
+	PQM_STATS_QUANTILES
+};
+
+/**
+ * @struct pqm_stats
+ * @brief Weekly 95th and 99th percentiles of the 10 min values, as used
+ * by EN 50160, in fixed memory. A week is at most PQM_STATS_WEEK values,
+ * so the percentiles always fall among its PQM_STATS_TOP largest values:
+ * only those are kept, sorted, and the percentiles are exact (nearest
+ * rank). Every series takes the RMS of the values sampled during a 10 min
+ * interval; flagged intervals are left out. The percentiles of the last
+ * complete week are kept for the report.
+ */
+struct pqm_stats {
+	/** Largest values of the current week, in decreasing order */
+	uint32_t top[PQM_STATS_SERIES][PQM_STATS_TOP];
+	/** Values of the current week */
+	uint32_t count[PQM_STATS_SERIES];
+	/** Sum of squared samples and samples of the current interval */
+	uint64_t sum[PQM_STATS_SERIES];
+	uint32_t samples[PQM_STATS_SERIES];
+	/** 10 min intervals elapsed and left out in the current week */
+	uint32_t intervals;
+	uint32_t flagged;
+	/**
+	 * Complete weeks, intervals left out, values and percentiles of the
+	 * last one
+	 */
+	uint32_t weeks;
+	uint32_t last_flagged;
+	uint32_t last_count[PQM_STATS_SERIES];
+	uint32_t last[PQM_STATS_SERIES][PQM_STATS_QUANTILES];
+};
+
+void pqm_stats_init(struct pqm_stats *st);
+
+void pqm_stats_sample(struct pqm_stats *st, uint32_t series, uint32_t value);
+
+bool pqm_stats_interval(struct pqm_stats *st, bool flagged);
+
+uint32_t pqm_stats_value(const struct pqm_stats *st, uint32_t series,
+			 enum pqm_stats_quantile quantile);
+
+#endif
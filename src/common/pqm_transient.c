@@ -0,0 +1,250 @@
+/**
+ * @file pqm_transient.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Transient detection on every scan.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_transient.h"
+#include "pqm_rms.h"
+#include "no_os_util.h"
+
+#define PQM_TRANSIENT_ALL (NO_OS_BIT(PQM_TRANSIENT_CHANNELS) - 1)
+
+/**
+ * @brief Compile the thresholds of a channel for the detector.
+ * @param tr - transient engine.
+ * @param ch - channel index.
+ */
+static void pqm_transient_compile(struct pqm_transient_engine *tr, uint32_t ch)
+{
+	tr->level_lim[ch] = tr->level[ch] ?
+			    no_os_min(tr->level[ch], INT32_MAX) : INT32_MAX;
+	tr->slope_lim[ch] = tr->slope[ch] ?
+			    no_os_min(tr->slope[ch], INT32_MAX) : INT32_MAX;
+}
+
+/**
+ * @brief Restart detection for a new sampling or nominal frequency. The
+ * thresholds, the pending transients and the time base are kept.
+ * @param tr - transient engine.
+ * @param fs - sampling frequency in Hz.
+ * @param f_nom - nominal frequency in Hz.
+ */
+void pqm_transient_init(struct pqm_transient_engine *tr, uint32_t fs,
+			uint32_t f_nom)
+{
+	uint32_t ch;
+
+	tr->fs = fs ? fs : 1;
+	tr->nominal = no_os_min(((uint64_t)tr->fs << 16) / (f_nom ? f_nom : 1),
+				(uint64_t)(PQM_TRANSIENT_DELAY - 2) << 16);
+	pqm_transient_track(tr, 0);
+	tr->fill = 0;
+	tr->hold = no_os_max(tr->fs / 1000, 1);
+	tr->pos = 0;
+	tr->active = false;
+	memset(tr->prev, 0, sizeof(tr->prev));
+	memset(tr->hits, 0, sizeof(tr->hits));
+	for (ch = 0; ch < PQM_TRANSIENT_CHANNELS; ch++)
+		pqm_transient_compile(tr, ch);
+}
+
+/**
+ * @brief Set the thresholds of a channel. Consumer side, takes effect from
+ * the next scan.
+ * @param tr - transient engine.
+ * @param ch - channel index.
+ * @param level - deviation from one cycle earlier, in codes, zero disables.
+ * @param slope - difference between consecutive samples, in codes, zero
+ * disables.
+ */
+void pqm_transient_set_thr(struct pqm_transient_engine *tr, uint32_t ch,
+			   uint32_t level, uint32_t slope)
+{
+	if (ch >= PQM_TRANSIENT_CHANNELS)
+		return;
+
+	tr->level[ch] = level;
+	tr->slope[ch] = slope;
+	pqm_transient_compile(tr, ch);
+}
+
+/**
+ * @brief Follow the fundamental period. Producer side only.
+ * @param tr - transient engine.
+ * @param period - tracked period, in scans Q16, zero if unknown. Periods that
+ * do not fit the delay line are replaced by the nominal one.
+ */
+void pqm_transient_track(struct pqm_transient_engine *tr, uint32_t period)
+{
+	if (period < (1 << 16) ||
+	    period > ((uint32_t)(PQM_TRANSIENT_DELAY - 2) << 16))
+		period = tr->nominal;
+
+	tr->len = period >> 16;
+	tr->frac = period & 0xFFFF;
+}
+
+/**
+ * @brief Hand the transient in progress to the client. Producer side only.
+ * @param tr - transient engine.
+ */
+static void pqm_transient_push(struct pqm_transient_engine *tr)
+{
+	uint32_t head = tr->head;
+	struct pqm_transient *t;
+
+	tr->active = false;
+	if (head - __atomic_load_n(&tr->tail, __ATOMIC_ACQUIRE) >=
+	    PQM_TRANSIENT_RING_SIZE) {
+		tr->overruns++;
+		return;
+	}
+
+	t = &tr->ring[head & (PQM_TRANSIENT_RING_SIZE - 1)];
+	*t = tr->cur;
+	t->start_us = tr->start * 1000000 / tr->fs;
+	t->duration_us = (tr->last + 1 - tr->start) * 1000000 / tr->fs;
+	__atomic_store_n(&tr->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Add the channels that crossed a threshold on the current scan to the
+ * transient in progress, starting one if needed.
+ * @param tr - transient engine.
+ * @param cyc - channels that deviated from one cycle earlier.
+ * @param fast - channels that changed faster than their slope threshold.
+ * @param dev - deviation from one cycle earlier of every channel, in codes.
+ * @param diff - difference from the previous sample of every channel, in codes.
+ */
+static void pqm_transient_hit(struct pqm_transient_engine *tr, uint32_t cyc,
+			      uint32_t fast, const int32_t *dev,
+			      const int32_t *diff)
+{
+	uint32_t ch, mask = cyc | fast;
+
+	if (!tr->active) {
+		tr->active = true;
+		tr->start = tr->now;
+		memset(&tr->cur, 0, sizeof(tr->cur));
+	}
+	tr->last = tr->now;
+	tr->cur.channels |= mask;
+	if (cyc)
+		tr->cur.kinds |= NO_OS_BIT(PQM_TRANSIENT_CYCLE);
+	if (fast)
+		tr->cur.kinds |= NO_OS_BIT(PQM_TRANSIENT_DVDT);
+	for (ch = 0; ch < PQM_TRANSIENT_CHANNELS; ch++) {
+		if (!(mask & NO_OS_BIT(ch)))
+			continue;
+		tr->cur.peak = no_os_max(tr->cur.peak, (uint32_t)dev[ch]);
+		tr->cur.slope = no_os_max(tr->cur.slope, (uint32_t)diff[ch]);
+	}
+}
+
+/**
+ * @brief Compare one full scan with the previous scan and with the same point
+ * one cycle earlier. Producer side only, a few cycles per channel when
+ * nothing happens.
+ * @param tr - transient engine.
+ * @param scan - PQM_TRANSIENT_CHANNELS raw samples.
+ */
+void pqm_transient_feed(struct pqm_transient_engine *tr, const uint32_t *scan)
+{
+	const uint32_t mask = PQM_TRANSIENT_DELAY - 1;
+	uint32_t i0 = (tr->pos - tr->len) & mask;
+	uint32_t i1 = (i0 - 1) & mask;
+	const int32_t *a = tr->line[i0];
+	const int32_t *b = tr->line[i1];
+	int32_t *cur = tr->line[tr->pos];
+	int32_t dev[PQM_TRANSIENT_CHANNELS];
+	int32_t diff[PQM_TRANSIENT_CHANNELS];
+	uint32_t cyc = 0, fast = 0;
+	uint32_t armed, ch;
+	int32_t x, ref;
+
+	for (ch = 0; ch < PQM_TRANSIENT_CHANNELS; ch++) {
+		x = pqm_sample_value(scan[ch]);
+		ref = a[ch] + (int32_t)(((int64_t)(b[ch] - a[ch]) * tr->frac) >> 16);
+		dev[ch] = x > ref ? x - ref : ref - x;
+		diff[ch] = x > tr->prev[ch] ? x - tr->prev[ch] : tr->prev[ch] - x;
+		cyc |= (uint32_t)(dev[ch] > tr->level_lim[ch]) << ch;
+		fast |= (uint32_t)(diff[ch] > tr->slope_lim[ch]) << ch;
+		tr->prev[ch] = x;
+		cur[ch] = x;
+	}
+
+	/*
+	 * One cycle plus the interpolation tap before the first comparison.
+	 * The tracked cycle may be longer than the nominal one the engine was
+	 * restarted with, the taps must not reach scans from before
+	 */
+	armed = tr->fill > tr->len + 1 ? PQM_TRANSIENT_ALL : 0;
+	tr->fill += tr->fill < PQM_TRANSIENT_DELAY;
+	fast &= armed;
+	/* The delay line replays a hit one cycle later, that is not a new one */
+	cyc &= armed & ~(tr->hits[i0] | tr->hits[i1]);
+	tr->hits[tr->pos] = cyc;
+	tr->pos = (tr->pos + 1) & mask;
+
+	if (cyc | fast)
+		pqm_transient_hit(tr, cyc, fast, dev, diff);
+	/* Long disturbances are split in one cycle transients */
+	if (tr->active && (tr->now - tr->last >= tr->hold ||
+			   tr->now + 1 - tr->start >= tr->len))
+		pqm_transient_push(tr);
+	tr->now++;
+}
+
+/**
+ * @brief Take the oldest detected transient. Consumer side only.
+ * @param tr - transient engine.
+ * @param transient - the transient, return param.
+ * @return true if a transient was available.
+ */
+bool pqm_transient_pop(struct pqm_transient_engine *tr,
+		       struct pqm_transient *transient)
+{
+	uint32_t tail = tr->tail;
+
+	if (__atomic_load_n(&tr->head, __ATOMIC_ACQUIRE) == tail)
+		return false;
+
+	*transient = tr->ring[tail & (PQM_TRANSIENT_RING_SIZE - 1)];
+	__atomic_store_n(&tr->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
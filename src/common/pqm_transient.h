@@ -0,0 +1,144 @@
+/**
+ * @file pqm_transient.h
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Header file for the pqm transient detector.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#ifndef PQM_TRANSIENT_H
+#define PQM_TRANSIENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Channels of a full scan: Va, Vb, Vc, Ia, Ib, Ic, In */
+#define PQM_TRANSIENT_CHANNELS 7
+/* Delay line, in scans, longer than a cycle. Must be a power of two */
+#define PQM_TRANSIENT_DELAY 1024
+/* Transients kept for the client, must be a power of two */
+#define PQM_TRANSIENT_RING_SIZE 32
+
+enum pqm_transient_kind {
+	/** Deviation from the same point one cycle earlier */
+	PQM_TRANSIENT_CYCLE,
+	/** Difference between two consecutive samples */
+	PQM_TRANSIENT_DVDT,
+	PQM_TRANSIENT_KINDS
+};
+
+/**
+ * @struct pqm_transient
+ * @brief Detected transient.
+ */
+struct pqm_transient {
+	/** Channels that crossed a threshold during the transient */
+	uint8_t channels;
+	/** Detectors that triggered, bits of enum pqm_transient_kind */
+	uint8_t kinds;
+	/** Start, in us since the acquisition started */
+	uint64_t start_us;
+	/** Duration, in us */
+	uint32_t duration_us;
+	/** Largest deviation from one cycle earlier, in codes */
+	uint32_t peak;
+	/** Largest difference between consecutive samples, in codes */
+	uint32_t slope;
+};
+
+/**
+ * @struct pqm_transient_engine
+ * @brief Transient detection on every scan of every channel. Each sample is
+ * compared with the same point one cycle earlier, interpolated from a delay
+ * line, and with the previous sample. The comparison is done on all channels
+ * without branches, hits are grouped into transients only when a threshold
+ * is crossed. A hit is not reported again one cycle later, when the delay
+ * line replays it.
+ */
+struct pqm_transient_engine {
+	/** Last scans, in codes */
+	int32_t line[PQM_TRANSIENT_DELAY][PQM_TRANSIENT_CHANNELS];
+	/** Channels that deviated from one cycle earlier, per scan of the line */
+	uint8_t hits[PQM_TRANSIENT_DELAY];
+	/** Position of the next scan in the line */
+	uint32_t pos;
+	/** Previous scan, in codes */
+	int32_t prev[PQM_TRANSIENT_CHANNELS];
+	/** Thresholds as configured, in codes, zero if disabled */
+	uint32_t level[PQM_TRANSIENT_CHANNELS];
+	uint32_t slope[PQM_TRANSIENT_CHANNELS];
+	/** Thresholds compared by the detector */
+	int32_t level_lim[PQM_TRANSIENT_CHANNELS];
+	int32_t slope_lim[PQM_TRANSIENT_CHANNELS];
+	/** Scans per second */
+	uint32_t fs;
+	/** Nominal cycle length, in scans Q16 */
+	uint32_t nominal;
+	/** Cycle length used by the detector, integer scans and Q16 fraction */
+	uint32_t len;
+	uint32_t frac;
+	/** Scans in the line since the restart, saturates at its length */
+	uint32_t fill;
+	/** Scans without a hit that end a transient */
+	uint32_t hold;
+	/** Scans since the acquisition started */
+	uint64_t now;
+	/** Transient in progress */
+	bool active;
+	uint64_t start;
+	uint64_t last;
+	struct pqm_transient cur;
+	/** Ring of detected transients, producer writes head, consumer tail */
+	struct pqm_transient ring[PQM_TRANSIENT_RING_SIZE];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	/** Transients lost because the ring was full */
+	volatile uint32_t overruns;
+	/** Processor cycles spent on the last scan */
+	uint32_t last_cycles;
+};
+
+void pqm_transient_init(struct pqm_transient_engine *tr, uint32_t fs,
+			uint32_t f_nom);
+
+void pqm_transient_set_thr(struct pqm_transient_engine *tr, uint32_t ch,
+			   uint32_t level, uint32_t slope);
+
+void pqm_transient_track(struct pqm_transient_engine *tr, uint32_t period);
+
+void pqm_transient_feed(struct pqm_transient_engine *tr, const uint32_t *scan);
+
+bool pqm_transient_pop(struct pqm_transient_engine *tr,
+		       struct pqm_transient *transient);
+
+#endif
@@ -46,12 +46,16 @@
 #include "maxim_i2c.h"
 #include "maxim_uart.h"
 #include "maxim_uart_stdio.h"
+#include "maxim_timer.h"
+#include "pqm_nv_flash.h"
 #include "common_data.h"
 
-#define MAX_SIZE_BASE_ADDR	(SAMPLES_PER_CHANNEL * TOTAL_PQM_CHANNELS * \
+#define MAX_SIZE_BASE_ADDR	(SAMPLES_PER_CHANNEL_PLATFORM * TOTAL_PQM_CHANNELS * \
 					sizeof(uint32_t))
 
 #define SAMPLES_PER_CHANNEL_PLATFORM 1024
+/* Event waveform capture history, in scans of all channels */
+#define CAPTURE_SCANS 8192
 
 #define INTC_DEVICE_ID	0
 #define UART_IRQ_ID    	UART0_IRQn
@@ -66,6 +70,20 @@
 #define SPI_OPS         &max_spi_ops
 #define SPI_EXTRA       &adin1110_spi_extra_ip
 
+#define ACQ_TIMER_ID		0
+#define ACQ_TIMER_FREQ_HZ	1000000
+#define ACQ_TIMER_IRQ_ID	TMR0_IRQn
+#define ACQ_TIMER_OPS		&max_timer_ops
+#define ACQ_TIMER_EXTRA		NULL
+#define IRQ_OPS			&max_irq_ops
+/* Core clock counted by the DWT cycle counter */
+#define PQM_CPU_CLK_HZ		120000000
+
+/* Energy checkpoints: last pages of the internal flash */
+#define PQM_NV_OPS		&max_pqm_nv_ops
+#define PQM_NV_PAGES		4
+#define PQM_NV_PAGE_SIZE	MXC_FLASH_PAGE_SIZE
+
 #define I2C_EXTRA	&vddioh_i2c_extra
 #define GPIO_EXTRA	&vddioh_gpio_extra
 
@@ -0,0 +1,122 @@
+/***************************************************************************//**
+ *   @file   pqm_nv_flash.c
+ *   @brief  Energy checkpoint storage in the Maxim internal flash.
+ *   @author Andrei-Dan Danila (andrei.danila@analog.com)
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#include "parameters.h"
+#include "no_os_error.h"
+
+/*
+ * The area takes the last PQM_NV_PAGES pages of the flash, which the
+ * application image never reaches. With a checkpoint every
+ * PQM_ENERGY_CHECKPOINT_S seconds and PQM_ENERGY_SLOT byte records, a page
+ * is erased once every PQM_NV_PAGES * PQM_NV_PAGE_SIZE / PQM_ENERGY_SLOT
+ * checkpoints, i.e. every 8.5 hours with four 8 KiB pages, so 10000 erase
+ * cycles last about ten years.
+ *
+ * The flash controller stalls code fetches from flash while it programs,
+ * so a record write delays the acquisition interrupt by tens of us. A page
+ * erase stalls it for milliseconds, tens of scan periods, and the timer
+ * ticks in between are merged into one: those scans are lost. The
+ * acquisition counts them and checkpoint_lost_scans reports them, and
+ * erases are kept that rare.
+ */
+#define PQM_NV_BASE	(MXC_FLASH_MEM_BASE + MXC_FLASH_MEM_SIZE - \
+			 PQM_NV_PAGES * PQM_NV_PAGE_SIZE)
+
+/**
+ * @brief Read from the checkpoint area.
+ * @param ctx - unused.
+ * @param offset - offset in the area.
+ * @param data - destination.
+ * @param len - bytes to be read.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int max_pqm_nv_read(void *ctx, uint32_t offset, void *data,
+			   uint32_t len)
+{
+	if (offset + len > PQM_NV_PAGES * PQM_NV_PAGE_SIZE)
+		return -EINVAL;
+
+	MXC_FLC_Read(PQM_NV_BASE + offset, data, len);
+
+	return 0;
+}
+
+/**
+ * @brief Program an erased part of the checkpoint area.
+ * @param ctx - unused.
+ * @param offset - offset in the area, 16 bytes aligned.
+ * @param data - data to be written, word aligned.
+ * @param len - bytes to be written, a multiple of 16.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int max_pqm_nv_write(void *ctx, uint32_t offset, const void *data,
+			    uint32_t len)
+{
+	if (offset + len > PQM_NV_PAGES * PQM_NV_PAGE_SIZE || (offset | len) % 16)
+		return -EINVAL;
+
+	if (MXC_FLC_Write(PQM_NV_BASE + offset, len, (uint32_t *)data))
+		return -EIO;
+
+	return 0;
+}
+
+/**
+ * @brief Erase a page of the checkpoint area.
+ * @param ctx - unused.
+ * @param offset - offset of the page in the area.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int max_pqm_nv_erase(void *ctx, uint32_t offset)
+{
+	if (offset >= PQM_NV_PAGES * PQM_NV_PAGE_SIZE ||
+	    offset % PQM_NV_PAGE_SIZE)
+		return -EINVAL;
+
+	if (MXC_FLC_PageErase(PQM_NV_BASE + offset))
+		return -EIO;
+
+	return 0;
+}
+
+const struct pqm_nv_ops max_pqm_nv_ops = {
+	.read = max_pqm_nv_read,
+	.write = max_pqm_nv_write,
+	.erase = max_pqm_nv_erase,
+};
@@ -50,7 +50,11 @@
 #define DATA_BUFFER_SIZE 1024
 #define CHNLS_NO 7
 
-uint32_t iio_data_buffer[MAX_SIZE_BASE_ADDR] = {0};
+/* Two halves: IIO storage in ring mode, capture pair in ping-pong mode */
+uint32_t iio_data_buffer[2][MAX_SIZE_BASE_ADDR / sizeof(uint32_t)] = {0};
+
+/* Event waveform history, full scans */
+uint32_t capture_buffer[CAPTURE_SCANS * TOTAL_PQM_CHANNELS];
 
 /**
  * @brief PQM main execution
@@ -70,7 +74,7 @@ int pqm_firmware()
 	struct iio_app_init_param app_init_param = {0};
 
 	struct iio_data_buffer buff = {
-		.buff = (void *)iio_data_buffer,
+		.buff = (void *)iio_data_buffer[0],
 		.size = MAX_SIZE_BASE_ADDR,
 	};
 
@@ -100,6 +104,14 @@ int pqm_firmware()
 	memcpy(app_init_param.lwip_param.hwaddr, adin1110_mac_address,
 		   NETIF_MAX_HWADDR_LEN);
 
+	pqm_ip.pp_buff[0] = iio_data_buffer[0];
+	pqm_ip.pp_buff[1] = iio_data_buffer[1];
+	pqm_ip.pp_buff_size = NO_OS_ARRAY_SIZE(iio_data_buffer[0]);
+	pqm_ip.iio_buff = buff.buff;
+	pqm_ip.iio_buff_size = buff.size;
+	pqm_ip.capture_buff = capture_buffer;
+	pqm_ip.capture_scans = CAPTURE_SCANS;
+
 	status = pqm_init(&pqm_desc, &pqm_ip);
 	if (status)
 		return status;
@@ -113,6 +125,8 @@ int pqm_firmware()
 	app_init_param.uart_init_params = iio_demo_uart_ip;
 	app_init_param.lwip_param.platform_ops = &adin1110_lwip_ops;
 	app_init_param.lwip_param.mac_param = &adin1110_ip;
+	app_init_param.post_step_callback = pqm_process;
+	app_init_param.arg = pqm_desc;
 
 	status = iio_app_init(&app, app_init_param);
 	if (status)
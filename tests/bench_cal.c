@@ -0,0 +1,80 @@
+/**
+ * @file bench_cal.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost of the calibration pass per scan.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include "pqm_test.h"
+#include "pqm_cal.h"
+
+/* 10 cycles of 50 Hz at 8 kS/s */
+#define WINDOW 1600
+#define RUNS 200
+
+static struct pqm_cal cal;
+static uint32_t scans[WINDOW][PQM_CAL_CHANNELS];
+static uint32_t out[WINDOW][PQM_CAL_CHANNELS];
+
+int main(void)
+{
+	uint64_t t0, t, best = UINT64_MAX;
+	uint32_t run, n, ch;
+
+	for (n = 0; n < WINDOW; n++)
+		for (ch = 0; ch < PQM_CAL_CHANNELS; ch++)
+			scans[n][ch] = pqm_test_code(0x600000 *
+						     sin(2 * M_PI * 10 * n / WINDOW -
+							 ch * 0.4));
+
+	/* Every channel with a gain, an offset and a fractional delay */
+	pqm_cal_init(&cal);
+	pqm_cal_compile(&cal, 8000, 50);
+	for (ch = 0; ch < PQM_CAL_CHANNELS; ch++)
+		PQM_CHECK(!pqm_cal_set(&cal, ch, 1010000 - 3000 * ch, 100 * ch,
+				       37 * ch - 100), "channel %u refused", ch);
+
+	for (run = 0; run < RUNS; run++) {
+		t0 = pqm_test_ns();
+		for (n = 0; n < WINDOW; n++)
+			pqm_cal_apply(&cal, scans[n], out[n]);
+		t = pqm_test_ns() - t0;
+		best = t < best ? t : best;
+	}
+	printf("calibration pass        %6.2f ns/scan, %5.2f ns/sample\n",
+	       (double)best / WINDOW,
+	       (double)best / (WINDOW * PQM_CAL_CHANNELS));
+
+	return pqm_test_result("bench_cal");
+}
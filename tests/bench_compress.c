@@ -0,0 +1,128 @@
+/**
+ * @file bench_compress.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Ratio and cost of the compressed stream on synthetic 3-phase data.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include "pqm_test.h"
+#include "pqm_compress.h"
+
+#define CHANNELS 7
+#define BLOCK PQM_COMPRESS_BLOCK_SCANS
+/* Ten seconds at 8 kS/s */
+#define SCANS 80000
+#define BLOCKS (SCANS / BLOCK)
+
+static uint32_t scans[SCANS * CHANNELS];
+static uint8_t stream[BLOCKS * 2048];
+static uint32_t out[BLOCK * CHANNELS];
+
+/**
+ * @brief Three voltages, three currents and the neutral current.
+ * @param harm - amplitude of the 3rd and 5th harmonics, fraction of the
+ * fundamental.
+ * @param noise - peak to peak noise, in codes.
+ */
+static void synth(double harm, uint32_t noise)
+{
+	double w, ph, amp;
+	uint32_t i, ch;
+
+	for (i = 0; i < SCANS; i++) {
+		/* 50 Hz with a slow drift, as the grid does */
+		w = 2 * M_PI * (50 + 0.05 * sin(2 * M_PI * i / SCANS)) * i / 8000.0;
+		for (ch = 0; ch < CHANNELS; ch++) {
+			ph = (ch % 3) * 2 * M_PI / 3 + (ch >= 3 ? 0.5 : 0);
+			amp = ch < 3 ? 0x600000 : ch < 6 ? 0x200000 : 0x20000;
+			scans[i * CHANNELS + ch] =
+				pqm_test_code(amp * (sin(w - ph) +
+						     harm * sin(3 * (w - ph)) +
+						     harm * sin(5 * (w - ph))) +
+					      (noise ? rand() % noise - noise / 2.0 : 0));
+		}
+	}
+}
+
+int main(void)
+{
+	static const struct {
+		const char *name;
+		double harm;
+		uint32_t noise;
+	} sets[] = {
+		{"clean", 0, 0},
+		{"thd 5%, 4 LSB noise", 0.035, 4},
+		{"thd 5%, 64 LSB noise", 0.035, 64},
+		{"thd 20%, 1024 LSB noise", 0.14, 1024},
+	};
+	uint64_t t0, enc, dec;
+	uint32_t s, b, size, used, n;
+	uint8_t mask;
+	int32_t ret;
+
+	srand(1);
+	printf("signal                      ratio  bits/sample  ns/sample enc  ns/sample dec\n");
+	for (s = 0; s < sizeof(sets) / sizeof(sets[0]); s++) {
+		synth(sets[s].harm, sets[s].noise);
+
+		t0 = pqm_test_ns();
+		for (b = 0, size = 0; b < BLOCKS; b++)
+			size += pqm_compress_block(scans + b * BLOCK * CHANNELS,
+						   BLOCK, 0x7F, stream + size);
+		enc = pqm_test_ns() - t0;
+
+		t0 = pqm_test_ns();
+		for (b = 0, used = 0; b < BLOCKS; b++, used += ret) {
+			ret = pqm_decompress_block(stream + used, size - used, out,
+						   BLOCK, &n, &mask);
+			if (ret <= 0)
+				break;
+		}
+		dec = pqm_test_ns() - t0;
+		PQM_CHECK(b == BLOCKS && used == size, "%s: decoded %u of %u bytes",
+			  sets[s].name, used, size);
+
+		printf("%-26s  %5.3f  %11.2f  %13.1f  %13.1f\n", sets[s].name,
+		       (double)size / (SCANS * CHANNELS * 4),
+		       size * 8.0 / (SCANS * CHANNELS),
+		       (double)enc / (SCANS * CHANNELS),
+		       (double)dec / (SCANS * CHANNELS));
+	}
+	printf("worst case block, %u scans of %u channels: %u bytes\n", BLOCK,
+	       CHANNELS, pqm_compress_max_size(CHANNELS, BLOCK));
+
+	return pqm_test_result("bench_compress");
+}
@@ -0,0 +1,78 @@
+/**
+ * @file bench_flicker.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost per sample of the flicker meter, three phases.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include "pqm_test.h"
+#include "pqm_flicker.h"
+
+#define FS 8000
+/* Ten seconds of acquisition */
+#define SCANS (10 * FS)
+#define RUNS 20
+
+static struct pqm_flicker flk;
+static uint32_t scans[SCANS][PQM_FLICKER_CHANNELS];
+
+int main(void)
+{
+	uint64_t t0, t, best = UINT64_MAX;
+	uint32_t run, n, ch, filtered = 0;
+
+	for (n = 0; n < SCANS; n++)
+		for (ch = 0; ch < PQM_FLICKER_CHANNELS; ch++)
+			scans[n][ch] = pqm_test_code(0x600000 *
+						     (1 + 0.005 * sin(2 * M_PI * 8.8 * n / FS)) *
+						     sin(2 * M_PI * 50 * n / FS - ch * 2 * M_PI / 3));
+
+	pqm_flicker_init(&flk, FS, false, false);
+	for (run = 0; run < RUNS; run++) {
+		filtered = 0;
+		t0 = pqm_test_ns();
+		for (n = 0; n < SCANS; n++)
+			filtered += pqm_flicker_feed(&flk, scans[n]);
+		t = pqm_test_ns() - t0;
+		best = t < best ? t : best;
+	}
+
+	printf("%u scans, %u filtered samples, 3 phases\n", SCANS, filtered);
+	printf("%.1f ns per scan, %.1f ns per filtered sample, %.3f%% of real time\n",
+	       (double)best / SCANS, (double)best / filtered,
+	       best / (SCANS * 1e9 / FS) * 100);
+	PQM_CHECK(filtered == SCANS / flk.decim, "%u filtered samples", filtered);
+
+	return pqm_test_result("bench_flicker");
+}
@@ -0,0 +1,119 @@
+/**
+ * @file bench_float.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Throughput of the float32 engineering unit conversion.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_pack.h"
+
+#define CHANNELS 7
+/* A refill of the scans per trigger maximum */
+#define SCANS 1024
+#define RUNS 500
+
+static uint32_t src[SCANS * CHANNELS];
+static uint32_t dst[SCANS * CHANNELS];
+static float ref[SCANS * CHANNELS];
+
+/**
+ * @brief What a client does with the raw stream: sign extend every code and
+ * scale it by the full scale value of its channel.
+ * @param fs - full scale volts or amps of each channel.
+ */
+static void client_convert(const double *fs)
+{
+	uint32_t i, j;
+	int32_t x;
+
+	for (i = 0; i < SCANS * CHANNELS; i += CHANNELS) {
+		for (j = 0; j < CHANNELS; j++) {
+			x = src[i + j] & 0xFFFFFF;
+			if (x & 0x800000)
+				x -= 0x1000000;
+			ref[i + j] = x * fs[j] / 0x7FFFFF;
+		}
+	}
+}
+
+int main(void)
+{
+	static const double fs[CHANNELS] = {
+		400.0, 400.0, 400.0, 20.0, 20.0, 20.0, 20.0
+	};
+	uint64_t t0, t, dev = UINT64_MAX, client = UINT64_MAX;
+	float scale[CHANNELS], f;
+	double err, worst = 0;
+	uint32_t run, i, j;
+
+	/* The device carries the 1/256 of the shifted code in the scale */
+	for (j = 0; j < CHANNELS; j++)
+		scale[j] = fs[j] / 0x7FFFFF / 256;
+	for (i = 0; i < SCANS; i++)
+		for (j = 0; j < CHANNELS; j++)
+			src[i * CHANNELS + j] =
+				pqm_test_code(0x7FFFFF * 0.9 *
+					      sin(2 * M_PI * 5 * i / SCANS +
+						  j * 0.9));
+
+	for (run = 0; run < RUNS; run++) {
+		t0 = pqm_test_ns();
+		pqm_pack_float(scale, CHANNELS, src, dst, SCANS * CHANNELS);
+		t = pqm_test_ns() - t0;
+		dev = t < dev ? t : dev;
+
+		t0 = pqm_test_ns();
+		client_convert(fs);
+		t = pqm_test_ns() - t0;
+		client = t < client ? t : client;
+	}
+
+	for (i = 0; i < SCANS * CHANNELS; i++) {
+		memcpy(&f, &dst[i], sizeof(f));
+		err = fabs(f - ref[i]) / fs[i % CHANNELS];
+		worst = err > worst ? err : worst;
+	}
+	printf("pqm_pack_float          %7.1f Msamples/s  %5.2f ns/sample\n",
+	       SCANS * CHANNELS * 1e3 / dev, (double)dev / (SCANS * CHANNELS));
+	printf("client side conversion  %7.1f Msamples/s  %5.2f ns/sample\n",
+	       SCANS * CHANNELS * 1e3 / client,
+	       (double)client / (SCANS * CHANNELS));
+	printf("largest difference      %.1e of full scale\n", worst);
+	/* float32 keeps 24 significant bits, as many as the codes */
+	PQM_CHECK(worst < 1.0 / 0x7FFFFF, "off by %.1e of full scale", worst);
+
+	return pqm_test_result("bench_float");
+}
@@ -0,0 +1,125 @@
+/**
+ * @file bench_freq.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost and error of the frequency tracker under drift and steps.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include "pqm_test.h"
+#include "pqm_freq.h"
+
+#define FS 8000
+#define F_NOM 50
+/* Long enough for five 10 s measurements */
+#define SECONDS 60
+/* IEC 61000-4-30 class A uncertainty of the 10 s frequency */
+#define CLASS_A_MHZ 10
+
+static struct pqm_freq freq;
+
+/**
+ * @brief Run the tracker over a frequency profile.
+ * @param name - profile name.
+ * @param f0 - frequency at the start, Hz.
+ * @param f1 - frequency at the end, Hz.
+ * @param step - the change is a step at half time instead of a ramp.
+ */
+static void run(const char *name, double f0, double f1, bool step)
+{
+	uint32_t scan[1] = {0};
+	uint64_t t0, spent = 0;
+	double ph = 0, f, err, worst = 0, cycles = 0, mean = 0;
+	uint32_t n, nb = 0, settle = 0, step_at = SECONDS * FS / 2;
+	double want_period = (double)FS / f1 * 65536;
+
+	pqm_freq_init(&freq, FS, F_NOM);
+	for (n = 0; n < SECONDS * FS; n++) {
+		if (step)
+			f = n < step_at ? f0 : f1;
+		else
+			f = f0 + (f1 - f0) * n / (SECONDS * FS);
+		/* 5% 3rd harmonic and 0.1% noise */
+		scan[0] = pqm_test_code(5e6 * (sin(ph) + 0.05 * sin(3 * ph)) +
+					rand() % 10001 - 5000);
+		ph += 2 * M_PI * f / FS;
+		cycles += f / FS;
+
+		t0 = pqm_test_ns();
+		if (pqm_freq_feed(&freq, scan)) {
+			/* Against the mean frequency of the interval that ended */
+			err = fabs(freq.value - mean * 1000);
+			/* The interval holding the step has no single answer */
+			if (!step || n / FS / PQM_FREQ_INTERVAL_S !=
+			    step_at / FS / PQM_FREQ_INTERVAL_S + 1)
+				worst = err > worst ? err : worst;
+			nb++;
+		}
+		spent += pqm_test_ns() - t0;
+		if (n % (FS * PQM_FREQ_INTERVAL_S) == FS * PQM_FREQ_INTERVAL_S - 1) {
+			mean = cycles / PQM_FREQ_INTERVAL_S;
+			cycles = 0;
+		}
+
+		/* Scans until the tracked period is within 0.1% of the new one */
+		if (step && n >= step_at && !settle &&
+		    fabs(freq.period - want_period) < want_period * 1e-3)
+			settle = n - step_at;
+	}
+
+	printf("%-24s %6.1f ns/scan  10 s error %5.2f mHz", name,
+	       (double)spent / (SECONDS * FS), worst);
+	if (step)
+		printf("  period settled in %.1f cycles", settle * f1 / FS);
+	printf("\n");
+	PQM_CHECK(nb >= SECONDS / PQM_FREQ_INTERVAL_S - 1, "%s: %u values",
+		  name, nb);
+	PQM_CHECK(worst <= CLASS_A_MHZ, "%s: off by %.2f mHz", name, worst);
+	PQM_CHECK(!step || (settle && settle * f1 / FS < 20),
+		  "%s: period did not settle", name);
+}
+
+int main(void)
+{
+	srand(1);
+	run("47.5 Hz", 47.5, 47.5, false);
+	run("50 Hz", 50, 50, false);
+	run("52.5 Hz", 52.5, 52.5, false);
+	run("drift 47.5 to 52.5 Hz", 47.5, 52.5, false);
+	run("drift 52.5 to 47.5 Hz", 52.5, 47.5, false);
+	run("step 50 to 52.5 Hz", 50, 52.5, true);
+	run("step 50 to 47.5 Hz", 50, 47.5, true);
+
+	return pqm_test_result("bench_freq");
+}
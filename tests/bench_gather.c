@@ -0,0 +1,152 @@
+/**
+ * @file bench_gather.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Scan interleaver throughput for every channel mask.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_ring.h"
+
+#define CHANNELS 7
+#define SCANS 1024
+#define ROUNDS 200
+/* Best of several runs, the host is not idle */
+#define RUNS 5
+
+static uint32_t ring_buff[SCANS * CHANNELS];
+static uint32_t dst[2][SCANS * CHANNELS];
+
+/**
+ * @brief Channel walk of the original read_samples(): next enabled channel
+ * after last_idx.
+ */
+static bool legacy_next_ch_idx(uint32_t ch_mask, uint32_t last_idx,
+			       uint32_t *new_idx)
+{
+	last_idx++;
+	ch_mask >>= last_idx;
+	if (!ch_mask) {
+		*new_idx = -1;
+		return 0;
+	}
+	while (!(ch_mask & 1)) {
+		last_idx++;
+		ch_mask >>= 1;
+	}
+	*new_idx = last_idx;
+
+	return 1;
+}
+
+/* Stand-in for iio_buffer_push_scan(), one call per scan */
+static __attribute__((noinline)) void legacy_push_scan(uint32_t **dst,
+		const uint32_t *scan, uint32_t cnt)
+{
+	memcpy(*dst, scan, cnt * sizeof(*scan));
+	*dst += cnt;
+}
+
+/**
+ * @brief Original read_samples(): walk the mask for every scan and push the
+ * scans one by one.
+ */
+static void legacy_read(uint32_t mask, const uint32_t *src, uint32_t *out)
+{
+	uint32_t buff[CHANNELS];
+	uint32_t ch, k, i;
+
+	for (i = 0; i < SCANS; i++) {
+		k = 0;
+		ch = -1;
+		while (legacy_next_ch_idx(mask, ch, &ch))
+			buff[k++] = src[i * CHANNELS + ch];
+		legacy_push_scan(&out, buff, k);
+	}
+}
+
+int main(void)
+{
+	struct pqm_ring ring;
+	uint8_t idx[CHANNELS];
+	uint64_t t0, t_old, t_new;
+	double worst = 1e9, gain;
+	uint32_t mask, cnt, ch, i, r, run;
+
+	for (i = 0; i < SCANS * CHANNELS; i++)
+		ring_buff[i] = i * 2654435761u & 0xFFFFFF;
+
+	printf("mask  before(Mscan/s)  after(Mscan/s)  speedup\n");
+	for (mask = 0x01; mask <= 0x7F; mask++) {
+		/* Channel table, as update_pqm_channels() builds it */
+		cnt = 0;
+		for (ch = 0; ch < CHANNELS; ch++)
+			if (mask & (1u << ch))
+				idx[cnt++] = ch;
+
+		t_old = UINT64_MAX;
+		t_new = UINT64_MAX;
+		pqm_ring_init(&ring, ring_buff, SCANS, CHANNELS);
+		for (run = 0; run < RUNS; run++) {
+			t0 = pqm_test_ns();
+			for (r = 0; r < ROUNDS; r++) {
+				legacy_read(mask, ring_buff, dst[0]);
+				__asm__ volatile("" : : "r"(dst[0]) : "memory");
+			}
+			t_old = fmin(t_old, pqm_test_ns() - t0);
+
+			t0 = pqm_test_ns();
+			for (r = 0; r < ROUNDS; r++) {
+				/* A full ring, drained by one refill */
+				ring.tail = 0;
+				ring.head = SCANS;
+				pqm_ring_pop(&ring, idx, cnt, dst[1], SCANS);
+				__asm__ volatile("" : : "r"(dst[1]) : "memory");
+			}
+			t_new = fmin(t_new, pqm_test_ns() - t0);
+		}
+
+		PQM_CHECK(!memcmp(dst[0], dst[1], SCANS * cnt * sizeof(uint32_t)),
+			  "mask 0x%02x: interleaved scans differ", mask);
+		gain = (double)t_old / t_new;
+		worst = fmin(worst, gain);
+		printf("0x%02x  %15.1f  %14.1f  %6.1fx\n", mask,
+		       SCANS * ROUNDS * 1e3 / t_old, SCANS * ROUNDS * 1e3 / t_new,
+		       gain);
+	}
+	printf("smallest speedup %.1fx\n", worst);
+
+	return pqm_test_result("bench_gather");
+}
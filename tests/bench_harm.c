@@ -0,0 +1,88 @@
+/**
+ * @file bench_harm.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost of the FFT and of the analysis of a full 7 channel window.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include "pqm_test.h"
+#include "pqm_harm.h"
+
+#define RUNS 200
+
+static struct pqm_harm harm;
+static struct pqm_cpx x[PQM_FFT_MAX_SIZE];
+
+int main(void)
+{
+	uint32_t scan[PQM_HARM_CHANNELS];
+	uint64_t t0, t, fft = UINT64_MAX, win = UINT64_MAX;
+	uint32_t run, ch, n, i;
+
+	pqm_fft_init();
+	for (run = 0; run < RUNS; run++) {
+		for (i = 0; i < PQM_FFT_MAX_SIZE; i++)
+			x[i] = (struct pqm_cpx) {
+				(int32_t)(i * 2654435761u) >> 2,
+				(int32_t)(i * 40503u << 16) >> 2
+			};
+		t0 = pqm_test_ns();
+		pqm_fft(x, PQM_FFT_MAX_LOG2);
+		t = pqm_test_ns() - t0;
+		fft = t < fft ? t : fft;
+	}
+
+	/* 10 cycles of 50 Hz at 8 kS/s, resampled to 2048 points */
+	pqm_harm_init(&harm, 1600, 10);
+	for (run = 0, n = 0; run < RUNS; n++) {
+		for (ch = 0; ch < PQM_HARM_CHANNELS; ch++)
+			scan[ch] = pqm_test_code(6e6 * sin(2 * M_PI * 50 * n / 8000.0 +
+							   ch));
+		pqm_harm_feed(&harm, scan);
+		if (!harm.pending)
+			continue;
+		t0 = pqm_test_ns();
+		pqm_harm_process(&harm);
+		t = pqm_test_ns() - t0;
+		win = t < win ? t : win;
+		run++;
+	}
+
+	printf("fft %u points: %.1f us\n", PQM_FFT_MAX_SIZE, fft / 1e3);
+	printf("7 channel window: %.1f us, %.3f%% of the 200 ms window\n",
+	       win / 1e3, win / 2e6);
+	PQM_CHECK(!harm.overruns, "%u windows overrun", harm.overruns);
+
+	return pqm_test_result("bench_harm");
+}
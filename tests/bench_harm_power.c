@@ -0,0 +1,150 @@
+/**
+ * @file bench_harm_power.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost of the harmonic active power and direction per window.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_test.h"
+#include "no_os_util.h"
+#include "pqm_harm.h"
+
+#define FS 8000
+#define F_NOM 50
+/* 10 cycles of 50 Hz at 8 kS/s */
+#define WINDOW 1600
+#define RUNS 200
+/* Power computations per timing, one is too short for the clock */
+#define REPEAT 1000
+/* Voltage and current amplitudes, in codes */
+#define U 6e6
+#define I 3e6
+
+/* Harmonic of the current, relative to the fundamental */
+struct order {
+	uint32_t h;
+	/* Voltage and current amplitudes */
+	double u;
+	double i;
+	/* Current phase relative to the voltage */
+	double phi;
+	int8_t direction;
+};
+
+static const struct order orders[] = {
+	/* Inductive load */
+	{1, 1, 1, -0.3, 1},
+	/* Drawn by the load */
+	{3, 0.03, 0.10, 0.2, 1},
+	/* Injected by the load */
+	{5, 0.05, 0.20, M_PI, -1},
+	/* In quadrature, no active power */
+	{7, 0.04, 0.10, M_PI / 2, 0},
+};
+
+static struct pqm_harm harm;
+
+int main(void)
+{
+	uint32_t scan[PQM_HARM_CHANNELS];
+	uint64_t t0, t, win = UINT64_MAX, power = UINT64_MAX;
+	int64_t ref[PQM_HARM_PHASES][PQM_MAX_HARMONIC];
+	uint32_t run, ph, n, k, r;
+	const struct order *o;
+	double w, u, i, want;
+
+	pqm_fft_init();
+	pqm_harm_init(&harm, WINDOW, WINDOW * F_NOM / FS);
+	for (run = 0, n = 0; run < RUNS; n++) {
+		for (ph = 0; ph < PQM_HARM_PHASES; ph++) {
+			w = 2 * M_PI * F_NOM * n / FS - ph * 2 * M_PI / 3;
+			u = 0;
+			i = 0;
+			for (k = 0; k < NO_OS_ARRAY_SIZE(orders); k++) {
+				o = &orders[k];
+				u += o->u * sin(o->h * w);
+				i += o->i * sin(o->h * w + o->phi);
+			}
+			scan[ph] = pqm_test_code(U * u);
+			scan[ph + PQM_HARM_PHASES] = pqm_test_code(I * i);
+		}
+		scan[PQM_HARM_CHANNELS - 1] = 0;
+		pqm_harm_feed(&harm, scan);
+		if (!harm.pending)
+			continue;
+		t0 = pqm_test_ns();
+		pqm_harm_process(&harm);
+		t = pqm_test_ns() - t0;
+		win = t < win ? t : win;
+		run++;
+	}
+
+	memcpy(ref, harm.power, sizeof(ref));
+	for (run = 0; run < RUNS; run++) {
+		t0 = pqm_test_ns();
+		for (r = 0; r < REPEAT; r++)
+			pqm_harm_power(&harm);
+		t = pqm_test_ns() - t0;
+		power = t < power ? t : power;
+	}
+
+	printf("window analysis         %8.1f us\n", win / 1e3);
+	printf("%u phases x %u orders   %8.1f ns, %.3f%% of the analysis\n",
+	       PQM_HARM_PHASES, PQM_MAX_HARMONIC, (double)power / REPEAT,
+	       100.0 * power / REPEAT / win);
+	PQM_CHECK(!memcmp(ref, harm.power, sizeof(ref)),
+		  "the power changes when computed again");
+	PQM_CHECK(!harm.overruns, "%u windows overrun", harm.overruns);
+
+	for (ph = 0; ph < PQM_HARM_PHASES; ph++) {
+		for (k = 0; k < NO_OS_ARRAY_SIZE(orders); k++) {
+			o = &orders[k];
+			want = U * o->u * I * o->i / 2 * cos(o->phi);
+			PQM_CHECK(fabs(harm.power[ph][o->h - 1] - want) <
+				  0.01 * U * o->u * I * o->i / 2,
+				  "phase %u order %u: %lld codes^2, not %.0f", ph,
+				  o->h, (long long)harm.power[ph][o->h - 1], want);
+			PQM_CHECK(harm.direction[ph][o->h - 1] == o->direction,
+				  "phase %u order %u: direction %d, not %d", ph,
+				  o->h, harm.direction[ph][o->h - 1],
+				  o->direction);
+		}
+		/* Orders absent from both sides */
+		PQM_CHECK(!harm.direction[ph][1] && !harm.direction[ph][10],
+			  "phase %u: direction of absent orders", ph);
+	}
+
+	return pqm_test_result("bench_harm_power");
+}
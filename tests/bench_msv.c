@@ -0,0 +1,79 @@
+/**
+ * @file bench_msv.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost of the mains signalling detection, per scan and per window.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include "pqm_test.h"
+#include "pqm_msv.h"
+
+#define FS 8000
+#define WINDOW 1600
+#define RUNS 200
+
+static struct pqm_msv msv;
+static uint32_t scans[WINDOW][PQM_MSV_CHANNELS];
+
+int main(void)
+{
+	uint64_t t0, t, feed = UINT64_MAX, proc = UINT64_MAX;
+	uint32_t run, n, ch;
+
+	for (n = 0; n < WINDOW; n++)
+		for (ch = 0; ch < PQM_MSV_CHANNELS; ch++)
+			scans[n][ch] = pqm_test_code(5e6 * sin(2 * M_PI * 50 * n / FS - ch) +
+						     1e5 * sin(2 * M_PI * 175 * n / FS));
+
+	pqm_msv_init(&msv, FS, WINDOW, 175);
+	pqm_msv_set_trigger(&msv, 4000000, 1, 50);
+	for (run = 0; run < RUNS; run++) {
+		t0 = pqm_test_ns();
+		for (n = 0; n < WINDOW; n++)
+			pqm_msv_feed(&msv, scans[n]);
+		t = pqm_test_ns() - t0;
+		feed = t < feed ? t : feed;
+
+		t0 = pqm_test_ns();
+		PQM_CHECK(pqm_msv_process(&msv), "no window");
+		t = pqm_test_ns() - t0;
+		proc = t < proc ? t : proc;
+	}
+
+	printf("feed: %.1f ns per scan, %.1f us per window\n",
+	       (double)feed / WINDOW, feed / 1e3);
+	printf("process: %.0f ns per window\n", (double)proc);
+
+	return pqm_test_result("bench_msv");
+}
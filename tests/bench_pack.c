@@ -0,0 +1,191 @@
+/**
+ * @file bench_pack.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Bytes per second delivered to a loopback client in each scan format.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "pqm_test.h"
+#include "pqm_pack.h"
+
+#define CHANNELS 7
+/* One 1024 scan refill, as the IIO buffer is sized */
+#define REFILL_SCANS 1024
+#define REFILLS 4096
+/* Payload rate of the 10 Mbit/s T1L link */
+#define LINK_BYTES_PER_S (10e6 / 8)
+
+static uint32_t native[REFILL_SCANS * CHANNELS];
+static uint32_t packed[REFILL_SCANS * CHANNELS];
+
+/* Loopback client: drains the socket and counts what it got */
+static void *client(void *arg)
+{
+	static uint8_t rx[64 * 1024];
+	uint64_t *total = arg;
+	int fd = (int)*total;
+	ssize_t n;
+
+	*total = 0;
+	while ((n = recv(fd, rx, sizeof(rx), 0)) > 0)
+		*total += n;
+	close(fd);
+
+	return NULL;
+}
+
+static int loopback(int *tx)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(addr);
+	int one = 1;
+	int lfd, rx;
+
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, len) ||
+	    getsockname(lfd, (struct sockaddr *)&addr, &len) || listen(lfd, 1))
+		return -1;
+	*tx = socket(AF_INET, SOCK_STREAM, 0);
+	if (*tx < 0 || connect(*tx, (struct sockaddr *)&addr, len))
+		return -1;
+	rx = accept(lfd, NULL, NULL);
+	close(lfd);
+	setsockopt(*tx, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	return rx;
+}
+
+static int send_all(int fd, const void *data, uint32_t size)
+{
+	const uint8_t *p = data;
+	ssize_t n;
+
+	while (size) {
+		n = send(fd, p, size, 0);
+		if (n <= 0)
+			return -1;
+		p += n;
+		size -= n;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	static const struct {
+		const char *name;
+		enum scan_format_values fmt;
+	} modes[] = {
+		{"be32", PQM_SCAN_BE32},
+		{"le32", PQM_SCAN_LE32},
+		{"packed24", PQM_SCAN_PACKED24},
+		{"trunc16", PQM_SCAN_TRUNC16},
+		{"float32", PQM_SCAN_FLOAT32},
+	};
+	const uint32_t nb = REFILL_SCANS * CHANNELS;
+	float scale[CHANNELS];
+	uint64_t total, sent, t0, t;
+	uint32_t i, m, r, size;
+	uint32_t w = 0;
+	pthread_t th;
+	int tx, rx;
+	double s;
+
+	for (i = 0; i < nb; i++)
+		native[i] = pqm_test_code(0.8 * 0x7FFFFF *
+					  sin(2 * M_PI * 50 * (i / CHANNELS) / 8000.0 +
+					      (i % CHANNELS) * 2 * M_PI / 3));
+	for (i = 0; i < CHANNELS; i++)
+		scale[i] = 1.0f / 256 / (1 << 23);
+
+	printf("format    bytes/scan  MB/s loopback  Mscans/s loopback  scans/s on T1L\n");
+	for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+		rx = loopback(&tx);
+		PQM_CHECK(rx >= 0, "%s: no loopback socket", modes[m].name);
+		if (rx < 0)
+			break;
+		total = rx;
+		pthread_create(&th, NULL, client, &total);
+
+		sent = 0;
+		t0 = pqm_test_ns();
+		for (r = 0; r < REFILLS; r++) {
+			/* A refill: pack the native scans, then hand them to the transport */
+			if (modes[m].fmt == PQM_SCAN_FLOAT32) {
+				pqm_pack_float(scale, CHANNELS, native, packed, nb);
+				size = nb * 4;
+			} else {
+				size = pqm_pack(modes[m].fmt, native, packed, nb);
+			}
+			if (send_all(tx, packed, size))
+				break;
+			sent += size;
+		}
+		close(tx);
+		pthread_join(th, NULL);
+		t = pqm_test_ns() - t0;
+
+		PQM_CHECK(total == sent, "%s: client got %llu of %llu bytes",
+			  modes[m].name, (unsigned long long)total,
+			  (unsigned long long)sent);
+		s = t / 1e9;
+		printf("%-8s  %10u  %13.1f  %17.2f  %14.0f\n", modes[m].name,
+		       size / REFILL_SCANS, total / s / 1e6,
+		       total / s / size * REFILL_SCANS / 1e6,
+		       LINK_BYTES_PER_S * REFILL_SCANS / size);
+	}
+
+	/* The formats carry the same sample, check it survives each one */
+	pqm_pack(PQM_SCAN_BE32, native, packed, CHANNELS);
+	PQM_CHECK(__builtin_bswap32(packed[1]) == native[1], "be32 sample");
+	pqm_pack(PQM_SCAN_PACKED24, native, packed, CHANNELS);
+	memcpy(&w, (uint8_t *)packed + 3, 3);
+	PQM_CHECK(w == (native[1] & 0xffffff), "packed24 sample");
+	pqm_pack(PQM_SCAN_TRUNC16, native, packed, CHANNELS);
+	PQM_CHECK(((uint16_t *)packed)[1] == (uint16_t)(native[1] >> 8),
+		  "trunc16 sample");
+
+	return pqm_test_result("bench_pack");
+}
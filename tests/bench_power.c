@@ -0,0 +1,155 @@
+/**
+ * @file bench_power.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost of the fused RMS and power pass against separate passes.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_rms.h"
+
+/* 10 cycles of 50 Hz at 8 kS/s */
+#define WINDOW 1600
+/* Quarter cycle of 50 Hz, 40 scans Q16 */
+#define QUARTER (40 << 16)
+#define RUNS 200
+
+static struct pqm_rms rms;
+static uint32_t scans[WINDOW][PQM_RMS_CHANNELS];
+
+/* Accumulators of the separate passes */
+static struct {
+	uint64_t sum[PQM_RMS_CHANNELS];
+	int64_t p_sum[PQM_RMS_PHASES];
+	int64_t q_sum[PQM_RMS_PHASES];
+	int32_t delay[PQM_RMS_DELAY_MAX][PQM_RMS_PHASES];
+	uint32_t pos;
+} sep;
+
+/**
+ * @brief Sum of squares pass over a window, every sample loaded once.
+ */
+static void rms_pass(void)
+{
+	uint32_t n, ch;
+	int64_t x;
+
+	for (n = 0; n < WINDOW; n++) {
+		for (ch = 0; ch < PQM_RMS_CHANNELS; ch++) {
+			x = pqm_sample_value(scans[n][ch]);
+			sep.sum[ch] += (uint64_t)(x * x);
+		}
+	}
+}
+
+/**
+ * @brief Power pass over the same window, voltages and currents loaded again.
+ * Same delay line and interpolation as the engine.
+ */
+static void power_pass(void)
+{
+	uint32_t n, ph, p1, p2, len = rms.delay_len;
+	int32_t v, i, vq, *d0, *d1, *d2;
+
+	for (n = 0; n < WINDOW; n++) {
+		p1 = sep.pos + 1;
+		if (p1 == len)
+			p1 = 0;
+		p2 = p1 + 1;
+		if (p2 == len)
+			p2 = 0;
+		d0 = sep.delay[sep.pos];
+		d1 = sep.delay[p1];
+		d2 = sep.delay[p2];
+		for (ph = 0; ph < PQM_RMS_PHASES; ph++) {
+			v = pqm_sample_value(scans[n][ph]);
+			i = pqm_sample_value(scans[n][ph + PQM_RMS_PHASES]);
+			vq = d2[ph] + (((d1[ph] - d2[ph]) *
+					(int64_t)rms.delay_frac) >> 15);
+			d0[ph] = v;
+			sep.p_sum[ph] += (int64_t)v * i;
+			sep.q_sum[ph] += (int64_t)vq * i;
+		}
+		sep.pos = p1;
+	}
+}
+
+int main(void)
+{
+	uint64_t t0, t, fused = UINT64_MAX, split = UINT64_MAX;
+	struct pqm_power pw;
+	uint32_t run, n, ch;
+
+	/* Loaded 3-phase supply, currents lagging by 30 deg */
+	for (n = 0; n < WINDOW; n++)
+		for (ch = 0; ch < PQM_RMS_CHANNELS; ch++)
+			scans[n][ch] = pqm_test_code((ch < 3 ? 0x600000 : 0x200000) *
+						     sin(2 * M_PI * 10 * n / WINDOW -
+							 (ch % 3) * 2 * M_PI / 3 -
+							 (ch >= 3) * M_PI / 6));
+
+	for (run = 0; run < RUNS; run++) {
+		pqm_rms_init(&rms, WINDOW, QUARTER);
+		t0 = pqm_test_ns();
+		for (n = 0; n < WINDOW; n++)
+			pqm_rms_update(&rms, scans[n]);
+		t = pqm_test_ns() - t0;
+		fused = t < fused ? t : fused;
+
+		memset(&sep, 0, sizeof(sep));
+		t0 = pqm_test_ns();
+		rms_pass();
+		power_pass();
+		t = pqm_test_ns() - t0;
+		split = t < split ? t : split;
+	}
+
+	printf("fused RMS and power     %6.2f ns/scan\n", (double)fused / WINDOW);
+	printf("separate passes         %6.2f ns/scan\n", (double)split / WINDOW);
+
+	/* Both compute the same window */
+	pqm_rms_power(&rms, &pw);
+	for (ch = 0; ch < PQM_RMS_CHANNELS; ch++)
+		PQM_CHECK(rms.value[ch] == pqm_isqrt64(sep.sum[ch] / WINDOW),
+			  "channel %u: rms %u", ch, rms.value[ch]);
+	for (ch = 0; ch < PQM_RMS_PHASES; ch++)
+		PQM_CHECK(pw.p[ch] == sep.p_sum[ch] / WINDOW &&
+			  pw.q[ch] == sep.q_sum[ch] / WINDOW,
+			  "phase %u: p %lld q %lld", ch, (long long)pw.p[ch],
+			  (long long)pw.q[ch]);
+	PQM_CHECK(fused < split, "fused pass is not faster");
+
+	return pqm_test_result("bench_power");
+}
@@ -0,0 +1,95 @@
+/**
+ * @file bench_seq.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost per window of the symmetrical components for each wiring.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include "pqm_test.h"
+#include "pqm_fft.h"
+#include "pqm_seq.h"
+
+/* 10 cycles of 50 Hz at 8 kS/s */
+#define WINDOW 1600
+#define RUNS 200
+
+static struct pqm_seq seq;
+static uint32_t scans[WINDOW][PQM_SEQ_CHANNELS];
+
+int main(void)
+{
+	static const char * const names[] = {
+		"4W_WYE", "4W_WYE_NON_BLONDEL", "3W_DELTA", "3W_DELTA_2",
+		"4W_DELTA_NON_BLONDEL"
+	};
+	uint64_t t0, t, feed, proc;
+	uint32_t mode, run, n, ch;
+
+	pqm_fft_init();
+	/* Balanced 3-phase voltages and currents */
+	for (n = 0; n < WINDOW; n++)
+		for (ch = 0; ch < PQM_SEQ_CHANNELS; ch++)
+			scans[n][ch] = pqm_test_code((ch < 3 ? 0x600000 : 0x200000) *
+						     sin(2 * M_PI * 10 * n / WINDOW -
+							 (ch % 3) * 2 * M_PI / 3 -
+							 (ch >= 3) * 0.5));
+
+	printf("wiring                 ns/window feed  ns/window process\n");
+	for (mode = _4W_WYE; mode <= _4W_DELTA_NON_BLONDEL; mode++) {
+		pqm_seq_init(&seq, WINDOW, 10);
+		pqm_seq_select(&seq, mode, false);
+		feed = proc = UINT64_MAX;
+		for (run = 0; run < RUNS; run++) {
+			t0 = pqm_test_ns();
+			for (n = 0; n < WINDOW; n++)
+				pqm_seq_feed(&seq, scans[n]);
+			t = pqm_test_ns() - t0;
+			feed = t < feed ? t : feed;
+
+			t0 = pqm_test_ns();
+			PQM_CHECK(pqm_seq_process(&seq), "%s: no window", names[mode]);
+			t = pqm_test_ns() - t0;
+			proc = t < proc ? t : proc;
+		}
+		printf("%-21s  %14.0f  %17.0f\n", names[mode], (double)feed,
+		       (double)proc);
+		/* Balanced supply: no negative sequence on the wye kernels */
+		if (mode == _4W_WYE)
+			PQM_CHECK(seq.unb_neg[0] < 5 && seq.unb_neg[1] < 5,
+				  "unbalance %u %u on a balanced supply",
+				  seq.unb_neg[0], seq.unb_neg[1]);
+	}
+
+	return pqm_test_result("bench_seq");
+}
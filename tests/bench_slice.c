@@ -0,0 +1,132 @@
+/**
+ * @file bench_slice.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Latency of the harmonic analysis, in one go and in slices.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_harm.h"
+
+#define FS 8000
+/* 10 cycles of 50 Hz */
+#define WINDOW 1600
+#define WINDOWS 40
+/* Histogram buckets of 2^b us, the last one takes everything longer */
+#define BUCKETS 12
+/* Period of the acquisition, the latency a trigger can absorb */
+#define SCAN_NS (1000000000 / FS)
+
+static struct pqm_harm harm;
+static uint32_t ref[PQM_HARM_CHANNELS][PQM_MAX_HARMONIC];
+static uint64_t lat[WINDOWS * WINDOW];
+/* 99th percentile of the whole window calls */
+static uint64_t whole_p99;
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Acquire WINDOWS windows and let the main loop call the analysis
+ * once after every scan, timing every call that had work.
+ * @param slice - work units per call, zero for a whole window.
+ */
+static void run(uint32_t slice)
+{
+	uint32_t scan[PQM_HARM_CHANNELS], hist[BUCKETS] = {0};
+	uint32_t n, ch, b, calls = 0, late = 0, windows = 0;
+	uint64_t t0, t;
+
+	pqm_harm_init(&harm, WINDOW, 10);
+	pqm_harm_set_slice(&harm, slice);
+	for (n = 0; n < WINDOWS * WINDOW; n++) {
+		for (ch = 0; ch < PQM_HARM_CHANNELS; ch++)
+			scan[ch] = pqm_test_code(6e6 * sin(2 * M_PI * 50 * n / FS +
+							   ch) +
+						 6e5 * sin(2 * M_PI * 250 * n / FS));
+		pqm_harm_feed(&harm, scan);
+		if (!harm.pending)
+			continue;
+		t0 = pqm_test_ns();
+		windows += pqm_harm_process(&harm);
+		t = pqm_test_ns() - t0;
+		lat[calls++] = t;
+		late += t > SCAN_NS;
+		for (b = 0; b < BUCKETS - 1 && t >> 10 >> (b + 1); b++)
+			;
+		hist[b]++;
+	}
+	qsort(lat, calls, sizeof(*lat), cmp_u64);
+
+	if (slice)
+		printf("slices of %5u units ", slice);
+	else
+		printf("whole window         ");
+	printf("%6u calls  max %7.1f us  p99 %7.1f us  %4u over a scan\n",
+	       calls, lat[calls - 1] / 1e3, lat[calls * 99 / 100] / 1e3, late);
+	printf("  us:");
+	for (b = 0; b < BUCKETS; b++)
+		printf(" %s%u:%u", b == BUCKETS - 1 ? ">=" : "", 1u << b, hist[b]);
+	printf("\n");
+
+	PQM_CHECK(windows >= WINDOWS - 2, "%u windows analysed", windows);
+	PQM_CHECK(!harm.overruns, "%u windows overrun", harm.overruns);
+	/* Slicing changes when the work is done, not the results */
+	if (!slice) {
+		memcpy(ref, harm.harmonics, sizeof(ref));
+		whole_p99 = lat[calls * 99 / 100];
+		return;
+	}
+	PQM_CHECK(!memcmp(ref, harm.harmonics, sizeof(ref)),
+		  "slices of %u give other harmonics", slice);
+	PQM_CHECK(lat[calls * 99 / 100] < whole_p99,
+		  "slices of %u are not shorter", slice);
+}
+
+int main(void)
+{
+	pqm_fft_init();
+	run(0);
+	run(8192);
+	run(PQM_HARM_SLICE);
+	run(512);
+
+	return pqm_test_result("bench_slice");
+}
@@ -0,0 +1,120 @@
+/**
+ * @file bench_transient.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost of the transient detector per scan, quiet and with impulses.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include "pqm_test.h"
+#include "pqm_transient.h"
+
+#define FS 8000
+#define F_NOM 50
+/* 10 cycles, the waveform repeats */
+#define WINDOW 1600
+#define RUNS 200
+#define AMP 3000000.0
+
+static struct pqm_transient_engine tr;
+static uint32_t quiet[WINDOW][PQM_TRANSIENT_CHANNELS];
+static uint32_t spiky[WINDOW][PQM_TRANSIENT_CHANNELS];
+
+/**
+ * @brief Best time of a window through the detector.
+ * @param scans - the window.
+ * @param found - transients detected over all the runs, return param.
+ * @return the time in ns.
+ */
+static uint64_t run(uint32_t (*scans)[PQM_TRANSIENT_CHANNELS], uint32_t *found)
+{
+	uint64_t t0, t, best = UINT64_MAX;
+	struct pqm_transient tt;
+	uint32_t r, n;
+
+	*found = 0;
+	for (r = 0; r < RUNS; r++) {
+		t0 = pqm_test_ns();
+		for (n = 0; n < WINDOW; n++)
+			pqm_transient_feed(&tr, scans[n]);
+		t = pqm_test_ns() - t0;
+		best = t < best ? t : best;
+		while (pqm_transient_pop(&tr, &tt))
+			(*found)++;
+	}
+
+	return best;
+}
+
+int main(void)
+{
+	uint32_t n, ch, found;
+	uint64_t t_quiet, t_spiky;
+	double w, v;
+
+	for (n = 0; n < WINDOW; n++) {
+		for (ch = 0; ch < PQM_TRANSIENT_CHANNELS; ch++) {
+			w = 2 * M_PI * F_NOM * n / FS - ch * 2 * M_PI / 3;
+			v = AMP * (sin(w) + 0.10 * sin(5 * w));
+			quiet[n][ch] = pqm_test_code(v);
+			/* One single sample spike per cycle on a rotating channel */
+			if (n % (FS / F_NOM) == 37 &&
+			    ch == n / (FS / F_NOM) % PQM_TRANSIENT_CHANNELS)
+				v += 0.5 * AMP;
+			spiky[n][ch] = pqm_test_code(v);
+		}
+	}
+
+	pqm_transient_init(&tr, FS, F_NOM);
+	for (ch = 0; ch < PQM_TRANSIENT_CHANNELS; ch++)
+		pqm_transient_set_thr(&tr, ch, 0.02 * AMP, 0.1 * AMP);
+
+	t_quiet = run(quiet, &found);
+	printf("quiet                   %6.2f ns/scan, %5.2f ns/sample\n",
+	       (double)t_quiet / WINDOW,
+	       (double)t_quiet / (WINDOW * PQM_TRANSIENT_CHANNELS));
+	PQM_CHECK(!found, "%u transients on the quiet waveform", found);
+
+	/*
+	 * The spikes come back every 10 cycles, in the replay of the last
+	 * window there is none: all are detected
+	 */
+	t_spiky = run(spiky, &found);
+	printf("one impulse per cycle   %6.2f ns/scan, %5.2f ns/sample\n",
+	       (double)t_spiky / WINDOW,
+	       (double)t_spiky / (WINDOW * PQM_TRANSIENT_CHANNELS));
+	PQM_CHECK(found == RUNS * WINDOW / (FS / F_NOM),
+		  "%u transients, not %u", found, RUNS * WINDOW / (FS / F_NOM));
+
+	return pqm_test_result("bench_transient");
+}
@@ -0,0 +1,118 @@
+/**
+ * @file bench_trigger.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Cost of the trigger handler for several scans per trigger.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_ring.h"
+
+#define CHANNELS 7
+#define RING_SCANS 1024
+/* IIO circular buffer: one 1024 scan refill */
+#define CB_SIZE (1024 * CHANNELS * sizeof(uint32_t))
+/* About one second of acquisition at 8 kS/s */
+#define SCANS 8192
+#define RUNS 200
+
+static uint32_t ring_buff[RING_SCANS * CHANNELS];
+static uint32_t stage_buff[128 * CHANNELS];
+static uint8_t cb[CB_SIZE];
+static uint32_t cb_pos;
+
+/* Stand-in for no_os_cb_write() into the IIO buffer */
+static __attribute__((noinline)) void cb_write(const void *data, uint32_t size)
+{
+	uint32_t run = CB_SIZE - cb_pos < size ? CB_SIZE - cb_pos : size;
+
+	memcpy(cb + cb_pos, data, run);
+	memcpy(cb, (const uint8_t *)data + run, size - run);
+	cb_pos = (cb_pos + size) % CB_SIZE;
+}
+
+/* Body of pqm_trigger_handler() */
+static __attribute__((noinline)) uint32_t trigger(struct pqm_ring *ring,
+		const uint8_t *idx, uint32_t n)
+{
+	uint32_t nb_scans = pqm_ring_pop(ring, idx, CHANNELS, stage_buff, n);
+
+	cb_write(stage_buff, nb_scans * CHANNELS * sizeof(uint32_t));
+
+	return nb_scans;
+}
+
+int main(void)
+{
+	static const uint32_t batch[] = {1, 8, 32, 128};
+	const uint8_t idx[CHANNELS] = {0, 1, 2, 3, 4, 5, 6};
+	uint32_t scan[CHANNELS] = {0};
+	uint64_t t0, best, t;
+	struct pqm_ring ring;
+	uint32_t b, i, k, run, done, n;
+	double base = 0;
+
+	pqm_ring_init(&ring, ring_buff, RING_SCANS, CHANNELS);
+	printf("scans/trigger  triggers  ns/trigger  ns/scan  speedup\n");
+	for (b = 0; b < sizeof(batch) / sizeof(batch[0]); b++) {
+		n = batch[b];
+		best = UINT64_MAX;
+		for (run = 0; run < RUNS; run++) {
+			t = 0;
+			for (i = 0; i < SCANS; i += n) {
+				/* The acquisition stores n scans, then the trigger fires */
+				for (k = 0; k < n; k++) {
+					scan[0] = i + k;
+					pqm_ring_push(&ring, scan);
+				}
+				/* Reading the clock is part of the cost, as an interrupt entry is */
+				t0 = pqm_test_ns();
+				done = trigger(&ring, idx, n);
+				t += pqm_test_ns() - t0;
+				PQM_CHECK(done == n, "N=%u: %u scans", n, done);
+			}
+			best = t < best ? t : best;
+		}
+		if (!base)
+			base = (double)best / SCANS;
+		printf("%13u  %8u  %10.1f  %7.2f  %7.2fx\n", n, SCANS / n,
+		       (double)best * n / SCANS, (double)best / SCANS,
+		       base / ((double)best / SCANS));
+	}
+	PQM_CHECK(!ring.overruns && !ring.underruns, "ring overruns %u underruns %u",
+		  ring.overruns, ring.underruns);
+
+	return pqm_test_result("bench_trigger");
+}
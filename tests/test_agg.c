@@ -0,0 +1,189 @@
+/**
+ * @file test_agg.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Interval aggregation against a double reference.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_agg.h"
+
+#define FS 8000
+/* 10 cycles of 50 Hz */
+#define WINDOW 1600
+#define WINDOWS_10MIN (FS * PQM_AGG_INTERVAL_S / WINDOW)
+#define WINDOWS_2H (WINDOWS_10MIN * PQM_AGG_LONG_INTERVALS)
+#define NOMINAL 4000000
+/* Window flagged as overlapping an event, in the 2nd 10 min interval */
+#define FLAGGED (WINDOWS_10MIN + 1234)
+
+static struct pqm_agg agg;
+
+/* Sums of an interval, in double */
+struct ref {
+	double sq[PQM_AGG_CHANNELS];
+	double under[PQM_AGG_VOLTAGES];
+	double over[PQM_AGG_VOLTAGES];
+	uint32_t count;
+	bool flagged;
+};
+
+static struct ref ref[PQM_AGG_LEVELS];
+static double worst_rms[PQM_AGG_LEVELS], worst_dev[PQM_AGG_LEVELS];
+
+/**
+ * @brief Compare the record of an interval that just closed with the
+ * reference sums and restart them.
+ * @param level - interval.
+ */
+static void check(enum pqm_agg_level level)
+{
+	static const char * const names[] = {"3 s", "10 min", "2 h"};
+	const struct pqm_agg_record *r = &agg.rec[level];
+	struct ref *s = &ref[level];
+	double want, err;
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_AGG_CHANNELS; ch++) {
+		err = fabs(r->rms[ch] - sqrt(s->sq[ch] / s->count));
+		worst_rms[level] = err > worst_rms[level] ? err : worst_rms[level];
+	}
+	for (ch = 0; ch < PQM_AGG_VOLTAGES; ch++) {
+		want = (NOMINAL - sqrt(s->under[ch] / s->count)) * 1e4 / NOMINAL;
+		err = fabs(r->under[ch] - want);
+		want = (sqrt(s->over[ch] / s->count) - NOMINAL) * 1e4 / NOMINAL;
+		err = fmax(err, fabs(r->over[ch] - want));
+		worst_dev[level] = err > worst_dev[level] ? err : worst_dev[level];
+	}
+	PQM_CHECK(r->flagged == s->flagged, "%s interval %u: flagged %d",
+		  names[level], r->index, r->flagged);
+	memset(s, 0, sizeof(*s));
+}
+
+int main(void)
+{
+	uint32_t value[PQM_AGG_CHANNELS], done, n, ch, l;
+	uint32_t closed[PQM_AGG_LEVELS] = {0};
+	double v;
+
+	srand(1);
+	pqm_agg_init(&agg, FS);
+	pqm_agg_set_nominal(&agg, NOMINAL);
+
+	/* Two 2 h intervals of voltages within +/-10 % and loads */
+	for (n = 0; n < 2 * WINDOWS_2H; n++) {
+		for (ch = 0; ch < PQM_AGG_CHANNELS; ch++) {
+			if (ch < PQM_AGG_VOLTAGES)
+				v = NOMINAL * (0.9 + 0.2 * rand() / RAND_MAX);
+			else
+				v = 0x7FFFFF * (double)rand() / RAND_MAX;
+			value[ch] = lround(v);
+		}
+		for (l = 0; l < PQM_AGG_LEVELS; l++) {
+			for (ch = 0; ch < PQM_AGG_CHANNELS; ch++)
+				ref[l].sq[ch] += (double)value[ch] * value[ch];
+			for (ch = 0; ch < PQM_AGG_VOLTAGES; ch++) {
+				v = fmin(value[ch], NOMINAL);
+				ref[l].under[ch] += v * v;
+				v = fmax(value[ch], NOMINAL);
+				ref[l].over[ch] += v * v;
+			}
+			ref[l].count++;
+			ref[l].flagged |= n == FLAGGED;
+		}
+
+		pqm_agg_push(&agg, value, WINDOW, n == FLAGGED);
+		done = pqm_agg_process(&agg);
+		for (l = 0; l < PQM_AGG_LEVELS; l++) {
+			if (!(done & (1u << l)))
+				continue;
+			closed[l]++;
+			check(l);
+		}
+	}
+
+	printf("%u, %u and %u intervals closed\n", closed[PQM_AGG_3S],
+	       closed[PQM_AGG_10MIN], closed[PQM_AGG_2H]);
+	for (l = 0; l < PQM_AGG_LEVELS; l++)
+		printf("level %u: rms off by %.2f codes, deviation by %.2f "
+		       "hundredths of a %%\n", l, worst_rms[l], worst_dev[l]);
+	PQM_CHECK(closed[PQM_AGG_3S] == 2 * WINDOWS_2H / PQM_AGG_SHORT_WINDOWS,
+		  "%u 3 s intervals", closed[PQM_AGG_3S]);
+	PQM_CHECK(closed[PQM_AGG_10MIN] == 2 * PQM_AGG_LONG_INTERVALS,
+		  "%u 10 min intervals", closed[PQM_AGG_10MIN]);
+	PQM_CHECK(closed[PQM_AGG_2H] == 2, "%u 2 h intervals",
+		  closed[PQM_AGG_2H]);
+	for (l = 0; l < PQM_AGG_LEVELS; l++) {
+		/* Integer square roots round to the nearest code */
+		PQM_CHECK(worst_rms[l] <= 1, "level %u: rms off by %.2f", l,
+			  worst_rms[l]);
+		PQM_CHECK(worst_dev[l] <= 1, "level %u: deviation off by %.2f",
+			  l, worst_dev[l]);
+	}
+	PQM_CHECK(agg.rec[PQM_AGG_10MIN].index == closed[PQM_AGG_10MIN],
+		  "10 min index %u", agg.rec[PQM_AGG_10MIN].index);
+
+	/*
+	 * Windows of 1601 scans do not divide 10 min: the one reaching the
+	 * tick closes the interval and the 3 s interval restarts with the next
+	 */
+	pqm_agg_init(&agg, FS);
+	for (ch = 0; ch < PQM_AGG_CHANNELS; ch++)
+		value[ch] = NOMINAL;
+	done = 0;
+	for (n = 0; !(done & (1u << PQM_AGG_10MIN)); n++) {
+		pqm_agg_push(&agg, value, WINDOW + 1, false);
+		done = pqm_agg_process(&agg);
+	}
+	PQM_CHECK(n == (FS * PQM_AGG_INTERVAL_S + WINDOW) / (WINDOW + 1),
+		  "10 min closed after %u windows", n);
+	for (ch = 0; ch < PQM_AGG_CHANNELS; ch++)
+		value[ch] = NOMINAL / 2;
+	for (n = 0; n < PQM_AGG_SHORT_WINDOWS; n++) {
+		pqm_agg_push(&agg, value, WINDOW + 1, false);
+		done = pqm_agg_process(&agg);
+	}
+	PQM_CHECK((done & (1u << PQM_AGG_3S)) &&
+		  agg.rec[PQM_AGG_3S].rms[0] == NOMINAL / 2,
+		  "3 s interval not restarted: %u", agg.rec[PQM_AGG_3S].rms[0]);
+
+	/* A window handed over before the previous one was taken is dropped */
+	pqm_agg_push(&agg, value, WINDOW, false);
+	pqm_agg_push(&agg, value, WINDOW, false);
+	PQM_CHECK(agg.overruns == 1, "%u overruns", agg.overruns);
+
+	return pqm_test_result("test_agg");
+}
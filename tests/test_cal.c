@@ -0,0 +1,152 @@
+/**
+ * @file test_cal.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Phase, gain and offset accuracy of the calibration pass.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include "pqm_test.h"
+#include "pqm_cal.h"
+#include "pqm_rms.h"
+#include "no_os_error.h"
+#include "no_os_util.h"
+
+/* Cycles skipped while the delay lines fill, then measured */
+#define SETTLE 2
+/* Whole scans at 50 and 60 Hz */
+#define CYCLES 60
+/* Phase of the corrected channels and gain, relative errors */
+#define PHASE_TOL 0.01
+#define GAIN_TOL 1e-5
+
+static struct pqm_cal cal;
+
+/*
+ * Phase corrections in hundredths of a degree, channel 0 is the reference.
+ * Each row spans less than the 14 scans of the delay lines at 8 kS/s.
+ */
+static const int32_t phases[][PQM_CAL_CHANNELS] = {
+	{0, 1, -1, 37, -250, 500, -1000},
+	{0, 999, 1234, -321, 7, 1500, -1500},
+	{0, 100, 200, 300, 400, 450, -450},
+};
+
+/**
+ * @brief Calibrate whole cycles of a sine with an offset and compare the
+ * phase, gain and offset of every channel with the settings.
+ * @param fs - sampling frequency in Hz.
+ * @param f_nom - nominal frequency in Hz.
+ * @param phase - phase corrections of the channels.
+ */
+static void run(uint32_t fs, uint32_t f_nom, const int32_t *phase)
+{
+	double re[PQM_CAL_CHANNELS] = {0}, im[PQM_CAL_CHANNELS] = {0};
+	double dc[PQM_CAL_CHANNELS] = {0};
+	uint32_t scan[PQM_CAL_CHANNELS], out[PQM_CAL_CHANNELS];
+	uint32_t n, ch, len = CYCLES * fs / f_nom;
+	double a, ang, err, worst_ph = 0, worst_g = 0, worst_dc = 0;
+	int32_t scale, offset, y;
+	int ret;
+
+	pqm_cal_init(&cal);
+	pqm_cal_compile(&cal, fs, f_nom);
+	for (ch = 0; ch < PQM_CAL_CHANNELS; ch++) {
+		scale = PQM_CAL_SCALE_ONE - 20000 + 7000 * ch;
+		offset = 1000 * ch - 3000;
+		ret = pqm_cal_set(&cal, ch, scale, offset, phase[ch]);
+		PQM_CHECK(!ret, "%u Hz: channel %u: set returned %d", f_nom, ch,
+			  ret);
+	}
+
+	for (n = 0; n < SETTLE * fs / f_nom + len; n++) {
+		a = 2 * M_PI * f_nom * n / fs;
+		for (ch = 0; ch < PQM_CAL_CHANNELS; ch++)
+			scan[ch] = pqm_test_code(3e6 * sin(a + 0.3) +
+						 cal.offset[ch]);
+		pqm_cal_apply(&cal, scan, out);
+		if (n < SETTLE * fs / f_nom)
+			continue;
+		for (ch = 0; ch < PQM_CAL_CHANNELS; ch++) {
+			y = pqm_sample_value(out[ch]);
+			re[ch] += y * cos(a);
+			im[ch] -= y * sin(a);
+			dc[ch] += y;
+		}
+	}
+
+	for (ch = 0; ch < PQM_CAL_CHANNELS; ch++) {
+		/* A delay shows as a phase lag against channel 0 */
+		ang = (atan2(im[ch], re[ch]) - atan2(im[0], re[0])) * 180 / M_PI;
+		err = fabs(remainder(ang + phase[ch] / 100.0, 360));
+		worst_ph = err > worst_ph ? err : worst_ph;
+		a = 2 * hypot(re[ch], im[ch]) / len / 3e6;
+		err = fabs(a / (cal.scale[ch] / (double)PQM_CAL_SCALE_ONE) - 1);
+		worst_g = err > worst_g ? err : worst_g;
+		err = fabs(dc[ch] / len);
+		worst_dc = err > worst_dc ? err : worst_dc;
+	}
+	printf("%5u S/s %u Hz, %+6.2f..%+6.2f deg: phase %.6f deg, gain %.1e, "
+	       "offset %.2f codes\n", fs, f_nom, phase[6] / 100.0,
+	       phase[5] / 100.0, worst_ph, worst_g, worst_dc);
+	PQM_CHECK(worst_ph < PHASE_TOL, "%u Hz: phase off by %.5f deg", f_nom,
+		  worst_ph);
+	PQM_CHECK(worst_g < GAIN_TOL, "%u Hz: gain off by %.1e", f_nom, worst_g);
+	PQM_CHECK(worst_dc < 1, "%u Hz: offset left %.2f codes", f_nom,
+		  worst_dc);
+}
+
+int main(void)
+{
+	uint32_t i, ch;
+	int ret;
+
+	for (i = 0; i < NO_OS_ARRAY_SIZE(phases); i++) {
+		run(8000, 50, phases[i]);
+		run(8000, 60, phases[i]);
+		run(4000, 50, phases[i]);
+	}
+
+	/* Out of range corrections are refused and leave the settings alone */
+	pqm_cal_init(&cal);
+	pqm_cal_compile(&cal, 8000, 50);
+	ret = pqm_cal_set(&cal, 1, PQM_CAL_SCALE_ONE, 0, 9000);
+	PQM_CHECK(ret == -EINVAL && !cal.phase[1], "90 deg accepted");
+	for (ch = 0; ch < PQM_CAL_CHANNELS; ch++)
+		PQM_CHECK(cal.coeff[ch].delay == 0 && !cal.coeff[ch].c1,
+			  "channel %u left delayed", ch);
+	PQM_CHECK(cal.identity, "identity lost");
+
+	return pqm_test_result("test_cal");
+}
@@ -0,0 +1,193 @@
+/**
+ * @file test_capture.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Alignment of the captured waveforms on their trigger.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include "pqm_test.h"
+#include "pqm_capture.h"
+#include "pqm_event.h"
+
+#define FS 8000
+#define F_NOM 50
+#define CYCLE (FS / F_NOM)
+#define NOMINAL 2500000.0
+#define HISTORY (32 * CYCLE)
+/* Scan stamped in In, which no trigger looks at */
+#define STAMP 6
+
+static struct pqm_capture cap;
+static struct pqm_event_engine ev;
+static uint32_t buff[HISTORY * PQM_CAPTURE_CHANNELS];
+static uint32_t slot[HISTORY * PQM_CAPTURE_CHANNELS];
+static const uint8_t idx[PQM_CAPTURE_CHANNELS] = {0, 1, 2, 3, 4, 5, 6};
+
+/**
+ * @brief Build a scan of the 3-phase supply, In holding the scan number.
+ * @param n - scan.
+ * @param level - phase A level, relative to nominal.
+ * @param scan - the scan, return param.
+ */
+static void make_scan(uint32_t n, double level, uint32_t *scan)
+{
+	uint32_t ch;
+
+	for (ch = 0; ch < PQM_CAPTURE_CHANNELS; ch++)
+		scan[ch] = pqm_test_code(NOMINAL * sqrt(2) * (ch ? 1 : level) *
+					 sin(2 * M_PI * n / CYCLE -
+					     ch * 2 * M_PI / 3));
+	scan[STAMP] = n;
+}
+
+/**
+ * @brief Download the frozen slot in chunks and check it holds consecutive
+ * scans with the trigger after pre_valid of them.
+ * @param trig - scan the trigger must be aligned on.
+ * @param name - case name for the report.
+ * @return the scan found at the trigger position.
+ */
+static uint32_t download(uint32_t trig, const char *name)
+{
+	uint32_t n = 0, got, i, at;
+
+	PQM_CHECK(cap.state == PQM_CAPTURE_FROZEN, "%s: state %u", name,
+		  cap.state);
+	while ((got = pqm_capture_read(&cap, idx, PQM_CAPTURE_CHANNELS,
+				       slot + n * PQM_CAPTURE_CHANNELS, 100)))
+		n += got;
+	PQM_CHECK(n == cap.pre_valid + cap.post, "%s: %u scans instead of %u",
+		  name, n, cap.pre_valid + cap.post);
+	PQM_CHECK(cap.state == PQM_CAPTURE_ARMED, "%s: not armed again", name);
+	for (i = 1; i < n; i++)
+		if (slot[i * PQM_CAPTURE_CHANNELS + STAMP] !=
+		    slot[(i - 1) * PQM_CAPTURE_CHANNELS + STAMP] + 1)
+			break;
+	PQM_CHECK(i >= n, "%s: scan %u of the slot out of sequence", name, i);
+
+	at = slot[cap.pre_valid * PQM_CAPTURE_CHANNELS + STAMP];
+	PQM_CHECK(abs((int32_t)(at - trig)) <= 1,
+		  "%s: trigger at scan %u instead of %u", name, at, trig);
+
+	return at;
+}
+
+/**
+ * @brief Capture around a level crossing or a manual trigger at a scan.
+ * @param pre - scans before the trigger.
+ * @param post - scans from the trigger.
+ * @param trig - scan of the trigger.
+ * @param manual - manual trigger instead of a level one.
+ */
+static void run_direct(uint32_t pre, uint32_t post, uint32_t trig, bool manual)
+{
+	uint32_t scan[PQM_CAPTURE_CHANNELS];
+	char name[48];
+	uint32_t n;
+
+	snprintf(name, sizeof(name), "%s %u/%u at %u",
+		 manual ? "manual" : "level", pre, post, trig);
+	pqm_capture_init(&cap, buff, HISTORY);
+	PQM_CHECK(!pqm_capture_config(&cap, pre, post), "%s: refused", name);
+	cap.sources = manual ? 0 : 1u << PQM_CAPTURE_LEVEL;
+	cap.level = NOMINAL * sqrt(2) * 1.5;
+	pqm_capture_arm(&cap);
+
+	for (n = 0; n < trig + post + CYCLE; n++) {
+		make_scan(n, 1, scan);
+		/* Phase A spikes on the trigger scan only */
+		if (n == trig && !manual)
+			scan[0] = pqm_test_code(-2 * NOMINAL * sqrt(2));
+		if (n == trig && manual)
+			cap.force = true;
+		pqm_capture_feed(&cap, scan, 0, 0);
+	}
+	download(trig, name);
+	/* Triggers too early for a full history keep what there is */
+	PQM_CHECK(cap.pre_valid == (trig < pre ? trig : pre),
+		  "%s: %u scans before the trigger", name, cap.pre_valid);
+}
+
+/**
+ * @brief Capture a dip detected by the event engine, the trigger being the
+ * start of the event, found half a cycle or more after it.
+ * @param pre - scans before the trigger.
+ * @param post - scans from the trigger.
+ * @param dip - scan the dip starts at.
+ */
+static void run_event(uint32_t pre, uint32_t post, uint32_t dip)
+{
+	uint32_t scan[PQM_CAPTURE_CHANNELS];
+	uint32_t n, events, ago = 0, start = 0;
+	char name[48];
+
+	snprintf(name, sizeof(name), "dip %u/%u at %u", pre, post, dip);
+	pqm_event_init(&ev, FS, F_NOM);
+	pqm_event_set_thr(&ev, PQM_EVENT_DIP, NOMINAL, 90, 2);
+	pqm_capture_init(&cap, buff, HISTORY);
+	PQM_CHECK(!pqm_capture_config(&cap, pre, post), "%s: refused", name);
+	cap.sources = 1u << PQM_CAPTURE_DIP;
+	pqm_capture_arm(&cap);
+
+	for (n = 0; n < dip + post + 4 * CYCLE; n++) {
+		make_scan(n, n >= dip ? 0.5 : 1, scan);
+		pqm_event_feed(&ev, scan);
+		events = pqm_event_started(&ev, &ago);
+		if (events & (1u << PQM_EVENT_DIP))
+			start = n - ago;
+		pqm_capture_feed(&cap, scan, events, ago);
+	}
+	PQM_CHECK(start, "%s: not detected", name);
+	/* Half cycle RMS values date the event to within half a cycle */
+	PQM_CHECK(abs((int32_t)(start - dip)) <= CYCLE / 2,
+		  "%s: event starts at %u", name, start);
+	download(start, name);
+}
+
+int main(void)
+{
+	run_direct(CYCLE, 2 * CYCLE, 3000, false);
+	run_direct(CYCLE, 2 * CYCLE, 3000, true);
+	run_direct(10 * CYCLE, 1, 5001, false);
+	run_direct(0, HISTORY, 777, true);
+	run_direct(5 * CYCLE, 5 * CYCLE, 100, false);
+
+	run_event(4 * CYCLE, 6 * CYCLE, 16100);
+	run_event(4 * CYCLE, 6 * CYCLE, 16040);
+	/* Slot already complete when the dip is detected */
+	run_event(8 * CYCLE, 10, 16123);
+
+	return pqm_test_result("test_capture");
+}
@@ -0,0 +1,168 @@
+/**
+ * @file test_compress.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Round trip of the compressed stream, padding included.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_compress.h"
+
+#define CHANNELS 7
+#define BLOCK PQM_COMPRESS_BLOCK_SCANS
+#define BLOCKS 2000
+
+static uint32_t scans[BLOCK * CHANNELS];
+static uint32_t out[BLOCK * CHANNELS];
+static uint8_t refill[8192];
+
+/**
+ * @brief Fill a block with one of the signal kinds the encoder must survive.
+ * @param kind - 0 sine with noise, 1 full scale noise, 2 constant,
+ * 3 alternating extremes, 4 steps.
+ * @param cnt - channels per scan.
+ * @param t0 - index of the first scan.
+ */
+static void fill(uint32_t kind, uint32_t cnt, uint32_t t0)
+{
+	uint32_t i, ch;
+	double v;
+
+	for (i = 0; i < BLOCK; i++) {
+		for (ch = 0; ch < cnt; ch++) {
+			switch (kind) {
+			case 0:
+				v = 0.9 * 0x7FFFFF * sin(2 * M_PI * 50 * (t0 + i) / 8000.0 +
+							 ch * 2 * M_PI / 3) +
+				    rand() % 64 - 32;
+				break;
+			case 1:
+				v = (double)(rand() & 0xFFFFFF) - 0x800000;
+				break;
+			case 2:
+				v = ch * 1000.0 - 3000;
+				break;
+			case 3:
+				v = (i + ch) & 1 ? 0x7FFFFF : -0x800000;
+				break;
+			default:
+				v = (i / 8) & 1 ? 0x700000 : -0x700000;
+				break;
+			}
+			scans[i * cnt + ch] = pqm_test_code(v);
+		}
+	}
+}
+
+int main(void)
+{
+	uint32_t mask, cnt, kind, b, size, pad, used, n;
+	uint32_t bad = 0, too_big = 0, blocks = 0;
+	uint8_t got_mask;
+	int32_t ret;
+
+	srand(1);
+	/* Every block decodes to the scans it was made of */
+	for (b = 0; b < BLOCKS; b++) {
+		mask = 1 + rand() % 0x7F;
+		cnt = __builtin_popcount(mask);
+		kind = b % 5;
+		n = b % 7 ? BLOCK : 1 + rand() % BLOCK;
+		fill(kind, cnt, b * BLOCK);
+		size = pqm_compress_block(scans, n, mask, refill);
+		too_big += size > pqm_compress_max_size(cnt, n);
+		memset(out, 0, sizeof(out));
+		ret = pqm_decompress_block(refill, size, out, BLOCK, &n, &got_mask);
+		if (ret != (int32_t)size || got_mask != mask ||
+		    memcmp(out, scans, n * cnt * sizeof(uint32_t)))
+			bad++;
+	}
+	PQM_CHECK(!bad, "%u of %u blocks do not round trip", bad, BLOCKS);
+	PQM_CHECK(!too_big, "%u blocks over pqm_compress_max_size()", too_big);
+
+	/*
+	 * A refill as read_samples_compressed() builds it: blocks while a worst
+	 * case one fits, then padding. Sweep the refill size so the padding
+	 * takes every length from 0 bytes up.
+	 */
+	cnt = CHANNELS;
+	bad = 0;
+	for (size = pqm_compress_max_size(cnt, BLOCK);
+	     size < pqm_compress_max_size(cnt, BLOCK) + 64; size++) {
+		for (kind = 0; kind < 5; kind++) {
+			for (used = 0;
+			     size - used >= pqm_compress_max_size(cnt, BLOCK);) {
+				fill(kind, cnt, used);
+				used += pqm_compress_block(scans, BLOCK, 0x7F,
+							   refill + used);
+			}
+			pad = size - used;
+			pqm_compress_pad(refill + used, pad);
+
+			for (used = 0, blocks = 0; used < size; used += ret) {
+				ret = pqm_decompress_block(refill + used, size - used,
+							   out, BLOCK, &n,
+							   &got_mask);
+				if (ret <= 0)
+					break;
+				blocks += n != 0;
+			}
+			if (used != size || !blocks) {
+				printf("refill %u bytes, pad %u: stuck at %u\n",
+				       size, pad, used);
+				bad++;
+			}
+		}
+	}
+	PQM_CHECK(!bad, "%u refills do not decode to the end", bad);
+
+	/* Padding of any length, header or not, spans the rest of the refill */
+	for (pad = 1; pad <= 16; pad++) {
+		memset(refill, 0xA5, sizeof(refill));
+		pqm_compress_pad(refill, pad);
+		ret = pqm_decompress_block(refill, pad, out, BLOCK, &n, &got_mask);
+		PQM_CHECK(ret == (int32_t)pad && !n, "pad %u: %d", pad, ret);
+	}
+
+	/* Garbage is rejected, not taken for padding */
+	memset(refill, 0xA5, 16);
+	PQM_CHECK(pqm_decompress_block(refill, 16, out, BLOCK, &n,
+				       &got_mask) < 0, "garbage accepted");
+	PQM_CHECK(pqm_decompress_block(refill, 3, out, BLOCK, &n,
+				       &got_mask) < 0, "short garbage accepted");
+
+	return pqm_test_result("test_compress");
+}
@@ -0,0 +1,238 @@
+/**
+ * @file test_energy.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Checkpoint and restore round trip of the energy registers over a file.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_energy.h"
+#include "no_os_error.h"
+
+#define FS 8000
+/* 10 cycles of 50 Hz */
+#define WINDOW 1600
+#define PAGE_SIZE 1024
+#define PAGES 4
+#define SLOTS (PAGES * PAGE_SIZE / PQM_ENERGY_SLOT)
+
+/* File stand-in for the flash: erased bytes read 0xFF, writes clear bits */
+struct file_nv {
+	FILE *f;
+	/** Fail the next write, as a reset right after an erase would */
+	bool fail_write;
+};
+
+static int file_read(void *ctx, uint32_t offset, void *data, uint32_t len)
+{
+	struct file_nv *nv = ctx;
+
+	if (offset + len > PAGES * PAGE_SIZE)
+		return -EINVAL;
+	if (fseek(nv->f, offset, SEEK_SET) || fread(data, 1, len, nv->f) != len)
+		return -EIO;
+
+	return 0;
+}
+
+static int file_write(void *ctx, uint32_t offset, const void *data,
+		      uint32_t len)
+{
+	const uint8_t *src = data;
+	struct file_nv *nv = ctx;
+	uint8_t old[PQM_ENERGY_SLOT];
+	uint32_t i;
+
+	if (nv->fail_write) {
+		nv->fail_write = false;
+		return -EIO;
+	}
+	if (len > sizeof(old) || file_read(ctx, offset, old, len))
+		return -EINVAL;
+	for (i = 0; i < len; i++)
+		old[i] &= src[i];
+	if (fseek(nv->f, offset, SEEK_SET) || fwrite(old, 1, len, nv->f) != len)
+		return -EIO;
+
+	return fflush(nv->f) ? -EIO : 0;
+}
+
+static int file_erase(void *ctx, uint32_t offset)
+{
+	struct file_nv *nv = ctx;
+	uint8_t page[PAGE_SIZE];
+
+	if (offset % PAGE_SIZE || offset >= PAGES * PAGE_SIZE)
+		return -EINVAL;
+	memset(page, 0xFF, sizeof(page));
+	if (fseek(nv->f, offset, SEEK_SET) ||
+	    fwrite(page, 1, sizeof(page), nv->f) != sizeof(page))
+		return -EIO;
+
+	return fflush(nv->f) ? -EIO : 0;
+}
+
+static const struct pqm_nv_ops file_ops = {
+	.read = file_read,
+	.write = file_write,
+	.erase = file_erase,
+};
+
+static struct file_nv store;
+static const struct pqm_nv nv = {
+	.ops = &file_ops,
+	.ctx = &store,
+	.page_size = PAGE_SIZE,
+	.pages = PAGES,
+};
+
+/**
+ * @brief Add windows of a load importing P and exporting Q on every phase.
+ * @param e - energy registers.
+ * @param windows - windows to be added.
+ */
+static void feed(struct pqm_energy *e, uint32_t windows)
+{
+	struct pqm_power pw = {0};
+	uint32_t ph;
+
+	while (windows--) {
+		for (ph = 0; ph < PQM_RMS_PHASES; ph++) {
+			pw.p[ph] = 3000000000000ll * (ph + 1) + rand();
+			pw.q[ph] = -1000000000000ll * (ph + 1) - rand();
+		}
+		pqm_energy_add(e, &pw, WINDOW);
+	}
+}
+
+/**
+ * @brief Restore into fresh registers and compare with the expected ones.
+ * @param want - registers expected, NULL if no checkpoint must be found.
+ * @param what - case name for the report.
+ */
+static void check_restore(const struct pqm_energy *want, const char *what)
+{
+	struct pqm_energy e;
+	int ret;
+
+	memset(&e, 0, sizeof(e));
+	ret = pqm_energy_restore(&e, &nv);
+	if (!want) {
+		PQM_CHECK(ret == -ENOENT, "%s: restore returned %d", what, ret);
+		return;
+	}
+	PQM_CHECK(!ret, "%s: restore returned %d", what, ret);
+	PQM_CHECK(!memcmp(e.reg, want->reg, sizeof(e.reg)),
+		  "%s: registers differ", what);
+	PQM_CHECK(e.rec_seq == want->rec_seq && e.slot == want->slot,
+		  "%s: seq %u slot %u instead of %u %u", what, e.rec_seq,
+		  e.slot, want->rec_seq, want->slot);
+}
+
+int main(void)
+{
+	static struct pqm_energy e, prev;
+	uint64_t t0, t, worst = 0;
+	uint32_t i, written = 0;
+	uint8_t byte;
+	int ret;
+
+	store.f = tmpfile();
+	if (!store.f) {
+		printf("no temporary file\n");
+		return 1;
+	}
+	srand(1);
+
+	/* Blank store */
+	for (i = 0; i < PAGES; i++)
+		file_erase(&store, i * PAGE_SIZE);
+	check_restore(NULL, "blank store");
+
+	/* Due every PQM_ENERGY_CHECKPOINT_S of windows, not before */
+	pqm_energy_init(&e, FS);
+	feed(&e, PQM_ENERGY_CHECKPOINT_S * FS / WINDOW - 1);
+	PQM_CHECK(!pqm_energy_checkpoint(&e, &nv, false), "early checkpoint");
+	feed(&e, 1);
+	PQM_CHECK(pqm_energy_checkpoint(&e, &nv, false) == 1, "no checkpoint");
+	check_restore(&e, "first checkpoint");
+
+	/* Several wraps of the log, every one erasing a page */
+	for (i = 0; i < 3 * SLOTS + 5; i++) {
+		prev = e;
+		feed(&e, 7);
+		t0 = pqm_test_ns();
+		ret = pqm_energy_checkpoint(&e, &nv, true);
+		t = pqm_test_ns() - t0;
+		worst = t > worst ? t : worst;
+		written += ret == 1;
+	}
+	PQM_CHECK(written == 3 * SLOTS + 5 && !e.nv_errors,
+		  "%u checkpoints, %u errors", written, e.nv_errors);
+	check_restore(&e, "after wrapping");
+
+	/* A corrupted newest record falls back to the previous one */
+	i = (e.slot + SLOTS - 1) % SLOTS * PQM_ENERGY_SLOT + 8;
+	file_read(&store, i, &byte, 1);
+	byte ^= 0x10;
+	fseek(store.f, i, SEEK_SET);
+	fwrite(&byte, 1, 1, store.f);
+	fflush(store.f);
+	prev.slot = (e.slot + SLOTS - 1) % SLOTS;
+	check_restore(&prev, "corrupted newest record");
+
+	/* Reset between a page erase and the write: the other pages hold */
+	memset(&e, 0, sizeof(e));
+	pqm_energy_init(&e, FS);
+	pqm_energy_restore(&e, &nv);
+	while (e.slot % (PAGE_SIZE / PQM_ENERGY_SLOT)) {
+		feed(&e, 1);
+		pqm_energy_checkpoint(&e, &nv, true);
+	}
+	prev = e;
+	feed(&e, 1);
+	store.fail_write = true;
+	PQM_CHECK(pqm_energy_checkpoint(&e, &nv, true) == -EIO,
+		  "failed write not reported");
+	PQM_CHECK(e.nv_errors == 1, "%u storage errors", e.nv_errors);
+	check_restore(&prev, "write lost after an erase");
+
+	printf("%u checkpoints over %u slots, longest %.1f us\n", written,
+	       SLOTS, worst * 1e-3);
+	fclose(store.f);
+
+	return pqm_test_result("test_energy");
+}
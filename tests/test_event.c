@@ -0,0 +1,188 @@
+/**
+ * @file test_event.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Replay of synthetic dips, swells, interruptions and RVCs.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include "pqm_test.h"
+#include "pqm_event.h"
+
+#define FS 8000
+#define F_NOM 50
+#define HALF (FS / F_NOM / 2)
+/* Nominal RMS voltage, in codes */
+#define NOMINAL 4000000.0
+#define END (11 * FS)
+
+static struct pqm_event_engine ev;
+/* Zero thresholds, as shipped: nothing is detected */
+static struct pqm_event_engine off;
+
+/* Disturbance of some phases, relative to the nominal voltage */
+struct step {
+	double start;
+	double end;
+	uint8_t phases;
+	double level;
+};
+
+static const struct step steps[] = {
+	/* Single phase dip, starting mid half cycle */
+	{2.0125, 2.1125, 0x1, 0.70},
+	/* Two phase swell */
+	{3.0, 3.5, 0x6, 1.20},
+	/* Interruption, also a dip */
+	{5.0, 5.3, 0x7, 0.01},
+	/*
+	 * Step to a new steady state inside the dip and swell limits: RVC.
+	 * The voltage must have been steady for a second before.
+	 */
+	{8.0, 100, 0x7, 0.94},
+};
+
+/* What the client must get, in any order */
+static const struct pqm_event want[] = {
+	{PQM_EVENT_DIP, 0x1, 2012, 100, 0.70 * NOMINAL},
+	{PQM_EVENT_SWELL, 0x6, 3000, 500, 1.20 * NOMINAL},
+	{PQM_EVENT_INTERRUPTION, 0x7, 5000, 300, 0.01 * NOMINAL},
+	{PQM_EVENT_DIP, 0x7, 5000, 300, 0.01 * NOMINAL},
+	{PQM_EVENT_RVC, 0x7, 8000, 0, 0.06 * NOMINAL},
+};
+
+/**
+ * @brief RMS level of a phase at a scan.
+ * @param n - scan.
+ * @param ch - phase.
+ * @return the level, relative to the nominal voltage.
+ */
+static double level(uint32_t n, uint32_t ch)
+{
+	double t = (double)n / FS;
+	double l = 1;
+	uint32_t i;
+
+	for (i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+		if (t >= steps[i].start && t < steps[i].end &&
+		    (steps[i].phases & (1 << ch)))
+			l = steps[i].level;
+
+	return l;
+}
+
+int main(void)
+{
+	static double sq[FS / F_NOM];
+	uint32_t scan[PQM_EVENT_CHANNELS];
+	struct pqm_event got[16];
+	uint32_t n, ch, i, nb = 0, ago, matched;
+	uint32_t crossed = 0, detected = 0;
+	double v, sum = 0, tol;
+	struct pqm_event e;
+
+	pqm_event_init(&ev, FS, F_NOM);
+	pqm_event_init(&off, FS, F_NOM);
+	pqm_event_set_thr(&ev, PQM_EVENT_DIP, NOMINAL, 90, 2);
+	pqm_event_set_thr(&ev, PQM_EVENT_SWELL, NOMINAL, 110, 2);
+	pqm_event_set_thr(&ev, PQM_EVENT_INTERRUPTION, NOMINAL, 5, 2);
+	pqm_event_set_thr(&ev, PQM_EVENT_RVC, NOMINAL, 5, 2);
+
+	srand(1);
+	for (n = 0; n < END; n++) {
+		for (ch = 0; ch < PQM_EVENT_CHANNELS; ch++) {
+			/* 3% 5th harmonic and noise must not trigger anything */
+			v = NOMINAL * sqrt(2) * level(n, ch) *
+			    (sin(2 * M_PI * F_NOM * n / FS - ch * 2 * M_PI / 3) +
+			     0.03 * sin(10 * M_PI * F_NOM * n / FS));
+			scan[ch] = pqm_test_code(v + rand() % 2001 - 1000);
+			if (ch)
+				continue;
+			/* One cycle RMS of phase A, slid on every scan */
+			sum += v * v - sq[n % (FS / F_NOM)];
+			sq[n % (FS / F_NOM)] = v * v;
+			if (!crossed && n > FS &&
+			    sum / (FS / F_NOM) < pow(0.9 * NOMINAL, 2))
+				crossed = n;
+		}
+		pqm_event_feed(&ev, scan);
+		pqm_event_feed(&off, scan);
+		if (!detected &&
+		    (pqm_event_started(&ev, &ago) & (1u << PQM_EVENT_DIP)))
+			detected = n;
+		while (nb < 16 && pqm_event_pop(&ev, &e))
+			got[nb++] = e;
+	}
+
+	/*
+	 * Urms(1/2) is refreshed every half cycle: the dip is seen at most
+	 * a half cycle after the one cycle RMS crossed the threshold.
+	 */
+	printf("dip detected %u scans after the crossing\n", detected - crossed);
+	PQM_CHECK(detected >= crossed && detected - crossed <= HALF,
+		  "detection %d scans after the crossing", (int)(detected - crossed));
+
+	PQM_CHECK(nb == sizeof(want) / sizeof(want[0]), "%u events", nb);
+	for (i = 0; i < nb; i++)
+		printf("type %u phases %x start %llu ms duration %u ms extreme %.3f\n",
+		       got[i].type, got[i].phases,
+		       (unsigned long long)got[i].start_ms, got[i].duration_ms,
+		       got[i].extreme / NOMINAL);
+	for (i = 0; i < sizeof(want) / sizeof(want[0]); i++) {
+		matched = 0;
+		for (n = 0; n < nb; n++) {
+			if (got[n].type != want[i].type ||
+			    got[n].phases != want[i].phases)
+				continue;
+			/* Start and end fall on half cycle boundaries, one cycle window */
+			tol = 1000.0 / F_NOM;
+			if (fabs((double)got[n].start_ms - want[i].start_ms) > tol)
+				continue;
+			if (want[i].duration_ms &&
+			    fabs((double)got[n].duration_ms - want[i].duration_ms) > tol)
+				continue;
+			if (fabs((double)got[n].extreme - want[i].extreme) >
+			    0.01 * NOMINAL)
+				continue;
+			matched++;
+		}
+		PQM_CHECK(matched == 1, "event %u type %u matched %u times", i,
+			  want[i].type, matched);
+	}
+	PQM_CHECK(!ev.overruns, "%u events lost", ev.overruns);
+	PQM_CHECK(!pqm_event_pop(&off, &e) && !pqm_event_started(&off, &ago),
+		  "events with detection disabled");
+
+	return pqm_test_result("test_event");
+}
@@ -0,0 +1,153 @@
+/**
+ * @file test_flicker.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Flicker meter against the IEC 61000-4-15 test waveforms.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_flicker.h"
+
+#define FS 8000
+#define AMP (0.8 * 0x7FFFFF)
+
+static struct pqm_flicker flk;
+
+/* Modulation of one phase, one of the standard's test points */
+struct modulation {
+	/** Rectangular changes per minute, zero for sinusoidal */
+	double cpm;
+	/** Sinusoidal modulation frequency, Hz */
+	double freq;
+	/** Relative voltage change, peak to peak, percent */
+	double dv;
+	/** Expected value of the test: Pinst peak or Pst */
+	double want;
+};
+
+/**
+ * @brief Relative modulation of the supply amplitude at time t.
+ * @param m - modulation.
+ * @param t - time, s.
+ * @return the factor applied to the amplitude.
+ */
+static double modulate(const struct modulation *m, double t)
+{
+	double d = m->dv / 100 / 2;
+
+	if (m->cpm)
+		return 1 + ((long)(t * m->cpm / 60) & 1 ? -d : d);
+
+	return 1 + d * sin(2 * M_PI * m->freq * t);
+}
+
+/**
+ * @brief Feed the three phases, each modulated its own way.
+ * @param m - modulation of each phase.
+ * @param from - first scan.
+ * @param to - end scan.
+ * @param pinst - largest Pinst of each phase, return param, may be NULL.
+ */
+static void feed(const struct modulation *m, uint32_t from, uint32_t to,
+		 uint32_t *pinst)
+{
+	uint32_t scan[PQM_FLICKER_CHANNELS];
+	uint32_t n, ch;
+	double t;
+
+	for (n = from; n < to; n++) {
+		t = (double)n / FS;
+		for (ch = 0; ch < PQM_FLICKER_CHANNELS; ch++)
+			scan[ch] = pqm_test_code(AMP * modulate(&m[ch], t) *
+						 sin(2 * M_PI * 50 * t -
+						     ch * 2 * M_PI / 3));
+		if (!pqm_flicker_feed(&flk, scan) || !pinst)
+			continue;
+		for (ch = 0; ch < PQM_FLICKER_CHANNELS; ch++)
+			if (flk.pinst[ch] > pinst[ch])
+				pinst[ch] = flk.pinst[ch];
+	}
+}
+
+int main(void)
+{
+	/* IEC 61000-4-15 Table 1, 230 V lamp, 50 Hz supply: Pinst peaks at 1 */
+	static const struct modulation pinst_tests[][PQM_FLICKER_CHANNELS] = {
+		{{0, 0.5, 2.325, 1}, {0, 8.8, 0.250, 1}, {0, 25, 1.037, 1}},
+		{{0, 1, 1.397, 1}, {0, 5, 0.396, 1}, {0, 20, 0.704, 1}},
+	};
+	/* IEC 61000-4-15 Table 5, 230 V lamp, 50 Hz supply: Pst is 1 */
+	static const struct modulation pst_tests[][PQM_FLICKER_CHANNELS] = {
+		{{1, 0, 2.724, 1}, {2, 0, 2.211, 1}, {7, 0, 1.459, 1}},
+		{{39, 0, 0.906, 1}, {110, 0, 0.725, 1}, {1620, 0, 0.402, 1}},
+	};
+	uint32_t pinst[PQM_FLICKER_CHANNELS] = {0};
+	uint32_t n, ch, p;
+	double err;
+
+	/* Pinst: let the filters and the reference level settle, then watch */
+	for (p = 0; p < sizeof(pinst_tests) / sizeof(pinst_tests[0]); p++) {
+		pqm_flicker_init(&flk, FS, false, false);
+		memset(pinst, 0, sizeof(pinst));
+		feed(pinst_tests[p], 0, 30 * FS, NULL);
+		feed(pinst_tests[p], 30 * FS, 60 * FS, pinst);
+		for (ch = 0; ch < PQM_FLICKER_CHANNELS; ch++) {
+			err = pinst[ch] / 1000.0 - pinst_tests[p][ch].want;
+			printf("pinst %6.1f Hz %.3f%%: %.3f\n",
+			       pinst_tests[p][ch].freq, pinst_tests[p][ch].dv,
+			       pinst[ch] / 1000.0);
+			PQM_CHECK(fabs(err) <= 0.05, "pinst at %.1f Hz off by %.3f",
+				  pinst_tests[p][ch].freq, err);
+		}
+	}
+
+	/* Pst: one 10 minute interval after the settling time */
+	for (p = 0; p < sizeof(pst_tests) / sizeof(pst_tests[0]); p++) {
+		pqm_flicker_init(&flk, FS, false, false);
+		for (n = 0; !flk.pending; n += FS)
+			feed(pst_tests[p], n, n + FS, NULL);
+		PQM_CHECK(pqm_flicker_process(&flk), "no pst");
+		for (ch = 0; ch < PQM_FLICKER_CHANNELS; ch++) {
+			err = flk.pst[ch] / 1000.0 - pst_tests[p][ch].want;
+			printf("pst %8.0f changes/min %.3f%%: %.3f\n",
+			       pst_tests[p][ch].cpm, pst_tests[p][ch].dv,
+			       flk.pst[ch] / 1000.0);
+			PQM_CHECK(fabs(err) <= 0.05, "pst at %.0f changes/min off by %.3f",
+				  pst_tests[p][ch].cpm, err);
+		}
+	}
+
+	return pqm_test_result("test_flicker");
+}
@@ -0,0 +1,213 @@
+/**
+ * @file test_harm.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Accuracy of the fixed point FFT and harmonic analyser against float.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include "pqm_test.h"
+#include "pqm_harm.h"
+
+#define FS 8000.0
+#define N PQM_HARM_POINTS
+#define LOG2N PQM_HARM_LOG2
+
+static struct pqm_harm harm;
+static struct pqm_cpx fix[N];
+static double complex ref[N];
+
+/**
+ * @brief Reference transform, recursive radix-2 in double.
+ * @param v - samples, replaced by their DFT.
+ * @param n - number of samples, a power of 2.
+ * @param tmp - scratch of n samples.
+ */
+static void ref_fft(double complex *v, uint32_t n, double complex *tmp)
+{
+	double complex t;
+	uint32_t k;
+
+	if (n == 1)
+		return;
+	for (k = 0; k < n / 2; k++) {
+		tmp[k] = v[2 * k];
+		tmp[k + n / 2] = v[2 * k + 1];
+	}
+	ref_fft(tmp, n / 2, v);
+	ref_fft(tmp + n / 2, n / 2, v);
+	for (k = 0; k < n / 2; k++) {
+		t = cexp(-2 * M_PI * I * k / n) * tmp[k + n / 2];
+		v[k] = tmp[k] + t;
+		v[k + n / 2] = tmp[k] - t;
+	}
+}
+
+/**
+ * @brief Transform random full scale input and compare with the reference
+ * scaled by 1/N, as pqm_fft() scales.
+ * @param amp - input amplitude, below 2^30.
+ * @return the RMS error relative to amp.
+ */
+static double fft_error(double amp)
+{
+	static double complex tmp[N];
+	double err = 0;
+	uint32_t i;
+
+	for (i = 0; i < N; i++) {
+		fix[i].re = lrint(amp * (2.0 * rand() / RAND_MAX - 1));
+		fix[i].im = lrint(amp * (2.0 * rand() / RAND_MAX - 1));
+		ref[i] = fix[i].re + I * fix[i].im;
+	}
+	pqm_fft(fix, LOG2N);
+	ref_fft(ref, N, tmp);
+	for (i = 0; i < N; i++)
+		err += pow(cabs(fix[i].re + I * fix[i].im - ref[i] / N), 2);
+
+	return sqrt(err / N) / amp;
+}
+
+int main(void)
+{
+	/* Orders and amplitudes of the test signal, relative to the fundamental */
+	static const struct {
+		uint32_t h;
+		double a;
+	} comp[] = {
+		{1, 1}, {3, 0.05}, {5, 0.06}, {7, 0.03}, {11, 0.02}, {13, 0.01},
+		{25, 0.005}, {49, 0.002},
+	};
+	static double amp[PQM_HARM_CHANNELS][PQM_MAX_HARMONIC];
+	static double want[PQM_HARM_CHANNELS][PQM_MAX_HARMONIC];
+	static double complex win[N], tmp[N];
+	double fund, err, worst_fix = 0, worst_low = 0, worst_thd = 0;
+	double ph, t, v, x, thd;
+	uint32_t scan[PQM_HARM_CHANNELS];
+	uint32_t ch, h, i, c, n, windows = 0;
+
+	srand(1);
+	pqm_fft_init();
+
+	/* The transform alone, at the levels the analyser feeds it */
+	err = fft_error(0x7FFFFF << 6);
+	printf("fft: rms error %.2e of full scale\n", err);
+	PQM_CHECK(err < 1e-6, "fft error %.2e", err);
+	err = fft_error(1000 << 6);
+	printf("fft: rms error %.2e of 0.01%% of full scale\n", err);
+	PQM_CHECK(err < 2e-3, "small signal fft error %.2e", err);
+
+	/*
+	 * The analyser on a 50 Hz 3-phase signal, 10 cycles in 1600 scans.
+	 * Each channel has a different fundamental so the pairs sharing a
+	 * transform are told apart.
+	 */
+	for (ch = 0; ch < PQM_HARM_CHANNELS; ch++) {
+		fund = 0x7FFFFF * (0.8 - 0.1 * ch);
+		for (c = 0; c < sizeof(comp) / sizeof(comp[0]); c++)
+			amp[ch][comp[c].h - 1] = fund * comp[c].a;
+	}
+	pqm_harm_init(&harm, 1600, 10);
+	for (n = 0; windows < 4; n++) {
+		t = 2 * M_PI * 50 * n / FS;
+		for (ch = 0; ch < PQM_HARM_CHANNELS; ch++) {
+			ph = (ch % 3) * 2 * M_PI / 3 + ch * 0.1;
+			v = 0;
+			for (c = 0; c < sizeof(comp) / sizeof(comp[0]); c++)
+				v += amp[ch][comp[c].h - 1] *
+				     sin(comp[c].h * (t - ph));
+			scan[ch] = pqm_test_code(v);
+		}
+		pqm_harm_feed(&harm, scan);
+		if (!harm.pending)
+			continue;
+
+		/* Float reference over the same resampled window */
+		for (ch = 0; ch < PQM_HARM_CHANNELS; ch++) {
+			for (i = 0; i < N; i++)
+				win[i] = harm.win[harm.fill ^ 1][ch][i];
+			ref_fft(win, N, tmp);
+			for (h = 1; h <= PQM_MAX_HARMONIC; h++) {
+				/* Corrected for the droop of the interpolation */
+				x = M_PI * h * 10 / 1600;
+				want[ch][h - 1] = h * 10 < N / 2 ?
+						  cabs(win[h * 10]) * sqrt(2) / N /
+						  pow(sin(x) / x, 2) : 0;
+			}
+		}
+		PQM_CHECK(pqm_harm_process(&harm), "window not analysed");
+		windows++;
+
+		for (ch = 0; ch < PQM_HARM_CHANNELS; ch++) {
+			fund = want[ch][0];
+			thd = 0;
+			for (h = 1; h <= PQM_MAX_HARMONIC; h++) {
+				/*
+				 * Fixed point against float, same window: rounding
+				 * plus the Q16 droop correction, 2^-17 of the reading
+				 */
+				err = fabs(harm.harmonics[ch][h - 1] - want[ch][h - 1]) /
+				      (2 + want[ch][h - 1] / 65536);
+				worst_fix = err > worst_fix ? err : worst_fix;
+				if (h > 1)
+					thd += want[ch][h - 1] * want[ch][h - 1];
+			}
+			/*
+			 * Against the signal: IEC 61000-4-7 class I allows 5% of
+			 * the reading from 1% of the fundamental up, 0.05% of
+			 * the fundamental below.
+			 */
+			for (c = 0; c < sizeof(comp) / sizeof(comp[0]); c++) {
+				v = fund * comp[c].a;
+				err = fabs(harm.harmonics[ch][comp[c].h - 1] - v) /
+				      (comp[c].a >= 0.01 ? 0.05 * v : 5e-4 * fund);
+				worst_low = err > worst_low ? err : worst_low;
+			}
+			err = fabs(harm.thd[ch] - sqrt(thd) / fund * 10000);
+			worst_thd = err > worst_thd ? err : worst_thd;
+		}
+	}
+
+	printf("harm: fixed vs float %.0f%% of the bound, vs signal %.1f%% of the class I "
+	       "limit, thd %.2f hundredths of %%\n", worst_fix * 100, worst_low * 100,
+	       worst_thd);
+	PQM_CHECK(worst_fix <= 1, "harmonics %.0f%% of the bound", worst_fix * 100);
+	PQM_CHECK(worst_low <= 1, "harmonics %.0f%% of the class I limit",
+		  worst_low * 100);
+	PQM_CHECK(worst_thd <= 1, "thd off by %.2f", worst_thd);
+
+	return pqm_test_result("test_harm");
+}
@@ -0,0 +1,138 @@
+/**
+ * @file test_msv.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Mains signalling detection on synthetic carrier bursts.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include "pqm_test.h"
+#include "pqm_msv.h"
+
+#define FS 8000
+#define WINDOW 1600
+#define CARRIER 175
+/* Nominal RMS voltage, in codes */
+#define NOMINAL 4000000.0
+#define REC_LEN 50
+
+static struct pqm_msv msv;
+/* Scans fed since the start, the engine must count the same */
+static uint32_t t;
+
+/**
+ * @brief Feed a 3-phase supply with a 5th harmonic and, optionally, a
+ * carrier, and process every complete window.
+ * @param scans - number of scans to feed.
+ * @param carrier - carrier RMS, relative to the nominal voltage.
+ * @param worst - largest error of the carrier RMS, in codes, return param.
+ */
+static void feed(uint32_t scans, double carrier, double *worst)
+{
+	uint32_t scan[PQM_MSV_CHANNELS];
+	double w, err;
+	uint32_t n, ch;
+
+	for (n = 0; n < scans; n++, t++) {
+		w = 2 * M_PI * t / FS;
+		for (ch = 0; ch < PQM_MSV_CHANNELS; ch++)
+			scan[ch] = pqm_test_code(NOMINAL * sqrt(2) *
+						 (sin(50 * w - ch * 2 * M_PI / 3) +
+						  0.05 * sin(250 * w - ch * 2 * M_PI / 3) +
+						  carrier * sin(CARRIER * w + ch)));
+		pqm_msv_feed(&msv, scan);
+		if (!pqm_msv_process(&msv))
+			continue;
+		for (ch = 0; ch < PQM_MSV_CHANNELS; ch++) {
+			err = fabs(msv.value[ch] - carrier * NOMINAL);
+			*worst = err > *worst ? err : *worst;
+		}
+	}
+}
+
+int main(void)
+{
+	double worst_off = 0, worst_on = 0;
+	uint32_t value[PQM_MSV_CHANNELS];
+	uint32_t i, bad = 0;
+	uint64_t ms, first;
+
+	pqm_msv_init(&msv, FS, WINDOW, CARRIER);
+	pqm_msv_set_trigger(&msv, NOMINAL, 1, REC_LEN);
+
+	/* No carrier: the fundamental and harmonics do not leak into its bin */
+	feed(2 * FS, 0, &worst_off);
+	PQM_CHECK(msv.state == PQM_MSV_IDLE, "triggered without a carrier");
+
+	/* A 2% carrier for 12 s starts a 10 s record on its first window */
+	feed(12 * FS, 0.02, &worst_on);
+	PQM_CHECK(msv.state == PQM_MSV_DONE, "state %u", msv.state);
+	PQM_CHECK(msv.rec_start_ms == 2200, "record starts at %llu ms",
+		  (unsigned long long)msv.rec_start_ms);
+	feed(2 * FS, 0, &worst_off);
+
+	printf("carrier rms error: %.1f codes without, %.1f codes with a carrier "
+	       "(%.4f%% of nominal)\n", worst_off, worst_on,
+	       worst_on / NOMINAL * 100);
+	PQM_CHECK(worst_off < 1e-4 * NOMINAL, "leak of %.0f codes", worst_off);
+	PQM_CHECK(worst_on < 1e-3 * 0.02 * NOMINAL, "carrier off by %.0f codes",
+		  worst_on);
+
+	/* A restart, e.g. a new sampling rate, keeps the unread record and time */
+	pqm_msv_init(&msv, FS, WINDOW, CARRIER);
+	PQM_CHECK(msv.state == PQM_MSV_DONE && msv.now == t,
+		  "restart lost the record or the time");
+
+	for (i = 0, first = 0; pqm_msv_read(&msv, value, &ms); i++) {
+		if (!i)
+			first = ms;
+		bad += ms != first + i * 200;
+		bad += value[0] < 0.019 * NOMINAL || value[0] > 0.021 * NOMINAL;
+	}
+	PQM_CHECK(i == REC_LEN && first == 2200 && !bad,
+		  "read %u windows from %llu ms, %u bad", i,
+		  (unsigned long long)first, bad);
+
+	/* A record in progress is dropped by a restart, then starts again */
+	feed(FS, 0.02, &worst_on);
+	PQM_CHECK(msv.state == PQM_MSV_RECORDING, "state %u", msv.state);
+	pqm_msv_init(&msv, FS, WINDOW, CARRIER);
+	PQM_CHECK(msv.state == PQM_MSV_IDLE, "record kept across restart");
+	feed(FS, 0.02, &worst_on);
+	PQM_CHECK(msv.state == PQM_MSV_RECORDING &&
+		  msv.rec_start_ms == (uint64_t)(t - FS + WINDOW) * 1000 / FS,
+		  "record restarted at %llu ms",
+		  (unsigned long long)msv.rec_start_ms);
+
+	return pqm_test_result("test_msv");
+}
@@ -0,0 +1,154 @@
+/**
+ * @file test_pp.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Ping-pong capture against a simulated producer.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_pp.h"
+
+#define CHANNELS 7
+#define HALF_SCANS 1024
+#define SCANS 2000000u
+
+static uint32_t halves[2][HALF_SCANS * CHANNELS];
+static uint32_t copy[HALF_SCANS * CHANNELS];
+
+/**
+ * @brief Run a buffer session: the acquisition produces bursts of numbered
+ * scans and the client takes every half that is ready in between, checking
+ * that each one holds consecutive scans of the enabled channels.
+ * @param mask - enabled channels.
+ * @param burst - longest burst of the producer, in scans.
+ */
+static void session(uint32_t mask, uint32_t burst)
+{
+	struct pqm_ping_pong pp;
+	uint32_t scan[CHANNELS];
+	uint8_t idx[CHANNELS];
+	uint32_t cnt = 0, produced = 0, taken = 0, bad = 0;
+	uint32_t next = 0, first, n, i, ch;
+	uint32_t *half;
+
+	for (ch = 0; ch < CHANNELS; ch++)
+		if (mask & (1u << ch))
+			idx[cnt++] = ch;
+
+	pqm_pp_init(&pp, halves[0], halves[1], HALF_SCANS * CHANNELS);
+	pqm_pp_arm(&pp, HALF_SCANS, cnt);
+	while (produced < SCANS) {
+		for (n = 1 + rand() % burst; n; n--, produced++) {
+			for (ch = 0; ch < CHANNELS; ch++)
+				scan[ch] = produced * CHANNELS + ch;
+			pqm_pp_produce(&pp, scan, idx);
+		}
+		if (pp.state[pp.rd] != PQM_PP_READY)
+			continue;
+
+		half = pqm_pp_take(&pp);
+		PQM_CHECK(half == halves[0] || half == halves[1],
+			  "half not handed by pointer");
+		first = half[0] / CHANNELS;
+		/* Scans are only dropped while both halves are busy */
+		PQM_CHECK(first >= next, "half starts at %u, expected %u", first,
+			  next);
+		for (i = 0; i < HALF_SCANS; i++)
+			for (ch = 0; ch < cnt; ch++)
+				bad += half[i * cnt + ch] !=
+				       (first + i) * CHANNELS + idx[ch];
+		next = first + HALF_SCANS;
+		taken += HALF_SCANS;
+	}
+
+	PQM_CHECK(!bad, "mask 0x%02x: %u wrong samples", mask, bad);
+	/* Everything is taken, dropped, or still in the acquisition halves */
+	PQM_CHECK(taken + pp.overruns <= produced &&
+		  produced - taken - pp.overruns <= 2 * HALF_SCANS,
+		  "mask 0x%02x: %u produced, %u taken, %u dropped", mask,
+		  produced, taken, pp.overruns);
+	PQM_CHECK(!pp.underruns, "client waited for a half");
+	printf("mask 0x%02x, bursts up to %4u scans: %u halves, %u scans dropped\n",
+	       mask, burst, taken / HALF_SCANS, pp.overruns);
+}
+
+int main(void)
+{
+	struct pqm_ping_pong pp;
+	uint64_t t0, t_take, t_copy;
+	uint32_t scan[CHANNELS] = {0};
+	const uint8_t idx[CHANNELS] = {0, 1, 2, 3, 4, 5, 6};
+	uint32_t *half = NULL;
+	uint32_t i, r;
+
+	srand(1);
+	/* Client polling between short bursts, then a much slower client */
+	session(0x7F, 64);
+	session(0x15, 64);
+	session(0x7F, 4096);
+	session(0x01, 4096);
+
+	/* Nothing is handed over before a half is complete, nor waited for */
+	pqm_pp_init(&pp, halves[0], halves[1], HALF_SCANS * CHANNELS);
+	pqm_pp_arm(&pp, HALF_SCANS, CHANNELS);
+	PQM_CHECK(!pqm_pp_take(&pp), "empty half taken");
+	for (i = 0; i < HALF_SCANS - 1; i++)
+		pqm_pp_produce(&pp, scan, idx);
+	PQM_CHECK(!pqm_pp_take(&pp), "incomplete half taken");
+	pqm_pp_produce(&pp, scan, idx);
+	PQM_CHECK(pqm_pp_take(&pp) == halves[0], "complete half not taken");
+
+	/* A refill is a pointer swap instead of a copy of the half */
+	pqm_pp_init(&pp, halves[0], halves[1], HALF_SCANS * CHANNELS);
+	pqm_pp_arm(&pp, HALF_SCANS, CHANNELS);
+	t_take = 0;
+	t_copy = 0;
+	for (r = 0; r < 1000; r++) {
+		for (i = 0; i < HALF_SCANS; i++)
+			pqm_pp_produce(&pp, scan, idx);
+		t0 = pqm_test_ns();
+		half = pqm_pp_take(&pp);
+		t_take += pqm_test_ns() - t0;
+		t0 = pqm_test_ns();
+		memcpy(copy, half, sizeof(copy));
+		__asm__ volatile("" : : "r"(copy) : "memory");
+		t_copy += pqm_test_ns() - t0;
+	}
+	printf("refill of %zu bytes: %.0f ns by pointer, %.0f ns by copy\n",
+	       sizeof(copy), t_take / 1000.0, t_copy / 1000.0);
+
+	return pqm_test_result("test_pp");
+}
@@ -0,0 +1,135 @@
+/**
+ * @file test_ring.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Two thread stress test of the scan ring.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "pqm_test.h"
+#include "pqm_ring.h"
+
+#define CHANNELS 7
+#define RING_SCANS 256
+#define SCANS 10000000u
+
+static uint32_t ring_buff[RING_SCANS * CHANNELS];
+static struct pqm_ring ring;
+static volatile bool producer_done;
+static bool lossless;
+static uint32_t pushed;
+
+/* Acquisition side: numbered scans, as fast as possible */
+static void *producer(void *arg)
+{
+	uint32_t scan[CHANNELS];
+	uint32_t i, ch;
+
+	for (i = 0; i < SCANS; i++) {
+		for (ch = 0; ch < CHANNELS; ch++)
+			scan[ch] = i * CHANNELS + ch;
+		while (!pqm_ring_push(&ring, scan) && lossless)
+			sched_yield();
+		pushed = i + 1 - ring.overruns * !lossless;
+	}
+	__atomic_store_n(&producer_done, true, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+/**
+ * @brief Run the acquisition and a client on two threads and check every
+ * scan the client gets.
+ * @param keep_all - the producer waits for room instead of dropping scans.
+ */
+static void run(bool keep_all)
+{
+	static uint32_t dst[RING_SCANS * CHANNELS];
+	const uint8_t idx[CHANNELS] = {0, 1, 2, 3, 4, 5, 6};
+	uint32_t popped = 0, gaps = 0, torn = 0, order = 0;
+	uint32_t n, i, ch, seq, next = 0;
+	pthread_t thread;
+	bool done;
+
+	pqm_ring_init(&ring, ring_buff, RING_SCANS, CHANNELS);
+	/* Free running counters wrap early in the run */
+	ring.head = ring.tail = UINT32_MAX - 1000;
+	lossless = keep_all;
+	producer_done = false;
+	pushed = 0;
+
+	pthread_create(&thread, NULL, producer, NULL);
+	do {
+		done = __atomic_load_n(&producer_done, __ATOMIC_ACQUIRE);
+		/* IIO side: refills of random size */
+		n = pqm_ring_pop(&ring, idx, CHANNELS, dst,
+				 1 + rand() % RING_SCANS);
+		if (!n)
+			sched_yield();
+		for (i = 0; i < n; i++) {
+			seq = dst[i * CHANNELS] / CHANNELS;
+			for (ch = 0; ch < CHANNELS; ch++)
+				torn += dst[i * CHANNELS + ch] != seq * CHANNELS + ch;
+			/* Scans may be dropped when the ring is full, never reordered */
+			order += seq < next;
+			gaps += seq > next;
+			next = seq + 1;
+		}
+		popped += n;
+	} while (n || !done);
+	pthread_join(thread, NULL);
+
+	printf("%s: %u scans popped, %u overruns, %u gaps\n",
+	       keep_all ? "lossless" : "lossy", popped, ring.overruns, gaps);
+	PQM_CHECK(!torn, "%u torn scans", torn);
+	PQM_CHECK(!order, "%u scans out of order", order);
+	PQM_CHECK(pushed == popped, "pushed %u popped %u", pushed, popped);
+	PQM_CHECK(!pqm_ring_level(&ring), "ring not empty");
+	if (keep_all)
+		PQM_CHECK(popped == SCANS && !gaps, "%u scans lost", SCANS - popped);
+	else
+		PQM_CHECK(popped + ring.overruns == SCANS, "%u scans lost silently",
+			  SCANS - popped - ring.overruns);
+}
+
+int main(void)
+{
+	srand(1);
+	run(true);
+	run(false);
+
+	return pqm_test_result("test_ring");
+}
@@ -0,0 +1,194 @@
+/**
+ * @file test_rms.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Accuracy of the RMS and power engine against a double reference.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include "pqm_test.h"
+#include "pqm_rms.h"
+
+#define FS 8000.0
+/* 10 cycles at 50 Hz, 12 at 60 Hz */
+#define WINDOW 1600
+#define WINDOWS 20
+
+/* Signal of one channel: fundamental, 5th harmonic, offset and noise */
+struct sig {
+	double amp;
+	double phase;
+	double h5;
+	double dc;
+	uint32_t noise;
+};
+
+/**
+ * @brief Feed whole windows and compare every published value with the RMS
+ * and powers computed in double over the same quantized samples.
+ * @param f - fundamental, Hz.
+ * @param quarter - quarter cycle delay handed to the engine, scans Q16.
+ * @param s - the 7 channels.
+ * @param name - case name for the report.
+ */
+static void run(double f, uint32_t quarter, const struct sig *s,
+		const char *name)
+{
+	static struct pqm_rms rms;
+	/* Window sums reach 2^57, beyond the 53 bit mantissa of a double */
+	long double sum[PQM_RMS_CHANNELS], p[PQM_RMS_PHASES];
+	double ref, err, worst = 0, worst_p = 0, worst_q = 0;
+	double ref_s, ref_q;
+	uint32_t scan[PQM_RMS_CHANNELS];
+	struct pqm_power pw;
+	uint32_t n, w, ch, ph, windows = 0;
+	double t, v[PQM_RMS_CHANNELS];
+	int32_t x;
+
+	pqm_rms_init(&rms, WINDOW, quarter);
+	for (w = 0; w < WINDOWS; w++) {
+		for (ch = 0; ch < PQM_RMS_CHANNELS; ch++)
+			sum[ch] = 0;
+		for (ph = 0; ph < PQM_RMS_PHASES; ph++)
+			p[ph] = 0;
+		for (n = 0; n < WINDOW; n++) {
+			t = 2 * M_PI * f * (w * WINDOW + n) / FS;
+			for (ch = 0; ch < PQM_RMS_CHANNELS; ch++) {
+				v[ch] = s[ch].amp * sin(t - s[ch].phase) +
+					s[ch].h5 * sin(5 * (t - s[ch].phase)) +
+					s[ch].dc;
+				if (s[ch].noise)
+					v[ch] += rand() % s[ch].noise -
+						 s[ch].noise / 2.0;
+				scan[ch] = pqm_test_code(v[ch]);
+				x = pqm_sample_value(scan[ch]);
+				sum[ch] += (long double)x * x;
+			}
+			for (ph = 0; ph < PQM_RMS_PHASES; ph++)
+				p[ph] += (long double)pqm_sample_value(scan[ph]) *
+					 pqm_sample_value(scan[ph + 3]);
+			if (!pqm_rms_update(&rms, scan))
+				continue;
+
+			PQM_CHECK(n == WINDOW - 1, "%s: window ends at %u", name, n);
+			windows++;
+			for (ch = 0; ch < PQM_RMS_CHANNELS; ch++) {
+				ref = sqrtl(sum[ch] / WINDOW);
+				/* Rounded root of the truncated mean square */
+				err = fabs(rms.value[ch] - ref);
+				worst = err > worst ? err : worst;
+			}
+			pqm_rms_power(&rms, &pw);
+			/* The first window runs with an empty delay line */
+			if (!w)
+				continue;
+			for (ph = 0; ph < PQM_RMS_PHASES; ph++) {
+				ref_s = s[ph].amp * s[ph + 3].amp / 2;
+				ref_q = ref_s * sin(s[ph + 3].phase - s[ph].phase);
+				err = fabsl(pw.p[ph] - p[ph] / WINDOW);
+				worst_p = err > worst_p ? err : worst_p;
+				if (!quarter)
+					continue;
+				err = fabs(pw.q[ph] - ref_q) / ref_s;
+				worst_q = err > worst_q ? err : worst_q;
+			}
+		}
+	}
+
+	printf("%-28s rms %.3f codes  p %.3f codes^2  q %.2e of S\n", name,
+	       worst, worst_p, worst_q);
+	PQM_CHECK(windows == WINDOWS, "%s: %u windows", name, windows);
+	PQM_CHECK(worst <= 0.5 + 1e-6, "%s: rms off by %.3f codes", name, worst);
+	PQM_CHECK(worst_p < 1, "%s: p off by %.3f codes^2", name, worst_p);
+	/* Interpolated delay, the 5th harmonic is not in quadrature */
+	PQM_CHECK(worst_q < 2e-3, "%s: q off by %.2e of S", name, worst_q);
+}
+
+int main(void)
+{
+	const double fs = 0x7FFFFF;
+	struct sig s[PQM_RMS_CHANNELS];
+	uint64_t x, r;
+	uint32_t i, ch, bad = 0;
+	long double root;
+
+	/* Rounded integer root over the whole 64 bit range */
+	srand(1);
+	for (i = 0; i < 1000000; i++) {
+		x = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ rand();
+		x >>= rand() % 64;
+		r = pqm_isqrt64(x);
+		root = sqrtl((long double)x);
+		bad += fabsl(r - root) > 0.5L;
+	}
+	r = pqm_isqrt64(UINT64_MAX);
+	PQM_CHECK(!bad && r == UINT32_MAX, "isqrt64: %u bad, max %llu", bad,
+		  (unsigned long long)r);
+
+	/* Clean full scale sines, currents lagging by 30 degrees */
+	for (ch = 0; ch < PQM_RMS_CHANNELS; ch++)
+		s[ch] = (struct sig) {
+			.amp = fs * (ch < 3 ? 0.95 : 0.5),
+			.phase = (ch % 3) * 2 * M_PI / 3 + (ch >= 3) * M_PI / 6,
+		};
+	run(50, 40 << 16, s, "50 Hz full scale");
+	/* 60 Hz: the quarter cycle is 33 1/3 scans */
+	run(60, (uint32_t)(FS / 240 * 65536), s, "60 Hz full scale");
+
+	/* 0.1% of full scale, offset, harmonics and noise */
+	for (ch = 0; ch < PQM_RMS_CHANNELS; ch++) {
+		s[ch].amp = fs * 1e-3;
+		s[ch].h5 = s[ch].amp * 0.05;
+		s[ch].dc = 37;
+		s[ch].noise = 16;
+	}
+	run(50, 0, s, "50 Hz 0.1%, h5, dc, noise");
+
+	/* Largest window the sums hold: 2^17 full scale samples */
+	{
+		static struct pqm_rms rms;
+		uint32_t scan[PQM_RMS_CHANNELS];
+
+		pqm_rms_init(&rms, 1 << 17, 0);
+		for (ch = 0; ch < PQM_RMS_CHANNELS; ch++)
+			scan[ch] = pqm_test_code(-8388608.0);
+		for (i = 0; i < (1 << 17) - 1; i++)
+			pqm_rms_update(&rms, scan);
+		PQM_CHECK(pqm_rms_update(&rms, scan) &&
+			  rms.value[6] == 8388608, "2^17 window: %u",
+			  rms.value[6]);
+	}
+
+	return pqm_test_result("test_rms");
+}
@@ -0,0 +1,158 @@
+/**
+ * @file test_sdft.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Long run drift test of the sliding DFT phasor estimator.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "pqm_test.h"
+#include "pqm_sdft.h"
+
+#define FS 8000
+#define F_NOM 50
+#define LEN (FS / F_NOM)
+/* Days of scans at 8 kS/s */
+#define SCANS 1000000000ull
+/* Scans between two checks of the accumulators */
+#define CHECK_EVERY (1u << 20)
+/* The signal repeats after 101 cycles, noise included */
+#define TABLE (101 * LEN)
+/* Scan the accumulators are corrupted at, midway between two rebuilds */
+#define CORRUPT_AT (3ull * LEN * PQM_SDFT_ANCHOR_CYCLES / 2)
+
+static struct pqm_sdft sdft;
+static uint32_t sig[TABLE][PQM_SDFT_CHANNELS];
+
+/* Amplitude in codes and phase in degrees of every channel */
+static const double amp[PQM_SDFT_CHANNELS] = {
+	5e6, 5e6, 5e6, 2e6, 2e6, 2e6, 1e6
+};
+static const double phase[PQM_SDFT_CHANNELS] = {
+	0, -120, 120, -30, -150, 90, 45
+};
+
+/**
+ * @brief Compare the accumulators with a sum over the delay line.
+ * @return true if every accumulator matches exactly.
+ */
+static bool sdft_exact(void)
+{
+	int64_t re, im;
+	uint32_t i, ch;
+
+	for (ch = 0; ch < PQM_SDFT_CHANNELS; ch++) {
+		re = 0;
+		im = 0;
+		for (i = 0; i < sdft.len; i++) {
+			re += (int64_t)sdft.x[i][ch] * sdft.cos[i];
+			im -= (int64_t)sdft.x[i][ch] * sdft.sin[i];
+		}
+		if (re != sdft.acc[ch][0] || im != sdft.acc[ch][1])
+			return false;
+	}
+
+	return true;
+}
+
+int main(void)
+{
+	uint32_t i, ch, idx = 0, anchors = 0, checks = 0, mismatches = 0;
+	double mag, ang, err, worst_ang = 0, worst_mag = 0, ref0;
+	int64_t ph[PQM_SDFT_CHANNELS][2];
+	bool corrupt = false;
+	uint64_t n, t0;
+
+	srand(1);
+	for (i = 0; i < TABLE; i++)
+		for (ch = 0; ch < PQM_SDFT_CHANNELS; ch++)
+			sig[i][ch] = pqm_test_code(amp[ch] *
+						   cos(2 * M_PI * i / LEN +
+						       phase[ch] * M_PI / 180) +
+						   rand() % 2001 - 1000);
+
+	pqm_sdft_init(&sdft, FS, F_NOM);
+	PQM_CHECK(sdft.len == LEN, "%u scans per cycle", sdft.len);
+
+	t0 = pqm_test_ns();
+	for (n = 0; n < SCANS; n++) {
+		pqm_sdft_feed(&sdft, sig[idx]);
+		if (++idx == TABLE)
+			idx = 0;
+
+		if (!sdft.pos && sdft.anchor == PQM_SDFT_ANCHOR_CYCLES) {
+			/* Just rebuilt, a corrupted value must be gone */
+			anchors++;
+			corrupt = false;
+			PQM_CHECK(sdft_exact(), "scan %llu: rebuild is off",
+				  (unsigned long long)n);
+		} else if (!(n % CHECK_EVERY)) {
+			/* In between, a corrupted value must persist as is */
+			checks++;
+			if (sdft_exact() == corrupt)
+				mismatches++;
+		}
+
+		if (n == CORRUPT_AT) {
+			sdft.acc[0][0] += 12345;
+			corrupt = true;
+		}
+	}
+	printf("%llu scans in %.1f s, %u rebuilds, %u checks\n",
+	       (unsigned long long)SCANS, (pqm_test_ns() - t0) * 1e-9,
+	       anchors, checks);
+	PQM_CHECK(anchors == SCANS / LEN / PQM_SDFT_ANCHOR_CYCLES,
+		  "%u rebuilds", anchors);
+	PQM_CHECK(!mismatches, "%u of %u checks off", mismatches, checks);
+	PQM_CHECK(sdft_exact(), "accumulators drifted");
+
+	/* Phasors after the run, against the signal in the delay line */
+	pqm_sdft_phasors(&sdft, ph);
+	ref0 = atan2(ph[0][1], ph[0][0]);
+	for (ch = 0; ch < PQM_SDFT_CHANNELS; ch++) {
+		mag = hypot(ph[ch][0], ph[ch][1]) / (LEN * 16383.5);
+		err = fabs(mag / amp[ch] - 1);
+		worst_mag = err > worst_mag ? err : worst_mag;
+		ang = (atan2(ph[ch][1], ph[ch][0]) - ref0) * 180 / M_PI;
+		err = fabs(remainder(ang - phase[ch], 360));
+		worst_ang = err > worst_ang ? err : worst_ang;
+	}
+	printf("after the run: magnitude off by %.2e, angle by %.4f deg\n",
+	       worst_mag, worst_ang);
+	PQM_CHECK(worst_mag < 1e-3, "magnitude off by %.2e", worst_mag);
+	PQM_CHECK(worst_ang < 0.01, "angle off by %.4f deg", worst_ang);
+
+	return pqm_test_result("test_sdft");
+}
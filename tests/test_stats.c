@@ -0,0 +1,180 @@
+/**
+ * @file test_stats.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Weekly percentiles against exact ones over random weeks.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include <stdlib.h>
+#include "pqm_test.h"
+#include "pqm_stats.h"
+#include "pqm_rms.h"
+
+#define WEEKS 500
+/* Samples taken in a 10 min interval, at most */
+#define SAMPLES 4
+
+static struct pqm_stats st;
+static uint32_t week[PQM_STATS_SERIES][PQM_STATS_WEEK];
+
+static const uint32_t pct[PQM_STATS_QUANTILES] = {95, 99};
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Draw a sample of a series. Every week uses another shape, among
+ * them ties, monotonic runs and heavy tails.
+ * @param w - week.
+ * @param s - series.
+ * @param i - interval in the week.
+ * @return the sample.
+ */
+static uint32_t draw(uint32_t w, uint32_t s, uint32_t i)
+{
+	double u = (double)rand() / RAND_MAX;
+
+	switch ((w + s) % 6) {
+	case 0:
+		return rand() % 0x7FFFFF;
+	case 1:
+		/* Few distinct values */
+		return 230 + rand() % 4;
+	case 2:
+		return i * 1000;
+	case 3:
+		return (PQM_STATS_WEEK - i) * 1000;
+	case 4:
+		/* Heavy tail */
+		return lround(100 / (u + 1e-4));
+	default:
+		return lround(4e6 + 1e5 * sin(i * 0.37) + 1e4 * u);
+	}
+}
+
+/**
+ * @brief Exact nearest rank percentile of a series.
+ * @param v - values, sorted on return.
+ * @param n - number of values.
+ * @param p - percentile, in percent.
+ * @return the percentile, zero without any value.
+ */
+static uint32_t exact(uint32_t *v, uint32_t n, uint32_t p)
+{
+	if (!n)
+		return 0;
+	qsort(v, n, sizeof(*v), cmp_u32);
+
+	return v[(n * p + 99) / 100 - 1];
+}
+
+int main(void)
+{
+	uint32_t n[PQM_STATS_SERIES], w, i, s, k, j, cnt, x, want, got;
+	uint32_t wrong = 0, checked = 0, flagged;
+	bool flag, done;
+	uint64_t sum;
+
+	srand(1);
+	pqm_stats_init(&st);
+	for (w = 0; w < WEEKS; w++) {
+		for (s = 0; s < PQM_STATS_SERIES; s++)
+			n[s] = 0;
+		flagged = 0;
+		for (i = 0; i < PQM_STATS_WEEK; i++) {
+			/* A few intervals overlap events and are left out */
+			flag = rand() % 50 == 0;
+			flagged += flag;
+			for (s = 0; s < PQM_STATS_SERIES; s++) {
+				/* A stage that did not run has no sample */
+				cnt = rand() % (SAMPLES + 1);
+				sum = 0;
+				for (j = 0; j < cnt; j++) {
+					x = draw(w, s, i);
+					sum += (uint64_t)x * x;
+					pqm_stats_sample(&st, s, x);
+				}
+				if (cnt && !flag)
+					week[s][n[s]++] = pqm_isqrt64(sum / cnt);
+			}
+			done = pqm_stats_interval(&st, flag);
+			PQM_CHECK(done == (i == PQM_STATS_WEEK - 1),
+				  "week %u: interval %u closed the week", w, i);
+
+			/* The current week so far, at a few points */
+			if (i % 337 != 100)
+				continue;
+			for (s = 0; s < PQM_STATS_SERIES; s++) {
+				for (k = 0; k < PQM_STATS_QUANTILES; k++) {
+					got = pqm_stats_value(&st, s, k);
+					want = exact(week[s], n[s], pct[k]);
+					checked++;
+					wrong += got != want;
+				}
+			}
+		}
+
+		PQM_CHECK(st.weeks == w + 1 && st.last_flagged == flagged,
+			  "week %u: %u weeks, %u flagged", w, st.weeks,
+			  st.last_flagged);
+		for (s = 0; s < PQM_STATS_SERIES; s++) {
+			/* Partial coverage shows in the value count */
+			PQM_CHECK(st.last_count[s] == n[s],
+				  "week %u series %u: %u values, not %u", w, s,
+				  st.last_count[s], n[s]);
+			for (k = 0; k < PQM_STATS_QUANTILES; k++) {
+				got = st.last[s][k];
+				want = exact(week[s], n[s], pct[k]);
+				checked++;
+				if (got == want)
+					continue;
+				if (!wrong)
+					printf("week %u series %u p%u: %u instead of %u\n",
+					       w, s, pct[k], got, want);
+				wrong++;
+			}
+		}
+	}
+
+	printf("%u weeks, %u percentiles checked, %u off\n", WEEKS, checked,
+	       wrong);
+	/* Only the top values are kept, but the percentiles are exact */
+	PQM_CHECK(!wrong, "%u of %u percentiles off", wrong, checked);
+
+	return pqm_test_result("test_stats");
+}
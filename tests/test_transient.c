@@ -0,0 +1,251 @@
+/**
+ * @file test_transient.c
+ * @author Andrei-Dan Danila (andrei.danila@analog.com)
+ * @brief Impulse detection, replay suppression and frequency tracking of the transient detector.
+********************************************************************************
+ * Copyright 2023(c) Analog Devices, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  - Neither the name of Analog Devices, Inc. nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *  - The use of this software may or may not infringe the patent rights
+ *    of one or more patent holders.  This license does not release you
+ *    from the requirement that you obtain separate licenses from these
+ *    patent holders to use this software.
+ *  - Use of the software either in source or binary form, must be run
+ *    on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT,
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, INTELLECTUAL PROPERTY RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+#include "pqm_test.h"
+#include "no_os_util.h"
+#include "pqm_transient.h"
+
+#define FS 8000
+#define F_NOM 50
+/* Fundamental amplitude, in codes */
+#define AMP 3000000.0
+/* Thresholds, relative to the amplitude */
+#define LEVEL 0.02
+#define SLOPE 0.10
+
+static struct pqm_transient_engine tr;
+
+/* Disturbance added to the waveform */
+struct impulse {
+	uint32_t at;
+	uint8_t channels;
+	uint32_t width;
+	double level;
+	/* Rises and falls linearly over the width instead of a rectangle */
+	bool slow;
+	/* Detectors that must trigger */
+	uint8_t kinds;
+};
+
+#define CYC (1u << PQM_TRANSIENT_CYCLE)
+#define DVDT (1u << PQM_TRANSIENT_DVDT)
+
+static const struct impulse impulses[] = {
+	/* Single sample spikes, both polarities */
+	{4000, 0x01, 1, 0.50, false, CYC | DVDT},
+	{4400, 0x02, 1, -0.20, false, CYC | DVDT},
+	/* Notch over a few samples, on two phases */
+	{5013, 0x06, 4, -0.30, false, CYC | DVDT},
+	/* Longer rectangle on a current */
+	{6007, 0x08, 16, 0.40, false, CYC | DVDT},
+	/* Oscillatory bump too slow for the slope detector */
+	{7003, 0x10, 40, 0.10, true, CYC},
+	/* Neutral, level detection disabled: only the slope sees it */
+	{8500, 0x40, 2, 0.60, false, DVDT},
+	/* All channels at once */
+	{9501, 0x7F, 3, 0.25, false, CYC | DVDT},
+};
+
+/**
+ * @brief Disturbance of a channel at a scan.
+ * @param imp - impulses.
+ * @param nb - number of impulses.
+ * @param n - scan.
+ * @param ch - channel.
+ * @return the disturbance, relative to the amplitude.
+ */
+static double disturbance(const struct impulse *imp, uint32_t nb, uint32_t n,
+			  uint32_t ch)
+{
+	double d = 0, x;
+	uint32_t i;
+
+	for (i = 0; i < nb; i++) {
+		if (!(imp[i].channels & (1u << ch)) || n < imp[i].at ||
+		    n >= imp[i].at + imp[i].width)
+			continue;
+		x = (double)(n - imp[i].at) / imp[i].width;
+		d += imp[i].slow ? imp[i].level * sin(M_PI * x) : imp[i].level;
+	}
+
+	return d;
+}
+
+/**
+ * @brief Feed a harmonic rich waveform with impulses to the detector.
+ * @param t - transient engine.
+ * @param f - fundamental frequency in Hz.
+ * @param from - first scan.
+ * @param to - scan after the last one.
+ * @param imp - impulses.
+ * @param nb - number of impulses.
+ */
+static void drive(struct pqm_transient_engine *t, double f, uint32_t from,
+		  uint32_t to, const struct impulse *imp, uint32_t nb)
+{
+	uint32_t scan[PQM_TRANSIENT_CHANNELS];
+	uint32_t period = lrint(FS * 65536.0 / f);
+	uint32_t n, ch;
+	double w, v;
+
+	for (n = from; n < to; n++) {
+		for (ch = 0; ch < PQM_TRANSIENT_CHANNELS; ch++) {
+			w = 2 * M_PI * f * n / FS - ch * 2 * M_PI / 3;
+			v = sin(w) + 0.10 * sin(5 * w) + 0.05 * sin(7 * w + 1);
+			scan[ch] = pqm_test_code(AMP * (v + disturbance(imp, nb,
+						 n, ch)));
+		}
+		pqm_transient_track(t, period);
+		pqm_transient_feed(t, scan);
+	}
+}
+
+/**
+ * @brief Match the detected transients with the impulses, one each.
+ * @param name - scenario.
+ * @param imp - impulses.
+ * @param nb - number of impulses.
+ */
+static void expect(const char *name, const struct impulse *imp, uint32_t nb)
+{
+	struct pqm_transient t;
+	uint32_t i = 0, start;
+	double a;
+
+	while (pqm_transient_pop(&tr, &t)) {
+		if (i >= nb) {
+			PQM_CHECK(0, "%s: spurious transient at %llu us on 0x%x",
+				  name, (unsigned long long)t.start_us,
+				  t.channels);
+			continue;
+		}
+		a = fabs(imp[i].level) * AMP;
+		/* The slow bump crosses the level threshold after its start */
+		start = imp[i].at * (1000000 / FS);
+		PQM_CHECK(imp[i].slow ? t.start_us >= start &&
+			  t.start_us < start + imp[i].width * 1000000 / FS :
+			  t.start_us == start,
+			  "%s: impulse %u starts at %llu us, not %u", name, i,
+			  (unsigned long long)t.start_us, start);
+		PQM_CHECK(t.duration_us <= (imp[i].width + 1) * 1000000 / FS,
+			  "%s: impulse %u lasts %u us", name, i,
+			  t.duration_us);
+		PQM_CHECK(t.channels == imp[i].channels,
+			  "%s: impulse %u on 0x%x, not 0x%x", name, i,
+			  t.channels, imp[i].channels);
+		PQM_CHECK(t.kinds == imp[i].kinds,
+			  "%s: impulse %u kinds 0x%x, not 0x%x", name, i,
+			  t.kinds, imp[i].kinds);
+		if (imp[i].kinds & CYC)
+			PQM_CHECK(fabs(t.peak - a) < 0.01 * AMP,
+				  "%s: impulse %u peak %u, not %.0f", name, i,
+				  t.peak, a);
+		if (imp[i].kinds & DVDT)
+			PQM_CHECK(fabs(t.slope - a) < SLOPE * AMP,
+				  "%s: impulse %u slope %u, not %.0f", name, i,
+				  t.slope, a);
+		i++;
+	}
+	PQM_CHECK(i == nb, "%s: %u of %u impulses detected", name, i, nb);
+}
+
+int main(void)
+{
+	const uint32_t nb = NO_OS_ARRAY_SIZE(impulses);
+	static struct impulse burst[40];
+	struct pqm_transient t;
+	uint32_t ch, i, end;
+
+	pqm_transient_init(&tr, FS, F_NOM);
+	for (ch = 0; ch < PQM_TRANSIENT_CHANNELS; ch++)
+		pqm_transient_set_thr(&tr, ch, ch == 6 ? 0 : LEVEL * AMP,
+				      SLOPE * AMP);
+
+	/*
+	 * Nominal frequency: every impulse once, no replay a cycle later and
+	 * nothing on the harmonics alone
+	 */
+	drive(&tr, F_NOM, 0, 12000, impulses, nb);
+	expect("50 Hz", impulses, nb);
+
+	/*
+	 * Off nominal, the interpolated cycle keeps the harmonics quiet. The
+	 * waveform jumps in phase, the engine is restarted as on a frequency
+	 * change
+	 */
+	pqm_transient_init(&tr, FS, F_NOM);
+	drive(&tr, 50.5, 12000, 24000, NULL, 0);
+	expect("50.5 Hz quiet", NULL, 0);
+	pqm_transient_init(&tr, FS, F_NOM);
+	drive(&tr, 49.3, 24000, 36000, NULL, 0);
+	expect("49.3 Hz quiet", NULL, 0);
+
+	/*
+	 * A restart keeps the time base and the thresholds: the impulses are
+	 * stamped from the start of the acquisition
+	 */
+	pqm_transient_init(&tr, FS, F_NOM);
+	for (i = 0; i < nb; i++) {
+		burst[i] = impulses[i];
+		burst[i].at += 36000;
+	}
+	drive(&tr, 50.5, 36000, 48000, burst, nb);
+	expect("restart", burst, nb);
+
+	/* More transients than the ring holds, the newest are dropped */
+	pqm_transient_init(&tr, FS, F_NOM);
+	end = 48000 + 400 * NO_OS_ARRAY_SIZE(burst);
+	for (i = 0; i < NO_OS_ARRAY_SIZE(burst); i++)
+		burst[i] = (struct impulse) {
+			48200 + 400 * i, 0x01, 1, 0.5, false, CYC | DVDT
+		};
+	drive(&tr, F_NOM, 48000, end, burst, NO_OS_ARRAY_SIZE(burst));
+	PQM_CHECK(tr.overruns == NO_OS_ARRAY_SIZE(burst) -
+		  PQM_TRANSIENT_RING_SIZE, "%u overruns", tr.overruns);
+	expect("overrun", burst, PQM_TRANSIENT_RING_SIZE);
+
+	/* Thresholds of zero, as shipped: nothing is detected */
+	for (i = 0; i < NO_OS_ARRAY_SIZE(burst); i++)
+		burst[i].at += end - 48000;
+	for (ch = 0; ch < PQM_TRANSIENT_CHANNELS; ch++)
+		pqm_transient_set_thr(&tr, ch, 0, 0);
+	drive(&tr, F_NOM, end, end + 12000, burst, NO_OS_ARRAY_SIZE(burst));
+	PQM_CHECK(!pqm_transient_pop(&tr, &t), "detected while disabled");
+
+	return pqm_test_result("test_transient");
+}